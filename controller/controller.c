@@ -1,61 +1,1842 @@
 #include "controller.h"
+#include <limits.h>
+#include <string.h>
+
+/* Commands of the single file, they are grayed while the merged files are shown */
+static const UINT fileCommands[] =
+{
+    IDM_FOLLOW, IDM_LAYOUT, IDM_FILTER, IDM_FIND, IDM_FINDNEXT, IDM_REGEX, IDM_NEXTMATCH, IDM_PREVMATCH,
+    IDM_STOPSEARCH, IDM_KEYWORDS, IDM_GOTO
+};
+
+static unsigned long lastSampleId = 0;  /* Identifier of the last started sampling of the timestamps */
 
 /*  Sets the mode of displaying text
 INPUT:
     controller_t *controller - pointer to an instance of a structure containing a model and a view
-    mode_t mode - mode of displaying text
+    mode_t mode - mode of displaying text
+*/
+void SetMode(controller_t *controller, mode_t mode)
+{
+    controller->View.Mode = mode;
+    if(mode == LAYOUT)
+        controller->View.HScrollPos = 0;
+}
+
+/*  Converts the memory budget in megabytes to bytes, a budget not fitting in
+    unsigned long is clamped
+INPUT:
+    const char *text - the number of megabytes
+RETURN:
+    unsigned long - the number of bytes
+*/
+static unsigned long ParseBudget(const char *text)
+{
+    unsigned long long megabytes = strtoull(text, NULL, 10);
+
+    if (megabytes > ULONG_MAX / (1024 * 1024))
+        return ULONG_MAX;
+
+    return (unsigned long)megabytes * 1024 * 1024;
+}
+
+/*  Initializes the controller
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+*/
+void InitController(controller_t *controller, HWND hwnd)
+{
+    char buffer[16];
+
+    /* The number of worker threads can be capped on shared machines */
+    if (GetEnvironmentVariable(THREADS_VARIABLE, buffer, sizeof(buffer)) > 0)
+        SetThreadPoolLimit(strtoul(buffer, NULL, 10));
+    if (GetEnvironmentVariable(LAYOUT_CACHE_VARIABLE, buffer, sizeof(buffer)) > 0)
+        SetLayoutCacheBudget(ParseBudget(buffer));
+    if (GetEnvironmentVariable(BLOCK_CACHE_VARIABLE, buffer, sizeof(buffer)) > 0)
+        SetBlockCacheBudget(ParseBudget(buffer));
+    if (GetEnvironmentVariable(INDEX_CACHE_VARIABLE, buffer, sizeof(buffer)) > 0)
+        SetIndexCacheBudget(ParseBudget(buffer));
+
+    controller->IsNotActive = 1;
+    InitModel(&controller->Model);
+    InitView(hwnd, &controller->View);
+
+    InitRelayoutScheduler(&controller->Scheduler);
+    InitLayout(&controller->NextLayout);
+    controller->Relayout = NULL;
+    controller->CancelRelayout = 0;
+    controller->RelayoutGeneration = 0;
+    controller->RelayoutColumns = 0;
+    controller->RelayoutWidth = 0;
+    controller->RelayoutHeight = 0;
+    controller->RelayoutWindow = hwnd;
+
+    controller->IsFollowing = 0;
+    InitFileWatcher(&controller->Watcher);
+
+    controller->Find.Dialog = NULL;
+    controller->Find.Message = RegisterWindowMessage(FINDMSGSTRING);
+    controller->Find.What[0] = '\0';
+    ZeroMemory(&controller->Find.Params, sizeof(controller->Find.Params));
+    controller->Find.Params.lStructSize = sizeof(controller->Find.Params);
+    controller->Find.Params.hwndOwner = hwnd;
+    controller->Find.Params.lpstrFindWhat = controller->Find.What;
+    controller->Find.Params.wFindWhatLen = sizeof(controller->Find.What);
+    controller->Find.Params.Flags = FR_DOWN | FR_HIDEWHOLEWORD;
+    controller->Find.Pattern[0] = '\0';
+    controller->Find.IsPatternCaseMatched = 0;
+    controller->Find.ShowFirstMatch = 0;
+    controller->Find.Keywords[0] = '\0';
+    controller->Find.IsKeywordCaseMatched = 0;
+    controller->Find.Filter[0] = '\0';
+    controller->Find.IsFilterRegex = 0;
+    controller->Find.IsFilterCaseMatched = 0;
+    controller->Find.GoTo[0] = '\0';
+    controller->Find.GoToKind = GO_TO_LINE;
+    controller->Find.Time[0] = '\0';
+    controller->Find.TimeFormat = TIME_ISO8601;
+    controller->Find.HasMatch = 0;
+    controller->Find.MatchOffset = 0;
+    controller->Find.MatchScrollPos = 0;
+    InitSearch(&controller->Search);
+    InitTimeIndex(&controller->Times);
+    InitTimeIndex(&controller->NextTimes);
+    controller->Sampler = NULL;
+    controller->CancelSampling = 0;
+    controller->SampleId = 0;
+    controller->SampleFormat = TIME_ISO8601;
+    controller->IsNextSampled = 0;
+    controller->IsTimePending = 0;
+    controller->SampleWindow = hwnd;
+    controller->IsMerged = 0;
+    InitMergedLog(&controller->Merge);
+}
+
+/*  Fills the model with data from the file, the lines are loaded in the background
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle which receives the loading progress
+    const char *filename - the name of the file from which the data is taken
+RETURN:
+    error_t - error code
+*/
+error_t ReadFileIntoModel(controller_t *controller, HWND hwnd, const char *filename)
+{
+    if (filename == NULL)
+        return NO_INPUT_FILE;
+
+    return (controller->IsNotActive = FillModel(&controller->Model, filename, hwnd));
+}
+
+/*  Sets the timer for the pending relayout or kills it if nothing can be started
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+*/
+static void SetRelayoutTimer(controller_t *controller, HWND hwnd)
+{
+    unsigned long delay = GetRelayoutDelay(&controller->Scheduler, GetTickCount());
+
+    if (delay == NO_RELAYOUT)
+        KillTimer(hwnd, RELAYOUT_TIMER);
+    else
+        SetTimer(hwnd, RELAYOUT_TIMER, delay > 0 ? delay : 1, NULL);
+}
+
+/*  Shows the lines loaded so far and refines the scrollbar range
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    WPARAM wParam - data that was sent to WndProc
+    LPARAM lParam - data that was sent to WndProc
+    HWND hwnd - data that was sent to WndProc
+RETURN:
+    error_t - error code
+*/
+error_t ModelProgress(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
+{
+    int isAtBottom;
+    int source;
+    error_t err;
+
+    /* Every merged file is loaded on its own, the rows of all of them are rebuilt */
+    if (controller->IsMerged)
+    {
+        source = FindMergedSource(&controller->Merge, (unsigned long)lParam);
+        if (controller->IsNotActive || source < 0)
+            return SUCCESS;
+        if (wParam && controller->Merge.Sources[source].Model.LoadError != SUCCESS)
+            return controller->Merge.Sources[source].Model.LoadError;
+
+        return SetRectSize(hwnd, controller, -1, -1);
+    }
+
+    /* The notification may come from the loading of a previously opened file */
+    if (controller->IsNotActive || (unsigned long)lParam != controller->Model.LoadId)
+        return SUCCESS;
+
+    if (wParam && controller->Model.LoadError != SUCCESS)
+        return controller->Model.LoadError;
+
+    /* In the follow mode the view at the bottom shows the new lines */
+    isAtBottom = controller->IsFollowing && IsViewAtBottom(&controller->View);
+    err = SetRectSize(hwnd, controller, -1, -1);
+    if (err == SUCCESS && isAtBottom)
+        SetVScroll(hwnd, &controller->View, controller->View.NumOfLines);
+
+    /* The finished search goes on with the new lines */
+    if (err == SUCCESS)
+        err = ContinueSearch(&controller->Search);
+
+    /* The used time index samples the lines while they are loaded, so the jump finds them ready */
+    if (err == SUCCESS && HasTimeIndex(&controller->Times))
+    {
+        LockModel(&controller->Model);
+        err = UpdateTimeIndex(&controller->Times, &controller->Model);
+        UnlockModel(&controller->Model);
+    }
+
+    /* The layout of the window width is built in the background once the file is loaded,
+       so switching to LAYOUT is a lookup. The shown rows are the lines themselves meanwhile */
+    if (err == SUCCESS && wParam && controller->View.Mode == DEFAULT)
+    {
+        if (RequestRelayout(&controller->Scheduler, controller->View.WindowWidth,
+                            controller->View.WindowHeight, GetTickCount()))
+            InterlockedExchange(&controller->CancelRelayout, 1);
+        SetRelayoutTimer(controller, hwnd);
+    }
+
+    return err;
+}
+
+/*  Converts the text of a dialog to the UTF-8 characters of the model
+INPUT:
+    const char *ansi - the text in the ANSI code page
+    char *text - buffer for the characters
+    int size - size of the buffer
+RETURN:
+    int - the number of characters, 0 if the text is empty or cannot be converted
+*/
+static int ConvertDialogText(const char *ansi, char *text, int size)
+{
+    wchar_t wide[KEYWORDS_TEXT_SIZE];
+    int length;
+
+    /* The keywords are the longest text of the dialogs */
+    length = MultiByteToWideChar(CP_ACP, 0, ansi, -1, wide, KEYWORDS_TEXT_SIZE);
+    length = length > 1 ? WideCharToMultiByte(CP_UTF8, 0, wide, length - 1, text, size, NULL, NULL) : 0;
+
+    return length > 0 ? length : 0;
+}
+
+/*  Highlights the keywords of the keywords dialog in the view
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+RETURN:
+    error_t - error code, BAD_PATTERN if there are too many keywords or a keyword is too long
+*/
+static error_t SetKeywords(controller_t *controller)
+{
+    char *text = malloc(3 * KEYWORDS_TEXT_SIZE);
+    int length;
+    error_t err;
+
+    if (text == NULL)
+        return MEMORY_SHORTAGE;
+
+    length = ConvertDialogText(controller->Find.Keywords, text, 3 * KEYWORDS_TEXT_SIZE);
+    err = SetHighlighterKeywords(&controller->View.Highlighter, text, (size_t)length,
+                                 !controller->Find.IsKeywordCaseMatched);
+    free(text);
+
+    return err;
+}
+
+/*  Sets the filter of the filter dialog and filters the loaded lines
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+RETURN:
+    error_t - error code, BAD_PATTERN if the text is empty or not a valid regular expression
+*/
+static error_t SetFilter(controller_t *controller)
+{
+    find_state_t *find = &controller->Find;
+    char text[3 * FIND_TEXT_SIZE];
+    int length;
+    error_t err;
+
+    length = ConvertDialogText(find->Filter, text, sizeof(text));
+
+    /* The loader must not change the lines while they are filtered */
+    LockModel(&controller->Model);
+    err = SetLineFilter(&controller->View.Filter, &controller->Model, text, (size_t)length, find->IsFilterRegex,
+                        !find->IsFilterCaseMatched);
+    UnlockModel(&controller->Model);
+
+    return err;
+}
+
+/*  Checks the item of the display mode in the menu
+INPUT:
+    HWND hwnd - window handle with the menu
+    mode_t mode - mode of displaying text
+*/
+static void CheckModeMenu(HWND hwnd, mode_t mode)
+{
+    HMENU hMenu = GetMenu(hwnd);
+
+    /* The filter item stays enabled to change the filter */
+    CheckMenuItem(hMenu, IDM_DEFAULT, mode == DEFAULT ? MF_CHECKED : MF_UNCHECKED);
+    CheckMenuItem(hMenu, IDM_LAYOUT, mode == LAYOUT ? MF_CHECKED : MF_UNCHECKED);
+    CheckMenuItem(hMenu, IDM_FILTER, mode == FILTER ? MF_CHECKED : MF_UNCHECKED);
+    EnableMenuItem(hMenu, IDM_DEFAULT, mode == DEFAULT ? MF_GRAYED : MF_ENABLED);
+    EnableMenuItem(hMenu, IDM_LAYOUT, mode == LAYOUT ? MF_GRAYED : MF_ENABLED);
+}
+
+/*  Enables or grays the commands of the single file, the display mode items
+    are checked again after they are enabled
+INPUT:
+    HWND hwnd - window handle with the menu
+    int isEnabled - nonzero if the commands are enabled
+    mode_t mode - mode of displaying text
+*/
+static void EnableFileCommands(HWND hwnd, int isEnabled, mode_t mode)
+{
+    HMENU hMenu = GetMenu(hwnd);
+    size_t i;
+
+    for (i = 0; i < sizeof(fileCommands) / sizeof(fileCommands[0]); i++)
+        EnableMenuItem(hMenu, fileCommands[i], isEnabled ? MF_ENABLED : MF_GRAYED);
+    if (isEnabled)
+        CheckModeMenu(hwnd, mode);
+}
+
+/*  Checks whether the command belongs to the single file
+INPUT:
+    UINT command - identifier of the command
+RETURN:
+    int - nonzero if the command is grayed while the merged files are shown
+*/
+static int IsFileCommand(UINT command)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(fileCommands) / sizeof(fileCommands[0]); i++)
+        if (fileCommands[i] == command)
+            return 1;
+
+    return 0;
+}
+
+/*  Opens the file in place of the current one keeping the display mode
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+    const char *filename - the name of the file
+RETURN:
+    error_t - error code
+*/
+static error_t OpenFile(controller_t *controller, HWND hwnd, const char *filename)
+{
+    error_t err;
+    RECT rect;
+    char name[MAX_PATH];
+    mode_t curMode = controller->View.Mode;
+    int isFollowing = controller->IsFollowing;
+    int wasMerged = controller->IsMerged;
+    int tabSize = controller->Model.TabSize;
+    find_state_t find = controller->Find;
+
+    /* The name may belong to the model which is cleared */
+    strncpy(name, filename, MAX_PATH - 1);
+    name[MAX_PATH - 1] = '\0';
+    GetClientRect(hwnd, &rect);
+
+    ClearControllerData(controller);
+    InitController(controller, hwnd);
+    SetMode(controller, curMode);
+    SetModelTabSize(&controller->Model, tabSize);
+    controller->IsFollowing = isFollowing;
+    if (wasMerged)
+        EnableFileCommands(hwnd, 1, curMode);
+
+    /* The dialog stays open for the new file, its parameters are at the same place */
+    controller->Find = find;
+    controller->Find.HasMatch = 0;
+    controller->Find.ShowFirstMatch = 0;
+    SetWindowText(hwnd, WINDOW_TITLE);
+    err = SetKeywords(controller);
+    if(err)
+        return err;
+
+    /* The filter mode keeps its filter, the lines are filtered while they are loaded */
+    if (curMode == FILTER)
+    {
+        err = SetFilter(controller);
+        if(err)
+            return err;
+    }
+
+    err = ReadFileIntoModel(controller, hwnd, name);
+    if(err)
+        return err;
+
+    if (isFollowing)
+    {
+        err = StartFileWatcher(&controller->Watcher, name, hwnd);
+        if(err)
+            return err;
+    }
+
+    err = SetRectSize(hwnd, controller, rect.right, rect.bottom);
+    if(err)
+        return err;
+
+    InvalidateRect(hwnd, NULL, TRUE);
+    UpdateWindow(hwnd);
+    return SUCCESS;
+}
+
+/*  Opens the files in place of the current one and shows their lines interleaved
+    by the timestamps in the format of the go to time dialog. The view has no layout,
+    the commands of the single file are grayed until another file is opened
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+    const char *const *names - the paths of the files
+    int count - the number of files
+RETURN:
+    error_t - error code
+*/
+static error_t OpenMergedFiles(controller_t *controller, HWND hwnd, const char *const *names, int count)
+{
+    error_t err;
+    RECT rect;
+    char title[sizeof(WINDOW_TITLE) + 64];
+    char number[16];
+    int tabSize = controller->Model.TabSize;
+    find_state_t find = controller->Find;
+
+    GetClientRect(hwnd, &rect);
+
+    ClearControllerData(controller);
+    InitController(controller, hwnd);
+    SetMode(controller, DEFAULT);
+    CheckModeMenu(hwnd, DEFAULT);
+    SetModelTabSize(&controller->Model, tabSize);
+    CheckMenuItem(GetMenu(hwnd), IDM_FOLLOW, MF_UNCHECKED);
+
+    controller->Find = find;
+    controller->Find.HasMatch = 0;
+    controller->Find.ShowFirstMatch = 0;
+    SetWindowText(hwnd, WINDOW_TITLE);
+
+    err = OpenMergedLog(&controller->Merge, names, count, find.TimeFormat, tabSize, hwnd);
+    if(err)
+        return err;
+    controller->IsMerged = 1;
+    controller->IsNotActive = 0;
+    EnableFileCommands(hwnd, 0, DEFAULT);
+
+    _itoa(count, number, 10);
+    strcpy(title, WINDOW_TITLE " - ");
+    strcat(title, number);
+    strcat(title, " merged files");
+    SetWindowText(hwnd, title);
+
+    err = SetRectSize(hwnd, controller, rect.right, rect.bottom);
+    if(err)
+        return err;
+
+    InvalidateRect(hwnd, NULL, TRUE);
+    UpdateWindow(hwnd);
+    return SUCCESS;
+}
+
+/*  Asks for the files to merge and opens them. The dialog gives the path of one
+    chosen file, or the directory followed by the names of several files
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+RETURN:
+    error_t - error code, TOO_MANY_FILES if more than MAX_MERGED_FILES files are chosen
+*/
+static error_t ChooseMergedFiles(controller_t *controller, HWND hwnd)
+{
+    OPENFILENAME ofn;
+    char *buffer = malloc(MERGED_NAMES_SIZE);
+    char (*paths)[MAX_PATH] = malloc(MAX_MERGED_FILES * sizeof(*paths));
+    const char *names[MAX_MERGED_FILES];
+    const char *name;
+    size_t length;
+    int count = 0;
+    error_t err = SUCCESS;
+
+    if (buffer == NULL || paths == NULL)
+    {
+        free(buffer);
+        free(paths);
+        return MEMORY_SHORTAGE;
+    }
+
+    ZeroMemory(&ofn, sizeof(ofn));
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hwnd;
+    ofn.lpstrFile = buffer;
+    ofn.lpstrFile[0] = '\0';
+    ofn.nMaxFile = MERGED_NAMES_SIZE;
+    ofn.lpstrFilter = "All\0*.*\0Logs\0*.LOG;*.TXT\0Compressed\0*.GZ;*.ZST\0";
+    ofn.nFilterIndex = 1;
+    ofn.lpstrTitle = "Open Merged";
+    ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST | OFN_ALLOWMULTISELECT | OFN_EXPLORER;
+
+    if (GetOpenFileName(&ofn) == TRUE)
+    {
+        if (buffer[ofn.nFileOffset - 1] != '\0')
+            names[count++] = buffer;
+        else
+        {
+            length = strlen(buffer);
+            for (name = buffer + ofn.nFileOffset; *name != '\0' && err == SUCCESS; name += strlen(name) + 1)
+            {
+                if (count == MAX_MERGED_FILES)
+                    err = TOO_MANY_FILES;
+                else if (length + 1 + strlen(name) >= MAX_PATH)
+                    err = NO_INPUT_FILE;
+                else
+                {
+                    strcpy(paths[count], buffer);
+                    strcat(paths[count], "\\");
+                    strcat(paths[count], name);
+                    names[count] = paths[count];
+                    count++;
+                }
+            }
+        }
+
+        if (err == SUCCESS)
+            err = OpenMergedFiles(controller, hwnd, names, count);
+    }
+
+    free(buffer);
+    free(paths);
+    return err;
+}
+
+/*  Indexes the data appended to the followed file and keeps the view at the bottom
+    if it was there. A truncated or rotated file is opened again
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    WPARAM wParam - data that was sent to WndProc
+    LPARAM lParam - data that was sent to WndProc
+    HWND hwnd - data that was sent to WndProc
+RETURN:
+    error_t - error code
+*/
+error_t FileChanged(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
+{
+    file_change_t change;
+    error_t err;
+
+    /* The notification may come from the watching of a previously opened file */
+    if (controller->IsNotActive || (unsigned long)lParam != controller->Watcher.WatchId)
+        return SUCCESS;
+
+    /* The background relayout reads the lines, the next notification checks the file again */
+    if (IsRelayoutBusy(&controller->Scheduler))
+        return SUCCESS;
+
+    err = GrowModel(&controller->Model, &change);
+    if (err != SUCCESS || change == FILE_UNCHANGED)
+        return err;
+
+    if (change == FILE_REPLACED)
+        return OpenFile(controller, hwnd, controller->Model.FileName);
+
+    /* The last line may become longer, so the layouts examine it again */
+    TrimLayout(&controller->View.Layout, controller->Model.NumOfLines);
+    TrimLayout(&controller->NextLayout, controller->Model.NumOfLines);
+
+    err = SetRectSize(hwnd, controller, -1, -1);
+    if (err != SUCCESS)
+        return err;
+
+    return ContinueSearch(&controller->Search);
+}
+
+/*  Rebuilds the view according to the new window sizes and performs
+    the necessary changes in the display of scrollbars
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+    long windowWidth - the width of the workspace or a negative number to use the past value
+    long windowHeight - the height of the workspace or a negative number to use the past value
+RETURN:
+    error_t - error code
+*/
+error_t SetRectSize(HWND hwnd, controller_t *controller, long windowWidth, long windowHeight)
+{
+    error_t err;
+
+    /* The rows of the merged files are merged while they are painted */
+    if (controller->IsMerged)
+    {
+        LockMergedLog(&controller->Merge);
+        if(windowWidth < 0 || windowHeight < 0)
+            err = MergedViewRectResize(hwnd, &controller->Merge, &controller->View,
+                                       controller->View.WindowWidth, controller->View.WindowHeight);
+        else
+            err = MergedViewRectResize(hwnd, &controller->Merge, &controller->View, windowWidth, windowHeight);
+        UnlockMergedLog(&controller->Merge);
+
+        return err;
+    }
+
+    /* The loader must not change the lines while the view is being built */
+    LockModel(&controller->Model);
+    if(windowWidth < 0 || windowHeight < 0) /* Use the same window size as last time */
+        err = ViewRectResize(hwnd, &controller->Model, &controller->View,
+                             controller->View.WindowWidth, controller->View.WindowHeight);
+    else
+        err = ViewRectResize(hwnd, &controller->Model, &controller->View, windowWidth, windowHeight);
+    UnlockModel(&controller->Model);
+
+    return err;
+}
+
+/*  Handles the window size change. The view is rebuilt at once when the rows stay
+    the same, otherwise the change is coalesced with the following ones and the
+    layout is built in the background while the old one is shown
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    WPARAM wParam - data that was sent to WndProc
+    LPARAM lParam - data that was sent to WndProc
+    HWND hwnd - data that was sent to WndProc
+RETURN:
+    error_t - error code
+*/
+error_t WindowResize(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
+{
+    view_t *view = &controller->View;
+    long width = LOWORD(lParam);
+    long height = HIWORD(lParam);
+
+    if (controller->IsNotActive)
+        return SUCCESS;
+
+    /* Without a new row width the rebuilding takes constant time */
+    if (!IsRelayoutBusy(&controller->Scheduler) &&
+        (view->Mode != LAYOUT || GetViewColumns(view, width) == view->Layout.Width))
+        return SetRectSize(hwnd, controller, width, height);
+
+    if (RequestRelayout(&controller->Scheduler, width, height, GetTickCount()))
+        InterlockedExchange(&controller->CancelRelayout, 1);
+    SetRelayoutTimer(controller, hwnd);
+
+    return SUCCESS;
+}
+
+/*  Builds NextLayout and notifies the window
+INPUT:
+    LPVOID param - pointer to an instance of a structure containing a model and a view
+RETURN:
+    DWORD - error code
+*/
+static DWORD WINAPI RelayoutThread(LPVOID param)
+{
+    controller_t *controller = param;
+    layout_t *layout = &controller->NextLayout;
+    index_t numOfLines;
+    int isDone;
+    error_t err;
+
+    /* The lines published during the relayout are laid out when the layout is shown */
+    LockModel(&controller->Model);
+    numOfLines = controller->Model.NumOfLines;
+    UnlockModel(&controller->Model);
+
+    /* The model is locked for a part of the lines at a time, the loader waiting to publish
+       new lines would otherwise keep the window waiting for the model until the end */
+    layout->Cancel = &controller->CancelRelayout;
+    do
+    {
+        LockModel(&controller->Model);
+        err = UpdateLayoutPart(layout, &controller->Model, controller->RelayoutColumns, RELAYOUT_PART_LINES);
+        isDone = layout->NumOfLines >= numOfLines;
+        UnlockModel(&controller->Model);
+    }
+    while (err == SUCCESS && !isDone && !controller->CancelRelayout);
+    layout->Cancel = NULL;
+
+    PostMessage(controller->RelayoutWindow, WM_RELAYOUT_DONE, controller->RelayoutGeneration, err);
+    return err;
+}
+
+/*  Starts the postponed relayout when it is due
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+*/
+void RelayoutTimer(controller_t *controller, HWND hwnd)
+{
+    if (!StartRelayout(&controller->Scheduler, GetTickCount(), &controller->RelayoutWidth,
+                       &controller->RelayoutHeight, &controller->RelayoutGeneration))
+    {
+        SetRelayoutTimer(controller, hwnd);
+        return;
+    }
+
+    KillTimer(hwnd, RELAYOUT_TIMER);
+    controller->RelayoutColumns = GetViewColumns(&controller->View, controller->RelayoutWidth);
+    controller->RelayoutWindow = hwnd;
+    controller->CancelRelayout = 0;
+
+    /* Building the layout in the calling thread if the thread cannot be started */
+    controller->Relayout = CreateThread(NULL, 0, RelayoutThread, controller, 0, NULL);
+    if (controller->Relayout == NULL)
+        RelayoutThread(controller);
+}
+
+/*  Shows the layout built in the background unless it is superseded
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    WPARAM wParam - data that was sent to WndProc
+    LPARAM lParam - data that was sent to WndProc
+    HWND hwnd - data that was sent to WndProc
+RETURN:
+    error_t - error code
+*/
+error_t RelayoutDone(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
+{
+    unsigned long generation = (unsigned long)wParam;
+    error_t err = (error_t)lParam;
+
+    if (controller->Relayout != NULL && generation == controller->RelayoutGeneration)
+    {
+        WaitForSingleObject(controller->Relayout, INFINITE);
+        CloseHandle(controller->Relayout);
+        controller->Relayout = NULL;
+    }
+
+    /* A superseded layout is not shown, the newer size is built after it */
+    if (!FinishRelayout(&controller->Scheduler, generation))
+    {
+        SetRelayoutTimer(controller, hwnd);
+        return SUCCESS;
+    }
+
+    if (err != SUCCESS)
+        return err;
+
+    LockModel(&controller->Model);
+    err = ReplaceViewLayout(hwnd, &controller->Model, &controller->View, &controller->NextLayout,
+                            controller->RelayoutWidth, controller->RelayoutHeight);
+    UnlockModel(&controller->Model);
+    InvalidateRect(hwnd, NULL, TRUE);
+
+    return err;
+}
+
+/*  Stops the background relayout and drops the pending one
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+*/
+static void StopRelayout(controller_t *controller)
+{
+    if (controller->Relayout != NULL)
+    {
+        InterlockedExchange(&controller->CancelRelayout, 1);
+        WaitForSingleObject(controller->Relayout, INFINITE);
+        CloseHandle(controller->Relayout);
+        controller->Relayout = NULL;
+    }
+
+    ResetRelayoutScheduler(&controller->Scheduler);
+    ClearLayout(&controller->NextLayout);
+}
+
+/*  Sets the distance between the tab stops. The lines having tabs change their widths,
+    so the layout is built again, the old one only gives the upper left corner
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+    int tabSize - the distance between the tab stops in columns
+RETURN:
+    error_t - error code
+*/
+static error_t SetTabSize(controller_t *controller, HWND hwnd, int tabSize)
+{
+    error_t err;
+    RECT rect;
+    int i;
+
+    /* The background relayout counts the widths for the old tab size */
+    StopRelayout(controller);
+    SetModelTabSize(&controller->Model, tabSize);
+    if (controller->IsNotActive)
+        return SUCCESS;
+
+    /* The merged files have no layout, only their widths change */
+    if (controller->IsMerged)
+    {
+        for (i = 0; i < controller->Merge.NumOfSources; i++)
+            SetModelTabSize(&controller->Merge.Sources[i].Model, tabSize);
+        InvalidateRect(hwnd, NULL, TRUE);
+        return SetRectSize(hwnd, controller, -1, -1);
+    }
+
+    /* The empty layout is swapped in and built for the current window size */
+    GetClientRect(hwnd, &rect);
+    LockModel(&controller->Model);
+    err = ReplaceViewLayout(hwnd, &controller->Model, &controller->View, &controller->NextLayout,
+                            rect.right, rect.bottom);
+    UnlockModel(&controller->Model);
+    ClearLayout(&controller->NextLayout);
+    InvalidateRect(hwnd, NULL, TRUE);
+
+    return err;
+}
+
+/*  Opens the find dialog or activates the opened one
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+*/
+static void OpenFindDialog(controller_t *controller)
+{
+    if (controller->Find.Dialog != NULL)
+    {
+        SetFocus(controller->Find.Dialog);
+        return;
+    }
+
+    /* Only the options are kept from the closed dialog */
+    controller->Find.Params.Flags = (controller->Find.Params.Flags & (FR_DOWN | FR_MATCHCASE)) | FR_HIDEWHOLEWORD;
+    controller->Find.Dialog = FindText(&controller->Find.Params);
+}
+
+/*  Finds the next occurrence of the text of the find dialog in its direction, marks
+    it and scrolls the view to it. The search continues from the shown occurrence
+    if the view was not scrolled since, otherwise from the upper left corner of the window
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+RETURN:
+    error_t - error code
+*/
+static error_t FindNext(controller_t *controller, HWND hwnd)
+{
+    find_state_t *find = &controller->Find;
+    find_direction_t direction = (find->Params.Flags & FR_DOWN) ? FIND_FORWARD : FIND_BACKWARD;
+    char text[3 * FIND_TEXT_SIZE];
+    literal_t literal;
+    offset_t from;
+    offset_t found;
+    HCURSOR cursor;
+    int length;
+    error_t err;
+
+    if (controller->IsNotActive)
+        return SUCCESS;
+
+    if (find->What[0] == '\0')
+    {
+        OpenFindDialog(controller);
+        return SUCCESS;
+    }
+
+    /* The dialog gives the text in the ANSI code page, the model characters are UTF-8 */
+    length = ConvertDialogText(find->What, text, sizeof(text));
+    if (length == 0)
+        return SUCCESS;
+    InitLiteral(&literal, text, (size_t)length, !(find->Params.Flags & FR_MATCHCASE));
+
+    LockModel(&controller->Model);
+    if (find->HasMatch && find->MatchScrollPos == controller->View.VScrollPos)
+        from = direction == FIND_FORWARD ? find->MatchOffset + 1 : find->MatchOffset;
+    else
+        from = GetViewOffset(&controller->Model, &controller->View);
+
+    cursor = SetCursor(LoadCursor(NULL, IDC_WAIT));
+    err = FindModelText(&controller->Model, &literal, from, direction, &found);
+    SetCursor(cursor);
+
+    if (err == SUCCESS && found != NO_MATCH)
+    {
+        ShowViewText(hwnd, &controller->Model, &controller->View, found, literal.Length);
+        find->HasMatch = 1;
+        find->MatchOffset = found;
+        find->MatchScrollPos = controller->View.VScrollPos;
+    }
+    UnlockModel(&controller->Model);
+
+    if (err == SUCCESS && found == NO_MATCH)
+        MessageBox(find->Dialog != NULL ? find->Dialog : hwnd, "Cannot find the text", "Find",
+                   MB_OK | MB_ICONINFORMATION);
+
+    return err;
+}
+
+/*  Shows the search state after the window title
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+*/
+static void UpdateSearchTitle(controller_t *controller, HWND hwnd)
+{
+    const search_t *search = &controller->Search;
+    char title[sizeof(WINDOW_TITLE) + 64];
+    char count[24];
+
+    if (search->Pattern.NumOfOps == 0)
+    {
+        SetWindowText(hwnd, WINDOW_TITLE);
+        return;
+    }
+
+    _ui64toa(GetSearchCount(&controller->Search), count, 10);
+    strcpy(title, WINDOW_TITLE " - ");
+    strcat(title, count);
+    strcat(title, " matches");
+    if (search->Thread != NULL)
+        strcat(title, ", searching...");
+    else if (search->IsTruncated)
+        strcat(title, ", limit reached");
+    else if (search->IsStopped)
+        strcat(title, ", stopped");
+    SetWindowText(hwnd, title);
+}
+
+/*  Handles the messages of the regular expression dialog
+INPUT:
+    HWND dialog - the dialog
+    UINT message - the message
+    WPARAM wParam - data of the message
+    LPARAM lParam - data of the message, the controller for WM_INITDIALOG
+RETURN:
+    INT_PTR - TRUE if the message is handled
+*/
+static INT_PTR CALLBACK RegexDialogProc(HWND dialog, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    find_state_t *find = (find_state_t *)GetWindowLongPtr(dialog, DWLP_USER);
+
+    switch (message)
+    {
+        case WM_INITDIALOG:
+            find = &((controller_t *)lParam)->Find;
+            SetWindowLongPtr(dialog, DWLP_USER, (LONG_PTR)find);
+            SetDlgItemText(dialog, IDC_PATTERN, find->Pattern);
+            CheckDlgButton(dialog, IDC_MATCHCASE, find->IsPatternCaseMatched ? BST_CHECKED : BST_UNCHECKED);
+            return TRUE;
+        case WM_COMMAND:
+            if (LOWORD(wParam) == IDOK)
+            {
+                GetDlgItemText(dialog, IDC_PATTERN, find->Pattern, sizeof(find->Pattern));
+                find->IsPatternCaseMatched = IsDlgButtonChecked(dialog, IDC_MATCHCASE) == BST_CHECKED;
+                EndDialog(dialog, IDOK);
+                return TRUE;
+            }
+            if (LOWORD(wParam) == IDCANCEL)
+            {
+                EndDialog(dialog, IDCANCEL);
+                return TRUE;
+            }
+            break;
+        default:
+            break;
+    }
+
+    return FALSE;
+}
+
+/*  Asks for the regular expression and starts its search in the background,
+    the dialog is opened again while the expression is not valid
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+RETURN:
+    error_t - error code
+*/
+static error_t SearchPattern(controller_t *controller, HWND hwnd)
+{
+    find_state_t *find = &controller->Find;
+    char text[3 * FIND_TEXT_SIZE];
+    int length;
+    error_t err;
+
+    if (controller->IsNotActive)
+        return SUCCESS;
+
+    while (DialogBoxParam(GetModuleHandle(NULL), "RegexDialog", hwnd, RegexDialogProc, (LPARAM)controller) == IDOK)
+    {
+        length = ConvertDialogText(find->Pattern, text, sizeof(text));
+        if (length == 0)
+            return SUCCESS;
+
+        err = StartSearch(&controller->Search, &controller->Model, text, (size_t)length, !find->IsPatternCaseMatched,
+                          hwnd);
+        if (err != BAD_PATTERN)
+        {
+            find->ShowFirstMatch = err == SUCCESS;
+            UpdateSearchTitle(controller, hwnd);
+            return err;
+        }
+        DisplayMessageBox(hwnd, err);
+    }
+
+    return SUCCESS;
+}
+
+/*  Handles the messages of the filter dialog
+INPUT:
+    HWND dialog - the dialog
+    UINT message - the message
+    WPARAM wParam - data of the message
+    LPARAM lParam - data of the message, the controller for WM_INITDIALOG
+RETURN:
+    INT_PTR - TRUE if the message is handled
+*/
+static INT_PTR CALLBACK FilterDialogProc(HWND dialog, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    find_state_t *find = (find_state_t *)GetWindowLongPtr(dialog, DWLP_USER);
+
+    switch (message)
+    {
+        case WM_INITDIALOG:
+            find = &((controller_t *)lParam)->Find;
+            SetWindowLongPtr(dialog, DWLP_USER, (LONG_PTR)find);
+            SetDlgItemText(dialog, IDC_PATTERN, find->Filter);
+            CheckDlgButton(dialog, IDC_MATCHCASE, find->IsFilterCaseMatched ? BST_CHECKED : BST_UNCHECKED);
+            CheckDlgButton(dialog, IDC_REGEX, find->IsFilterRegex ? BST_CHECKED : BST_UNCHECKED);
+            return TRUE;
+        case WM_COMMAND:
+            if (LOWORD(wParam) == IDOK)
+            {
+                GetDlgItemText(dialog, IDC_PATTERN, find->Filter, sizeof(find->Filter));
+                find->IsFilterCaseMatched = IsDlgButtonChecked(dialog, IDC_MATCHCASE) == BST_CHECKED;
+                find->IsFilterRegex = IsDlgButtonChecked(dialog, IDC_REGEX) == BST_CHECKED;
+                EndDialog(dialog, IDOK);
+                return TRUE;
+            }
+            if (LOWORD(wParam) == IDCANCEL)
+            {
+                EndDialog(dialog, IDCANCEL);
+                return TRUE;
+            }
+            break;
+        default:
+            break;
+    }
+
+    return FALSE;
+}
+
+/*  Asks for the filter and shows only the lines it keeps, the upper line of the
+    window stays in place if it is kept. The dialog is opened again while
+    the regular expression is not valid
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+RETURN:
+    error_t - error code
+*/
+static error_t FilterLines(controller_t *controller, HWND hwnd)
+{
+    index_t line = 0;
+    error_t err;
+
+    if (controller->IsNotActive)
+        return SUCCESS;
+
+    while (DialogBoxParam(GetModuleHandle(NULL), "FilterDialog", hwnd, FilterDialogProc,
+                          (LPARAM)controller) == IDOK)
+    {
+        if (controller->Find.Filter[0] == '\0')
+            return SUCCESS;
+
+        LockModel(&controller->Model);
+        if (controller->View.NumOfLines > 0 && controller->Model.NumOfLines > 0)
+            line = FindModelLine(&controller->Model, GetViewOffset(&controller->Model, &controller->View));
+        UnlockModel(&controller->Model);
+
+        err = SetFilter(controller);
+        if (err == BAD_PATTERN)
+        {
+            DisplayMessageBox(hwnd, err);
+            continue;
+        }
+        if (err != SUCCESS)
+            return err;
+
+        SetMode(controller, FILTER);
+        CheckModeMenu(hwnd, FILTER);
+        err = SetRectSize(hwnd, controller, -1, -1);
+        if (err == SUCCESS)
+            SetVScroll(hwnd, &controller->View, FindFilterRow(&controller->View.Filter, line));
+        return err;
+    }
+
+    return SUCCESS;
+}
+
+/*  Handles the messages of the keywords dialog
+INPUT:
+    HWND dialog - the dialog
+    UINT message - the message
+    WPARAM wParam - data of the message
+    LPARAM lParam - data of the message, the controller for WM_INITDIALOG
+RETURN:
+    INT_PTR - TRUE if the message is handled
+*/
+static INT_PTR CALLBACK KeywordsDialogProc(HWND dialog, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    find_state_t *find = (find_state_t *)GetWindowLongPtr(dialog, DWLP_USER);
+
+    switch (message)
+    {
+        case WM_INITDIALOG:
+            find = &((controller_t *)lParam)->Find;
+            SetWindowLongPtr(dialog, DWLP_USER, (LONG_PTR)find);
+            SendDlgItemMessage(dialog, IDC_KEYWORDS, EM_LIMITTEXT, sizeof(find->Keywords) - 1, 0);
+            SetDlgItemText(dialog, IDC_KEYWORDS, find->Keywords);
+            CheckDlgButton(dialog, IDC_MATCHCASE, find->IsKeywordCaseMatched ? BST_CHECKED : BST_UNCHECKED);
+            return TRUE;
+        case WM_COMMAND:
+            if (LOWORD(wParam) == IDOK)
+            {
+                GetDlgItemText(dialog, IDC_KEYWORDS, find->Keywords, sizeof(find->Keywords));
+                find->IsKeywordCaseMatched = IsDlgButtonChecked(dialog, IDC_MATCHCASE) == BST_CHECKED;
+                EndDialog(dialog, IDOK);
+                return TRUE;
+            }
+            if (LOWORD(wParam) == IDCANCEL)
+            {
+                EndDialog(dialog, IDCANCEL);
+                return TRUE;
+            }
+            break;
+        default:
+            break;
+    }
+
+    return FALSE;
+}
+
+/*  Asks for the keywords and highlights them in the painted rows, the dialog
+    is opened again while the keywords cannot be compiled
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+RETURN:
+    error_t - error code
+*/
+static error_t HighlightKeywords(controller_t *controller, HWND hwnd)
+{
+    error_t err;
+
+    while (DialogBoxParam(GetModuleHandle(NULL), "KeywordsDialog", hwnd, KeywordsDialogProc,
+                          (LPARAM)controller) == IDOK)
+    {
+        err = SetKeywords(controller);
+        if (err != BAD_PATTERN)
+        {
+            InvalidateRect(hwnd, NULL, TRUE);
+            return err;
+        }
+        DisplayMessageBox(hwnd, err);
+    }
+
+    return SUCCESS;
+}
+
+/*  Writes the position of the upper row of the view in the dialog field
+INPUT:
+    HWND dialog - the go to dialog
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    go_to_t kind - kind of the position
+*/
+static void ShowGoToPosition(HWND dialog, controller_t *controller, go_to_t kind)
+{
+    model_t *model = &controller->Model;
+    offset_t end;
+    char text[32];
+    unsigned long long pos = 0;
+
+    LockModel(model);
+    if (controller->View.NumOfLines > 0 && model->NumOfLines > 0)
+    {
+        end = GetModelLineOffset(model, model->NumOfLines);
+        if (kind == GO_TO_LINE)
+            pos = GetViewLine(model, &controller->View) + 1;
+        else if (kind == GO_TO_OFFSET)
+            pos = GetViewOffset(model, &controller->View);
+        else if (end > 0)
+            pos = (unsigned long long)((double)GetViewOffset(model, &controller->View) * 100 / end);
+    }
+    UnlockModel(model);
+
+    _ui64toa(pos, text, 10);
+    SetDlgItemText(dialog, IDC_GOTOVALUE, text);
+}
+
+/*  Handles the messages of the go to dialog. The rejected text is shown again,
+    otherwise the current position is shown, as well as when the kind is chosen
+INPUT:
+    HWND dialog - the dialog
+    UINT message - the message
+    WPARAM wParam - data of the message
+    LPARAM lParam - data of the message, the controller for WM_INITDIALOG
+RETURN:
+    INT_PTR - TRUE if the message is handled
+*/
+static INT_PTR CALLBACK GoToDialogProc(HWND dialog, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    controller_t *controller = (controller_t *)GetWindowLongPtr(dialog, DWLP_USER);
+    find_state_t *find = controller == NULL ? NULL : &controller->Find;
+
+    switch (message)
+    {
+        case WM_INITDIALOG:
+            controller = (controller_t *)lParam;
+            find = &controller->Find;
+            SetWindowLongPtr(dialog, DWLP_USER, (LONG_PTR)controller);
+            CheckRadioButton(dialog, IDC_GOTOLINE, IDC_GOTOPERCENT, IDC_GOTOLINE + find->GoToKind);
+            if (find->GoTo[0] != '\0')
+                SetDlgItemText(dialog, IDC_GOTOVALUE, find->GoTo);
+            else
+                ShowGoToPosition(dialog, controller, find->GoToKind);
+            return TRUE;
+        case WM_COMMAND:
+            switch (LOWORD(wParam))
+            {
+                case IDC_GOTOLINE:
+                case IDC_GOTOOFFSET:
+                case IDC_GOTOPERCENT:
+                    ShowGoToPosition(dialog, controller, (go_to_t)(LOWORD(wParam) - IDC_GOTOLINE));
+                    return TRUE;
+                case IDOK:
+                    GetDlgItemText(dialog, IDC_GOTOVALUE, find->GoTo, sizeof(find->GoTo));
+                    if (IsDlgButtonChecked(dialog, IDC_GOTOOFFSET) == BST_CHECKED)
+                        find->GoToKind = GO_TO_OFFSET;
+                    else if (IsDlgButtonChecked(dialog, IDC_GOTOPERCENT) == BST_CHECKED)
+                        find->GoToKind = GO_TO_PERCENT;
+                    else
+                        find->GoToKind = GO_TO_LINE;
+                    EndDialog(dialog, IDOK);
+                    return TRUE;
+                case IDCANCEL:
+                    EndDialog(dialog, IDCANCEL);
+                    return TRUE;
+                default:
+                    break;
+            }
+            break;
+        default:
+            break;
+    }
+
+    return FALSE;
+}
+
+/*  Asks for the line, the offset or the percentage and scrolls the view to it,
+    the dialog is opened again while the position is not a number in its range
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+*/
+static void GoToPosition(controller_t *controller, HWND hwnd)
+{
+    find_state_t *find = &controller->Find;
+    model_t *model = &controller->Model;
+    unsigned long long pos = 0;
+    double percent = 0;
+    char *end;
+
+    if (controller->IsNotActive)
+        return;
+
+    while (DialogBoxParam(GetModuleHandle(NULL), "GoToDialog", hwnd, GoToDialogProc, (LPARAM)controller) == IDOK)
+    {
+        /* The number must take the whole text, the lines are counted from one */
+        if (find->GoToKind == GO_TO_PERCENT)
+        {
+            percent = strtod(find->GoTo, &end);
+            if (end == find->GoTo || *end != '\0' || !(percent >= 0 && percent <= 100))
+            {
+                DisplayMessageBox(hwnd, BAD_POSITION);
+                continue;
+            }
+        }
+        else
+        {
+            pos = strtoull(find->GoTo, &end, 0);
+            if (end == find->GoTo || *end != '\0' || find->GoTo[0] == '-' ||
+                (find->GoToKind == GO_TO_LINE && pos == 0))
+            {
+                DisplayMessageBox(hwnd, BAD_POSITION);
+                continue;
+            }
+        }
+
+        /* The lines and the offsets past the loaded ones are rejected, not clamped */
+        LockModel(model);
+        if ((find->GoToKind == GO_TO_LINE && pos > model->NumOfLines) ||
+            (find->GoToKind == GO_TO_OFFSET && (model->NumOfLines == 0 ||
+                pos >= GetModelLineOffset(model, model->NumOfLines))))
+        {
+            UnlockModel(model);
+            DisplayMessageBox(hwnd, BAD_POSITION);
+            continue;
+        }
+
+        if (find->GoToKind == GO_TO_LINE)
+            GoToViewLine(hwnd, model, &controller->View, pos - 1);
+        else if (find->GoToKind == GO_TO_OFFSET)
+            GoToViewOffset(hwnd, model, &controller->View, pos);
+        else
+            GoToViewPercent(hwnd, model, &controller->View, percent);
+        UnlockModel(model);
+
+        /* The next dialog shows the new position */
+        find->GoTo[0] = '\0';
+        return;
+    }
+}
+
+/*  Samples the timestamps of the file in parts
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    time_index_t *times - pointer on the sampled time index
+    model_t *model - pointer on the model of the file
+RETURN:
+    error_t - error code
+*/
+static error_t SampleFileTimes(controller_t *controller, time_index_t *times, model_t *model)
+{
+    int isDone;
+    error_t err;
+
+    /* The model is locked for a part of the lines at a time, the lines published meanwhile are
+       sampled by the next parts, so the window finds only the last ones to sample */
+    do
+    {
+        LockModel(model);
+        err = UpdateTimeIndexPart(times, model, SAMPLE_PART_LINES);
+        isDone = IsTimeIndexUpdated(times, model);
+        UnlockModel(model);
+    }
+    while (err == SUCCESS && !isDone && !controller->CancelSampling);
+
+    return err;
+}
+
+/*  Samples NextTimes of the file or of every merged file and notifies the window
+INPUT:
+    LPVOID param - pointer to an instance of a structure containing a model and a view
+RETURN:
+    DWORD - error code
+*/
+static DWORD WINAPI SampleThread(LPVOID param)
+{
+    controller_t *controller = param;
+    merged_log_t *merge = &controller->Merge;
+    error_t err = SUCCESS;
+    int i;
+
+    if (!controller->IsMerged)
+        err = SampleFileTimes(controller, &controller->NextTimes, &controller->Model);
+    for (i = 0; controller->IsMerged && i < merge->NumOfSources && err == SUCCESS; i++)
+        err = SampleFileTimes(controller, &merge->Sources[i].NextTimes, &merge->Sources[i].Model);
+
+    PostMessage(controller->SampleWindow, WM_SAMPLE_DONE, controller->SampleId, err);
+    return err;
+}
+
+/*  Stops the background sampling, the lines sampled so far stay in NextTimes
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+*/
+static void StopSampling(controller_t *controller)
+{
+    if (controller->Sampler != NULL)
+    {
+        InterlockedExchange(&controller->CancelSampling, 1);
+        WaitForSingleObject(controller->Sampler, INFINITE);
+        CloseHandle(controller->Sampler);
+        controller->Sampler = NULL;
+    }
+
+    /* The notification of the stopped sampling is ignored */
+    controller->SampleId = 0;
+    controller->IsNextSampled = 0;
+}
+
+/*  Checks whether the timestamps of the shown files are sampled in the format
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    time_format_t format - format of the timestamps
+RETURN:
+    int - nonzero if the times of the shown files are in the format
+*/
+static int HasTimeFormat(controller_t *controller, time_format_t format)
+{
+    if (controller->IsMerged)
+        return controller->Merge.Format == format;
+
+    return HasTimeIndex(&controller->Times) && controller->Times.Format == format;
+}
+
+/*  Starts sampling every line in the format in the background, so the dialog and
+    the window do not wait for it. The sampling of the same format goes on and the
+    lines sampled before in the format are not sampled again
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window receiving WM_SAMPLE_DONE
+    time_format_t format - format of the timestamps
+*/
+static void StartSampling(controller_t *controller, HWND hwnd, time_format_t format)
+{
+    merged_log_t *merge = &controller->Merge;
+    int i;
+
+    if (controller->IsNotActive || HasTimeFormat(controller, format) ||
+        (controller->SampleId != 0 && controller->SampleFormat == format))
+        return;
+
+    StopSampling(controller);
+    if (!controller->IsMerged)
+        SetTimeIndexFormat(&controller->NextTimes, format);
+    for (i = 0; controller->IsMerged && i < merge->NumOfSources; i++)
+        SetTimeIndexFormat(&merge->Sources[i].NextTimes, format);
+
+    controller->SampleId = ++lastSampleId;
+    controller->SampleFormat = format;
+    controller->SampleWindow = hwnd;
+    controller->CancelSampling = 0;
+
+    /* Sampling in the calling thread if the thread cannot be started */
+    controller->Sampler = CreateThread(NULL, 0, SampleThread, controller, 0, NULL);
+    if (controller->Sampler == NULL)
+        SampleThread(controller);
+}
+
+/*  Makes the times of the shown files the ones sampled in the format, NextTimes
+    sampled to the end in the background are taken. Only the lines loaded since
+    are sampled then
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    time_format_t format - format of the timestamps
+RETURN:
+    int - nonzero if the times are in the format, zero if every line must be sampled first
+*/
+static int TakeSampledTimes(controller_t *controller, time_format_t format)
+{
+    time_index_t times;
+
+    if (HasTimeFormat(controller, format))
+        return 1;
+    if (controller->Sampler != NULL || !controller->IsNextSampled || controller->SampleFormat != format)
+        return 0;
+
+    if (controller->IsMerged)
+    {
+        LockMergedLog(&controller->Merge);
+        SetMergedLogFormat(&controller->Merge, format);
+        UnlockMergedLog(&controller->Merge);
+    }
+    else
+    {
+        times = controller->Times;
+        controller->Times = controller->NextTimes;
+        controller->NextTimes = times;
+        ClearTimeIndex(&controller->NextTimes);
+    }
+
+    controller->SampleId = 0;
+    controller->IsNextSampled = 0;
+    return 1;
+}
+
+/*  Finds the timestamp of the upper row of the merged files
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    timestamp_t *time - the timestamp
+RETURN:
+    int - nonzero if the timestamp is found
+*/
+static int GetMergedViewTime(controller_t *controller, timestamp_t *time)
+{
+    merged_log_t *merge = &controller->Merge;
+    merged_row_t row;
+
+    /* The merge must be locked and updated */
+    if (controller->View.NumOfLines == 0 || GetMergedRows(merge, controller->View.VScrollPos, &row, 1) == 0)
+        return 0;
+
+    return GetLineTime(&merge->Sources[row.Source].Times, &merge->Sources[row.Source].Model, row.Line, time);
+}
+
+/*  Writes the time of the upper row of the view in the dialog field and starts
+    sampling the lines in the format in the background if it is new
+INPUT:
+    HWND dialog - the go to time dialog
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    time_format_t format - format of the timestamps
+*/
+static void ShowViewTime(HWND dialog, controller_t *controller, time_format_t format)
+{
+    model_t *model = &controller->Model;
+    time_index_t times;
+    timestamp_t time;
+    char text[TIME_TEXT_SIZE];
+
+    /* The time of one line needs no checkpoints, the syslog year is not shown */
+    InitTimeIndex(&times);
+    SetTimeIndexFormat(&times, format);
+    text[0] = '\0';
+
+    if (controller->IsMerged)
+    {
+        merged_log_t *merge = &controller->Merge;
+        merged_row_t row;
+
+        LockMergedLog(merge);
+        if (UpdateMergedLog(merge) == SUCCESS && controller->View.NumOfLines > 0 &&
+            GetMergedRows(merge, controller->View.VScrollPos, &row, 1) > 0 &&
+            GetLineTime(&times, &merge->Sources[row.Source].Model, row.Line, &time))
+            FormatTimeText(&times, time, text);
+        UnlockMergedLog(merge);
+    }
+    else
+    {
+        LockModel(model);
+        if (model->NumOfLines > 0 && GetLineTime(&times, model, GetViewLine(model, &controller->View), &time))
+            FormatTimeText(&times, time, text);
+        UnlockModel(model);
+    }
+
+    SetDlgItemText(dialog, IDC_TIMEVALUE, text);
+    StartSampling(controller, GetParent(dialog), format);
+}
+
+/*  Handles the messages of the go to time dialog. The rejected text is shown again,
+    otherwise the time of the upper row is shown, as well as when the format is chosen
+INPUT:
+    HWND dialog - the dialog
+    UINT message - the message
+    WPARAM wParam - data of the message
+    LPARAM lParam - data of the message, the controller for WM_INITDIALOG
+RETURN:
+    INT_PTR - TRUE if the message is handled
+*/
+static INT_PTR CALLBACK TimeDialogProc(HWND dialog, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    controller_t *controller = (controller_t *)GetWindowLongPtr(dialog, DWLP_USER);
+    find_state_t *find = controller == NULL ? NULL : &controller->Find;
+
+    switch (message)
+    {
+        case WM_INITDIALOG:
+            controller = (controller_t *)lParam;
+            find = &controller->Find;
+            SetWindowLongPtr(dialog, DWLP_USER, (LONG_PTR)controller);
+            CheckRadioButton(dialog, IDC_TIMEISO, IDC_TIMEEPOCH, IDC_TIMEISO + find->TimeFormat);
+            if (find->Time[0] != '\0')
+                SetDlgItemText(dialog, IDC_TIMEVALUE, find->Time);
+            else
+                ShowViewTime(dialog, controller, find->TimeFormat);
+            return TRUE;
+        case WM_COMMAND:
+            switch (LOWORD(wParam))
+            {
+                case IDC_TIMEISO:
+                case IDC_TIMESYSLOG:
+                case IDC_TIMEEPOCH:
+                    ShowViewTime(dialog, controller, (time_format_t)(LOWORD(wParam) - IDC_TIMEISO));
+                    return TRUE;
+                case IDOK:
+                    GetDlgItemText(dialog, IDC_TIMEVALUE, find->Time, sizeof(find->Time));
+                    if (IsDlgButtonChecked(dialog, IDC_TIMESYSLOG) == BST_CHECKED)
+                        find->TimeFormat = TIME_SYSLOG;
+                    else if (IsDlgButtonChecked(dialog, IDC_TIMEEPOCH) == BST_CHECKED)
+                        find->TimeFormat = TIME_EPOCH;
+                    else
+                        find->TimeFormat = TIME_ISO8601;
+                    EndDialog(dialog, IDOK);
+                    return TRUE;
+                case IDCANCEL:
+                    EndDialog(dialog, IDCANCEL);
+                    return TRUE;
+                default:
+                    break;
+            }
+            break;
+        default:
+            break;
+    }
+
+    return FALSE;
+}
+
+/*  Scrolls the view of the merged files to the first row with the timestamp at or
+    after the time of the go to time dialog. The files must be merged in its format
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+RETURN:
+    error_t - error code, BAD_TIME or NO_TIMESTAMPS if the time is not looked for
 */
-void SetMode(controller_t *controller, mode_t mode)
+static error_t GoToMergedTime(controller_t *controller, HWND hwnd)
 {
-    controller->View.Mode = mode;
-    if(mode == LAYOUT)
-        controller->View.HScrollPos = 0;
+    find_state_t *find = &controller->Find;
+    merged_log_t *merge = &controller->Merge;
+    timestamp_t reference;
+    timestamp_t time;
+    index_t row;
+    error_t err;
+    int i;
+
+    LockMergedLog(merge);
+    err = UpdateMergedLog(merge);
+    if (err != SUCCESS)
+    {
+        UnlockMergedLog(merge);
+        return err;
+    }
+
+    /* The time of day alone is taken on the day of the upper row or of the first checkpoint of a file */
+    if (!GetMergedViewTime(controller, &reference))
+    {
+        err = NO_TIMESTAMPS;
+        for (i = 0; i < merge->NumOfSources && err != SUCCESS; i++)
+            if (merge->Sources[i].Times.NumOfPoints > 0)
+            {
+                reference = merge->Sources[i].Times.Points[0].Time;
+                err = SUCCESS;
+            }
+    }
+    if (err == SUCCESS)
+        err = ParseTimeText(&merge->Sources[0].Times, find->Time, reference, &time);
+    if (err != SUCCESS)
+    {
+        UnlockMergedLog(merge);
+        InvalidateRect(hwnd, NULL, TRUE);
+        return err;
+    }
+
+    row = FindMergedTimeRow(merge, time);
+    if (row >= merge->NumOfRows && merge->NumOfRows > 0)
+        row = merge->NumOfRows - 1;
+    UnlockMergedLog(merge);
+    SetVScroll(hwnd, &controller->View, row);
+    InvalidateRect(hwnd, NULL, TRUE);
+
+    /* The next dialog shows the new time */
+    find->Time[0] = '\0';
+    return SUCCESS;
 }
 
-/*  Initializes the controller
+/*  Scrolls the view to the first line with the timestamp at or after the time of
+    the go to time dialog, the view goes to the last line if every timestamp is
+    earlier. The lines must be sampled in its format
 INPUT:
     controller_t *controller - pointer to an instance of a structure containing a model and a view
     HWND hwnd - window handle for which the displaying will be performed
+RETURN:
+    error_t - error code, BAD_TIME or NO_TIMESTAMPS if the time is not looked for
 */
-void InitController(controller_t *controller, HWND hwnd)
+static error_t GoToFileTime(controller_t *controller, HWND hwnd)
 {
-    controller->IsNotActive = 1;
-    InitModel(&controller->Model);
-    InitView(hwnd, &controller->View);
+    find_state_t *find = &controller->Find;
+    model_t *model = &controller->Model;
+    time_index_t *times = &controller->Times;
+    timestamp_t reference;
+    timestamp_t time;
+    index_t line;
+    error_t err;
+
+    LockModel(model);
+    err = UpdateTimeIndex(times, model);
+    if (err != SUCCESS)
+    {
+        UnlockModel(model);
+        return err;
+    }
+
+    /* The time of day alone is taken on the day of the upper row or of the first checkpoint */
+    if (model->NumOfLines == 0 || !GetLineTime(times, model, GetViewLine(model, &controller->View), &reference))
+    {
+        if (times->NumOfPoints == 0)
+            err = NO_TIMESTAMPS;
+        else
+            reference = times->Points[0].Time;
+    }
+    if (err == SUCCESS)
+        err = ParseTimeText(times, find->Time, reference, &time);
+    if (err != SUCCESS)
+    {
+        UnlockModel(model);
+        return err;
+    }
+
+    if (FindTimeLine(times, model, time, &line))
+        GoToViewLine(hwnd, model, &controller->View, line);
+    else
+        GoToViewLine(hwnd, model, &controller->View, model->NumOfLines - 1);
+    UnlockModel(model);
+
+    /* The next dialog shows the new time */
+    find->Time[0] = '\0';
+    return SUCCESS;
 }
 
-/*  Fills the model with data from the file
+/*  Asks for the time and scrolls the view to the first line or merged row with the
+    timestamp at or after it. Every line is sampled in the format of the time in the
+    background first, the jump waits for the end of the sampling if it is not over.
+    The dialog is opened again while the time cannot be parsed
 INPUT:
     controller_t *controller - pointer to an instance of a structure containing a model and a view
-    const char *filename - the name of the file from which the data is taken
+    HWND hwnd - window handle for which the displaying will be performed
 RETURN:
     error_t - error code
 */
-error_t ReadFileIntoModel(controller_t *controller, const char *filename)
+static error_t GoToTime(controller_t *controller, HWND hwnd)
 {
-    if (filename == NULL)
-        return NO_INPUT_FILE;
+    find_state_t *find = &controller->Find;
+    time_index_t times;
+    timestamp_t time;
+    error_t err;
+
+    if (controller->IsNotActive)
+        return SUCCESS;
+
+    /* The jump waiting for the sampling is replaced by the new one */
+    controller->IsTimePending = 0;
+    while (DialogBoxParam(GetModuleHandle(NULL), "TimeDialog", hwnd, TimeDialogProc, (LPARAM)controller) == IDOK)
+    {
+        /* The text is checked at once, the day of the time of day alone is found by the jump */
+        InitTimeIndex(&times);
+        SetTimeIndexFormat(&times, find->TimeFormat);
+        if (ParseTimeText(&times, find->Time, 0, &time) != SUCCESS)
+        {
+            DisplayMessageBox(hwnd, BAD_TIME);
+            continue;
+        }
+
+        if (!TakeSampledTimes(controller, find->TimeFormat))
+        {
+            StartSampling(controller, hwnd, find->TimeFormat);
+            controller->IsTimePending = 1;
+            return SUCCESS;
+        }
 
-    return (controller->IsNotActive = FillModel(&controller->Model, filename));
+        err = controller->IsMerged ? GoToMergedTime(controller, hwnd) : GoToFileTime(controller, hwnd);
+        if (err != BAD_TIME && err != NO_TIMESTAMPS)
+            return err;
+        DisplayMessageBox(hwnd, err);
+    }
+
+    return SUCCESS;
 }
 
-/*  Rebuilds the view according to the new window sizes and performs
-    the necessary changes in the display of scrollbars
+/*  Finishes the background sampling of the timestamps and goes to the time
+    of the dialog if the jump waits for it
 INPUT:
     controller_t *controller - pointer to an instance of a structure containing a model and a view
-    HWND hwnd - window handle for which the displaying will be performed
-    long windowWidth - the width of the workspace or a negative number to use the past value
-    long windowHeight - the height of the workspace or a negative number to use the past value
+    WPARAM wParam - data that was sent to WndProc
+    LPARAM lParam - data that was sent to WndProc
+    HWND hwnd - data that was sent to WndProc
 RETURN:
     error_t - error code
 */
-error_t SetRectSize(HWND hwnd, controller_t *controller, long windowWidth, long windowHeight)
+error_t SamplingDone(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
 {
-    if(windowWidth < 0 || windowHeight < 0) /* Use the same window size as last time */
-        return ViewRectResize(hwnd, &controller->Model, &controller->View,
-                              controller->View.WindowWidth, controller->View.WindowHeight);
+    error_t err = (error_t)lParam;
+
+    /* The notification may come from a stopped sampling */
+    if (controller->SampleId == 0 || (unsigned long)wParam != controller->SampleId)
+        return SUCCESS;
+
+    if (controller->Sampler != NULL)
+    {
+        WaitForSingleObject(controller->Sampler, INFINITE);
+        CloseHandle(controller->Sampler);
+        controller->Sampler = NULL;
+    }
+    if (err != SUCCESS)
+    {
+        controller->SampleId = 0;
+        return err;
+    }
+
+    controller->IsNextSampled = 1;
+    if (!controller->IsTimePending || !TakeSampledTimes(controller, controller->Find.TimeFormat))
+        return SUCCESS;
+
+    controller->IsTimePending = 0;
+    err = controller->IsMerged ? GoToMergedTime(controller, hwnd) : GoToFileTime(controller, hwnd);
+    if (err != BAD_TIME && err != NO_TIMESTAMPS)
+        return err;
+
+    /* The time is kept for the next dialog */
+    DisplayMessageBox(hwnd, err);
+    return SUCCESS;
+}
+
+/*  Marks the match found so far nearest to the offset and scrolls the view to it,
+    the model must be locked
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+    offset_t from - offset in the model
+    find_direction_t direction - direction of the search
+RETURN:
+    int - nonzero if the match is shown
+*/
+static int ShowSearchMatch(controller_t *controller, HWND hwnd, offset_t from, find_direction_t direction)
+{
+    find_state_t *find = &controller->Find;
+    search_match_t match;
+
+    /* The match in the line taken back by the model is not shown until the line is searched again */
+    if (!FindSearchMatch(&controller->Search, from, direction, &match) ||
+        match.Offset >= GetModelLineOffset(&controller->Model, controller->Model.NumOfLines))
+        return 0;
+
+    ShowViewText(hwnd, &controller->Model, &controller->View, match.Offset, match.Length);
+    find->HasMatch = 1;
+    find->MatchOffset = match.Offset;
+    find->MatchScrollPos = controller->View.VScrollPos;
+    return 1;
+}
+
+/*  Shows the match found so far next to the shown occurrence if the view was not
+    scrolled since, otherwise next to the upper left corner of the window
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+    find_direction_t direction - direction of the search
+*/
+static void ShowNextMatch(controller_t *controller, HWND hwnd, find_direction_t direction)
+{
+    find_state_t *find = &controller->Find;
+    offset_t from;
+    int isFound;
+
+    if (controller->IsNotActive)
+        return;
+
+    LockModel(&controller->Model);
+    if (find->HasMatch && find->MatchScrollPos == controller->View.VScrollPos)
+        from = direction == FIND_FORWARD ? find->MatchOffset + 1 : find->MatchOffset;
     else
-        return ViewRectResize(hwnd, &controller->Model, &controller->View, windowWidth, windowHeight);
+        from = GetViewOffset(&controller->Model, &controller->View);
+
+    isFound = ShowSearchMatch(controller, hwnd, from, direction);
+    UnlockModel(&controller->Model);
+
+    if (!isFound)
+        MessageBeep(MB_OK);
 }
 
 /*  Handles vertical scrollbar events
@@ -86,7 +1867,7 @@ void VScroll(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
             break;
         case SB_THUMBPOSITION:
         case SB_THUMBTRACK:
-            SetVScroll(hwnd, &controller->View, HIWORD(wParam) / controller->View.VScale);
+            SetVScrollThumb(hwnd, &controller->View);
             break;
         default:
             break;
@@ -121,7 +1902,7 @@ void HScroll(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
             break;
         case SB_THUMBPOSITION:
         case SB_THUMBTRACK:
-            SetHScroll(hwnd, &controller->View, HIWORD(wParam) / controller->View.HScale);
+            SetHScrollThumb(hwnd, &controller->View);
             break;
         default:
             break;
@@ -171,6 +1952,43 @@ void Keydown(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
             case VK_NEXT:
                 SetWithDeltaVScroll(hwnd, &controller->View, controller->View.LinesInWindow);
                 break;
+            case VK_F3:
+                SendMessage(hwnd, WM_COMMAND, IDM_FINDNEXT, 0);
+                break;
+            case VK_F4:
+                SendMessage(hwnd, WM_COMMAND, GetKeyState(VK_SHIFT) < 0 ? IDM_PREVMATCH : IDM_NEXTMATCH, 0);
+                break;
+            case VK_ESCAPE:
+                SendMessage(hwnd, WM_COMMAND, IDM_STOPSEARCH, 0);
+                break;
+            case 'F':
+                if (GetKeyState(VK_CONTROL) < 0)
+                    SendMessage(hwnd, WM_COMMAND, IDM_FIND, 0);
+                break;
+            case 'R':
+                if (GetKeyState(VK_CONTROL) < 0)
+                    SendMessage(hwnd, WM_COMMAND, IDM_REGEX, 0);
+                break;
+            case 'K':
+                if (GetKeyState(VK_CONTROL) < 0)
+                    SendMessage(hwnd, WM_COMMAND, IDM_KEYWORDS, 0);
+                break;
+            case 'L':
+                if (GetKeyState(VK_CONTROL) < 0)
+                    SendMessage(hwnd, WM_COMMAND, IDM_FILTER, 0);
+                break;
+            case 'G':
+                if (GetKeyState(VK_CONTROL) < 0)
+                    SendMessage(hwnd, WM_COMMAND, IDM_GOTO, 0);
+                break;
+            case 'T':
+                if (GetKeyState(VK_CONTROL) < 0)
+                    SendMessage(hwnd, WM_COMMAND, IDM_GOTOTIME, 0);
+                break;
+            case 'M':
+                if (GetKeyState(VK_CONTROL) < 0)
+                    SendMessage(hwnd, WM_COMMAND, IDM_OPENMERGED, 0);
+                break;
             default:
                 break;
         }
@@ -207,6 +2025,10 @@ error_t Menu(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
 {
     HMENU hMenu = GetMenu(hwnd);
 
+    /* The shortcuts of the grayed commands come here as well */
+    if (controller->IsMerged && IsFileCommand(LOWORD(wParam)))
+        return SUCCESS;
+
     switch(LOWORD(wParam))
     {
         case IDM_OPEN :
@@ -220,7 +2042,7 @@ error_t Menu(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
             ofn.lpstrFile = buffer;
             ofn.lpstrFile[0] = '\0';
             ofn.nMaxFile = sizeof(buffer);
-            ofn.lpstrFilter = "All\0*.*\0Text\0*.TXT\0";
+            ofn.lpstrFilter = "All\0*.*\0Text\0*.TXT\0Compressed\0*.GZ;*.ZST\0";
             ofn.nFilterIndex = 1;
             ofn.lpstrFileTitle = NULL;
             ofn.nMaxFileTitle = 0;
@@ -229,29 +2051,45 @@ error_t Menu(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
 
             if (GetOpenFileName(&ofn) == TRUE) {
                 error_t err;
-                RECT rect;
-
-                GetClientRect(hwnd, &rect);
-                unsigned long windowWidth = rect.right;
-                unsigned long windowHeight = rect.bottom;
-                mode_t curMode = controller->View.Mode;
 
-                ClearControllerData(controller);
-                InitController(controller, hwnd);
-                SetMode(controller, curMode);
-                err = ReadFileIntoModel(controller, ofn.lpstrFile);
+                err = OpenFile(controller, hwnd, ofn.lpstrFile);
                 if(err)
                     return err;
+            }
+            break;
+        }
+        case IDM_OPENMERGED :
+        {
+            error_t err;
+
+            err = ChooseMergedFiles(controller, hwnd);
+            if(err)
+                return err;
+
+            break;
+        }
+        case IDM_FOLLOW :
+        {
+            if (controller->IsFollowing)
+            {
+                StopFileWatcher(&controller->Watcher);
+                controller->IsFollowing = 0;
+                CheckMenuItem(hMenu, IDM_FOLLOW, MF_UNCHECKED);
+                break;
+            }
 
-                err = SetRectSize(hwnd, controller, windowWidth, windowHeight);
+            if (!controller->IsNotActive)
+            {
+                error_t err;
+
+                err = StartFileWatcher(&controller->Watcher, controller->Model.FileName, hwnd);
                 if(err)
                     return err;
-
-                InvalidateRect(hwnd, NULL, TRUE);
-                UpdateWindow(hwnd);
-            }
-            break;
-        }
+            }
+            controller->IsFollowing = 1;
+            CheckMenuItem(hMenu, IDM_FOLLOW, MF_CHECKED);
+            break;
+        }
         case IDM_EXIT :
             SendMessage(hwnd, WM_CLOSE, 0, 0L);
             break;
@@ -311,10 +2149,7 @@ error_t Menu(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
             error_t err;
 
             SetMode(controller, DEFAULT);
-            CheckMenuItem(hMenu, IDM_DEFAULT, MF_CHECKED);
-            CheckMenuItem(hMenu, IDM_LAYOUT, MF_UNCHECKED);
-            EnableMenuItem(hMenu, IDM_DEFAULT, MF_GRAYED);
-            EnableMenuItem(hMenu, IDM_LAYOUT, MF_ENABLED);
+            CheckModeMenu(hwnd, DEFAULT);
             err = SetRectSize(hwnd, controller, -1, -1);
             if(err)
                 return err;
@@ -326,16 +2161,128 @@ error_t Menu(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
             error_t err;
 
             SetMode(controller, LAYOUT);
-            CheckMenuItem(hMenu, IDM_DEFAULT, MF_UNCHECKED);
-            CheckMenuItem(hMenu, IDM_LAYOUT, MF_CHECKED);
-            EnableMenuItem(hMenu, IDM_DEFAULT, MF_ENABLED);
-            EnableMenuItem(hMenu, IDM_LAYOUT, MF_GRAYED);
+            CheckModeMenu(hwnd, LAYOUT);
             err = SetRectSize(hwnd, controller, -1, -1);
             if(err)
                 return err;
 
             break;
         }
+        case IDM_FILTER:
+        {
+            error_t err;
+
+            err = FilterLines(controller, hwnd);
+            if(err)
+                return err;
+
+            break;
+        }
+        case IDM_TAB2:
+        {
+            error_t err;
+
+            CheckMenuItem(hMenu, IDM_TAB2, MF_CHECKED);
+            CheckMenuItem(hMenu, IDM_TAB4, MF_UNCHECKED);
+            CheckMenuItem(hMenu, IDM_TAB8, MF_UNCHECKED);
+            EnableMenuItem(hMenu, IDM_TAB2, MF_GRAYED);
+            EnableMenuItem(hMenu, IDM_TAB4, MF_ENABLED);
+            EnableMenuItem(hMenu, IDM_TAB8, MF_ENABLED);
+            err = SetTabSize(controller, hwnd, 2);
+            if(err)
+                return err;
+
+            break;
+        }
+        case IDM_TAB4:
+        {
+            error_t err;
+
+            CheckMenuItem(hMenu, IDM_TAB2, MF_UNCHECKED);
+            CheckMenuItem(hMenu, IDM_TAB4, MF_CHECKED);
+            CheckMenuItem(hMenu, IDM_TAB8, MF_UNCHECKED);
+            EnableMenuItem(hMenu, IDM_TAB2, MF_ENABLED);
+            EnableMenuItem(hMenu, IDM_TAB4, MF_GRAYED);
+            EnableMenuItem(hMenu, IDM_TAB8, MF_ENABLED);
+            err = SetTabSize(controller, hwnd, 4);
+            if(err)
+                return err;
+
+            break;
+        }
+        case IDM_TAB8:
+        {
+            error_t err;
+
+            CheckMenuItem(hMenu, IDM_TAB2, MF_UNCHECKED);
+            CheckMenuItem(hMenu, IDM_TAB4, MF_UNCHECKED);
+            CheckMenuItem(hMenu, IDM_TAB8, MF_CHECKED);
+            EnableMenuItem(hMenu, IDM_TAB2, MF_ENABLED);
+            EnableMenuItem(hMenu, IDM_TAB4, MF_ENABLED);
+            EnableMenuItem(hMenu, IDM_TAB8, MF_GRAYED);
+            err = SetTabSize(controller, hwnd, 8);
+            if(err)
+                return err;
+
+            break;
+        }
+        case IDM_FIND:
+            OpenFindDialog(controller);
+            break;
+        case IDM_FINDNEXT:
+        {
+            error_t err;
+
+            err = FindNext(controller, hwnd);
+            if(err)
+                return err;
+
+            break;
+        }
+        case IDM_REGEX:
+        {
+            error_t err;
+
+            err = SearchPattern(controller, hwnd);
+            if(err)
+                return err;
+
+            break;
+        }
+        case IDM_NEXTMATCH:
+            ShowNextMatch(controller, hwnd, FIND_FORWARD);
+            break;
+        case IDM_PREVMATCH:
+            ShowNextMatch(controller, hwnd, FIND_BACKWARD);
+            break;
+        case IDM_STOPSEARCH:
+            StopSearch(&controller->Search);
+            controller->Find.ShowFirstMatch = 0;
+            UpdateSearchTitle(controller, hwnd);
+            break;
+        case IDM_KEYWORDS:
+        {
+            error_t err;
+
+            err = HighlightKeywords(controller, hwnd);
+            if(err)
+                return err;
+
+            break;
+        }
+        case IDM_GOTO:
+            GoToPosition(controller, hwnd);
+            break;
+        case IDM_GOTOTIME:
+        {
+            error_t err;
+
+            err = GoToTime(controller, hwnd);
+            if(err)
+                return err;
+
+            break;
+        }
         case IDM_ABOUT :
             MessageBox(hwnd, "Interfaces Lab",
                         "About", MB_OK | MB_ICONINFORMATION);
@@ -347,6 +2294,74 @@ error_t Menu(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
     return SUCCESS;
 }
 
+/*  Handles the message of the find dialog. The search continues from the shown occurrence
+    if the view was not scrolled since, otherwise from the upper left corner of the window
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    WPARAM wParam - data that was sent to WndProc
+    LPARAM lParam - data that was sent to WndProc
+    HWND hwnd - data that was sent to WndProc
+RETURN:
+    error_t - error code
+*/
+error_t FindDialogMessage(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
+{
+    const FINDREPLACE *params = (const FINDREPLACE *)lParam;
+
+    if (params->Flags & FR_DIALOGTERM)
+    {
+        controller->Find.Dialog = NULL;
+        return SUCCESS;
+    }
+
+    if ((params->Flags & FR_FINDNEXT) && !controller->IsMerged)
+        return FindNext(controller, hwnd);
+
+    return SUCCESS;
+}
+
+/*  Shows the number of the matches found so far in the title and the first match
+    after the view when it is found, the finished search continues on the new lines
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    WPARAM wParam - data that was sent to WndProc
+    LPARAM lParam - data that was sent to WndProc
+    HWND hwnd - data that was sent to WndProc
+RETURN:
+    error_t - error code
+*/
+error_t SearchProgress(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
+{
+    find_state_t *find = &controller->Find;
+    error_t err;
+
+    /* The notification may come from the search of a previous pattern */
+    if (controller->IsNotActive || (unsigned long)lParam != controller->Search.SearchId)
+        return SUCCESS;
+
+    if (wParam)
+    {
+        err = ContinueSearch(&controller->Search);
+        if (err != SUCCESS)
+            return err;
+    }
+
+    if (find->ShowFirstMatch)
+    {
+        LockModel(&controller->Model);
+        if (ShowSearchMatch(controller, hwnd, GetViewOffset(&controller->Model, &controller->View), FIND_FORWARD))
+            find->ShowFirstMatch = 0;
+        UnlockModel(&controller->Model);
+
+        /* The match before the view is left for the user to go back to */
+        if (controller->Search.Thread == NULL)
+            find->ShowFirstMatch = 0;
+    }
+
+    UpdateSearchTitle(controller, hwnd);
+    return SUCCESS;
+}
+
 /*  Sets the font for displaying text
 INPUT:
     controller_t *controller - pointer to an instance of a structure containing a model and a view
@@ -371,7 +2386,18 @@ void Display(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd)
     if(controller->IsNotActive)
         return;
 
-    DisplayView(hwnd, &controller->View);
+    if (controller->IsMerged)
+    {
+        LockMergedLog(&controller->Merge);
+        DisplayMergedView(hwnd, &controller->Merge, &controller->View);
+        UnlockMergedLog(&controller->Merge);
+        return;
+    }
+
+    /* The loader must not change the lines while they are being displayed */
+    LockModel(&controller->Model);
+    DisplayView(hwnd, &controller->Model, &controller->View);
+    UnlockModel(&controller->Model);
 }
 
 /*  Clears the model and view data
@@ -383,6 +2409,15 @@ void ClearControllerData(controller_t *controller)
     if (controller == NULL)
         return;
 
+    StopFileWatcher(&controller->Watcher);
+    StopRelayout(controller);
+    StopSampling(controller);
+    ClearSearch(&controller->Search);
+    ClearTimeIndex(&controller->Times);
+    ClearTimeIndex(&controller->NextTimes);
+    controller->IsTimePending = 0;
+    ClearMergedLog(&controller->Merge);
+    controller->IsMerged = 0;
     ClearModel(&controller->Model);
     ClearViewData(&controller->View);
     controller->IsNotActive = 1;
@@ -397,6 +2432,15 @@ void ClearController(controller_t *controller)
     if (controller == NULL)
         return;
 
+    StopFileWatcher(&controller->Watcher);
+    StopRelayout(controller);
+    StopSampling(controller);
+    ClearSearch(&controller->Search);
+    ClearTimeIndex(&controller->Times);
+    ClearTimeIndex(&controller->NextTimes);
+    controller->IsTimePending = 0;
+    ClearMergedLog(&controller->Merge);
+    controller->IsMerged = 0;
     ClearModel(&controller->Model);
     ClearView(&controller->View);
     controller->IsNotActive = 1;
@@ -3,11 +3,67 @@
 
 #include "../view/fileScreenView.h"
 #include "../menu/menu.h"
+#include "relayoutScheduler.h"
+#include "../model/fileWatcher.h"
+#include "../model/textSearch.h"
+#include "../model/indexCache.h"
+#include "../model/timeIndex.h"
 
 #include <time.h>
 
 #define FONTHEIGHT 18
 #define HOLD 0.1 * CLOCKS_PER_SEC
+#define THREADS_VARIABLE "VIEWER_THREADS"               /* Environment variable capping the number of worker threads */
+#define LAYOUT_CACHE_VARIABLE "VIEWER_LAYOUT_CACHE"     /* Environment variable with the layout cache budget in MB */
+#define BLOCK_CACHE_VARIABLE "VIEWER_BLOCK_CACHE"       /* Environment variable with the file block cache budget in MB */
+#define INDEX_CACHE_VARIABLE "VIEWER_INDEX_CACHE"       /* Environment variable with the disk budget of the saved indexes in MB */
+#define RELAYOUT_TIMER 1                                /* Timer starting the postponed relayout */
+#define RELAYOUT_PART_LINES (4ul << 20)                 /* The number of lines laid out under one lock of the model */
+#define SAMPLE_PART_LINES (1ul << 20)                   /* The number of lines sampled under one lock of the model */
+#define FIND_TEXT_SIZE 256                              /* Size of the buffer of the find dialog text */
+#define KEYWORDS_TEXT_SIZE 16384                        /* Size of the buffer of the highlighted keywords */
+#define WINDOW_TITLE "FileReader"                       /* Title of the window, the search state follows it */
+#define MERGED_NAMES_SIZE 32768                         /* Size of the buffer of the names of the merged files */
+
+/* Message posted to the window when the background relayout is finished
+   (wParam is the generation of the relayout, lParam is the error code) */
+#define WM_RELAYOUT_DONE (WM_APP + 2)
+
+/* Message posted to the window when the timestamps are sampled in the background
+   (wParam is the SampleId of the sampling, lParam is the error code) */
+#define WM_SAMPLE_DONE (WM_APP + 5)
+
+/* Kind of the position of the go to dialog, in the order of its buttons */
+typedef enum
+{
+    GO_TO_LINE,         /* The line number counted from one */
+    GO_TO_OFFSET,       /* The byte offset */
+    GO_TO_PERCENT       /* The percentage of the loaded characters */
+} go_to_t;
+
+/*  Text and options of the find dialog, the searched pattern and the last shown occurrence */
+typedef struct
+{
+    HWND Dialog;                    /* The modeless find dialog or NULL */
+    UINT Message;                   /* Message the find dialog sends to the window */
+    FINDREPLACE Params;             /* Parameters of the find dialog, its buffer is What */
+    char What[FIND_TEXT_SIZE];      /* The searched text in the ANSI code page */
+    char Pattern[FIND_TEXT_SIZE];   /* The regular expression in the ANSI code page */
+    int IsPatternCaseMatched;       /* Nonzero if the case of the letters of the pattern is matched */
+    int ShowFirstMatch;             /* Nonzero if the first match after the view is shown when it is found */
+    char Keywords[KEYWORDS_TEXT_SIZE];  /* The highlighted keywords in the ANSI code page */
+    int IsKeywordCaseMatched;       /* Nonzero if the case of the letters of the keywords is matched */
+    char Filter[FIND_TEXT_SIZE];    /* The literal or the regular expression of the filter in the ANSI code page */
+    int IsFilterRegex;              /* Nonzero if the filter is a regular expression */
+    int IsFilterCaseMatched;        /* Nonzero if the case of the letters of the filter is matched */
+    char GoTo[FIND_TEXT_SIZE];      /* The rejected text of the go to dialog or the empty text */
+    go_to_t GoToKind;               /* Kind of the position of the go to dialog */
+    char Time[FIND_TEXT_SIZE];      /* The rejected text of the go to time dialog or the empty text */
+    time_format_t TimeFormat;       /* Format of the timestamps of the go to time dialog */
+    int HasMatch;                   /* Nonzero if an occurrence is shown */
+    offset_t MatchOffset;           /* Offset of the shown occurrence */
+    index_t MatchScrollPos;         /* Vertical scroll position the occurrence was shown at */
+} find_state_t;
 
 /*  The structure that implements the controller */
 typedef struct
@@ -16,6 +72,34 @@ typedef struct
 
     model_t Model;     /* An instance of the model that the controller is working with */
     view_t View;       /* An instance of the view that the controller is working with */
+
+    relayout_scheduler_t Scheduler;     /* Coalesces the window size changes */
+    layout_t NextLayout;                /* Layout built in the background */
+    HANDLE Relayout;                    /* Thread building NextLayout or NULL */
+    volatile long CancelRelayout;       /* Nonzero when the relayout must stop */
+    unsigned long RelayoutGeneration;   /* Generation of the running relayout */
+    unsigned long RelayoutColumns;      /* The number of characters in a row of NextLayout */
+    long RelayoutWidth;                 /* The width of the workspace NextLayout is built for */
+    long RelayoutHeight;                /* The height of the workspace NextLayout is built for */
+    HWND RelayoutWindow;                /* Window receiving WM_RELAYOUT_DONE */
+
+    int IsFollowing;                    /* Nonzero if the growth of the file is followed */
+    file_watcher_t Watcher;             /* Watches the opened file in the follow mode */
+
+    find_state_t Find;                  /* State of the search */
+    search_t Search;                    /* Background search of the regular expression */
+    time_index_t Times;                 /* Timestamps of the sampled lines in the format of the last jump */
+    time_index_t NextTimes;             /* Timestamps sampled in the background in another format */
+    HANDLE Sampler;                     /* Thread sampling NextTimes or NULL */
+    volatile long CancelSampling;       /* Nonzero when the sampling must stop */
+    unsigned long SampleId;             /* Identifier of the last started sampling, 0 if there is none */
+    time_format_t SampleFormat;         /* Format of the last started sampling */
+    int IsNextSampled;                  /* Nonzero if the last started sampling reached the end of the lines */
+    int IsTimePending;                  /* Nonzero if the view goes to the time of the dialog when it is sampled */
+    HWND SampleWindow;                  /* Window receiving WM_SAMPLE_DONE */
+
+    int IsMerged;                       /* Nonzero if the merged files are shown instead of the model */
+    merged_log_t Merge;                 /* Lines of several files interleaved by their timestamps */
 } controller_t;
 
 /*  Sets the mode of displaying text
@@ -32,14 +116,38 @@ INPUT:
 */
 void InitController(controller_t *controller, HWND hwnd);
 
-/*  Fills the model with data from the file
+/*  Fills the model with data from the file, the lines are loaded in the background
 INPUT:
     controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle which receives the loading progress
     const char *filename - the name of the file from which the data is taken
 RETURN:
     error_t - error code
 */
-error_t ReadFileIntoModel(controller_t *controller, const char *filename);
+error_t ReadFileIntoModel(controller_t *controller, HWND hwnd, const char *filename);
+
+/*  Shows the lines loaded so far and refines the scrollbar range
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    WPARAM wParam - data that was sent to WndProc
+    LPARAM lParam - data that was sent to WndProc
+    HWND hwnd - data that was sent to WndProc
+RETURN:
+    error_t - error code
+*/
+error_t ModelProgress(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd);
+
+/*  Indexes the data appended to the followed file and keeps the view at the bottom
+    if it was there. A truncated or rotated file is opened again
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    WPARAM wParam - data that was sent to WndProc
+    LPARAM lParam - data that was sent to WndProc
+    HWND hwnd - data that was sent to WndProc
+RETURN:
+    error_t - error code
+*/
+error_t FileChanged(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd);
 
 /*  Rebuilds the view according to the new window sizes and performs
     the necessary changes in the display of scrollbars
@@ -53,6 +161,49 @@ RETURN:
 */
 error_t SetRectSize(HWND hwnd, controller_t *controller, long windowWidth, long windowHeight);
 
+/*  Handles the window size change. The view is rebuilt at once when the rows stay
+    the same, otherwise the change is coalesced with the following ones and the
+    layout is built in the background while the old one is shown
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    WPARAM wParam - data that was sent to WndProc
+    LPARAM lParam - data that was sent to WndProc
+    HWND hwnd - data that was sent to WndProc
+RETURN:
+    error_t - error code
+*/
+error_t WindowResize(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd);
+
+/*  Starts the postponed relayout when it is due
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    HWND hwnd - window handle for which the displaying will be performed
+*/
+void RelayoutTimer(controller_t *controller, HWND hwnd);
+
+/*  Shows the layout built in the background unless it is superseded
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    WPARAM wParam - data that was sent to WndProc
+    LPARAM lParam - data that was sent to WndProc
+    HWND hwnd - data that was sent to WndProc
+RETURN:
+    error_t - error code
+*/
+error_t RelayoutDone(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd);
+
+/*  Finishes the background sampling of the timestamps and goes to the time
+    of the dialog if the jump waits for it
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    WPARAM wParam - data that was sent to WndProc
+    LPARAM lParam - data that was sent to WndProc
+    HWND hwnd - data that was sent to WndProc
+RETURN:
+    error_t - error code
+*/
+error_t SamplingDone(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd);
+
 /*  Handles vertical scrollbar events
 INPUT:
     controller_t *controller - pointer to an instance of a structure containing a model and a view
@@ -100,6 +251,30 @@ RETURN:
 */
 error_t Menu(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd);
 
+/*  Handles the message of the find dialog. The search continues from the shown occurrence
+    if the view was not scrolled since, otherwise from the upper left corner of the window
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    WPARAM wParam - data that was sent to WndProc
+    LPARAM lParam - data that was sent to WndProc
+    HWND hwnd - data that was sent to WndProc
+RETURN:
+    error_t - error code
+*/
+error_t FindDialogMessage(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd);
+
+/*  Shows the number of the matches found so far in the title and the first match
+    after the view when it is found, the finished search continues on the new lines
+INPUT:
+    controller_t *controller - pointer to an instance of a structure containing a model and a view
+    WPARAM wParam - data that was sent to WndProc
+    LPARAM lParam - data that was sent to WndProc
+    HWND hwnd - data that was sent to WndProc
+RETURN:
+    error_t - error code
+*/
+error_t SearchProgress(controller_t *controller, WPARAM wParam, LPARAM lParam, HWND hwnd);
+
 /*  Sets the font for displaying text
 INPUT:
     controller_t *controller - pointer to an instance of a structure containing a model and a view
@@ -0,0 +1,132 @@
+#include "relayoutScheduler.h"
+
+/*  Initializes the scheduler
+INPUT:
+    relayout_scheduler_t *scheduler - pointer on scheduler structure
+OUTPUT:
+    relayout_scheduler_t *scheduler - pointer on idle scheduler structure
+*/
+void InitRelayoutScheduler(relayout_scheduler_t *scheduler)
+{
+    scheduler->Width = 0;
+    scheduler->Height = 0;
+    scheduler->IsPending = 0;
+    scheduler->FirstRequest = 0;
+    scheduler->LastRequest = 0;
+    scheduler->Generation = 0;
+    scheduler->Running = 0;
+}
+
+/*  Drops the pending and the running relayouts. The generations keep growing,
+    so the results of the dropped relayouts are recognized as stale
+INPUT:
+    relayout_scheduler_t *scheduler - pointer on scheduler structure
+*/
+void ResetRelayoutScheduler(relayout_scheduler_t *scheduler)
+{
+    scheduler->IsPending = 0;
+    scheduler->Running = 0;
+}
+
+/*  Records the new size of the workspace
+INPUT:
+    relayout_scheduler_t *scheduler - pointer on scheduler structure
+    long width - the width of the workspace
+    long height - the height of the workspace
+    unsigned long now - the current time in milliseconds
+RETURN:
+    int - nonzero if the running relayout is superseded and should be cancelled
+*/
+int RequestRelayout(relayout_scheduler_t *scheduler, long width, long height, unsigned long now)
+{
+    if (!scheduler->IsPending)
+        scheduler->FirstRequest = now;
+
+    scheduler->Width = width;
+    scheduler->Height = height;
+    scheduler->IsPending = 1;
+    scheduler->LastRequest = now;
+
+    /* Zero is left for the idle state */
+    if (++scheduler->Generation == 0)
+        scheduler->Generation = 1;
+
+    return scheduler->Running != 0;
+}
+
+/*  Returns the time left until the pending relayout should be started
+INPUT:
+    const relayout_scheduler_t *scheduler - pointer on scheduler structure
+    unsigned long now - the current time in milliseconds
+RETURN:
+    unsigned long - milliseconds, 0 if it is due or NO_RELAYOUT if nothing can be started
+*/
+unsigned long GetRelayoutDelay(const relayout_scheduler_t *scheduler, unsigned long now)
+{
+    unsigned long quiet;
+    unsigned long waited;
+
+    if (!scheduler->IsPending || scheduler->Running != 0)
+        return NO_RELAYOUT;
+
+    /* The differences are correct when the millisecond counter wraps */
+    quiet = now - scheduler->LastRequest;
+    waited = now - scheduler->FirstRequest;
+    if (quiet >= RELAYOUT_QUIET || waited >= RELAYOUT_MAX_DELAY)
+        return 0;
+
+    if (RELAYOUT_MAX_DELAY - waited < RELAYOUT_QUIET - quiet)
+        return RELAYOUT_MAX_DELAY - waited;
+    return RELAYOUT_QUIET - quiet;
+}
+
+/*  Starts the pending relayout if it is due
+INPUT:
+    relayout_scheduler_t *scheduler - pointer on scheduler structure
+    unsigned long now - the current time in milliseconds
+    long *width - the width of the workspace to build
+    long *height - the height of the workspace to build
+    unsigned long *generation - the number passed to FinishRelayout
+RETURN:
+    int - nonzero if the relayout is started
+*/
+int StartRelayout(relayout_scheduler_t *scheduler, unsigned long now,
+                  long *width, long *height, unsigned long *generation)
+{
+    if (GetRelayoutDelay(scheduler, now) != 0)
+        return 0;
+
+    *width = scheduler->Width;
+    *height = scheduler->Height;
+    *generation = scheduler->Generation;
+    scheduler->Running = scheduler->Generation;
+    scheduler->IsPending = 0;
+    return 1;
+}
+
+/*  Finishes the running relayout
+INPUT:
+    relayout_scheduler_t *scheduler - pointer on scheduler structure
+    unsigned long generation - the number given by StartRelayout
+RETURN:
+    int - nonzero if the result is up to date and should be shown
+*/
+int FinishRelayout(relayout_scheduler_t *scheduler, unsigned long generation)
+{
+    if (scheduler->Running != generation)
+        return 0;
+
+    scheduler->Running = 0;
+    return generation == scheduler->Generation;
+}
+
+/*  Checks whether a relayout is pending or running
+INPUT:
+    const relayout_scheduler_t *scheduler - pointer on scheduler structure
+RETURN:
+    int - nonzero if the scheduler is not idle
+*/
+int IsRelayoutBusy(const relayout_scheduler_t *scheduler)
+{
+    return scheduler->IsPending || scheduler->Running != 0;
+}
@@ -0,0 +1,88 @@
+#ifndef __RELAYOUT_SCHEDULER_H_INCLUDED
+#define __RELAYOUT_SCHEDULER_H_INCLUDED
+
+#define RELAYOUT_QUIET 40           /* Milliseconds without size changes before the relayout starts */
+#define RELAYOUT_MAX_DELAY 200      /* Milliseconds a continuous resize may postpone the relayout */
+#define NO_RELAYOUT ((unsigned long)-1) /* Delay returned when there is nothing to start */
+
+/*  Coalesces bursts of window size changes into background relayouts. Only one
+    relayout runs at a time, a newer request supersedes the running one. The
+    scheduler knows nothing about windows or threads: the caller passes the
+    current time in milliseconds and starts the work itself */
+typedef struct
+{
+    long Width;                     /* Requested width of the workspace */
+    long Height;                    /* Requested height of the workspace */
+    int IsPending;                  /* Nonzero if the requested size is not being built */
+    unsigned long FirstRequest;     /* Time of the first request not being built */
+    unsigned long LastRequest;      /* Time of the last request */
+    unsigned long Generation;       /* Number of the last request */
+    unsigned long Running;          /* Generation being built or 0 */
+} relayout_scheduler_t;
+
+/*  Initializes the scheduler
+INPUT:
+    relayout_scheduler_t *scheduler - pointer on scheduler structure
+OUTPUT:
+    relayout_scheduler_t *scheduler - pointer on idle scheduler structure
+*/
+void InitRelayoutScheduler(relayout_scheduler_t *scheduler);
+
+/*  Drops the pending and the running relayouts. The generations keep growing,
+    so the results of the dropped relayouts are recognized as stale
+INPUT:
+    relayout_scheduler_t *scheduler - pointer on scheduler structure
+*/
+void ResetRelayoutScheduler(relayout_scheduler_t *scheduler);
+
+/*  Records the new size of the workspace
+INPUT:
+    relayout_scheduler_t *scheduler - pointer on scheduler structure
+    long width - the width of the workspace
+    long height - the height of the workspace
+    unsigned long now - the current time in milliseconds
+RETURN:
+    int - nonzero if the running relayout is superseded and should be cancelled
+*/
+int RequestRelayout(relayout_scheduler_t *scheduler, long width, long height, unsigned long now);
+
+/*  Returns the time left until the pending relayout should be started
+INPUT:
+    const relayout_scheduler_t *scheduler - pointer on scheduler structure
+    unsigned long now - the current time in milliseconds
+RETURN:
+    unsigned long - milliseconds, 0 if it is due or NO_RELAYOUT if nothing can be started
+*/
+unsigned long GetRelayoutDelay(const relayout_scheduler_t *scheduler, unsigned long now);
+
+/*  Starts the pending relayout if it is due
+INPUT:
+    relayout_scheduler_t *scheduler - pointer on scheduler structure
+    unsigned long now - the current time in milliseconds
+    long *width - the width of the workspace to build
+    long *height - the height of the workspace to build
+    unsigned long *generation - the number passed to FinishRelayout
+RETURN:
+    int - nonzero if the relayout is started
+*/
+int StartRelayout(relayout_scheduler_t *scheduler, unsigned long now,
+                  long *width, long *height, unsigned long *generation);
+
+/*  Finishes the running relayout
+INPUT:
+    relayout_scheduler_t *scheduler - pointer on scheduler structure
+    unsigned long generation - the number given by StartRelayout
+RETURN:
+    int - nonzero if the result is up to date and should be shown
+*/
+int FinishRelayout(relayout_scheduler_t *scheduler, unsigned long generation);
+
+/*  Checks whether a relayout is pending or running
+INPUT:
+    const relayout_scheduler_t *scheduler - pointer on scheduler structure
+RETURN:
+    int - nonzero if the scheduler is not idle
+*/
+int IsRelayoutBusy(const relayout_scheduler_t *scheduler);
+
+#endif // __RELAYOUT_SCHEDULER_H_INCLUDED
@@ -1,5 +1,4 @@
 #include "error.h"
-#include <string.h>
 
 /* Displays a window with an error message
 INPUT:
@@ -8,17 +7,39 @@ INPUT:
 */
 void DisplayMessageBox(HWND hwnd, error_t err)
 {
-    char buffer [20];
+    const char *message;
+
     switch(err)
     {
         case NO_INPUT_FILE:
-            strcpy(buffer, "File not found!");
+            message = "File not found!";
             break;
         case MEMORY_SHORTAGE:
-            strcpy(buffer, "Not enough memory!");
+            message = "Not enough memory!";
+            break;
+        case DAMAGED_FILE:
+            message = "File is damaged!";
+            break;
+        case UNSUPPORTED_FORMAT:
+            message = "Unsupported format!";
+            break;
+        case BAD_PATTERN:
+            message = "Invalid pattern!";
+            break;
+        case BAD_POSITION:
+            message = "Invalid position!";
+            break;
+        case BAD_TIME:
+            message = "Invalid time!";
+            break;
+        case NO_TIMESTAMPS:
+            message = "No timestamps found!";
+            break;
+        case TOO_MANY_FILES:
+            message = "Too many files!";
             break;
         default:
-            strcpy(buffer, "Unexpected error!");
+            message = "Unexpected error!";
     }
-    MessageBox(hwnd, buffer, "Error details", MB_ICONERROR | MB_OK);
+    MessageBox(hwnd, message, "Error details", MB_ICONERROR | MB_OK);
 }
@@ -9,6 +9,13 @@ typedef enum
     SUCCESS,           /* Returned in case of successful execution */
     NO_INPUT_FILE,     /* Returned if the input file cannot be opened */
     MEMORY_SHORTAGE,   /* Returned if there is not enough memory to complete the task */
+    DAMAGED_FILE,      /* Returned if the compressed data cannot be decoded */
+    UNSUPPORTED_FORMAT,/* Returned if the decoder of the file format is not available */
+    BAD_PATTERN,       /* Returned if the regular expression is not valid */
+    BAD_POSITION,      /* Returned if the position to go to is not a number in its range */
+    BAD_TIME,          /* Returned if the time to go to is not in the format of the timestamps */
+    NO_TIMESTAMPS,     /* Returned if no line starts with a timestamp of the format */
+    TOO_MANY_FILES,    /* Returned if more files are chosen than can be merged */
 } error_t;
 
 /* Displays a window with an error message
@@ -45,7 +45,7 @@ int WINAPI WinMain (HINSTANCE hThisInstance,
     hwnd = CreateWindowEx (
            0,                           /* Extended possibilites for variation */
            _T("GAChevykalovInterface"), /* Classname */
-           _T("FileReader"),            /* Title Text */
+           _T(WINDOW_TITLE),            /* Title Text */
            WS_OVERLAPPEDWINDOW,         /* default window */
            CW_USEDEFAULT,               /* Windows decides the position */
            CW_USEDEFAULT,               /* where the window ends up on the screen */
@@ -63,6 +63,11 @@ int WINAPI WinMain (HINSTANCE hThisInstance,
     /* Run the message loop. It will run until GetMessage() returns 0 */
     while (GetMessage (&messages, NULL, 0, 0))
     {
+        HWND dialog = GetAncestor(messages.hwnd, GA_ROOT);
+
+        /* The modeless find dialog handles its own keyboard navigation */
+        if (dialog != NULL && dialog != hwnd && IsDialogMessage(dialog, &messages))
+            continue;
         /* Translate virtual-key messages into character messages */
         TranslateMessage(&messages);
         /* Send message to WindowProcedure */
@@ -91,7 +96,7 @@ LRESULT CALLBACK WindowProcedure (HWND hwnd, UINT message, WPARAM wParam, LPARAM
 
                 InitController(&controller, hwnd);
                 SetFont(&controller, hwnd, "Consolas", FONTHEIGHT);
-                err = ReadFileIntoModel(&controller, createStruct->lpCreateParams);
+                err = ReadFileIntoModel(&controller, hwnd, createStruct->lpCreateParams);
                 if(err && ((char*)createStruct->lpCreateParams)[0] != 0)
                 {
                     DisplayMessageBox(hwnd, err);
@@ -104,7 +109,7 @@ LRESULT CALLBACK WindowProcedure (HWND hwnd, UINT message, WPARAM wParam, LPARAM
             {
                 error_t err;
 
-                err = SetRectSize(hwnd, &controller, LOWORD(lParam), HIWORD(lParam));
+                err = WindowResize(&controller, wParam, lParam, hwnd);
                 if(err)
                 {
                     DisplayMessageBox(hwnd, err);
@@ -113,6 +118,70 @@ LRESULT CALLBACK WindowProcedure (HWND hwnd, UINT message, WPARAM wParam, LPARAM
                 }
             }
             break;
+        case WM_MODEL_PROGRESS:
+            {
+                error_t err;
+
+                err = ModelProgress(&controller, wParam, lParam, hwnd);
+                if(err)
+                {
+                    DisplayMessageBox(hwnd, err);
+                    ClearController(&controller);
+                }
+            }
+            break;
+        case WM_SEARCH_PROGRESS:
+            {
+                error_t err;
+
+                err = SearchProgress(&controller, wParam, lParam, hwnd);
+                if(err)
+                {
+                    DisplayMessageBox(hwnd, err);
+                    ClearController(&controller);
+                }
+            }
+            break;
+        case WM_FILE_CHANGED:
+            {
+                error_t err;
+
+                err = FileChanged(&controller, wParam, lParam, hwnd);
+                if(err)
+                {
+                    DisplayMessageBox(hwnd, err);
+                    ClearController(&controller);
+                }
+            }
+            break;
+        case WM_TIMER:
+            if (wParam == RELAYOUT_TIMER)
+                RelayoutTimer(&controller, hwnd);
+            break;
+        case WM_RELAYOUT_DONE:
+            {
+                error_t err;
+
+                err = RelayoutDone(&controller, wParam, lParam, hwnd);
+                if(err)
+                {
+                    DisplayMessageBox(hwnd, err);
+                    ClearController(&controller);
+                }
+            }
+            break;
+        case WM_SAMPLE_DONE:
+            {
+                error_t err;
+
+                err = SamplingDone(&controller, wParam, lParam, hwnd);
+                if(err)
+                {
+                    DisplayMessageBox(hwnd, err);
+                    ClearController(&controller);
+                }
+            }
+            break;
         case WM_PAINT:
             Display(&controller, wParam, lParam, hwnd);
             break;
@@ -142,6 +211,19 @@ LRESULT CALLBACK WindowProcedure (HWND hwnd, UINT message, WPARAM wParam, LPARAM
             }
             break;
         default:        /* for messages that we don't deal with */
+            /* The message of the find dialog is registered at runtime */
+            if (message != 0 && message == controller.Find.Message)
+            {
+                error_t err;
+
+                err = FindDialogMessage(&controller, wParam, lParam, hwnd);
+                if(err)
+                {
+                    DisplayMessageBox(hwnd, err);
+                    ClearController(&controller);
+                }
+                break;
+            }
             return DefWindowProc (hwnd, message, wParam, lParam);
     }
 
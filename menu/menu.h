@@ -9,5 +9,33 @@
 #define IDM_COURIER 5   /* ID of the element that switches the font to Courier New */
 #define IDM_LUCIDA 6    /* ID of the element that switches the font to Lucida Console */
 #define IDM_ABOUT 7     /* ID of the element displaying the short info */
+#define IDM_FOLLOW 8    /* ID of the element that switches following the growth of the file */
+#define IDM_TAB2 9      /* ID of the element that sets the tab stops every 2 columns */
+#define IDM_TAB4 10     /* ID of the element that sets the tab stops every 4 columns */
+#define IDM_TAB8 11     /* ID of the element that sets the tab stops every 8 columns */
+#define IDM_FIND 12     /* ID of the element that opens the find dialog */
+#define IDM_FINDNEXT 13 /* ID of the element that finds the next occurrence of the text */
+#define IDM_REGEX 14    /* ID of the element that opens the regular expression dialog */
+#define IDM_NEXTMATCH 15    /* ID of the element that shows the next match of the regular expression */
+#define IDM_PREVMATCH 16    /* ID of the element that shows the previous match of the regular expression */
+#define IDM_STOPSEARCH 17   /* ID of the element that stops the search of the regular expression */
+#define IDM_KEYWORDS 18     /* ID of the element that opens the highlighted keywords dialog */
+#define IDM_FILTER 19       /* ID of the element that opens the filter dialog and switches to the filter mode */
+#define IDM_GOTO 20         /* ID of the element that opens the go to dialog */
+#define IDM_GOTOTIME 21     /* ID of the element that opens the go to time dialog */
+#define IDM_OPENMERGED 22   /* ID of the element that opens several files interleaved by their timestamps */
+
+#define IDC_PATTERN 100     /* ID of the regular expression field of the dialog */
+#define IDC_MATCHCASE 101   /* ID of the match case box of the regular expression and keywords dialogs */
+#define IDC_KEYWORDS 102    /* ID of the keywords field of the keywords dialog */
+#define IDC_REGEX 103       /* ID of the regular expression box of the filter dialog */
+#define IDC_GOTOVALUE 104   /* ID of the position field of the go to dialog */
+#define IDC_GOTOLINE 105    /* ID of the line button of the go to dialog, the buttons follow the order of go_to_t */
+#define IDC_GOTOOFFSET 106  /* ID of the byte offset button of the go to dialog */
+#define IDC_GOTOPERCENT 107 /* ID of the percentage button of the go to dialog */
+#define IDC_TIMEVALUE 108   /* ID of the time field of the go to time dialog */
+#define IDC_TIMEISO 109     /* ID of the ISO 8601 button of the go to time dialog, the buttons follow the order of time_format_t */
+#define IDC_TIMESYSLOG 110  /* ID of the syslog button of the go to time dialog */
+#define IDC_TIMEEPOCH 111   /* ID of the epoch button of the go to time dialog */
 
 #endif // __MENU_H_INCLUDED
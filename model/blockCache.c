@@ -0,0 +1,300 @@
+#include "blockCache.h"
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned long CacheBudget = BLOCK_CACHE_BUDGET; /* Bytes the cached blocks may take */
+
+/*  Sets the memory budget of the cached blocks of every opened file
+INPUT:
+    unsigned long bytes - the number of bytes
+*/
+void SetBlockCacheBudget(unsigned long bytes)
+{
+    CacheBudget = bytes;
+}
+
+/*  Maps the range of the file, the view starts at the block containing the offset
+INPUT:
+    HANDLE mapping - file mapping object
+    offset_t offset - offset of the range
+    size_t size - the number of characters in the range
+    const char **view - the mapped view to be passed to UnmapViewOfFile
+RETURN:
+    const char * - pointer on the character at the offset or NULL
+*/
+const char *MapFileRange(HANDLE mapping, offset_t offset, size_t size, const char **view)
+{
+    /* The view must start at a multiple of the allocation granularity */
+    offset_t start = offset - offset % BLOCK_SIZE;
+
+    *view = MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)(start >> 32), (DWORD)start,
+                          (SIZE_T)(offset - start) + size);
+    if (*view == NULL)
+        return NULL;
+
+    return *view + (offset - start);
+}
+
+/*  Initializes the block cache
+INPUT:
+    block_cache_t *cache - pointer on block cache structure
+OUTPUT:
+    block_cache_t *cache - pointer on empty block cache structure
+*/
+void InitBlockCache(block_cache_t *cache)
+{
+    cache->Mapping = NULL;
+    cache->ReadRange = NULL;
+    cache->Decoder = NULL;
+    cache->Size = 0;
+    cache->Blocks = NULL;
+    cache->NumOfBlocks = 0;
+    cache->Clock = 0;
+    InitializeSRWLock(&cache->Lock);
+    InitializeConditionVariable(&cache->Released);
+}
+
+/*  Prepares the cache for the blocks of the mapping, the blocks are mapped on demand
+INPUT:
+    block_cache_t *cache - pointer on block cache structure
+    HANDLE mapping - file mapping object or NULL for the decoded file
+    read_range_t readRange - decoding function of the decoded file or NULL
+    void *decoder - decoder passed to readRange
+    offset_t size - the number of characters in the mapping or in the decoded output
+RETURN:
+    error_t - error code
+*/
+error_t OpenBlockCache(block_cache_t *cache, HANDLE mapping, read_range_t readRange, void *decoder, offset_t size)
+{
+    unsigned long numOfBlocks = CacheBudget / BLOCK_SIZE;
+
+    if (numOfBlocks < MIN_CACHED_BLOCKS)
+        numOfBlocks = MIN_CACHED_BLOCKS;
+
+    cache->Blocks = calloc(numOfBlocks, sizeof(cached_block_t));
+    if (cache->Blocks == NULL)
+        return MEMORY_SHORTAGE;
+
+    cache->NumOfBlocks = numOfBlocks;
+    cache->Mapping = mapping;
+    cache->ReadRange = readRange;
+    cache->Decoder = decoder;
+    cache->Size = size;
+    return SUCCESS;
+}
+
+/*  Unmaps all the blocks, the buffers of the decoded blocks are freed
+INPUT:
+    block_cache_t *cache - pointer on block cache structure
+*/
+static void UnmapBlocks(block_cache_t *cache)
+{
+    unsigned long i;
+
+    for (i = 0; i < cache->NumOfBlocks; i++)
+        if (cache->Blocks[i].Data != NULL)
+        {
+            if (cache->ReadRange != NULL)
+                free((char *)cache->Blocks[i].Data);
+            else
+                UnmapViewOfFile(cache->Blocks[i].Data);
+            cache->Blocks[i].Data = NULL;
+        }
+}
+
+/*  Unmaps all the blocks and switches the cache to another mapping of the same file,
+    no block may be read meanwhile
+INPUT:
+    block_cache_t *cache - pointer on opened block cache structure
+    HANDLE mapping - file mapping object
+    offset_t size - the number of characters in the mapping
+*/
+void ResetBlockCache(block_cache_t *cache, HANDLE mapping, offset_t size)
+{
+    AcquireSRWLockExclusive(&cache->Lock);
+    UnmapBlocks(cache);
+    cache->Mapping = mapping;
+    cache->Size = size;
+    ReleaseSRWLockExclusive(&cache->Lock);
+}
+
+/*  Sets the size of the growing decoded output, the cached blocks stay and
+    the incomplete ones are decoded again when they are read
+INPUT:
+    block_cache_t *cache - pointer on opened block cache structure
+    offset_t size - the number of characters in the decoded output
+*/
+void SetBlockCacheSize(block_cache_t *cache, offset_t size)
+{
+    AcquireSRWLockExclusive(&cache->Lock);
+    cache->Size = size;
+    ReleaseSRWLockExclusive(&cache->Lock);
+}
+
+/*  Finds the entry of the block and pins it, the least recently used entry
+    nobody reads is reserved for a missing block. The entries loaded by other
+    readers are waited for, as well as a free entry when all of them are pinned
+INPUT:
+    block_cache_t *cache - pointer on opened block cache structure locked exclusively
+    offset_t offset - offset of the block, a multiple of BLOCK_SIZE less than the size
+    offset_t size - the number of characters of the block
+RETURN:
+    cached_block_t * - pointer on the pinned entry, IsLoading is set if the block must be loaded into it
+*/
+static cached_block_t *PinBlock(block_cache_t *cache, offset_t offset, offset_t size)
+{
+    for (;;)
+    {
+        cached_block_t *victim = NULL;
+        int isBusy = 0;
+        unsigned long i;
+
+        for (i = 0; i < cache->NumOfBlocks && !isBusy; i++)
+        {
+            cached_block_t *block = &cache->Blocks[i];
+
+            if ((block->Data != NULL || block->IsLoading) && block->Offset == offset)
+            {
+                /* The output decoded since the block was read is added to it when nobody copies it */
+                int isIncomplete = cache->ReadRange != NULL && block->Length < size;
+
+                if (block->IsLoading || (isIncomplete && block->Pins > 0))
+                {
+                    isBusy = 1;
+                    continue;
+                }
+
+                block->LastUse = ++cache->Clock;
+                block->Pins++;
+                block->IsLoading = isIncomplete;
+                return block;
+            }
+
+            if (block->Pins == 0 && (victim == NULL
+                || (victim->Data != NULL && (block->Data == NULL || block->LastUse < victim->LastUse))))
+                victim = block;
+        }
+
+        if (!isBusy && victim != NULL)
+        {
+            victim->Offset = offset;
+            victim->LastUse = ++cache->Clock;
+            victim->Pins = 1;
+            victim->IsLoading = 1;
+            return victim;
+        }
+
+        SleepConditionVariableSRW(&cache->Released, &cache->Lock, INFINITE, 0);
+    }
+}
+
+/*  Maps or decodes the block into the pinned entry, the cache is not locked meanwhile
+INPUT:
+    block_cache_t *cache - pointer on opened block cache structure locked exclusively
+    cached_block_t *block - the pinned entry with IsLoading set
+    offset_t size - the number of characters of the block
+*/
+static void LoadBlock(block_cache_t *cache, cached_block_t *block, offset_t size)
+{
+    /* The entry is reserved, so its old data belongs to this reader */
+    char *data = (char *)block->Data;
+    const char *view = NULL;
+    offset_t length = 0;
+
+    if (cache->ReadRange == NULL)
+        block->Data = NULL;
+    ReleaseSRWLockExclusive(&cache->Lock);
+
+    if (cache->ReadRange != NULL)
+    {
+        if (data == NULL)
+            data = malloc(BLOCK_SIZE);
+        if (data != NULL)
+            length = cache->ReadRange(cache->Decoder, block->Offset, data, (size_t)size);
+        view = data;
+    }
+    else
+    {
+        if (data != NULL)
+            UnmapViewOfFile(data);
+        if (MapFileRange(cache->Mapping, block->Offset, (size_t)size, &view) != NULL)
+            length = size;
+    }
+
+    AcquireSRWLockExclusive(&cache->Lock);
+    block->Data = view;
+    block->Length = length;
+    block->IsLoading = 0;
+    WakeAllConditionVariable(&cache->Released);
+}
+
+/*  Copies the characters of the file, the missing blocks are mapped or decoded
+INPUT:
+    block_cache_t *cache - pointer on opened block cache structure
+    offset_t offset - offset of the first character
+    char *buffer - buffer receiving the characters
+    offset_t size - the number of characters to copy
+RETURN:
+    offset_t - the number of copied characters, less than size at the end of
+               the file or when a block cannot be mapped
+*/
+offset_t ReadBlocks(block_cache_t *cache, offset_t offset, char *buffer, offset_t size)
+{
+    offset_t copied = 0;
+
+    /* The lookup changes the use times and the pins, so it is exclusive */
+    AcquireSRWLockExclusive(&cache->Lock);
+    if (offset >= cache->Size)
+        size = 0;
+    else if (size > cache->Size - offset)
+        size = cache->Size - offset;
+
+    while (copied < size)
+    {
+        offset_t start = offset + copied;
+        offset_t blockOffset = start - start % BLOCK_SIZE;
+        offset_t blockSize = cache->Size - blockOffset < BLOCK_SIZE ? cache->Size - blockOffset : BLOCK_SIZE;
+        cached_block_t *block = PinBlock(cache, blockOffset, blockSize);
+        offset_t part = 0;
+
+        if (block->IsLoading)
+            LoadBlock(cache, block, blockSize);
+
+        /* The pinned block stays while it is copied without the lock */
+        if (block->Data != NULL && block->Length > start - blockOffset)
+        {
+            part = blockOffset + block->Length - start;
+            if (part > size - copied)
+                part = size - copied;
+
+            ReleaseSRWLockExclusive(&cache->Lock);
+            memcpy(buffer + copied, block->Data + (start - blockOffset), (size_t)part);
+            AcquireSRWLockExclusive(&cache->Lock);
+        }
+
+        block->Pins--;
+        WakeAllConditionVariable(&cache->Released);
+        if (part == 0)
+            break;
+        copied += part;
+    }
+    ReleaseSRWLockExclusive(&cache->Lock);
+
+    return copied;
+}
+
+/*  Unmaps all the blocks and clears the cache
+INPUT:
+    block_cache_t *cache - pointer on block cache structure
+OUTPUT:
+    block_cache_t *cache - pointer on block cache structure filled with zero values
+*/
+void ClearBlockCache(block_cache_t *cache)
+{
+    if (cache == NULL)
+        return;
+
+    UnmapBlocks(cache);
+    free(cache->Blocks);
+    InitBlockCache(cache);
+}
@@ -0,0 +1,121 @@
+#ifndef __BLOCK_CACHE_H_INCLUDED
+#define __BLOCK_CACHE_H_INCLUDED
+
+#include <windows.h>
+#include "../error/error.h"
+#include "modelTypes.h"
+
+#define BLOCK_SIZE (1ul << 20)                  /* Size of one cached block, a multiple of the allocation granularity */
+#define BLOCK_CACHE_BUDGET (64ul * 1024 * 1024) /* Default memory budget of the cached blocks in bytes */
+#define MIN_CACHED_BLOCKS 2                     /* A read crossing the block border needs both blocks */
+
+/*  Decodes the characters of the decoded output of the file, less than size
+    are returned if the output ends or the data is damaged */
+typedef size_t (*read_range_t)(void *decoder, offset_t offset, char *buffer, size_t size);
+
+/*  Mapped view or decoded characters of one block of the file */
+typedef struct
+{
+    offset_t Offset;            /* Offset of the block in the file */
+    const char *Data;           /* Characters of the block or NULL for a free entry */
+    offset_t Length;            /* The number of valid characters, the decoded block may end early */
+    unsigned long LastUse;      /* Time of the last use for the LRU eviction */
+    unsigned long Pins;         /* The number of readers copying or loading the block, it is not evicted */
+    int IsLoading;              /* Nonzero while the block is mapped or decoded, the readers wait for it */
+} cached_block_t;
+
+/*  Keeps a bounded set of fixed-size blocks of the file mapped, so a file
+    larger than the address space or the free memory is read by blocks.
+    The least recently used block is unmapped to map a new one. The blocks
+    of a compressed or transcoded file are decoded into the buffers of the entries.
+    The lock only guards the entries: a reader pins the entry it copies from and
+    maps or decodes a missing block into a reserved entry without the lock, so
+    the readers of the cached blocks do not wait for it */
+typedef struct
+{
+    HANDLE Mapping;                 /* File mapping object the blocks are mapped from, not owned */
+    read_range_t ReadRange;         /* Decoding function of the decoded file or NULL */
+    void *Decoder;                  /* Decoder passed to ReadRange, not owned */
+    offset_t Size;                  /* The number of characters in the mapping or in the decoded output */
+    cached_block_t *Blocks;         /* Mapped blocks */
+    unsigned long NumOfBlocks;      /* The number of entries in Blocks */
+    unsigned long Clock;            /* Counter of the block reads */
+    SRWLOCK Lock;                   /* Guards the entries, every read may evict a block */
+    CONDITION_VARIABLE Released;    /* Signaled when a block is loaded or unpinned */
+} block_cache_t;
+
+/*  Sets the memory budget of the cached blocks of every opened file
+INPUT:
+    unsigned long bytes - the number of bytes
+*/
+void SetBlockCacheBudget(unsigned long bytes);
+
+/*  Maps the range of the file, the view starts at the block containing the offset
+INPUT:
+    HANDLE mapping - file mapping object
+    offset_t offset - offset of the range
+    size_t size - the number of characters in the range
+    const char **view - the mapped view to be passed to UnmapViewOfFile
+RETURN:
+    const char * - pointer on the character at the offset or NULL
+*/
+const char *MapFileRange(HANDLE mapping, offset_t offset, size_t size, const char **view);
+
+/*  Initializes the block cache
+INPUT:
+    block_cache_t *cache - pointer on block cache structure
+OUTPUT:
+    block_cache_t *cache - pointer on empty block cache structure
+*/
+void InitBlockCache(block_cache_t *cache);
+
+/*  Prepares the cache for the blocks of the mapping, the blocks are mapped on demand
+INPUT:
+    block_cache_t *cache - pointer on block cache structure
+    HANDLE mapping - file mapping object or NULL for the decoded file
+    read_range_t readRange - decoding function of the decoded file or NULL
+    void *decoder - decoder passed to readRange
+    offset_t size - the number of characters in the mapping or in the decoded output
+RETURN:
+    error_t - error code
+*/
+error_t OpenBlockCache(block_cache_t *cache, HANDLE mapping, read_range_t readRange, void *decoder, offset_t size);
+
+/*  Unmaps all the blocks and switches the cache to another mapping of the same file,
+    no block may be read meanwhile
+INPUT:
+    block_cache_t *cache - pointer on opened block cache structure
+    HANDLE mapping - file mapping object
+    offset_t size - the number of characters in the mapping
+*/
+void ResetBlockCache(block_cache_t *cache, HANDLE mapping, offset_t size);
+
+/*  Sets the size of the growing decoded output, the cached blocks stay and
+    the incomplete ones are decoded again when they are read
+INPUT:
+    block_cache_t *cache - pointer on opened block cache structure
+    offset_t size - the number of characters in the decoded output
+*/
+void SetBlockCacheSize(block_cache_t *cache, offset_t size);
+
+/*  Copies the characters of the file, the missing blocks are mapped or decoded
+INPUT:
+    block_cache_t *cache - pointer on opened block cache structure
+    offset_t offset - offset of the first character
+    char *buffer - buffer receiving the characters
+    offset_t size - the number of characters to copy
+RETURN:
+    offset_t - the number of copied characters, less than size at the end of
+               the file or when a block cannot be mapped
+*/
+offset_t ReadBlocks(block_cache_t *cache, offset_t offset, char *buffer, offset_t size);
+
+/*  Unmaps all the blocks and clears the cache
+INPUT:
+    block_cache_t *cache - pointer on block cache structure
+OUTPUT:
+    block_cache_t *cache - pointer on block cache structure filled with zero values
+*/
+void ClearBlockCache(block_cache_t *cache);
+
+#endif // __BLOCK_CACHE_H_INCLUDED
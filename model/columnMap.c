@@ -0,0 +1,181 @@
+#include "columnMap.h"
+
+#define MIN_POINTS 16   /* Initial number of checkpoints of a map */
+
+/*  Initializes the column maps
+INPUT:
+    column_maps_t *maps - pointer on column maps structure
+OUTPUT:
+    column_maps_t *maps - pointer on column maps structure without maps
+*/
+void InitColumnMaps(column_maps_t *maps)
+{
+    int i;
+
+    InitializeSRWLock(&maps->Lock);
+    for (i = 0; i < COLUMN_MAP_LINES; i++)
+    {
+        maps->Maps[i].LineStart = 0;
+        maps->Maps[i].Points = NULL;
+        maps->Maps[i].NumOfPoints = 0;
+        maps->Maps[i].Capacity = 0;
+        maps->Maps[i].LastUse = 0;
+    }
+    maps->Clock = 0;
+}
+
+/*  Finds the map of the line, the lock must be held
+INPUT:
+    column_maps_t *maps - pointer on column maps structure
+    offset_t lineStart - offset of the line in the model
+RETURN:
+    column_map_t * - the map or NULL if the line has none
+*/
+static column_map_t *FindColumnMap(column_maps_t *maps, offset_t lineStart)
+{
+    int i;
+
+    for (i = 0; i < COLUMN_MAP_LINES; i++)
+        if (maps->Maps[i].Points != NULL && maps->Maps[i].LineStart == lineStart)
+        {
+            maps->Maps[i].LastUse = ++maps->Clock;
+            return &maps->Maps[i];
+        }
+
+    return NULL;
+}
+
+/*  Finds the checkpoints of the line around the column
+INPUT:
+    column_maps_t *maps - pointer on column maps structure
+    offset_t lineStart - offset of the line in the model
+    offset_t column - the column
+    column_point_t *point - the last checkpoint starting not after the column,
+                            the beginning of the line if there is none
+    column_point_t *last - the last checkpoint of the line, the beginning of the
+                           line if the line has no map
+*/
+void FindColumnPoint(column_maps_t *maps, offset_t lineStart, offset_t column, column_point_t *point,
+                     column_point_t *last)
+{
+    column_map_t *map;
+    size_t low = 0;
+    size_t high;
+
+    point->Offset = point->Column = 0;
+    *last = *point;
+
+    AcquireSRWLockExclusive(&maps->Lock);
+    map = FindColumnMap(maps, lineStart);
+    if (map != NULL)
+    {
+        /* The columns grow with the offsets, the last checkpoint not after the column is searched */
+        high = map->NumOfPoints;
+        while (low < high)
+        {
+            size_t middle = low + (high - low) / 2;
+
+            if (map->Points[middle].Column <= column)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+
+        if (low > 0)
+            *point = map->Points[low - 1];
+        *last = map->Points[map->NumOfPoints - 1];
+    }
+    ReleaseSRWLockExclusive(&maps->Lock);
+}
+
+/*  Appends the checkpoint to the map of the line, a checkpoint not following
+    the last one is ignored. A line without a map takes the least recently used one
+INPUT:
+    column_maps_t *maps - pointer on column maps structure
+    offset_t lineStart - offset of the line in the model
+    const column_point_t *point - the checkpoint
+RETURN:
+    error_t - error code
+*/
+error_t AddColumnPoint(column_maps_t *maps, offset_t lineStart, const column_point_t *point)
+{
+    column_map_t *map;
+    error_t err = SUCCESS;
+    int i;
+
+    AcquireSRWLockExclusive(&maps->Lock);
+    map = FindColumnMap(maps, lineStart);
+    if (map == NULL)
+    {
+        /* A free entry has zero LastUse, so it is taken before the used ones */
+        map = &maps->Maps[0];
+        for (i = 1; i < COLUMN_MAP_LINES; i++)
+            if (maps->Maps[i].LastUse < map->LastUse)
+                map = &maps->Maps[i];
+
+        if (map->Points == NULL)
+        {
+            map->Points = malloc(MIN_POINTS * sizeof(column_point_t));
+            map->Capacity = map->Points != NULL ? MIN_POINTS : 0;
+        }
+        map->LineStart = lineStart;
+        map->NumOfPoints = 0;
+        map->LastUse = ++maps->Clock;
+    }
+
+    if (map->Points == NULL)
+        err = MEMORY_SHORTAGE;
+    else if (map->NumOfPoints == 0 || map->Points[map->NumOfPoints - 1].Offset < point->Offset)
+    {
+        if (map->NumOfPoints == map->Capacity)
+        {
+            column_point_t *tmp = realloc(map->Points, 2 * map->Capacity * sizeof(column_point_t));
+
+            if (tmp != NULL)
+            {
+                map->Points = tmp;
+                map->Capacity *= 2;
+            }
+        }
+
+        if (map->NumOfPoints < map->Capacity)
+            map->Points[map->NumOfPoints++] = *point;
+        else
+            err = MEMORY_SHORTAGE;
+    }
+
+    /* The map must not be left without checkpoints */
+    if (map->Points != NULL && map->NumOfPoints == 0)
+    {
+        free(map->Points);
+        map->Points = NULL;
+        map->Capacity = 0;
+        map->LastUse = 0;
+    }
+    ReleaseSRWLockExclusive(&maps->Lock);
+
+    return err;
+}
+
+/*  Drops the maps of all lines, it is used when the columns of the lines change
+INPUT:
+    column_maps_t *maps - pointer on column maps structure
+OUTPUT:
+    column_maps_t *maps - pointer on column maps structure without maps
+*/
+void ClearColumnMaps(column_maps_t *maps)
+{
+    int i;
+
+    AcquireSRWLockExclusive(&maps->Lock);
+    for (i = 0; i < COLUMN_MAP_LINES; i++)
+    {
+        free(maps->Maps[i].Points);
+        maps->Maps[i].Points = NULL;
+        maps->Maps[i].NumOfPoints = 0;
+        maps->Maps[i].Capacity = 0;
+        maps->Maps[i].LastUse = 0;
+    }
+    maps->Clock = 0;
+    ReleaseSRWLockExclusive(&maps->Lock);
+}
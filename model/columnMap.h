@@ -0,0 +1,79 @@
+#ifndef __COLUMN_MAP_H_INCLUDED
+#define __COLUMN_MAP_H_INCLUDED
+
+#include <windows.h>
+#include "../error/error.h"
+#include "modelTypes.h"
+
+#define COLUMN_MAP_STEP 4096        /* Minimum distance between the checkpoints of a line in columns */
+#define COLUMN_MAP_LINES 64         /* The number of lines whose checkpoints are kept */
+
+/*  Character of a line and the column it starts at */
+typedef struct
+{
+    offset_t Offset;            /* Offset of the character in the line */
+    offset_t Column;            /* The column the character starts at */
+} column_point_t;
+
+/*  Checkpoints of one line ordered by their offsets */
+typedef struct
+{
+    offset_t LineStart;         /* Offset of the line in the model */
+    column_point_t *Points;     /* Checkpoints or NULL for a free entry */
+    size_t NumOfPoints;         /* The number of checkpoints */
+    size_t Capacity;            /* The number of allocated checkpoints */
+    unsigned long LastUse;      /* Time of the last use for the LRU eviction */
+} column_map_t;
+
+/*  Maps of the columns of the recently drawn long lines whose characters are not
+    one column wide. The map of a line is extended lazily up to the searched
+    column, so the search starts at most COLUMN_MAP_STEP columns before it.
+    The least recently used map is dropped to make room for a new one */
+typedef struct
+{
+    SRWLOCK Lock;                           /* Serializes the users, every search updates the LRU order */
+    column_map_t Maps[COLUMN_MAP_LINES];    /* Maps of the lines */
+    unsigned long Clock;                    /* Counter of the searches */
+} column_maps_t;
+
+/*  Initializes the column maps
+INPUT:
+    column_maps_t *maps - pointer on column maps structure
+OUTPUT:
+    column_maps_t *maps - pointer on column maps structure without maps
+*/
+void InitColumnMaps(column_maps_t *maps);
+
+/*  Finds the checkpoints of the line around the column
+INPUT:
+    column_maps_t *maps - pointer on column maps structure
+    offset_t lineStart - offset of the line in the model
+    offset_t column - the column
+    column_point_t *point - the last checkpoint starting not after the column,
+                            the beginning of the line if there is none
+    column_point_t *last - the last checkpoint of the line, the beginning of the
+                           line if the line has no map
+*/
+void FindColumnPoint(column_maps_t *maps, offset_t lineStart, offset_t column, column_point_t *point,
+                     column_point_t *last);
+
+/*  Appends the checkpoint to the map of the line, a checkpoint not following
+    the last one is ignored. A line without a map takes the least recently used one
+INPUT:
+    column_maps_t *maps - pointer on column maps structure
+    offset_t lineStart - offset of the line in the model
+    const column_point_t *point - the checkpoint
+RETURN:
+    error_t - error code
+*/
+error_t AddColumnPoint(column_maps_t *maps, offset_t lineStart, const column_point_t *point);
+
+/*  Drops the maps of all lines, it is used when the columns of the lines change
+INPUT:
+    column_maps_t *maps - pointer on column maps structure
+OUTPUT:
+    column_maps_t *maps - pointer on column maps structure without maps
+*/
+void ClearColumnMaps(column_maps_t *maps);
+
+#endif // __COLUMN_MAP_H_INCLUDED
@@ -0,0 +1,806 @@
+#include "compressedFile.h"
+#include "blockCache.h"
+#include "../thread/threadPool.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define GZIP_MAGIC 0x8B1F           /* The first two characters of a gzip member */
+#define ZSTD_MAGIC 0xFD2FB528       /* The first four characters of a zstd frame */
+#define ZSTD_SKIPPABLE 0x184D2A50   /* The first four characters of a skippable frame, the lowest 4 bits vary */
+#define BGZF_HEADER 18              /* Size of the gzip header with the BGZF extra field */
+#define MIN_POINTS 64               /* The number of seek points allocated at first */
+
+/* Buffers of the zstd streaming decoder, the same as ZSTD_inBuffer and ZSTD_outBuffer */
+typedef struct
+{
+    const void *Src;
+    size_t Size;
+    size_t Pos;
+} zstd_in_t;
+
+typedef struct
+{
+    void *Dst;
+    size_t Size;
+    size_t Pos;
+} zstd_out_t;
+
+/* Functions of the zstd library */
+typedef void *(*zstd_create_t)(void);
+typedef size_t (*zstd_free_t)(void *stream);
+typedef size_t (*zstd_decompress_t)(void *stream, zstd_out_t *out, zstd_in_t *in);
+typedef unsigned (*zstd_is_error_t)(size_t result);
+
+static HMODULE zstdLibrary = NULL;              /* The loaded zstd library or NULL */
+static zstd_create_t zstdCreate = NULL;         /* ZSTD_createDCtx */
+static zstd_free_t zstdFree = NULL;             /* ZSTD_freeDCtx */
+static zstd_decompress_t zstdDecompress = NULL; /* ZSTD_decompressStream */
+static zstd_is_error_t zstdIsError = NULL;      /* ZSTD_isError */
+
+/*  Loads the zstd library once, the viewer works without it for other files
+RETURN:
+    error_t - error code, UNSUPPORTED_FORMAT if the library is not available
+*/
+static error_t LoadZstd(void)
+{
+    HMODULE library;
+
+    if (zstdLibrary != NULL)
+        return SUCCESS;
+
+    library = LoadLibrary(ZSTD_LIBRARY);
+    if (library == NULL)
+        return UNSUPPORTED_FORMAT;
+
+    zstdCreate = (zstd_create_t)GetProcAddress(library, "ZSTD_createDCtx");
+    zstdFree = (zstd_free_t)GetProcAddress(library, "ZSTD_freeDCtx");
+    zstdDecompress = (zstd_decompress_t)GetProcAddress(library, "ZSTD_decompressStream");
+    zstdIsError = (zstd_is_error_t)GetProcAddress(library, "ZSTD_isError");
+    if (zstdCreate == NULL || zstdFree == NULL || zstdDecompress == NULL || zstdIsError == NULL)
+    {
+        FreeLibrary(library);
+        return UNSUPPORTED_FORMAT;
+    }
+
+    zstdLibrary = library;
+    return SUCCESS;
+}
+
+/*  Finds the format of the file by its first characters
+INPUT:
+    HANDLE mapping - file mapping object
+    offset_t size - the number of characters in the file
+RETURN:
+    compression_t - format of the file
+*/
+compression_t DetectCompression(HANDLE mapping, offset_t size)
+{
+    compression_t type = COMPRESSION_NONE;
+    const unsigned char *data;
+    const char *view;
+
+    if (size < 4)
+        return COMPRESSION_NONE;
+
+    data = (const unsigned char *)MapFileRange(mapping, 0, 4, &view);
+    if (data == NULL)
+        return COMPRESSION_NONE;
+
+    if ((data[0] | data[1] << 8) == GZIP_MAGIC)
+        type = COMPRESSION_GZIP;
+    else if ((data[0] | data[1] << 8 | data[2] << 16 | (unsigned long)data[3] << 24) == ZSTD_MAGIC)
+        type = COMPRESSION_ZSTD;
+
+    UnmapViewOfFile(view);
+    return type;
+}
+
+/*  Initializes the compressed file
+INPUT:
+    compressed_file_t *file - pointer on compressed file structure
+OUTPUT:
+    compressed_file_t *file - pointer on compressed file structure filled with zero values
+*/
+void InitCompressedFile(compressed_file_t *file)
+{
+    file->Type = COMPRESSION_NONE;
+    file->Mapping = NULL;
+    file->InSize = 0;
+
+    InitializeSRWLock(&file->Lock);
+    file->Points = NULL;
+    file->NumOfPoints = 0;
+    file->Capacity = 0;
+    file->Windows = INVALID_HANDLE_VALUE;
+    file->NumOfWindows = 0;
+
+    file->NextIn = 0;
+    file->OutSize = 0;
+    file->Units = NULL;
+    file->NumOfUnits = 0;
+    file->NextUnit = 0;
+    file->Inflate = NULL;
+    file->Stream = NULL;
+    InitCompressedInput(&file->Input, NULL, 0);
+    file->StreamEnd = 0;
+    file->StreamHint = 0;
+    file->Piece = NULL;
+}
+
+/*  Prepares the decoding of the compressed file
+INPUT:
+    compressed_file_t *file - pointer on compressed file structure
+    HANDLE mapping - file mapping object
+    offset_t size - the number of compressed characters
+    compression_t type - format of the file
+RETURN:
+    error_t - error code, UNSUPPORTED_FORMAT if the decoder is not available
+*/
+error_t OpenCompressedFile(compressed_file_t *file, HANDLE mapping, offset_t size, compression_t type)
+{
+    if (type == COMPRESSION_ZSTD && LoadZstd() != SUCCESS)
+        return UNSUPPORTED_FORMAT;
+
+    file->Units = calloc(MAX_UNITS, sizeof(compressed_unit_t));
+    file->Piece = malloc(STREAM_PIECE);
+    if (file->Units == NULL || file->Piece == NULL)
+    {
+        ClearCompressedFile(file);
+        return MEMORY_SHORTAGE;
+    }
+
+    file->Type = type;
+    file->Mapping = mapping;
+    file->InSize = size;
+    InitCompressedInput(&file->Input, mapping, size);
+    return SUCCESS;
+}
+
+/*  Creates the temporary file keeping the windows of the seek points
+INPUT:
+    compressed_file_t *file - pointer on opened compressed file structure
+RETURN:
+    error_t - error code
+*/
+static error_t CreateWindowFile(compressed_file_t *file)
+{
+    char directory[MAX_PATH];
+    char path[MAX_PATH];
+    DWORD length = GetTempPath(MAX_PATH, directory);
+
+    if (length == 0 || length >= MAX_PATH || GetTempFileName(directory, "tvw", 0, path) == 0)
+        return NO_INPUT_FILE;
+
+    /* The file disappears when it is closed, also when the viewer is terminated */
+    file->Windows = CreateFile(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    if (file->Windows == INVALID_HANDLE_VALUE)
+    {
+        DeleteFile(path);
+        return NO_INPUT_FILE;
+    }
+
+    return SUCCESS;
+}
+
+/*  Adds the seek point if it is far enough from the last one, the window is
+    written into the temporary file. A point which cannot be saved is skipped,
+    the reading only starts from an earlier point then
+INPUT:
+    compressed_file_t *file - pointer on opened compressed file structure
+    offset_t out - offset of the next output character
+    offset_t inBits - offset of the compressed data in bits
+    const inflate_t *inflate - pointer on the decoder whose window is needed or NULL
+*/
+static void AddSeekPoint(compressed_file_t *file, offset_t out, offset_t inBits, const inflate_t *inflate)
+{
+    unsigned char window[INFLATE_WINDOW];
+    seek_point_t *point;
+    LARGE_INTEGER position;
+    DWORD written;
+
+    if (file->NumOfPoints > 0 && out - file->Points[file->NumOfPoints - 1].Out < SEEK_SPAN)
+        return;
+
+    AcquireSRWLockExclusive(&file->Lock);
+    if (file->NumOfPoints == file->Capacity)
+    {
+        unsigned long capacity = file->Capacity > 0 ? file->Capacity * 2 : MIN_POINTS;
+        seek_point_t *points = realloc(file->Points, capacity * sizeof(seek_point_t));
+
+        if (points == NULL)
+        {
+            ReleaseSRWLockExclusive(&file->Lock);
+            return;
+        }
+        file->Points = points;
+        file->Capacity = capacity;
+    }
+
+    point = &file->Points[file->NumOfPoints];
+    point->Out = out;
+    point->InBits = inBits;
+    point->Window = NO_WINDOW;
+
+    if (inflate != NULL)
+    {
+        GetInflateWindow(inflate, window);
+        position.QuadPart = (LONGLONG)file->NumOfWindows * INFLATE_WINDOW;
+        if ((file->Windows == INVALID_HANDLE_VALUE && CreateWindowFile(file) != SUCCESS) ||
+            !SetFilePointerEx(file->Windows, position, NULL, FILE_BEGIN) ||
+            !WriteFile(file->Windows, window, INFLATE_WINDOW, &written, NULL) || written != INFLATE_WINDOW)
+        {
+            ReleaseSRWLockExclusive(&file->Lock);
+            return;
+        }
+        point->Window = file->NumOfWindows++;
+    }
+
+    file->NumOfPoints++;
+    ReleaseSRWLockExclusive(&file->Lock);
+}
+
+/*  Finds the last seek point before the offset and reads its window
+INPUT:
+    compressed_file_t *file - pointer on opened compressed file structure
+    offset_t offset - offset in the output
+    seek_point_t *point - the found point
+    unsigned char *window - buffer of INFLATE_WINDOW characters receiving the window
+RETURN:
+    error_t - error code
+*/
+static error_t FindSeekPoint(compressed_file_t *file, offset_t offset, seek_point_t *point, unsigned char *window)
+{
+    unsigned long low = 0;
+    unsigned long high;
+    LARGE_INTEGER position;
+    DWORD read;
+    error_t err = SUCCESS;
+
+    /* The window file has one file pointer, so even the lookup is exclusive */
+    AcquireSRWLockExclusive(&file->Lock);
+    if (file->NumOfPoints == 0)
+    {
+        ReleaseSRWLockExclusive(&file->Lock);
+        return DAMAGED_FILE;
+    }
+
+    high = file->NumOfPoints - 1;
+    while (low < high)
+    {
+        unsigned long middle = low + (high - low + 1) / 2;
+
+        if (file->Points[middle].Out <= offset)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+    *point = file->Points[low];
+
+    if (point->Window != NO_WINDOW)
+    {
+        position.QuadPart = (LONGLONG)point->Window * INFLATE_WINDOW;
+        if (!SetFilePointerEx(file->Windows, position, NULL, FILE_BEGIN) ||
+            !ReadFile(file->Windows, window, INFLATE_WINDOW, &read, NULL) || read != INFLATE_WINDOW)
+            err = NO_INPUT_FILE;
+    }
+    ReleaseSRWLockExclusive(&file->Lock);
+
+    return err;
+}
+
+/*  Finds the end of the zstd frame by the sizes of its blocks without decoding it
+INPUT:
+    compressed_input_t *input - input of the compressed file
+    offset_t offset - offset of the frame
+    offset_t *end - offset of the next frame
+RETURN:
+    error_t - error code
+*/
+static error_t FindZstdFrameEnd(compressed_input_t *input, offset_t offset, offset_t *end)
+{
+    static const unsigned char dictionarySize[4] = {0, 1, 2, 4};
+    unsigned char header[5];
+    unsigned long magic, isLast;
+    int fcsFlag, isSingleSegment;
+    error_t err;
+
+    err = ReadCompressedInput(input, offset, header, 4);
+    if (err != SUCCESS)
+        return err;
+    magic = header[0] | header[1] << 8 | header[2] << 16 | (unsigned long)header[3] << 24;
+
+    /* The skippable frame has its size after the magic number */
+    if ((magic & 0xFFFFFFF0) == ZSTD_SKIPPABLE)
+    {
+        err = ReadCompressedInput(input, offset + 4, header, 4);
+        *end = offset + 8 + (header[0] | header[1] << 8 | header[2] << 16 | (unsigned long)header[3] << 24);
+        return err == SUCCESS && *end > input->Size ? DAMAGED_FILE : err;
+    }
+    if (magic != ZSTD_MAGIC || (err = ReadCompressedInput(input, offset + 4, header, 1)) != SUCCESS)
+        return DAMAGED_FILE;
+
+    /* The frame header descriptor gives the sizes of the optional header fields */
+    fcsFlag = header[0] >> 6;
+    isSingleSegment = (header[0] >> 5) & 1;
+    offset += 5 + !isSingleSegment + dictionarySize[header[0] & 3] + (fcsFlag == 0 ? isSingleSegment : 1 << fcsFlag);
+    *end = header[0] & 4 ? 4 : 0;
+
+    do
+    {
+        unsigned long blockHeader, type;
+
+        if ((err = ReadCompressedInput(input, offset, header, 3)) != SUCCESS)
+            return err;
+        blockHeader = header[0] | header[1] << 8 | (unsigned long)header[2] << 16;
+        isLast = blockHeader & 1;
+        type = (blockHeader >> 1) & 3;
+        if (type == 3)
+            return DAMAGED_FILE;
+
+        /* The run-length block keeps one character */
+        offset += 3 + (type == 1 ? 1 : blockHeader >> 3);
+    } while (!isLast);
+
+    *end += offset;
+    return *end > input->Size ? DAMAGED_FILE : SUCCESS;
+}
+
+/*  Finds the end of the gzip member written in its BGZF extra field
+INPUT:
+    compressed_input_t *input - input of the compressed file
+    offset_t offset - offset of the member
+    offset_t *end - offset of the next member
+RETURN:
+    int - nonzero if the member has the size
+*/
+static int FindGzipMemberEnd(compressed_input_t *input, offset_t offset, offset_t *end)
+{
+    unsigned char header[BGZF_HEADER];
+
+    /* The flags, the extra length and the subfield 'BC' of two characters */
+    if (ReadCompressedInput(input, offset, header, BGZF_HEADER) != SUCCESS || (header[0] | header[1] << 8) != GZIP_MAGIC ||
+        !(header[3] & 0x04) || header[12] != 'B' || header[13] != 'C' || header[14] != 2 || header[15] != 0)
+        return 0;
+
+    *end = offset + (header[16] | header[17] << 8) + 1;
+    return *end <= input->Size;
+}
+
+/*  Decodes zstd frames until the buffer is full or the input ends
+INPUT:
+    void *stream - zstd decoder
+    compressed_input_t *input - input of the compressed file
+    offset_t end - offset of the end of the input
+    char *buffer - buffer receiving the characters
+    size_t size - the size of the buffer
+    size_t *produced - the number of decoded characters
+    size_t *hint - the last result of the decoder, nonzero before the first call
+OUTPUT:
+    size_t *hint - the last result of the decoder, zero after a complete frame
+RETURN:
+    error_t - error code
+*/
+static error_t DecodeZstd(void *stream, compressed_input_t *input, offset_t end, char *buffer, size_t size,
+                          size_t *produced, size_t *hint)
+{
+    zstd_out_t out = {buffer, size, 0};
+    zstd_in_t in;
+    size_t last;
+    error_t err;
+
+    *produced = 0;
+    while (out.Pos < size)
+    {
+        offset_t available = end - input->Offset;
+
+        if (available > input->Length)
+            available = input->Length;
+        if (input->Next == available && input->Offset + input->Next < end)
+        {
+            err = FillCompressedInput(input);
+            if (err != SUCCESS)
+                return err;
+            continue;
+        }
+
+        /* The decoder asks for the next frame after a complete one */
+        if (input->Offset + input->Next >= end && *hint == 0)
+            break;
+
+        in.Src = input->Data;
+        in.Size = (size_t)available;
+        in.Pos = input->Next;
+        last = out.Pos;
+        *hint = zstdDecompress(stream, &out, &in);
+        input->Next = in.Pos;
+        *produced = out.Pos;
+        if (zstdIsError(*hint))
+            return DAMAGED_FILE;
+
+        /* The input is over, the frame is cut off when nothing more comes out */
+        if (input->Offset + input->Next >= end && out.Pos == last && *hint != 0)
+            return DAMAGED_FILE;
+    }
+
+    *produced = out.Pos;
+    return SUCCESS;
+}
+
+/*  Decodes one unit of the batch into its own buffer
+INPUT:
+    void *arg - pointer on compressed file structure
+    unsigned long index - index of the unit
+*/
+static void DecodeUnit(void *arg, unsigned long index)
+{
+    compressed_file_t *file = arg;
+    compressed_unit_t *unit = &file->Units[index];
+    size_t capacity = 0;
+    inflate_t *inflate = NULL;
+    void *stream = NULL;
+    compressed_input_t input;
+    size_t produced;
+    size_t hint = 1;
+
+    InitCompressedInput(&input, file->Mapping, file->InSize);
+    SeekCompressedInput(&input, unit->In);
+    if (file->Type == COMPRESSION_GZIP)
+    {
+        /* The input ends with the member, so the decoder stops after it */
+        inflate = malloc(sizeof(inflate_t));
+        unit->Error = inflate != NULL ? InitInflate(inflate, file->Mapping, unit->End, unit->In * 8, NULL, 0)
+                                      : MEMORY_SHORTAGE;
+    }
+    else
+    {
+        stream = zstdCreate();
+        unit->Error = stream != NULL ? SUCCESS : MEMORY_SHORTAGE;
+    }
+
+    while (unit->Error == SUCCESS)
+    {
+        if (unit->Size == capacity)
+        {
+            char *data;
+
+            /* Logs are compressed several times, the first guess avoids most of the reallocations */
+            capacity = capacity > 0 ? capacity * 2 : (size_t)(unit->End - unit->In) * 4 + INFLATE_WINDOW;
+            data = realloc(unit->Data, capacity);
+            if (data == NULL)
+            {
+                unit->Error = MEMORY_SHORTAGE;
+                break;
+            }
+            unit->Data = data;
+        }
+
+        if (inflate != NULL)
+            unit->Error = Inflate(inflate, unit->Data + unit->Size, capacity - unit->Size, &produced);
+        else
+            unit->Error = DecodeZstd(stream, &input, unit->End, unit->Data + unit->Size, capacity - unit->Size,
+                                     &produced, &hint);
+        unit->Size += produced;
+
+        if (unit->Size < capacity && (inflate != NULL ? inflate->State == INFLATE_END : 1))
+            break;
+    }
+
+    if (inflate != NULL)
+    {
+        ClearInflate(inflate);
+        free(inflate);
+    }
+    if (stream != NULL)
+        zstdFree(stream);
+    ClearCompressedInput(&input);
+}
+
+/*  Frees the characters of the decoded units
+INPUT:
+    compressed_file_t *file - pointer on compressed file structure
+*/
+static void FreeUnits(compressed_file_t *file)
+{
+    unsigned long i;
+
+    for (i = 0; i < file->NumOfUnits; i++)
+        free(file->Units[i].Data);
+
+    file->NumOfUnits = 0;
+    file->NextUnit = 0;
+}
+
+/*  Starts the sequential decoding of the data whose units have unknown or too large sizes
+INPUT:
+    compressed_file_t *file - pointer on opened compressed file structure
+    offset_t end - offset of the end of the large zstd frame
+RETURN:
+    error_t - error code
+*/
+static error_t StartStream(compressed_file_t *file, offset_t end)
+{
+    error_t err;
+
+    if (file->Type == COMPRESSION_GZIP)
+    {
+        /* The rest of the gzip file is decoded sequentially, the blocks give the seek points */
+        file->Inflate = malloc(sizeof(inflate_t));
+        if (file->Inflate == NULL)
+            return MEMORY_SHORTAGE;
+
+        err = InitInflate(file->Inflate, file->Mapping, file->InSize, file->NextIn * 8, NULL, file->OutSize);
+        file->NextIn = file->InSize;
+        return err;
+    }
+
+    /* The decoding can start only at the frame */
+    file->Stream = zstdCreate();
+    if (file->Stream == NULL)
+        return MEMORY_SHORTAGE;
+
+    AddSeekPoint(file, file->OutSize, file->NextIn * 8, NULL);
+    SeekCompressedInput(&file->Input, file->NextIn);
+    file->StreamEnd = end;
+    file->StreamHint = 1;
+    file->NextIn = end;
+    return SUCCESS;
+}
+
+/*  Finds the next units of the first pass and decodes them in parallel
+INPUT:
+    compressed_file_t *file - pointer on opened compressed file structure
+RETURN:
+    error_t - error code
+*/
+static error_t DecodeBatch(compressed_file_t *file)
+{
+    compressed_input_t input;
+    offset_t in = file->NextIn;
+    offset_t end = 0;
+    error_t err = SUCCESS;
+
+    FreeUnits(file);
+    InitCompressedInput(&input, file->Mapping, file->InSize);
+    while (file->NumOfUnits < MAX_UNITS && in < file->InSize && in - file->NextIn < MAX_BATCH_SIZE)
+    {
+        compressed_unit_t *unit = &file->Units[file->NumOfUnits];
+
+        if (file->Type == COMPRESSION_GZIP)
+            err = FindGzipMemberEnd(&input, in, &end) ? SUCCESS : NO_INPUT_FILE;
+        else
+            err = FindZstdFrameEnd(&input, in, &end);
+        if (err != SUCCESS || end - in > MAX_UNIT_SIZE)
+            break;
+
+        unit->In = in;
+        unit->End = end;
+        unit->Data = NULL;
+        unit->Size = 0;
+        unit->Error = SUCCESS;
+        file->NumOfUnits++;
+        in = end;
+    }
+    ClearCompressedInput(&input);
+
+    /* The found units are decoded before the one stopping the batch */
+    if (file->NumOfUnits == 0)
+    {
+        if (file->Type == COMPRESSION_ZSTD && err != SUCCESS)
+            return err;
+        return StartStream(file, end);
+    }
+
+    RunParallel(DecodeUnit, file, file->NumOfUnits);
+    file->NextIn = in;
+    return SUCCESS;
+}
+
+/*  Decodes the next piece of the sequentially decoded gzip data
+INPUT:
+    compressed_file_t *file - pointer on opened compressed file structure
+    size_t *size - the number of decoded characters
+RETURN:
+    error_t - error code
+*/
+static error_t DecodeGzipPiece(compressed_file_t *file, size_t *size)
+{
+    inflate_t *inflate = file->Inflate;
+    error_t err = SUCCESS;
+    size_t produced;
+
+    while (*size < STREAM_PIECE && inflate->State != INFLATE_END && err == SUCCESS)
+    {
+        /* The decoder stops at every boundary, the distant ones become the seek points */
+        if (inflate->State == INFLATE_MEMBER)
+            AddSeekPoint(file, inflate->Out, GetInflateBitOffset(inflate), NULL);
+        else if (inflate->State == INFLATE_BLOCK)
+            AddSeekPoint(file, inflate->Out, GetInflateBitOffset(inflate), inflate);
+
+        err = Inflate(inflate, file->Piece + *size, STREAM_PIECE - *size, &produced);
+        *size += produced;
+    }
+
+    if (inflate->State == INFLATE_END)
+    {
+        ClearInflate(inflate);
+        free(inflate);
+        file->Inflate = NULL;
+    }
+    return err;
+}
+
+/*  Decodes the next piece of the large zstd frame
+INPUT:
+    compressed_file_t *file - pointer on opened compressed file structure
+    size_t *size - the number of decoded characters
+RETURN:
+    error_t - error code
+*/
+static error_t DecodeZstdPiece(compressed_file_t *file, size_t *size)
+{
+    error_t err = DecodeZstd(file->Stream, &file->Input, file->StreamEnd, file->Piece, STREAM_PIECE, size,
+                             &file->StreamHint);
+
+    if (err != SUCCESS || *size < STREAM_PIECE)
+    {
+        zstdFree(file->Stream);
+        file->Stream = NULL;
+        ClearCompressedInput(&file->Input);
+    }
+    return err;
+}
+
+/*  Decodes the next characters of the first pass and remembers the seek points.
+    The frames and the members whose sizes are written in the file are decoded
+    in parallel, the others sequentially
+INPUT:
+    compressed_file_t *file - pointer on opened compressed file structure
+    const char **data - the decoded characters valid until the next call
+    size_t *size - the number of decoded characters, zero at the end of the file
+RETURN:
+    error_t - error code
+*/
+error_t DecodeNextPiece(compressed_file_t *file, const char **data, size_t *size)
+{
+    error_t err = SUCCESS;
+
+    *data = file->Piece;
+    *size = 0;
+
+    /* The returned unit is not needed anymore */
+    if (file->NextUnit > 0)
+    {
+        free(file->Units[file->NextUnit - 1].Data);
+        file->Units[file->NextUnit - 1].Data = NULL;
+    }
+
+    while (*size == 0 && err == SUCCESS)
+    {
+        if (file->NextUnit < file->NumOfUnits)
+        {
+            compressed_unit_t *unit = &file->Units[file->NextUnit++];
+
+            /* Every unit may start the decoding */
+            AddSeekPoint(file, file->OutSize, unit->In * 8, NULL);
+            *data = unit->Data;
+            *size = unit->Size;
+            err = unit->Error;
+        }
+        else if (file->Inflate != NULL)
+            err = DecodeGzipPiece(file, size);
+        else if (file->Stream != NULL)
+            err = DecodeZstdPiece(file, size);
+        else if (file->NextIn < file->InSize)
+            err = DecodeBatch(file);
+        else
+            break;
+    }
+
+    file->OutSize += *size;
+    return err;
+}
+
+/*  Decodes the characters already found by the first pass starting from the nearest seek point
+INPUT:
+    compressed_file_t *file - pointer on opened compressed file structure
+    offset_t offset - offset of the first character in the output
+    char *buffer - buffer receiving the characters
+    size_t size - the number of characters to decode
+RETURN:
+    size_t - the number of decoded characters, less than size if the data is damaged
+*/
+size_t ReadCompressedRange(void *decoder, offset_t offset, char *buffer, size_t size)
+{
+    compressed_file_t *file = decoder;
+    unsigned char window[INFLATE_WINDOW];
+    inflate_t *inflate = NULL;
+    void *stream = NULL;
+    compressed_input_t input;
+    seek_point_t point;
+    offset_t out;
+    size_t copied = 0;
+    size_t produced = 0;
+    size_t hint = 1;
+    error_t err;
+
+    err = FindSeekPoint(file, offset, &point, window);
+    if (err != SUCCESS)
+        return 0;
+
+    InitCompressedInput(&input, file->Mapping, file->InSize);
+    if (file->Type == COMPRESSION_GZIP)
+    {
+        inflate = malloc(sizeof(inflate_t));
+        err = inflate != NULL ? InitInflate(inflate, file->Mapping, file->InSize, point.InBits,
+                                            point.Window != NO_WINDOW ? window : NULL, point.Out)
+                              : MEMORY_SHORTAGE;
+    }
+    else
+    {
+        SeekCompressedInput(&input, point.InBits / 8);
+        stream = zstdCreate();
+        err = stream != NULL ? SUCCESS : MEMORY_SHORTAGE;
+    }
+
+    /* The characters before the offset are decoded into the buffer and dropped */
+    out = point.Out;
+    while (err == SUCCESS && copied < size)
+    {
+        size_t part = out < offset && offset - out < size ? (size_t)(offset - out) : size - copied;
+        char *target = out < offset ? buffer : buffer + copied;
+
+        if (inflate != NULL)
+            err = Inflate(inflate, target, part, &produced);
+        else
+            err = DecodeZstd(stream, &input, file->InSize, target, part, &produced, &hint);
+        if (produced == 0)
+            break;
+
+        if (out >= offset)
+            copied += produced;
+        out += produced;
+    }
+
+    if (inflate != NULL)
+    {
+        ClearInflate(inflate);
+        free(inflate);
+    }
+    if (stream != NULL)
+        zstdFree(stream);
+    ClearCompressedInput(&input);
+
+    return copied;
+}
+
+/*  Frees the decoders and the seek points
+INPUT:
+    compressed_file_t *file - pointer on compressed file structure
+OUTPUT:
+    compressed_file_t *file - pointer on compressed file structure filled with zero values
+*/
+void ClearCompressedFile(compressed_file_t *file)
+{
+    if (file == NULL)
+        return;
+
+    if (file->Units != NULL)
+        FreeUnits(file);
+    free(file->Units);
+    if (file->Inflate != NULL)
+    {
+        ClearInflate(file->Inflate);
+        free(file->Inflate);
+    }
+    if (file->Stream != NULL)
+        zstdFree(file->Stream);
+    ClearCompressedInput(&file->Input);
+    free(file->Piece);
+
+    free(file->Points);
+    if (file->Windows != INVALID_HANDLE_VALUE)
+        CloseHandle(file->Windows);
+
+    InitCompressedFile(file);
+}
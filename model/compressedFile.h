@@ -0,0 +1,130 @@
+#ifndef __COMPRESSED_FILE_H_INCLUDED
+#define __COMPRESSED_FILE_H_INCLUDED
+
+#include <windows.h>
+#include "../error/error.h"
+#include "modelTypes.h"
+#include "inflate.h"
+
+#define ZSTD_LIBRARY "libzstd.dll"      /* Library decoding the zstd frames, loaded when needed */
+#define SEEK_SPAN (4ul << 20)           /* Minimum distance between the seek points in output characters */
+#define STREAM_PIECE (4ul << 20)        /* The number of characters decoded sequentially at once */
+#define MAX_UNIT_SIZE (8ul << 20)       /* Larger frames are decoded sequentially, not kept in memory */
+#define MAX_BATCH_SIZE (32ul << 20)     /* The number of compressed characters decoded in parallel at once */
+#define MAX_UNITS 1024                  /* The number of frames or members decoded in parallel at once */
+#define NO_WINDOW ((unsigned long)-1)   /* The seek point needs no window */
+
+/* Format of the opened file */
+typedef enum
+{
+    COMPRESSION_NONE,   /* The file is not compressed */
+    COMPRESSION_GZIP,   /* One or more gzip members */
+    COMPRESSION_ZSTD,   /* One or more zstd frames */
+} compression_t;
+
+/*  Place where the decoding may start without decoding the file from its beginning */
+typedef struct
+{
+    offset_t Out;               /* Offset of the next output character */
+    offset_t InBits;            /* Offset of the compressed data in bits */
+    unsigned long Window;       /* Number of the saved 32 KB window before the block or NO_WINDOW */
+} seek_point_t;
+
+/*  Frame or member whose compressed size is known, so it is decoded in parallel with the others */
+typedef struct
+{
+    offset_t In;                /* Offset of the unit in the compressed file */
+    offset_t End;               /* Offset of the next unit */
+    char *Data;                 /* Decoded characters */
+    size_t Size;                /* The number of decoded characters */
+    error_t Error;              /* Result of the decoding */
+} compressed_unit_t;
+
+/*  Compressed file decoded sequentially once, the seek points found on the way
+    let any part of the output be decoded again starting from the nearest point */
+typedef struct
+{
+    compression_t Type;         /* Format of the file */
+    HANDLE Mapping;             /* File mapping object of the compressed file, not owned */
+    offset_t InSize;            /* The number of compressed characters */
+
+    SRWLOCK Lock;               /* Guards the seek points and the window file */
+    seek_point_t *Points;       /* Seek points ordered by their output offsets */
+    unsigned long NumOfPoints;  /* The number of seek points */
+    unsigned long Capacity;     /* The number of allocated seek points */
+    HANDLE Windows;             /* Temporary file with the windows of the seek points */
+    unsigned long NumOfWindows; /* The number of windows in the file */
+
+    offset_t NextIn;            /* Offset of the data not decoded by the first pass */
+    offset_t OutSize;           /* The number of characters decoded by the first pass */
+    compressed_unit_t *Units;   /* Units decoded in parallel */
+    unsigned long NumOfUnits;   /* The number of units in the last batch */
+    unsigned long NextUnit;     /* Index of the unit returned next */
+    inflate_t *Inflate;         /* Sequential gzip decoder or NULL */
+    void *Stream;               /* Sequential zstd decoder or NULL */
+    compressed_input_t Input;   /* Input of the sequential zstd decoder */
+    offset_t StreamEnd;         /* End of the frame decoded sequentially */
+    size_t StreamHint;          /* The last result of the sequential zstd decoder, zero after the frame */
+    char *Piece;                /* Characters decoded sequentially */
+} compressed_file_t;
+
+/*  Finds the format of the file by its first characters
+INPUT:
+    HANDLE mapping - file mapping object
+    offset_t size - the number of characters in the file
+RETURN:
+    compression_t - format of the file
+*/
+compression_t DetectCompression(HANDLE mapping, offset_t size);
+
+/*  Initializes the compressed file
+INPUT:
+    compressed_file_t *file - pointer on compressed file structure
+OUTPUT:
+    compressed_file_t *file - pointer on compressed file structure filled with zero values
+*/
+void InitCompressedFile(compressed_file_t *file);
+
+/*  Prepares the decoding of the compressed file
+INPUT:
+    compressed_file_t *file - pointer on compressed file structure
+    HANDLE mapping - file mapping object
+    offset_t size - the number of compressed characters
+    compression_t type - format of the file
+RETURN:
+    error_t - error code, UNSUPPORTED_FORMAT if the decoder is not available
+*/
+error_t OpenCompressedFile(compressed_file_t *file, HANDLE mapping, offset_t size, compression_t type);
+
+/*  Decodes the next characters of the first pass and remembers the seek points.
+    The frames and the members whose sizes are written in the file are decoded
+    in parallel, the others sequentially
+INPUT:
+    compressed_file_t *file - pointer on opened compressed file structure
+    const char **data - the decoded characters valid until the next call
+    size_t *size - the number of decoded characters, zero at the end of the file
+RETURN:
+    error_t - error code
+*/
+error_t DecodeNextPiece(compressed_file_t *file, const char **data, size_t *size);
+
+/*  Decodes the characters already found by the first pass starting from the nearest seek point
+INPUT:
+    void *decoder - pointer on opened compressed file structure
+    offset_t offset - offset of the first character in the output
+    char *buffer - buffer receiving the characters
+    size_t size - the number of characters to decode
+RETURN:
+    size_t - the number of decoded characters, less than size if the data is damaged
+*/
+size_t ReadCompressedRange(void *decoder, offset_t offset, char *buffer, size_t size);
+
+/*  Frees the decoders and the seek points
+INPUT:
+    compressed_file_t *file - pointer on compressed file structure
+OUTPUT:
+    compressed_file_t *file - pointer on compressed file structure filled with zero values
+*/
+void ClearCompressedFile(compressed_file_t *file);
+
+#endif // __COMPRESSED_FILE_H_INCLUDED
@@ -1,4 +1,41 @@
 #include "fileModel.h"
+#include "indexCache.h"
+#include <string.h>
+
+#define FIRST_PIECE (256ul << 10)   /* Size of the first portion, enough for the first screen */
+#define MAX_PIECE (64ul << 20)      /* Maximum size of one portion, limits the temporary pointers */
+#define NOTIFY_PERIOD 200           /* Minimum interval between notifications in milliseconds */
+#define COLUMN_CHUNK (16ul << 10)   /* The number of characters read at once while the columns are counted */
+#define MIN_TAB_WORDS 1024          /* Initial number of words of the bit set */
+#define MIN_TASK_WORDS 1024         /* Minimum number of words of the bit set examined by one parallel task */
+#define TASKS_PER_THREAD 4          /* Tasks per pool thread to even out the load */
+#define MIN_FIND_CHUNK (64ul << 10) /* The number of positions searched by one task in the first round */
+#define MAX_FIND_CHUNK (16ul << 20) /* Maximum number of positions searched by one task in one round */
+#define FIND_WINDOW (1ul << 20)     /* The number of positions read at once from the file read by blocks */
+
+/* Shared state of the parallel counting of the widths of the lines having tabs */
+typedef struct
+{
+    const model_t *Model;       /* Pointer on the model */
+    index_t TaskWords;          /* The number of words of the bit set examined by one task */
+    offset_t *Maxima;           /* Maximum width found by every task */
+} parallel_tabs_t;
+
+/* Shared state of one round of the parallel search */
+typedef struct
+{
+    const model_t *Model;       /* Pointer on the model */
+    const literal_t *Literal;   /* The searched literal */
+    find_direction_t Direction; /* Direction of the search */
+    offset_t Start;             /* The first position of the round */
+    offset_t End;               /* Position past the last one of the round */
+    offset_t Limit;             /* The number of searched characters */
+    offset_t ChunkSize;         /* The number of positions searched by one task */
+    offset_t *Found;            /* Occurrence found by every task or NO_MATCH */
+    error_t *Errors;            /* Result of the search of every task */
+} parallel_find_t;
+
+static unsigned long lastLoadId = 0;    /* Identifier of the last started loading */
 
 /* Initializes the model
 INPUT:
@@ -9,89 +46,1309 @@ OUTPUT:
 void InitModel(model_t *model)
 {
     model->Data = NULL;
-    model->Lines = NULL;
     model->Size = 0;
     model->NumOfLines = 0;
     model->MaxLength = 0;
+    model->MaxColumns = 0;
+    model->MaxPlainColumns = 0;
+    model->MaxTabColumns = 0;
+    model->IsUtf8 = 0;
+    model->TabSize = DEFAULT_TAB_SIZE;
+    model->TabLines = NULL;
+    model->TabWords = 0;
+    model->NumOfTabLines = 0;
+    InitColumnMaps(&model->ColumnMaps);
+    model->File = INVALID_HANDLE_VALUE;
+    model->Mapping = NULL;
+    InitBlockCache(&model->Blocks);
+    InitCompressedFile(&model->Compressed);
+    InitTranscodedFile(&model->Transcoded);
+    model->FileName[0] = '\0';
+
+    InitLineIndex(&model->Index);
+    InitializeSRWLock(&model->Lock);
+    model->Loader = NULL;
+    model->CancelLoading = 0;
+    model->IndexedSize = 0;
+    model->LoadError = SUCCESS;
+    model->NotifyWindow = NULL;
+    model->LoadId = 0;
+}
+
+/*  Reads the UTF-8 text of the model part by part until a character starting at the column
+INPUT:
+    const model_t *model - pointer on model structure
+    offset_t offset - offset of the first character of the text
+    offset_t size - the number of characters in the text
+    offset_t from - the column the text starts at
+    offset_t column - the column, the maximum value counts the columns of the whole text
+    int tabSize - the distance between the tab stops or zero if the text has no tabs
+    offset_t *start - the column the found character starts at
+RETURN:
+    offset_t - offset of the found character in the text, size if every character starts before the column
+*/
+static offset_t ScanModelColumns(const model_t *model, offset_t offset, offset_t size, offset_t from, offset_t column,
+                                 int tabSize, offset_t *start)
+{
+    char buffer[COLUMN_CHUNK];
+    offset_t pos = 0;
+
+    *start = from;
+    while (pos < size && *start < column)
+    {
+        offset_t length = size - pos < COLUMN_CHUNK ? size - pos : COLUMN_CHUNK;
+        const char *text = GetModelText(model, offset + pos, buffer, &length);
+        size_t part = (size_t)length;
+        size_t found;
+        offset_t reached;
+
+        if (length == 0)
+            break;
+
+        /* The sequence crossing the end of the part is decoded with the next one */
+        if (pos + length < size && TrimUtf8(text, part) > 0)
+            part = TrimUtf8(text, part);
+
+        if (tabSize > 0)
+            found = FindTabColumn(text, part, *start, column, tabSize, &reached);
+        else
+        {
+            found = FindColumn(text, part, column - *start, &reached);
+            reached += *start;
+        }
+        *start = reached;
+        if (found < part)
+            return pos + found;
+        pos += part;
+    }
+
+    return pos;
+}
+
+/*  Checks whether the characters of the model are decoded from the file, so
+    the model grows while the file is split on lines
+INPUT:
+    const model_t *model - pointer on model structure
+RETURN:
+    int - nonzero for a compressed or transcoded file
+*/
+static int IsDecodedModel(const model_t *model)
+{
+    return model->Compressed.Type != COMPRESSION_NONE || model->Transcoded.Encoding != ENCODING_UTF8;
+}
+
+/*  Checks whether the model line has tabs, the scanner marks such lines
+INPUT:
+    const model_t *model - pointer on model structure
+    index_t line - index of the line
+RETURN:
+    int - nonzero if the line has tabs
+*/
+int IsModelTabLine(const model_t *model, index_t line)
+{
+    return line / TAB_WORD_BITS < model->TabWords &&
+           (model->TabLines[line / TAB_WORD_BITS] >> (line % TAB_WORD_BITS) & 1) != 0;
+}
+
+/*  Finds the maximum width of the lines having tabs in the words of the bit set of one task
+INPUT:
+    void *arg - pointer on parallel counting structure
+    unsigned long index - index of the task
+*/
+static void CountTabLines(void *arg, unsigned long index)
+{
+    parallel_tabs_t *count = arg;
+    const model_t *model = count->Model;
+    index_t word = index * count->TaskWords;
+    index_t last = word + count->TaskWords;
+    offset_t maxColumns = 0;
+
+    if (last > model->TabWords)
+        last = model->TabWords;
+
+    for (; word < last; word++)
+    {
+        unsigned long long bits = model->TabLines[word];
+        index_t line = word * TAB_WORD_BITS;
+
+        for (; bits != 0 && line < model->NumOfLines; bits >>= 1, line++)
+        {
+            offset_t columns;
+
+            if ((bits & 1) == 0)
+                continue;
+
+            columns = GetModelLineColumns(model, line);
+            if (maxColumns < columns)
+                maxColumns = columns;
+        }
+    }
+
+    count->Maxima[index] = maxColumns;
+}
+
+/*  Counts the maximum width of the lines having tabs, the words of the bit set are
+    split between the pool threads
+INPUT:
+    const model_t *model - pointer on model structure
+RETURN:
+    offset_t - the maximum width
+*/
+static offset_t GetTabLinesColumns(const model_t *model)
+{
+    parallel_tabs_t count;
+    index_t numOfTasks = model->TabWords / MIN_TASK_WORDS;
+    offset_t maxColumns = 0;
+    offset_t single;
+    unsigned long i;
+
+    if (model->NumOfTabLines == 0)
+        return 0;
+
+    if (numOfTasks > GetThreadPoolLimit() * TASKS_PER_THREAD)
+        numOfTasks = GetThreadPoolLimit() * TASKS_PER_THREAD;
+    if (numOfTasks == 0)
+        numOfTasks = 1;
+
+    count.Model = model;
+    count.TaskWords = (model->TabWords + numOfTasks - 1) / numOfTasks;
+    count.Maxima = numOfTasks > 1 ? calloc((size_t)numOfTasks, sizeof(offset_t)) : NULL;
+
+    /* Counting in the calling thread if there is little work or no memory for the results */
+    if (count.Maxima == NULL)
+    {
+        count.TaskWords = model->TabWords;
+        count.Maxima = &single;
+        CountTabLines(&count, 0);
+        return single;
+    }
+
+    RunParallel(CountTabLines, &count, (unsigned long)numOfTasks);
+    for (i = 0; i < numOfTasks; i++)
+        if (maxColumns < count.Maxima[i])
+            maxColumns = count.Maxima[i];
+
+    free(count.Maxima);
+    return maxColumns;
+}
+
+/*  Sets the distance between the tab stops. The widths of the lines having tabs
+    are counted again, the lines without them are not read
+INPUT:
+    model_t *model - pointer on model structure
+    int tabSize - the distance between the tab stops in columns
+*/
+void SetModelTabSize(model_t *model, int tabSize)
+{
+    if (tabSize <= 0 || tabSize == model->TabSize)
+        return;
+
+    AcquireSRWLockExclusive(&model->Lock);
+    model->TabSize = tabSize;
+    model->MaxTabColumns = GetTabLinesColumns(model);
+    model->MaxColumns = model->MaxPlainColumns > model->MaxTabColumns ? model->MaxPlainColumns
+                                                                      : model->MaxTabColumns;
+    ClearColumnMaps(&model->ColumnMaps);
+    ReleaseSRWLockExclusive(&model->Lock);
+}
+
+/*  Marks the line as having tabs, the exclusive lock must be held
+INPUT:
+    model_t *model - pointer on model structure
+    index_t line - index of the line
+RETURN:
+    error_t - error code
+*/
+static error_t MarkTabLine(model_t *model, index_t line)
+{
+    index_t word = line / TAB_WORD_BITS;
+    unsigned long long bit = 1ull << (line % TAB_WORD_BITS);
+
+    if (word >= model->TabWords)
+    {
+        index_t words = model->TabWords < MIN_TAB_WORDS ? MIN_TAB_WORDS : model->TabWords * 2;
+        unsigned long long *tmp;
+
+        if (words <= word)
+            words = word + 1;
+        if (!FITS_IN_MEMORY(words, sizeof(unsigned long long)))
+            return MEMORY_SHORTAGE;
+        tmp = realloc(model->TabLines, (size_t)words * sizeof(unsigned long long));
+        if (tmp == NULL)
+            return MEMORY_SHORTAGE;
+
+        memset(tmp + model->TabWords, 0, (size_t)(words - model->TabWords) * sizeof(unsigned long long));
+        model->TabLines = tmp;
+        model->TabWords = words;
+    }
+
+    /* The open line may be marked by several portions */
+    if ((model->TabLines[word] & bit) == 0)
+    {
+        model->TabLines[word] |= bit;
+        model->NumOfTabLines++;
+    }
+    return SUCCESS;
+}
+
+/*  Returns the length of the line ended in the portion
+INPUT:
+    const line_starts_t *piece - line starts found in the portion
+    size_t line - number of the line in the portion, from 1 to the number of line starts minus one
+RETURN:
+    offset_t - the number of characters in the line without the line break
+*/
+static offset_t GetPieceLineLength(const line_starts_t *piece, size_t line)
+{
+    const char *lineStart = piece->Starts[line - 1];
+    offset_t len = piece->Starts[line] - 1 - lineStart;
+
+    if (len > 0 && lineStart[len - 1] == '\r')
+        len--;
+    return len;
+}
+
+/*  Finds the maximum widths of the lines ended in the portion in columns. A line
+    without tabs is never wider than its length and a line having tabs is never wider
+    than its length times the tab size, so only the lines which may be wider than the
+    current maximum are counted. The lines without tabs are counted only in the UTF-8
+    file, the lines of the ASCII file having tabs are taken from their list
+INPUT:
+    const model_t *model - pointer on model structure
+    const line_starts_t *piece - line starts found in the portion
+    const char *data - pointer on the first character of the portion
+    offset_t openLength - the length of the line ended first in the portion
+    int isUtf8 - nonzero if the characters are decoded as UTF-8
+    int tabSize - the distance between the tab stops
+    offset_t *maxPlain - the maximum width of the lines without tabs
+    offset_t *maxTabs - the maximum width of the lines having tabs
+*/
+static void GetPieceColumns(const model_t *model, const line_starts_t *piece, const char *data, offset_t openLength,
+                            int isUtf8, int tabSize, offset_t *maxPlain, offset_t *maxTabs)
+{
+    index_t openLine = model->Index.Count - 1;
+    int isTabLine;
+    offset_t columns;
+    size_t tab = 0;
+    size_t i;
+
+    *maxPlain = model->MaxPlainColumns;
+    *maxTabs = model->MaxTabColumns;
+    if (piece->Count == 0)
+        return;
+
+    /* The beginning of the open line is read from the model, its end from the portion */
+    isTabLine = IsModelTabLine(model, openLine) || (piece->NumOfTabLines > 0 && piece->TabLines[0] == 0);
+    if (isTabLine ? openLength * tabSize > *maxTabs : isUtf8 && openLength > *maxPlain)
+    {
+        offset_t lineStart = GetLineOffset(&model->Index, openLine);
+        offset_t before = model->IndexedSize - lineStart;
+
+        if (before > openLength)
+            before = openLength;
+        ScanModelColumns(model, lineStart, before, 0, (offset_t)-1, isTabLine ? tabSize : 0, &columns);
+        if (isTabLine)
+        {
+            columns = CountTabColumns(data, openLength - before, columns, tabSize);
+            if (*maxTabs < columns)
+                *maxTabs = columns;
+        }
+        else
+        {
+            columns += CountColumns(data, openLength - before);
+            if (*maxPlain < columns)
+                *maxPlain = columns;
+        }
+    }
+
+    for (i = 1; i < piece->Count; i++)
+    {
+        offset_t len;
+
+        /* The lines without tabs of the ASCII file are as wide as they are long */
+        if (!isUtf8)
+        {
+            for (; tab < piece->NumOfTabLines && piece->TabLines[tab] < i; tab++)
+                ;
+            if (tab == piece->NumOfTabLines || piece->TabLines[tab] >= piece->Count)
+                break;
+            i = piece->TabLines[tab];
+        }
+
+        len = GetPieceLineLength(piece, i);
+        for (; tab < piece->NumOfTabLines && piece->TabLines[tab] < i; tab++)
+            ;
+        if (tab < piece->NumOfTabLines && piece->TabLines[tab] == i)
+        {
+            if (len * tabSize <= *maxTabs)
+                continue;
+
+            columns = CountTabColumns(piece->Starts[i - 1], len, 0, tabSize);
+            if (*maxTabs < columns)
+                *maxTabs = columns;
+        }
+        else if (len > *maxPlain)
+        {
+            columns = CountColumns(piece->Starts[i - 1], len);
+            if (*maxPlain < columns)
+                *maxPlain = columns;
+        }
+    }
+}
+
+/*  Adds the line starts of the indexed portion to the model and makes them visible
+INPUT:
+    model_t *model - pointer on model structure
+    const line_starts_t *piece - line starts found in the portion
+    const char *data - pointer on the first character of the portion
+    offset_t pieceSize - the number of characters in the portion
+    char previous - the character before the portion
+RETURN:
+    error_t - error code
+*/
+static error_t PublishPiece(model_t *model, const line_starts_t *piece, const char *data, offset_t pieceSize,
+                            char previous)
+{
+    index_t openLine = model->Index.Count - 1;
+    offset_t openLength = 0;
+    offset_t maxPlain = model->MaxPlainColumns;
+    offset_t maxTabs = model->MaxTabColumns;
+    int isUtf8 = model->IsUtf8 || piece->HasNonAscii;
+    int tabSize = model->TabSize;
+    error_t err = SUCCESS;
+    size_t i;
+
+    /* The scanner does not see the beginning of the line ended in the portion */
+    if (piece->Count > 0)
+    {
+        const char *lineBreak = piece->Starts[0] - 1;
+        char beforeBreak = lineBreak > data ? lineBreak[-1] : previous;
+
+        openLength = model->IndexedSize + (lineBreak - data) - GetLineOffset(&model->Index, openLine);
+        if (openLength > 0 && beforeBreak == '\r')
+            openLength--;
+    }
+
+    /* The widths of the ASCII lines without tabs are their lengths, the others are counted */
+    if (isUtf8 || piece->NumOfTabLines > 0 || IsModelTabLine(model, openLine))
+        GetPieceColumns(model, piece, data, openLength, isUtf8, tabSize, &maxPlain, &maxTabs);
+
+    AcquireSRWLockExclusive(&model->Lock);
+
+    /* The tab size was changed while the widths were counted, it is rare enough to count them again */
+    if (tabSize != model->TabSize)
+        GetPieceColumns(model, piece, data, openLength, isUtf8, model->TabSize, &maxPlain, &maxTabs);
+
+    for (i = 0; i < piece->NumOfTabLines && err == SUCCESS; i++)
+        err = MarkTabLine(model, openLine + piece->TabLines[i]);
+    for (i = 0; i < piece->Count && err == SUCCESS; i++)
+        err = AppendLineOffset(&model->Index, model->IndexedSize + (piece->Starts[i] - data));
+
+    /* The last start belongs to the line whose end is not found yet */
+    model->NumOfLines = model->Index.Count - 1;
+    if (err == SUCCESS)
+    {
+        if (model->MaxLength < piece->MaxLength)
+            model->MaxLength = piece->MaxLength;
+        if (model->MaxLength < openLength)
+            model->MaxLength = openLength;
+        if (piece->HasNonAscii)
+            model->IsUtf8 = 1;
+        model->MaxPlainColumns = model->IsUtf8 ? maxPlain : model->MaxLength;
+        model->MaxTabColumns = maxTabs;
+        model->MaxColumns = model->MaxPlainColumns > maxTabs ? model->MaxPlainColumns : maxTabs;
+        model->IndexedSize += pieceSize;
+
+        /* The decoded output is readable as soon as it is split on lines */
+        if (IsDecodedModel(model))
+        {
+            model->Size = model->IndexedSize;
+            SetBlockCacheSize(&model->Blocks, model->Size);
+        }
+    }
+    ReleaseSRWLockExclusive(&model->Lock);
+
+    return err;
+}
+
+/*  Closes the index with the last line of the file
+INPUT:
+    model_t *model - pointer on model structure
+RETURN:
+    error_t - error code
+*/
+static error_t PublishLastLine(model_t *model)
+{
+    index_t lastLine;
+    offset_t lastLength;
+    offset_t lastColumns;
+    error_t err;
+
+    AcquireSRWLockExclusive(&model->Lock);
+    err = AppendLineOffset(&model->Index, model->Size);
+    if (err == SUCCESS)
+    {
+        model->NumOfLines = model->Index.Count - 1;
+        lastLine = model->NumOfLines - 1;
+        lastLength = GetModelLineLength(model, lastLine);
+
+        /* Checking the lenght of the last line, its width is counted only if it may be larger */
+        if (model->MaxLength < lastLength)
+            model->MaxLength = lastLength;
+        if (IsModelTabLine(model, lastLine))
+        {
+            if (model->MaxTabColumns < lastLength * model->TabSize)
+            {
+                lastColumns = GetModelLineColumns(model, lastLine);
+                if (model->MaxTabColumns < lastColumns)
+                    model->MaxTabColumns = lastColumns;
+            }
+        }
+        else if (!model->IsUtf8)
+            model->MaxPlainColumns = model->MaxLength;
+        else if (model->MaxPlainColumns < lastLength)
+        {
+            lastColumns = GetModelLineColumns(model, lastLine);
+            if (model->MaxPlainColumns < lastColumns)
+                model->MaxPlainColumns = lastColumns;
+        }
+        model->MaxColumns = model->MaxPlainColumns > model->MaxTabColumns ? model->MaxPlainColumns
+                                                                          : model->MaxTabColumns;
+        model->IndexedSize = model->Size;
+    }
+    ReleaseSRWLockExclusive(&model->Lock);
+
+    return err;
+}
+
+/*  Takes the next portion of the file, the portions grow up to MAX_PIECE. The
+    portion of the compressed file has the characters the decoder gives at once
+INPUT:
+    model_t *model - pointer on model structure
+    offset_t *pieceSize - the size of the next portion of the file
+    const char **data - the characters of the portion
+    offset_t *size - the number of characters, zero at the end of the file
+    const char **view - the mapped view to be unmapped or NULL
+RETURN:
+    error_t - error code
+*/
+static error_t ReadNextPiece(model_t *model, offset_t *pieceSize, const char **data, offset_t *size, const char **view)
+{
+    *view = NULL;
+    if (model->Compressed.Type != COMPRESSION_NONE)
+    {
+        size_t decoded;
+        error_t err = DecodeNextPiece(&model->Compressed, data, &decoded);
+
+        *size = decoded;
+        return err;
+    }
+    if (model->Transcoded.Encoding != ENCODING_UTF8)
+    {
+        size_t transcoded;
+        error_t err = TranscodeNextPiece(&model->Transcoded, data, &transcoded);
+
+        *size = transcoded;
+        return err;
+    }
+
+    *size = model->Size - model->IndexedSize;
+    if (*size > *pieceSize)
+        *size = *pieceSize;
+    if (*pieceSize < MAX_PIECE)
+        *pieceSize *= 4;
+
+    if (*size == 0 || model->Data != NULL)
+    {
+        *data = model->Data + model->IndexedSize;
+        return SUCCESS;
+    }
+
+    *data = MapFileRange(model->Mapping, model->IndexedSize, (size_t)*size, view);
+    return *data != NULL ? SUCCESS : MEMORY_SHORTAGE;
+}
+
+/*  Splits the mapped file on lines portion by portion, publishes every portion
+    and notifies the window about the progress. The portions of the file read
+    by blocks are mapped one by one, the portions of the compressed file are decoded
+INPUT:
+    LPVOID param - pointer on model structure
+RETURN:
+    DWORD - not used
+*/
+static DWORD WINAPI LoadModel(LPVOID param)
+{
+    model_t *model = param;
+    int isWholeFile = model->IndexedSize == 0;
+    line_starts_t piece;
+    offset_t pieceSize = FIRST_PIECE;
+    char previous = '\0';
+    DWORD lastNotification = GetTickCount() - NOTIFY_PERIOD;
+    error_t err = SUCCESS;
+
+    /* The line break of the open line may start before the appended data */
+    if (!isWholeFile)
+    {
+        offset_t size = 1;
+        const char *last = GetModelText(model, model->IndexedSize - 1, &previous, &size);
+
+        previous = size > 0 ? *last : '\0';
+    }
+
+    while (!model->CancelLoading)
+    {
+        const char *view;
+        const char *data;
+        offset_t size;
+
+        err = ReadNextPiece(model, &pieceSize, &data, &size, &view);
+        if (err != SUCCESS || size == 0)
+            break;
+
+        InitLineStarts(&piece, NULL);
+        err = ScanLineStartsParallel(&piece, data, size);
+        if (err == SUCCESS)
+            err = PublishPiece(model, &piece, data, size, previous);
+        previous = data[size - 1];
+        ClearLineStarts(&piece);
+        if (view != NULL)
+            UnmapViewOfFile(view);
+        if (err != SUCCESS)
+            break;
+
+        /* The first portion is shown at once, the next ones not too often */
+        if (GetTickCount() - lastNotification >= NOTIFY_PERIOD)
+        {
+            PostMessage(model->NotifyWindow, WM_MODEL_PROGRESS, FALSE, model->LoadId);
+            lastNotification = GetTickCount();
+        }
+    }
+
+    if (model->CancelLoading)
+        return 0;
+
+    if (err == SUCCESS)
+        err = PublishLastLine(model);
+
+    model->LoadError = err;
+    PostMessage(model->NotifyWindow, WM_MODEL_PROGRESS, TRUE, model->LoadId);
+
+    /* The index of a large file is kept for the next opening, the appended data is not worth it */
+    if (err == SUCCESS && isWholeFile && model->Size >= INDEX_CACHE_MIN_SIZE && !IsDecodedModel(model))
+        SaveIndexCache(model);
+
+    return 0;
+}
+
+/*  Returns the size of the opened file
+INPUT:
+    const model_t *model - pointer on model structure with the opened file
+    offset_t *size - the number of characters in the file
+RETURN:
+    error_t - error code
+*/
+static error_t GetModelFileSize(const model_t *model, offset_t *size)
+{
+    LARGE_INTEGER fileSize;
+
+    if (!GetFileSizeEx(model->File, &fileSize) || fileSize.QuadPart < 0)
+        return NO_INPUT_FILE;
+
+    *size = fileSize.QuadPart;
+    return SUCCESS;
+}
+
+/*  Maps the whole file, the file which does not fit in the address space or
+    in the free memory is read by blocks instead
+INPUT:
+    model_t *model - pointer on model structure with the file mapping
+RETURN:
+    error_t - error code
+*/
+static error_t MapModelData(model_t *model)
+{
+    if (model->Size <= SIZE_MAX)
+        model->Data = MapViewOfFile(model->Mapping, FILE_MAP_READ, 0, 0, 0);
+    if (model->Data != NULL)
+        return SUCCESS;
+
+    return OpenBlockCache(&model->Blocks, model->Mapping, NULL, NULL, model->Size);
+}
+
+/*  Prepares the decoding of the compressed file, the decoded output is read
+    by blocks and its size grows while the file is split on lines
+INPUT:
+    model_t *model - pointer on model structure with the file mapping
+    compression_t type - format of the file
+RETURN:
+    error_t - error code
+*/
+static error_t OpenCompressedModel(model_t *model, compression_t type)
+{
+    error_t err = OpenCompressedFile(&model->Compressed, model->Mapping, model->Size, type);
+
+    if (err != SUCCESS)
+        return err;
+
+    model->Size = 0;
+    return OpenBlockCache(&model->Blocks, NULL, ReadCompressedRange, &model->Compressed, 0);
 }
 
-/*  Fills the model with data from the file
+/*  Prepares the transcoding of the file to UTF-8, the output is read by blocks
+    and its size grows while the file is split on lines
+INPUT:
+    model_t *model - pointer on model structure with the file mapping
+    encoding_t encoding - encoding of the file
+    offset_t start - offset of the text after the byte order mark
+RETURN:
+    error_t - error code
+*/
+static error_t OpenTranscodedModel(model_t *model, encoding_t encoding, offset_t start)
+{
+    OpenTranscodedFile(&model->Transcoded, model->Mapping, model->Size, encoding, start);
+
+    model->Size = 0;
+    return OpenBlockCache(&model->Blocks, NULL, ReadTranscodedRange, &model->Transcoded, 0);
+}
+
+/*  Maps the file and starts splitting it on lines in the background. The lines
+    are published in portions, the first one is small to show the first screen
+    quickly. After every portion WM_MODEL_PROGRESS is posted to the window.
+    A file which cannot be mapped as a whole is read by blocks, only the line
+    index and a bounded number of the blocks stay in memory. A gzip or zstd
+    file is decoded while it is split on lines, its blocks are decoded again
+    from the nearest seek point when they are read. A file in UTF-16 or in a
+    Cyrillic code page is transcoded to UTF-8 the same way, its blocks are
+    transcoded again from the chunk they start in
 INPUT:
     model_t *model - pointer on model structure
     const char *filename - path to file
+    HWND hwnd - window receiving the notifications
 OUTPUT:
-    model_t *model - pointer on model structure filled with data if operation
+    model_t *model - pointer on model structure with the mapped data if operation
                      ended successfully, otherwise filled with zeroes
 RETURN:
     error_t - error code
 */
-error_t FillModel(model_t *model, const char *filename)
+error_t FillModel(model_t *model, const char *filename, HWND hwnd)
 {
-    FILE *file = NULL;
-    char *tmp = NULL;
-    unsigned long curLine = 0;
-    unsigned long lineLenght = 0;
+    compression_t compression;
+    encoding_t encoding;
+    offset_t start;
+    int tabSize;
+    error_t err;
 
-    if ((file = fopen(filename, "rt")) == NULL)
+    /* The writer of a log may append to the file or rename it while it is opened */
+    model->File = CreateFile(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                             NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (model->File == INVALID_HANDLE_VALUE)
         return NO_INPUT_FILE;
+    strncpy(model->FileName, filename, MAX_PATH - 1);
+    model->FileName[MAX_PATH - 1] = '\0';
 
     /*  Getting the file size */
-    fseek(file, 0, SEEK_END);
-    model->Size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    err = GetModelFileSize(model, &model->Size);
+    if (err != SUCCESS)
+    {
+        ClearModel(model);
+        return err;
+    }
 
-    /*  Reading the file and save it to the model */
-    model->Data = malloc((model->Size + 1) * sizeof(char));
-    if (model->Data == NULL)
+    /*  Mapping the file into memory (an empty file cannot be mapped) */
+    if (model->Size == 0)
+        model->Data = "";
+    else
     {
-        model->Size = 0;
-        fclose(file);
+        model->Mapping = CreateFileMapping(model->File, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (model->Mapping == NULL)
+        {
+            ClearModel(model);
+            return MEMORY_SHORTAGE;
+        }
+
+        /* The compressed file is recognized by its first characters, not by its name */
+        compression = DetectCompression(model->Mapping, model->Size);
+        if (compression != COMPRESSION_NONE)
+            err = OpenCompressedModel(model, compression);
+        else
+        {
+            encoding = DetectEncoding(model->Mapping, model->Size, &start);
+            if (encoding != ENCODING_UTF8)
+                err = OpenTranscodedModel(model, encoding, start);
+            else
+                err = MapModelData(model);
+        }
+        if (err != SUCCESS)
+        {
+            ClearModel(model);
+            return err;
+        }
+    }
+
+    model->NotifyWindow = hwnd;
+    model->LoadId = ++lastLoadId;
+    model->CancelLoading = 0;
+    model->LoadError = SUCCESS;
+
+    /* The unchanged file is not split on lines again, only the lines having tabs
+       are counted again if the index was saved for another tab size */
+    if (model->Size >= INDEX_CACHE_MIN_SIZE && LoadIndexCache(model, &tabSize) == SUCCESS)
+    {
+        if (tabSize != model->TabSize)
+        {
+            model->MaxTabColumns = GetTabLinesColumns(model);
+            model->MaxColumns = model->MaxPlainColumns > model->MaxTabColumns ? model->MaxPlainColumns
+                                                                              : model->MaxTabColumns;
+        }
+        PostMessage(model->NotifyWindow, WM_MODEL_PROGRESS, TRUE, model->LoadId);
+        return SUCCESS;
+    }
+
+    /* The index starts with the first line whose end is not known yet */
+    if (AppendLineOffset(&model->Index, 0) != SUCCESS)
+    {
+        ClearModel(model);
         return MEMORY_SHORTAGE;
     }
+    model->NumOfLines = 0;
+
+    /* Splitting the file on lines in the calling thread if the loader cannot be started */
+    model->Loader = CreateThread(NULL, 0, LoadModel, model, 0, NULL);
+    if (model->Loader == NULL)
+        LoadModel(model);
+
+    return SUCCESS;
+}
+
+/*  Checks whether the path of the model still leads to the opened file
+INPUT:
+    const model_t *model - pointer on model structure
+RETURN:
+    int - nonzero if the file is the same
+*/
+static int IsSameFile(const model_t *model)
+{
+    BY_HANDLE_FILE_INFORMATION opened;
+    BY_HANDLE_FILE_INFORMATION current;
+    HANDLE file;
+    BOOL isRead;
 
-    model->Size = fread(model->Data, sizeof(char), model->Size, file);
-    model->Data[model->Size] = 0;
+    file = CreateFile(model->FileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                      NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return 0;
 
-    fclose(file);
+    isRead = GetFileInformationByHandle(model->File, &opened) && GetFileInformationByHandle(file, &current);
+    CloseHandle(file);
+
+    return isRead && opened.dwVolumeSerialNumber == current.dwVolumeSerialNumber &&
+           opened.nFileIndexHigh == current.nFileIndexHigh && opened.nFileIndexLow == current.nFileIndexLow;
+}
+
+/*  Checks the opened file on disk. If data was appended, the file is mapped again
+    and only the new data is split on lines in the background, the last line is
+    removed from the index until it is split again. A truncated or rotated file
+    is not changed, it must be opened again, as well as a changed compressed or
+    transcoded file
+INPUT:
+    model_t *model - pointer on model structure
+    file_change_t *change - the found change of the file
+RETURN:
+    error_t - error code
+*/
+error_t GrowModel(model_t *model, file_change_t *change)
+{
+    offset_t fileSize;
+    HANDLE mapping;
+    const char *data = NULL;
 
-    /* Counting the number of lines */
-    model->NumOfLines = 1;
-    for (tmp = model->Data; *tmp != 0; tmp++)
-        if (*tmp == '\n')
-            model->NumOfLines++;
+    *change = FILE_UNCHANGED;
 
-    model->Lines = malloc(model->NumOfLines * sizeof(char *));
-    if (model->Lines == NULL)
+    /* The file is checked only after the previous data is split on lines */
+    if (model->Loader != NULL)
     {
-        free(model->Data);
-        model->Data = NULL;
-        model->Size = 0;
-        model->NumOfLines = 0;
+        if (WaitForSingleObject(model->Loader, 0) != WAIT_OBJECT_0)
+            return SUCCESS;
+        CloseHandle(model->Loader);
+        model->Loader = NULL;
+    }
+    if (model->LoadError != SUCCESS)
+        return SUCCESS;
+
+    if (GetModelFileSize(model, &fileSize) != SUCCESS)
+        return SUCCESS;
+
+    /* The decoded output cannot grow by the appended data, the file is transcoded again */
+    if (IsDecodedModel(model))
+    {
+        offset_t inSize = model->Compressed.Type != COMPRESSION_NONE ? model->Compressed.InSize
+                                                                     : model->Transcoded.InSize;
+
+        if (fileSize != inSize || !IsSameFile(model))
+            *change = FILE_REPLACED;
+        return SUCCESS;
+    }
+
+    if (fileSize < model->Size || !IsSameFile(model))
+    {
+        *change = FILE_REPLACED;
+        return SUCCESS;
+    }
+    if (fileSize == model->Size)
+        return SUCCESS;
+
+    /* The old mapping does not cover the appended data */
+    mapping = CreateFileMapping(model->File, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+        return MEMORY_SHORTAGE;
+
+    /* The file stops fitting in the memory at some size, then it is read by blocks */
+    if (model->Data != NULL && fileSize <= SIZE_MAX)
+        data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL && model->Blocks.Blocks == NULL &&
+        OpenBlockCache(&model->Blocks, mapping, NULL, NULL, fileSize) != SUCCESS)
+    {
+        CloseHandle(mapping);
         return MEMORY_SHORTAGE;
     }
 
-    /* Split data on lines */
-    model->Lines[curLine++] = model->Data;
-    for (tmp = model->Data; *tmp != 0; tmp++)
+    AcquireSRWLockExclusive(&model->Lock);
+    if (model->Mapping != NULL)
+    {
+        if (model->Data != NULL)
+            UnmapViewOfFile(model->Data);
+        CloseHandle(model->Mapping);
+    }
+    if (data == NULL)
+        ResetBlockCache(&model->Blocks, mapping, fileSize);
+    model->Mapping = mapping;
+    model->Data = data;
+    model->Size = fileSize;
+
+    /* The last line is open again, its start stays in the index, its checkpoints may end inside a character */
+    RemoveLastLineOffset(&model->Index);
+    model->NumOfLines = model->Index.Count - 1;
+    ClearColumnMaps(&model->ColumnMaps);
+    ReleaseSRWLockExclusive(&model->Lock);
+
+    *change = FILE_GROWN;
+    model->CancelLoading = 0;
+
+    /* Splitting the new data in the calling thread if the loader cannot be started */
+    model->Loader = CreateThread(NULL, 0, LoadModel, model, 0, NULL);
+    if (model->Loader == NULL)
+        LoadModel(model);
+
+    return SUCCESS;
+}
+
+/*  Locks the line index for reading, the loader does not change it until the unlock
+INPUT:
+    model_t *model - pointer on model structure
+*/
+void LockModel(model_t *model)
+{
+    AcquireSRWLockShared(&model->Lock);
+}
+
+/*  Unlocks the line index locked by LockModel
+INPUT:
+    model_t *model - pointer on model structure
+*/
+void UnlockModel(model_t *model)
+{
+    ReleaseSRWLockShared(&model->Lock);
+}
+
+/*  Returns the offset of the beginning of the model line
+INPUT:
+    const model_t *model - pointer on model structure
+    index_t line - index of the line, NumOfLines gives the end of the last line
+RETURN:
+    offset_t - offset of the first character of the line
+*/
+offset_t GetModelLineOffset(const model_t *model, index_t line)
+{
+    return GetLineOffset(&model->Index, line);
+}
+
+/*  Returns the characters of the model. The mapped file is not copied, the
+    characters of the file read by blocks are copied into the buffer
+INPUT:
+    const model_t *model - pointer on model structure
+    offset_t offset - offset of the first character
+    char *buffer - buffer of at least size characters
+    offset_t *size - the number of characters needed
+OUTPUT:
+    offset_t *size - the number of characters available
+RETURN:
+    const char * - pointer on the characters
+*/
+const char *GetModelText(const model_t *model, offset_t offset, char *buffer, offset_t *size)
+{
+    if (offset >= model->Size)
     {
-        lineLenght++;
-        if (*tmp == '\n')
+        *size = 0;
+        return buffer;
+    }
+    if (*size > model->Size - offset)
+        *size = model->Size - offset;
+
+    if (model->Data != NULL)
+        return model->Data + offset;
+
+    /* The blocks are only a cache of the file, reading them does not change the model */
+    *size = ReadBlocks((block_cache_t *)&model->Blocks, offset, buffer, *size);
+    return buffer;
+}
+
+/*  Finds the model line containing the character
+INPUT:
+    const model_t *model - pointer on model structure
+    offset_t offset - offset of the character
+RETURN:
+    index_t - index of the line
+*/
+index_t FindModelLine(const model_t *model, offset_t offset)
+{
+    index_t line = FindLineByOffset(&model->Index, offset);
+
+    return line < model->NumOfLines ? line : model->NumOfLines - 1;
+}
+
+/*  Returns the length of the model line without the line break
+INPUT:
+    const model_t *model - pointer on model structure
+    index_t line - index of the line
+RETURN:
+    offset_t - the number of characters in the line
+*/
+offset_t GetModelLineLength(const model_t *model, index_t line)
+{
+    offset_t start = GetLineOffset(&model->Index, line);
+    offset_t end = GetLineOffset(&model->Index, line + 1);
+    offset_t size = end - start < 2 ? end - start : 2;
+    char buffer[2];
+    const char *tail = GetModelText(model, end - size, buffer, &size);
+
+    /* Lines are not terminated, so the line break is cut off from the next line start */
+    if (size > 0 && tail[size - 1] == '\n')
+    {
+        end--;
+        size--;
+    }
+    if (size > 0 && tail[size - 1] == '\r')
+        end--;
+
+    return end - start;
+}
+
+/*  Returns the width of the model line in display columns, the line of
+    the ASCII file without tabs is as wide as it is long
+INPUT:
+    const model_t *model - pointer on model structure
+    index_t line - index of the line
+RETURN:
+    offset_t - the number of columns in the line
+*/
+offset_t GetModelLineColumns(const model_t *model, index_t line)
+{
+    offset_t len = GetModelLineLength(model, line);
+    int tabSize = IsModelTabLine(model, line) ? model->TabSize : 0;
+    offset_t columns;
+
+    if (!model->IsUtf8 && tabSize == 0)
+        return len;
+
+    ScanModelColumns(model, GetLineOffset(&model->Index, line), len, 0, (offset_t)-1, tabSize, &columns);
+    return columns;
+}
+
+/*  Returns the column the character of the model line starts at
+INPUT:
+    const model_t *model - pointer on model structure
+    index_t line - index of the line
+    offset_t offset - offset of the character in the line
+RETURN:
+    offset_t - the column
+*/
+offset_t GetModelColumn(const model_t *model, index_t line, offset_t offset)
+{
+    int tabSize = IsModelTabLine(model, line) ? model->TabSize : 0;
+    offset_t column;
+
+    if (!model->IsUtf8 && tabSize == 0)
+        return offset;
+
+    ScanModelColumns(model, GetLineOffset(&model->Index, line), offset, 0, (offset_t)-1, tabSize, &column);
+    return column;
+}
+
+/*  Returns the column the character of the model line starts at, the line is read
+    from a character known to start not after it
+INPUT:
+    const model_t *model - pointer on model structure
+    index_t line - index of the line
+    offset_t from - offset in the line of the character the reading starts at
+    offset_t fromColumn - the column this character starts at
+    offset_t offset - offset of the character in the line, not less than from
+RETURN:
+    offset_t - the column
+*/
+offset_t GetModelColumnFrom(const model_t *model, index_t line, offset_t from, offset_t fromColumn, offset_t offset)
+{
+    int tabSize = IsModelTabLine(model, line) ? model->TabSize : 0;
+    offset_t column;
+
+    if (!model->IsUtf8 && tabSize == 0)
+        return offset;
+
+    ScanModelColumns(model, GetLineOffset(&model->Index, line) + from, offset - from, fromColumn, (offset_t)-1, tabSize,
+                     &column);
+    return column;
+}
+
+/*  Finds the checkpoint of the long line nearest to the column, the column map of
+    the line is extended up to the column by steps of COLUMN_MAP_STEP columns
+INPUT:
+    const model_t *model - pointer on model structure
+    offset_t lineStart - offset of the line
+    offset_t len - the length of the line
+    offset_t column - the column
+    int tabSize - the distance between the tab stops or zero if the line has no tabs
+    column_point_t *point - the last checkpoint starting not after the column
+*/
+static void FindMappedColumn(const model_t *model, offset_t lineStart, offset_t len, offset_t column, int tabSize,
+                             column_point_t *point)
+{
+    /* The checkpoints are only a cache of the columns, extending them does not change the model */
+    column_maps_t *maps = (column_maps_t *)&model->ColumnMaps;
+    column_point_t last;
+
+    FindColumnPoint(maps, lineStart, column, point, &last);
+    while (last.Column < column && last.Offset < len)
+    {
+        offset_t reached;
+        offset_t found = ScanModelColumns(model, lineStart + last.Offset, len - last.Offset, last.Column,
+                                          last.Column + COLUMN_MAP_STEP, tabSize, &reached);
+
+        if (found == 0)
+            break;
+
+        last.Offset += found;
+        last.Column = reached;
+        if (last.Column <= column)
+            *point = last;
+        if (AddColumnPoint(maps, lineStart, &last) != SUCCESS)
+            break;
+    }
+}
+
+/*  Finds the first character of the model line that starts at the column or after it.
+    The line is read from a character known to start not after the column or from
+    the nearest checkpoint of the column map of the long line, whichever is closer
+INPUT:
+    const model_t *model - pointer on model structure
+    index_t line - index of the line
+    offset_t from - offset in the line of the character the reading starts at
+    offset_t fromColumn - the column this character starts at
+    offset_t column - the column
+    offset_t *start - the column the found character starts at
+RETURN:
+    offset_t - offset of the found character in the line, the length of the line
+               if every character starts before the column
+*/
+offset_t FindModelColumn(const model_t *model, index_t line, offset_t from, offset_t fromColumn,
+                         offset_t column, offset_t *start)
+{
+    offset_t len = GetModelLineLength(model, line);
+    offset_t lineStart = GetLineOffset(&model->Index, line);
+    int tabSize = IsModelTabLine(model, line) ? model->TabSize : 0;
+    column_point_t point;
+
+    /* Every character of the ASCII line without tabs takes one column */
+    if (!model->IsUtf8 && tabSize == 0)
+    {
+        *start = column < len ? column : len;
+        return *start;
+    }
+
+    /* The long line is not read from its beginning for every row */
+    if (len > COLUMN_MAP_STEP && fromColumn + COLUMN_MAP_STEP < column)
+    {
+        FindMappedColumn(model, lineStart, len, column, tabSize, &point);
+        if (point.Column > fromColumn)
         {
-            if(model->MaxLength < --lineLenght)
-                model->MaxLength = lineLenght;
-            *tmp = 0;
-            model->Lines[curLine++] = tmp + 1;
-            lineLenght = 0;
+            from = point.Offset;
+            fromColumn = point.Column;
         }
     }
-    /* Checking the lenght of the last line */
-    if(model->MaxLength < lineLenght)
-        model->MaxLength = lineLenght;
 
-    return SUCCESS;
+    if (from >= len || fromColumn >= column)
+    {
+        *start = fromColumn;
+        return from < len ? from : len;
+    }
+
+    return from + ScanModelColumns(model, lineStart + from, len - from, fromColumn, column, tabSize, start);
+}
+
+/*  Searches the positions of the chunk of one task, the nearest occurrence in the
+    direction of the search is kept. The mapped file is searched in place, the
+    file read by blocks is copied by windows overlapping by the literal length
+INPUT:
+    void *arg - pointer on parallel search structure
+    unsigned long index - index of the task
+*/
+static void FindInChunk(void *arg, unsigned long index)
+{
+    parallel_find_t *find = arg;
+    const model_t *model = find->Model;
+    size_t length = find->Literal->Length;
+    offset_t first = find->Start + index * find->ChunkSize;
+    offset_t last = find->End - first > find->ChunkSize ? first + find->ChunkSize : find->End;
+    offset_t window = model->Data != NULL ? find->ChunkSize : FIND_WINDOW;
+    char *buffer = NULL;
+
+    find->Found[index] = NO_MATCH;
+    find->Errors[index] = SUCCESS;
+    if (model->Data == NULL && (buffer = malloc(FIND_WINDOW + length - 1)) == NULL)
+    {
+        find->Errors[index] = MEMORY_SHORTAGE;
+        return;
+    }
+
+    while (first < last)
+    {
+        offset_t part = last - first < window ? last - first : window;
+        offset_t start = find->Direction == FIND_FORWARD ? first : last - part;
+        offset_t size = part + length - 1;
+        const char *text;
+        size_t pos;
+
+        /* The occurrence starting in the window may end in the next one */
+        if (size > find->Limit - start)
+            size = find->Limit - start;
+        text = GetModelText(model, start, buffer, &size);
+        if (find->Direction == FIND_FORWARD)
+            pos = FindLiteral(find->Literal, text, (size_t)size);
+        else
+            pos = FindLastLiteral(find->Literal, text, (size_t)size);
+
+        if (pos < size)
+        {
+            find->Found[index] = start + pos;
+            break;
+        }
+
+        if (find->Direction == FIND_FORWARD)
+            first += part;
+        else
+            last -= part;
+    }
+
+    free(buffer);
+}
+
+/*  Finds the literal in the characters split on lines so far. The characters are
+    searched by rounds from the position, every round is split in chunks between
+    the pool threads and the next one is twice as long, so a near occurrence
+    is found at once and a far one at the speed of the memory
+INPUT:
+    const model_t *model - pointer on model structure
+    const literal_t *literal - pointer on the searched literal
+    offset_t from - the position the search starts at
+    find_direction_t direction - direction of the search
+    offset_t *found - offset of the occurrence or NO_MATCH
+RETURN:
+    error_t - error code
+*/
+error_t FindModelText(const model_t *model, const literal_t *literal, offset_t from, find_direction_t direction,
+                      offset_t *found)
+{
+    parallel_find_t find;
+    unsigned long maxTasks = GetThreadPoolLimit() * TASKS_PER_THREAD;
+    offset_t singleFound;
+    error_t singleError;
+    offset_t count;
+    error_t err = SUCCESS;
+
+    *found = NO_MATCH;
+    if (model->IndexedSize < literal->Length)
+        return SUCCESS;
+
+    /* The number of positions the occurrence may start at */
+    count = model->IndexedSize - literal->Length + 1;
+    if (from > count)
+        from = count;
+
+    find.Model = model;
+    find.Literal = literal;
+    find.Direction = direction;
+    find.Limit = model->IndexedSize;
+    find.ChunkSize = MIN_FIND_CHUNK;
+    find.Found = malloc(maxTasks * sizeof(offset_t));
+    find.Errors = malloc(maxTasks * sizeof(error_t));
+
+    /* Searching in the calling thread if there is no memory for the results */
+    if (find.Found == NULL || find.Errors == NULL)
+    {
+        free(find.Found);
+        free(find.Errors);
+        find.Found = &singleFound;
+        find.Errors = &singleError;
+        maxTasks = 1;
+    }
+
+    find.Start = find.End = from;
+    while (err == SUCCESS && *found == NO_MATCH)
+    {
+        offset_t round = find.ChunkSize * maxTasks;
+        unsigned long numOfTasks;
+        unsigned long i;
+
+        if (direction == FIND_FORWARD)
+        {
+            find.Start = find.End;
+            find.End = count - find.Start > round ? find.Start + round : count;
+        }
+        else
+        {
+            find.End = find.Start;
+            find.Start = find.End > round ? find.End - round : 0;
+        }
+        if (find.Start >= find.End)
+            break;
+
+        numOfTasks = (unsigned long)((find.End - find.Start + find.ChunkSize - 1) / find.ChunkSize);
+        if (numOfTasks > 1)
+            RunParallel(FindInChunk, &find, numOfTasks);
+        else
+            FindInChunk(&find, 0);
+
+        /* The chunks are ordered, the nearest one with an occurrence wins */
+        for (i = 0; i < numOfTasks && err == SUCCESS && *found == NO_MATCH; i++)
+        {
+            unsigned long task = direction == FIND_FORWARD ? i : numOfTasks - 1 - i;
+
+            err = find.Errors[task];
+            *found = find.Found[task];
+        }
+
+        if (find.ChunkSize < MAX_FIND_CHUNK)
+            find.ChunkSize *= 2;
+    }
+
+    if (find.Found != &singleFound)
+    {
+        free(find.Found);
+        free(find.Errors);
+    }
+
+    return err;
 }
 
-/*  Clears the model
+/*  Clears the model, the loading is cancelled if it is still running
 INPUT:
     model_t *model - pointer on model structure
 OUTPUT:
@@ -102,13 +1359,46 @@ void ClearModel(model_t *model)
     if (model == NULL)
         return;
 
-    free(model->Lines);
-    model->Lines = NULL;
+    if (model->Loader != NULL)
+    {
+        InterlockedExchange(&model->CancelLoading, 1);
+        WaitForSingleObject(model->Loader, INFINITE);
+        CloseHandle(model->Loader);
+        model->Loader = NULL;
+    }
+
+    ClearLineIndex(&model->Index);
+    free(model->TabLines);
+    model->TabLines = NULL;
+    model->TabWords = 0;
+    model->NumOfTabLines = 0;
+    ClearColumnMaps(&model->ColumnMaps);
 
-    free(model->Data);
+    ClearBlockCache(&model->Blocks);
+    ClearCompressedFile(&model->Compressed);
+    ClearTranscodedFile(&model->Transcoded);
+    if (model->Mapping != NULL)
+    {
+        if (model->Data != NULL)
+            UnmapViewOfFile(model->Data);
+        CloseHandle(model->Mapping);
+        model->Mapping = NULL;
+    }
     model->Data = NULL;
 
+    if (model->File != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(model->File);
+        model->File = INVALID_HANDLE_VALUE;
+    }
+
     model->NumOfLines = 0;
     model->MaxLength = 0;
+    model->MaxColumns = 0;
+    model->MaxPlainColumns = 0;
+    model->MaxTabColumns = 0;
+    model->IsUtf8 = 0;
     model->Size = 0;
+    model->IndexedSize = 0;
+    model->FileName[0] = '\0';
 }
@@ -4,15 +4,69 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "../error/error.h"
+#include "lineScanner.h"
+#include "lineIndex.h"
+#include "blockCache.h"
+#include "compressedFile.h"
+#include "textEncoding.h"
+#include "utf8Columns.h"
+#include "columnMap.h"
+#include "literalSearch.h"
+
+#define DEFAULT_TAB_SIZE 8      /* The distance between the tab stops until another one is set */
+#define TAB_WORD_BITS 64        /* The number of lines in one word of the bit set of the lines having tabs */
+#define NO_MATCH ((offset_t)-1) /* Offset of the occurrence which is not found */
+
+/* Message posted to the window while the file is being split on lines
+   (wParam is nonzero when the loading is finished, lParam is the LoadId of the model) */
+#define WM_MODEL_PROGRESS (WM_APP + 1)
+
+/* Result of the check of the file on disk */
+typedef enum
+{
+    FILE_UNCHANGED,     /* The file has the same size or cannot be checked now */
+    FILE_GROWN,         /* New data was appended, it is being split on lines */
+    FILE_REPLACED,      /* The file was truncated or another file took its name */
+} file_change_t;
+
+/* Direction of the search */
+typedef enum
+{
+    FIND_FORWARD,       /* The first occurrence starting at the position or after it is found */
+    FIND_BACKWARD,      /* The last occurrence starting before the position is found */
+} find_direction_t;
 
 /*  The structure that implements the model */
 typedef struct
 {
-    char *Data;                   /* Data */
-    unsigned long Size;           /* The number of characters */
-    char **Lines;                 /* Pointers on file lines */
-    unsigned long NumOfLines;     /* Number of lines */
-    unsigned long MaxLength;      /* Maximum line length */
+    const char *Data;             /* Read-only view of the whole file or NULL when it is read by blocks */
+    offset_t Size;                /* The number of characters, the decoded ones for a compressed or transcoded file */
+    line_index_t Index;           /* Offsets of file lines, the extra last one is the end of the data */
+    index_t NumOfLines;           /* Number of lines */
+    offset_t MaxLength;           /* Maximum line length */
+    offset_t MaxColumns;          /* Maximum line width in display columns */
+    offset_t MaxPlainColumns;     /* Maximum width of the lines without tabs, MaxLength for the ASCII file */
+    offset_t MaxTabColumns;       /* Maximum width of the lines having tabs */
+    int IsUtf8;                   /* Nonzero if the file has characters above 127, they are decoded as UTF-8 */
+    int TabSize;                  /* The distance between the tab stops in columns */
+    unsigned long long *TabLines; /* Bit set of the lines having tabs, the other lines skip the tab expansion */
+    index_t TabWords;             /* The number of allocated words of the bit set, the bits after them are zero */
+    index_t NumOfTabLines;        /* The number of lines having tabs */
+    column_maps_t ColumnMaps;     /* Checkpoints of the columns of the recently drawn long lines */
+    HANDLE File;                  /* Handle of the opened file */
+    HANDLE Mapping;               /* Handle of the file mapping object */
+    block_cache_t Blocks;         /* Mapped blocks of the file which does not fit in the memory */
+    compressed_file_t Compressed; /* Decoder of the gzip or zstd file, COMPRESSION_NONE for others */
+    transcoded_file_t Transcoded; /* Transcoder of the file in another encoding, ENCODING_UTF8 for UTF-8 */
+    char FileName[MAX_PATH];      /* Path to the opened file */
+
+    SRWLOCK Lock;                 /* Guards the line index while it is being loaded */
+    HANDLE Loader;                /* Thread splitting the file on lines or NULL */
+    volatile long CancelLoading;  /* Nonzero when the loader must stop */
+    offset_t IndexedSize;         /* The number of characters already split on lines */
+    error_t LoadError;            /* Result of the loading */
+    HWND NotifyWindow;            /* Window receiving WM_MODEL_PROGRESS */
+    unsigned long LoadId;         /* Identifier of the loading sent with the notifications */
 } model_t;
 
 /* Initializes the model
@@ -23,19 +77,174 @@ OUTPUT:
 */
 void InitModel(model_t *model);
 
-/*  Fills the model with data from the file
+/*  Maps the file and starts splitting it on lines in the background. The lines
+    are published in portions, the first one is small to show the first screen
+    quickly. After every portion WM_MODEL_PROGRESS is posted to the window.
+    A file which cannot be mapped as a whole is read by blocks, only the line
+    index and a bounded number of the blocks stay in memory. A gzip or zstd
+    file is decoded while it is split on lines, its blocks are decoded again
+    from the nearest seek point when they are read
 INPUT:
     model_t *model - pointer on model structure
     const char *filename - path to file
+    HWND hwnd - window receiving the notifications
 OUTPUT:
     model_t *model - pointer on model structure filled with data if operation
                      ended successfully, otherwise filled with zeroes
 RETURN:
     error_t - error code
 */
-error_t FillModel(model_t *model, const char *filename);
+error_t FillModel(model_t *model, const char *filename, HWND hwnd);
+
+/*  Checks the opened file on disk. If data was appended, the file is mapped again
+    and only the new data is split on lines in the background, the last line is
+    removed from the index until it is split again. A truncated or rotated file
+    is not changed, it must be opened again, as well as a changed compressed file
+INPUT:
+    model_t *model - pointer on model structure
+    file_change_t *change - the found change of the file
+RETURN:
+    error_t - error code
+*/
+error_t GrowModel(model_t *model, file_change_t *change);
+
+/*  Locks the line index for reading, the loader does not change it until the unlock
+INPUT:
+    model_t *model - pointer on model structure
+*/
+void LockModel(model_t *model);
+
+/*  Unlocks the line index locked by LockModel
+INPUT:
+    model_t *model - pointer on model structure
+*/
+void UnlockModel(model_t *model);
+
+/*  Returns the offset of the beginning of the model line
+INPUT:
+    const model_t *model - pointer on model structure
+    index_t line - index of the line, NumOfLines gives the end of the last line
+RETURN:
+    offset_t - offset of the first character of the line
+*/
+offset_t GetModelLineOffset(const model_t *model, index_t line);
+
+/*  Returns the characters of the model. The mapped file is not copied, the
+    characters of the file read by blocks are copied into the buffer
+INPUT:
+    const model_t *model - pointer on model structure
+    offset_t offset - offset of the first character
+    char *buffer - buffer of at least size characters
+    offset_t *size - the number of characters needed
+OUTPUT:
+    offset_t *size - the number of characters available
+RETURN:
+    const char * - pointer on the characters
+*/
+const char *GetModelText(const model_t *model, offset_t offset, char *buffer, offset_t *size);
+
+/*  Finds the model line containing the character
+INPUT:
+    const model_t *model - pointer on model structure
+    offset_t offset - offset of the character
+RETURN:
+    index_t - index of the line
+*/
+index_t FindModelLine(const model_t *model, offset_t offset);
+
+/*  Returns the length of the model line without the line break
+INPUT:
+    const model_t *model - pointer on model structure
+    index_t line - index of the line
+RETURN:
+    offset_t - the number of characters in the line
+*/
+offset_t GetModelLineLength(const model_t *model, index_t line);
+
+/*  Checks whether the model line has tabs, the scanner marks such lines
+INPUT:
+    const model_t *model - pointer on model structure
+    index_t line - index of the line
+RETURN:
+    int - nonzero if the line has tabs
+*/
+int IsModelTabLine(const model_t *model, index_t line);
+
+/*  Sets the distance between the tab stops. The widths of the lines having tabs
+    are counted again, the lines without them are not read
+INPUT:
+    model_t *model - pointer on model structure
+    int tabSize - the distance between the tab stops in columns
+*/
+void SetModelTabSize(model_t *model, int tabSize);
+
+/*  Returns the width of the model line in display columns, the line of
+    the ASCII file without tabs is as wide as it is long
+INPUT:
+    const model_t *model - pointer on model structure
+    index_t line - index of the line
+RETURN:
+    offset_t - the number of columns in the line
+*/
+offset_t GetModelLineColumns(const model_t *model, index_t line);
+
+/*  Returns the column the character of the model line starts at
+INPUT:
+    const model_t *model - pointer on model structure
+    index_t line - index of the line
+    offset_t offset - offset of the character in the line
+RETURN:
+    offset_t - the column
+*/
+offset_t GetModelColumn(const model_t *model, index_t line, offset_t offset);
+
+/*  Returns the column the character of the model line starts at, the line is read
+    from a character known to start not after it
+INPUT:
+    const model_t *model - pointer on model structure
+    index_t line - index of the line
+    offset_t from - offset in the line of the character the reading starts at
+    offset_t fromColumn - the column this character starts at
+    offset_t offset - offset of the character in the line, not less than from
+RETURN:
+    offset_t - the column
+*/
+offset_t GetModelColumnFrom(const model_t *model, index_t line, offset_t from, offset_t fromColumn, offset_t offset);
+
+/*  Finds the first character of the model line that starts at the column or after it.
+    The line is read from a character known to start not after the column or from
+    the nearest checkpoint of the column map of the long line, whichever is closer
+INPUT:
+    const model_t *model - pointer on model structure
+    index_t line - index of the line
+    offset_t from - offset in the line of the character the reading starts at
+    offset_t fromColumn - the column this character starts at
+    offset_t column - the column
+    offset_t *start - the column the found character starts at
+RETURN:
+    offset_t - offset of the found character in the line, the length of the line
+               if every character starts before the column
+*/
+offset_t FindModelColumn(const model_t *model, index_t line, offset_t from, offset_t fromColumn,
+                         offset_t column, offset_t *start);
+
+/*  Finds the literal in the characters split on lines so far. The characters are
+    searched by rounds from the position, every round is split in chunks between
+    the pool threads and the next one is twice as long, so a near occurrence
+    is found at once and a far one at the speed of the memory
+INPUT:
+    const model_t *model - pointer on model structure
+    const literal_t *literal - pointer on the searched literal
+    offset_t from - the position the search starts at
+    find_direction_t direction - direction of the search
+    offset_t *found - offset of the occurrence or NO_MATCH
+RETURN:
+    error_t - error code
+*/
+error_t FindModelText(const model_t *model, const literal_t *literal, offset_t from, find_direction_t direction,
+                      offset_t *found);
 
-/*  Clears the model
+/*  Clears the model, the loading is cancelled if it is still running
 INPUT:
     model_t *model - pointer on model structure
 OUTPUT:
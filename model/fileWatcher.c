@@ -0,0 +1,131 @@
+#include "fileWatcher.h"
+#include <string.h>
+
+static unsigned long lastWatchId = 0;   /* Identifier of the last started watching */
+
+/*  Initializes the watcher
+INPUT:
+    file_watcher_t *watcher - pointer on watcher structure
+OUTPUT:
+    file_watcher_t *watcher - pointer on stopped watcher structure
+*/
+void InitFileWatcher(file_watcher_t *watcher)
+{
+    watcher->Thread = NULL;
+    watcher->Stop = NULL;
+    watcher->Change = INVALID_HANDLE_VALUE;
+    watcher->NotifyWindow = NULL;
+    watcher->WatchId = 0;
+}
+
+/*  Waits for the changes and notifies the window until the watcher is stopped
+INPUT:
+    LPVOID param - pointer on watcher structure
+RETURN:
+    DWORD - not used
+*/
+static DWORD WINAPI WatchFile(LPVOID param)
+{
+    file_watcher_t *watcher = param;
+    HANDLE handles[2];
+    DWORD numOfHandles = 1;
+
+    handles[0] = watcher->Stop;
+    if (watcher->Change != INVALID_HANDLE_VALUE)
+        handles[numOfHandles++] = watcher->Change;
+
+    for (;;)
+    {
+        DWORD result = WaitForMultipleObjects(numOfHandles, handles, FALSE, WATCH_POLL_PERIOD);
+
+        if (result == WAIT_OBJECT_0)
+            break;
+
+        /* Every change in the directory and every timeout leads to a check of the size */
+        if (result == WAIT_OBJECT_0 + 1 && !FindNextChangeNotification(watcher->Change))
+        {
+            FindCloseChangeNotification(watcher->Change);
+            watcher->Change = INVALID_HANDLE_VALUE;
+            numOfHandles = 1;
+        }
+        PostMessage(watcher->NotifyWindow, WM_FILE_CHANGED, 0, watcher->WatchId);
+
+        /* A file written continuously is checked not more often than every WATCH_MIN_PERIOD */
+        if (WaitForSingleObject(watcher->Stop, WATCH_MIN_PERIOD) == WAIT_OBJECT_0)
+            break;
+    }
+
+    return 0;
+}
+
+/*  Starts watching the file, WM_FILE_CHANGED is posted after the changes in its
+    directory and at least every WATCH_POLL_PERIOD milliseconds
+INPUT:
+    file_watcher_t *watcher - pointer on stopped watcher structure
+    const char *filename - path to the file
+    HWND hwnd - window receiving the notifications
+RETURN:
+    error_t - error code
+*/
+error_t StartFileWatcher(file_watcher_t *watcher, const char *filename, HWND hwnd)
+{
+    char directory[MAX_PATH];
+    char *nameStart = directory;
+    char *cur;
+
+    /* The notifications are given for directories, so the name of the file is cut off */
+    strncpy(directory, filename, MAX_PATH - 1);
+    directory[MAX_PATH - 1] = '\0';
+    for (cur = directory; *cur != '\0'; cur++)
+        if (*cur == '\\' || *cur == '/')
+            nameStart = cur + 1;
+    if (nameStart == directory)
+        strcpy(directory, ".");
+    else
+        *nameStart = '\0';
+
+    watcher->Stop = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (watcher->Stop == NULL)
+        return MEMORY_SHORTAGE;
+
+    /* Without the notifications the file is polled */
+    watcher->Change = FindFirstChangeNotification(directory, FALSE, FILE_NOTIFY_CHANGE_SIZE |
+                                                  FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+
+    watcher->NotifyWindow = hwnd;
+    watcher->WatchId = ++lastWatchId;
+    watcher->Thread = CreateThread(NULL, 0, WatchFile, watcher, 0, NULL);
+    if (watcher->Thread == NULL)
+    {
+        StopFileWatcher(watcher);
+        return MEMORY_SHORTAGE;
+    }
+
+    return SUCCESS;
+}
+
+/*  Stops watching the file
+INPUT:
+    file_watcher_t *watcher - pointer on watcher structure
+OUTPUT:
+    file_watcher_t *watcher - pointer on stopped watcher structure
+*/
+void StopFileWatcher(file_watcher_t *watcher)
+{
+    if (watcher == NULL)
+        return;
+
+    if (watcher->Thread != NULL)
+    {
+        SetEvent(watcher->Stop);
+        WaitForSingleObject(watcher->Thread, INFINITE);
+        CloseHandle(watcher->Thread);
+    }
+
+    if (watcher->Change != INVALID_HANDLE_VALUE)
+        FindCloseChangeNotification(watcher->Change);
+    if (watcher->Stop != NULL)
+        CloseHandle(watcher->Stop);
+
+    InitFileWatcher(watcher);
+}
@@ -0,0 +1,52 @@
+#ifndef __FILE_WATCHER_H_INCLUDED
+#define __FILE_WATCHER_H_INCLUDED
+
+#include <windows.h>
+#include "../error/error.h"
+
+/* Message posted to the window when the watched file may have changed
+   (lParam is the WatchId of the watcher) */
+#define WM_FILE_CHANGED (WM_APP + 3)
+
+#define WATCH_POLL_PERIOD 1000      /* Interval of the checks without change notifications in milliseconds */
+#define WATCH_MIN_PERIOD 100        /* Minimum interval between the notifications in milliseconds */
+
+/*  Watches the directory of the file for changes in a background thread. When
+    the change notifications are not available the file is polled periodically */
+typedef struct
+{
+    HANDLE Thread;              /* Thread waiting for the changes or NULL */
+    HANDLE Stop;                /* Event stopping the thread */
+    HANDLE Change;              /* Change notification or INVALID_HANDLE_VALUE when polling */
+    HWND NotifyWindow;          /* Window receiving WM_FILE_CHANGED */
+    unsigned long WatchId;      /* Identifier of the watching sent with the notifications */
+} file_watcher_t;
+
+/*  Initializes the watcher
+INPUT:
+    file_watcher_t *watcher - pointer on watcher structure
+OUTPUT:
+    file_watcher_t *watcher - pointer on stopped watcher structure
+*/
+void InitFileWatcher(file_watcher_t *watcher);
+
+/*  Starts watching the file, WM_FILE_CHANGED is posted after the changes in its
+    directory and at least every WATCH_POLL_PERIOD milliseconds
+INPUT:
+    file_watcher_t *watcher - pointer on stopped watcher structure
+    const char *filename - path to the file
+    HWND hwnd - window receiving the notifications
+RETURN:
+    error_t - error code
+*/
+error_t StartFileWatcher(file_watcher_t *watcher, const char *filename, HWND hwnd);
+
+/*  Stops watching the file
+INPUT:
+    file_watcher_t *watcher - pointer on watcher structure
+OUTPUT:
+    file_watcher_t *watcher - pointer on stopped watcher structure
+*/
+void StopFileWatcher(file_watcher_t *watcher);
+
+#endif // __FILE_WATCHER_H_INCLUDED
@@ -0,0 +1,474 @@
+#include "indexCache.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define INDEX_CACHE_MAGIC "TVINDEX"         /* The first bytes of the index file */
+#define WRITE_CHUNK (1ul << 20)             /* The number of bytes written at once */
+#define FNV_OFFSET 14695981039346656037ull  /* Initial value of the FNV-1a hash */
+#define FNV_PRIME 1099511628211ull          /* Multiplier of the FNV-1a hash */
+
+/* Header of the index file, the arrays of the line index follow it */
+typedef struct
+{
+    char Magic[8];                  /* INDEX_CACHE_MAGIC */
+    unsigned long long Version;     /* INDEX_CACHE_VERSION */
+    unsigned long long FileSize;    /* The number of characters in the file */
+    unsigned long long WriteTime;   /* Last write time of the file */
+    unsigned long long SampleHash;  /* Hash of the sampled parts of the file */
+    unsigned long long Count;       /* The number of line starts */
+    unsigned long long NumOfWide;   /* The number of widened blocks */
+    unsigned long long MaxLength;   /* Maximum line length */
+    unsigned long long MaxColumns;  /* Maximum line width in display columns */
+    unsigned long long MaxPlainColumns; /* Maximum width of the lines without tabs */
+    unsigned long long MaxTabColumns;   /* Maximum width of the lines having tabs */
+    unsigned long long TabSize;     /* The tab size the widths of the lines having tabs are counted for */
+    unsigned long long TabWords;    /* The number of words of the bit set of the lines having tabs */
+    unsigned long long NumOfTabLines;   /* The number of lines having tabs */
+    unsigned long long IsUtf8;      /* Nonzero if the file has characters above 127 */
+    char Path[MAX_PATH];            /* Full path of the file */
+} index_header_t;
+
+/* Index file found in the directory of the index files */
+typedef struct
+{
+    unsigned long long WriteTime;   /* Last write time of the index file */
+    unsigned long long Size;        /* The number of bytes of the index file */
+    char Name[MAX_PATH];            /* Name of the index file without the directory */
+} cached_index_t;
+
+static unsigned long CacheBudget = INDEX_CACHE_BUDGET; /* Bytes all the index files may take */
+
+/*  Sets the disk budget of the index files of all the files
+INPUT:
+    unsigned long bytes - the number of bytes
+*/
+void SetIndexCacheBudget(unsigned long bytes)
+{
+    CacheBudget = bytes;
+}
+
+/*  Adds the bytes to the FNV-1a hash
+INPUT:
+    unsigned long long hash - the hash of the previous bytes
+    const char *data - pointer on the bytes
+    size_t size - the number of bytes
+RETURN:
+    unsigned long long - the hash
+*/
+static unsigned long long HashBytes(unsigned long long hash, const char *data, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+        hash = (hash ^ (unsigned char)data[i]) * FNV_PRIME;
+
+    return hash;
+}
+
+/*  Hashes the parts of the file spread evenly from its beginning to its end,
+    a change in the middle of a large file is cheaper to miss than to read
+INPUT:
+    const model_t *model - pointer on model structure with the mapped file
+RETURN:
+    unsigned long long - the hash
+*/
+static unsigned long long GetSampleHash(const model_t *model)
+{
+    char buffer[INDEX_CACHE_SAMPLE_SIZE];
+    unsigned long long hash = FNV_OFFSET;
+    offset_t step = 0;
+    int i;
+
+    if (model->Size > INDEX_CACHE_SAMPLE_SIZE)
+        step = (model->Size - INDEX_CACHE_SAMPLE_SIZE) / (INDEX_CACHE_SAMPLES - 1);
+
+    for (i = 0; i < INDEX_CACHE_SAMPLES; i++)
+    {
+        offset_t size = INDEX_CACHE_SAMPLE_SIZE;
+        const char *text = GetModelText(model, step * i, buffer, &size);
+
+        hash = HashBytes(hash, text, (size_t)size);
+    }
+
+    return hash;
+}
+
+/*  Returns the last write time of the file
+INPUT:
+    const model_t *model - pointer on model structure with the opened file
+    unsigned long long *time - the last write time
+RETURN:
+    error_t - error code
+*/
+static error_t GetWriteTime(const model_t *model, unsigned long long *time)
+{
+    FILETIME writeTime;
+
+    if (!GetFileTime(model->File, NULL, NULL, &writeTime))
+        return NO_INPUT_FILE;
+
+    *time = (unsigned long long)writeTime.dwHighDateTime << 32 | writeTime.dwLowDateTime;
+    return SUCCESS;
+}
+
+/*  Fills the header describing the file, the index fields are left zero
+INPUT:
+    const model_t *model - pointer on model structure with the mapped file
+    index_header_t *header - the header
+    char *indexPath - path of the index file, MAX_PATH characters
+RETURN:
+    error_t - error code
+*/
+static error_t FillHeader(const model_t *model, index_header_t *header, char *indexPath)
+{
+    const char hexDigits[] = "0123456789abcdef";
+    unsigned long long pathHash;
+    DWORD len;
+    int i;
+
+    memset(header, 0, sizeof(index_header_t));
+    memcpy(header->Magic, INDEX_CACHE_MAGIC, sizeof(INDEX_CACHE_MAGIC));
+    header->Version = INDEX_CACHE_VERSION;
+    header->FileSize = model->Size;
+    if (GetWriteTime(model, &header->WriteTime) != SUCCESS)
+        return NO_INPUT_FILE;
+
+    len = GetFullPathName(model->FileName, MAX_PATH, header->Path, NULL);
+    if (len == 0 || len >= MAX_PATH)
+        return NO_INPUT_FILE;
+
+    /* The index file is named by the hash of the full path */
+    len = GetTempPath(MAX_PATH, indexPath);
+    if (len == 0 || len + sizeof(INDEX_CACHE_DIRECTORY) + 1 + 16 + sizeof(".idx") > MAX_PATH)
+        return NO_INPUT_FILE;
+    strcpy(indexPath + len, INDEX_CACHE_DIRECTORY);
+    CreateDirectory(indexPath, NULL);
+    len += sizeof(INDEX_CACHE_DIRECTORY) - 1;
+    indexPath[len++] = '\\';
+
+    pathHash = HashBytes(FNV_OFFSET, header->Path, strlen(header->Path));
+    for (i = 60; i >= 0; i -= 4)
+        indexPath[len++] = hexDigits[(pathHash >> i) & 0xF];
+    strcpy(indexPath + len, ".idx");
+
+    header->SampleHash = GetSampleHash(model);
+    return SUCCESS;
+}
+
+/*  Returns the number of bytes of the index file
+INPUT:
+    const index_header_t *header - the header with the index fields
+RETURN:
+    unsigned long long - the number of bytes
+*/
+static unsigned long long GetIndexFileSize(const index_header_t *header)
+{
+    unsigned long long numOfBlocks = (header->Count + LINE_INDEX_BLOCK - 1) / LINE_INDEX_BLOCK;
+
+    /* The 64-bit arrays go first, so every array stays aligned */
+    return sizeof(index_header_t) + numOfBlocks * sizeof(offset_t) +
+           header->NumOfWide * LINE_INDEX_BLOCK * sizeof(offset_t) + header->TabWords * sizeof(unsigned long long) +
+           numOfBlocks * sizeof(unsigned long) + header->Count * sizeof(unsigned short);
+}
+
+/*  Attaches the line index saved for the file when it was opened before. The
+    index file is found by the full path of the file and is used only when the
+    size, the last write time and the hash of the sampled parts of the file are
+    the same. The index file is mapped, nothing is read line by line except the bit
+    set of the lines having tabs, which is copied to grow with the file. The index
+    file of a changed or damaged file is deleted, it would never be used again
+INPUT:
+    model_t *model - pointer on model structure with the mapped file and empty index
+    int *tabSize - the tab size the widths of the lines having tabs were counted for
+OUTPUT:
+    model_t *model - pointer on model structure with the complete index if operation
+                     ended successfully, otherwise the index is left empty
+RETURN:
+    error_t - error code, NO_INPUT_FILE if there is no valid index file
+*/
+error_t LoadIndexCache(model_t *model, int *tabSize)
+{
+    index_header_t expected;
+    const index_header_t *header;
+    char indexPath[MAX_PATH];
+    LARGE_INTEGER indexSize;
+    HANDLE file;
+    HANDLE mapping;
+    const char *image = NULL;
+    unsigned long long numOfBlocks;
+    unsigned long long i;
+    const char *arrays;
+    size_t arraysSize;
+
+    if (FillHeader(model, &expected, indexPath) != SUCCESS)
+        return NO_INPUT_FILE;
+
+    file = CreateFile(indexPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NO_INPUT_FILE;
+
+    /* The view keeps the mapping alive after the handles are closed */
+    if (GetFileSizeEx(file, &indexSize) && (unsigned long long)indexSize.QuadPart >= sizeof(index_header_t) &&
+        (unsigned long long)indexSize.QuadPart <= SIZE_MAX)
+    {
+        mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL)
+        {
+            image = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+    if (image == NULL)
+        return NO_INPUT_FILE;
+
+    header = (const index_header_t *)image;
+    if (memcmp(header->Magic, expected.Magic, sizeof(expected.Magic)) != 0 ||
+        header->Version != expected.Version || header->FileSize != expected.FileSize ||
+        header->WriteTime != expected.WriteTime || header->SampleHash != expected.SampleHash ||
+        strncmp(header->Path, expected.Path, MAX_PATH) != 0 || header->Count < 2 ||
+        header->Count > (unsigned long long)indexSize.QuadPart ||
+        header->NumOfWide > header->Count / LINE_INDEX_BLOCK + 1 ||
+        header->TabWords > header->Count / TAB_WORD_BITS + 1 || header->TabSize == 0 ||
+        GetIndexFileSize(header) != (unsigned long long)indexSize.QuadPart)
+    {
+        UnmapViewOfFile(image);
+        DeleteFile(indexPath);
+        return NO_INPUT_FILE;
+    }
+
+    numOfBlocks = (header->Count + LINE_INDEX_BLOCK - 1) / LINE_INDEX_BLOCK;
+    arrays = image + sizeof(index_header_t);
+    arraysSize = (numOfBlocks + header->NumOfWide * LINE_INDEX_BLOCK) * sizeof(offset_t) +
+                 header->TabWords * sizeof(unsigned long long);
+
+    if (header->TabWords > 0)
+    {
+        model->TabLines = malloc((size_t)header->TabWords * sizeof(unsigned long long));
+        if (model->TabLines == NULL)
+        {
+            UnmapViewOfFile(image);
+            return NO_INPUT_FILE;
+        }
+        memcpy(model->TabLines, arrays + (numOfBlocks + header->NumOfWide * LINE_INDEX_BLOCK) * sizeof(offset_t),
+               (size_t)header->TabWords * sizeof(unsigned long long));
+    }
+
+    AttachLineIndex(&model->Index, image,
+                    (const offset_t *)arrays,
+                    (const unsigned long *)(arrays + arraysSize),
+                    (const unsigned short *)(arrays + arraysSize + numOfBlocks * sizeof(unsigned long)),
+                    (const offset_t *)(arrays + numOfBlocks * sizeof(offset_t)),
+                    header->Count, (unsigned long)header->NumOfWide);
+
+    /* The widened blocks must exist and the index must end with the end of the file */
+    for (i = 0; i < numOfBlocks; i++)
+        if (model->Index.WideBlocks[i] != NARROW_BLOCK && model->Index.WideBlocks[i] >= model->Index.NumOfWide)
+            break;
+    if (i < numOfBlocks || GetLineOffset(&model->Index, 0) != 0 ||
+        GetLineOffset(&model->Index, header->Count - 1) != model->Size)
+    {
+        ClearLineIndex(&model->Index);
+        free(model->TabLines);
+        model->TabLines = NULL;
+        DeleteFile(indexPath);
+        return NO_INPUT_FILE;
+    }
+
+    model->NumOfLines = header->Count - 1;
+    model->MaxLength = header->MaxLength;
+    model->MaxColumns = header->MaxColumns;
+    model->MaxPlainColumns = header->MaxPlainColumns;
+    model->MaxTabColumns = header->MaxTabColumns;
+    model->TabWords = header->TabWords;
+    model->NumOfTabLines = header->NumOfTabLines;
+    model->IsUtf8 = header->IsUtf8 != 0;
+    model->IndexedSize = model->Size;
+    *tabSize = (int)header->TabSize;
+    return SUCCESS;
+}
+
+/*  Writes the bytes to the file in chunks, the writing stops when the loading
+    of the model is cancelled
+INPUT:
+    const model_t *model - pointer on model structure
+    HANDLE file - the file
+    const void *data - pointer on the bytes
+    unsigned long long size - the number of bytes
+RETURN:
+    error_t - error code
+*/
+static error_t WriteBytes(const model_t *model, HANDLE file, const void *data, unsigned long long size)
+{
+    const char *bytes = data;
+
+    while (size > 0)
+    {
+        DWORD chunk = size > WRITE_CHUNK ? WRITE_CHUNK : (DWORD)size;
+        DWORD written;
+
+        if (model->CancelLoading || !WriteFile(file, bytes, chunk, &written, NULL) || written != chunk)
+            return NO_INPUT_FILE;
+
+        bytes += chunk;
+        size -= chunk;
+    }
+
+    return SUCCESS;
+}
+
+/*  Orders the index files from the least recently written
+INPUT:
+    const void *first - the first index file
+    const void *second - the second index file
+RETURN:
+    int - negative, zero or positive as the first file is written before, with or after the second
+*/
+static int CompareWriteTimes(const void *first, const void *second)
+{
+    const cached_index_t *a = (const cached_index_t *)first;
+    const cached_index_t *b = (const cached_index_t *)second;
+
+    if (a->WriteTime != b->WriteTime)
+        return a->WriteTime < b->WriteTime ? -1 : 1;
+
+    return 0;
+}
+
+/*  Deletes the least recently written index files until the new index file fits
+    in the budget with the others. The index file being replaced is not counted
+INPUT:
+    const char *indexPath - path of the new index file
+    unsigned long long size - the number of bytes of the new index file
+*/
+static void TrimIndexCache(const char *indexPath, unsigned long long size)
+{
+    char path[MAX_PATH];
+    const char *name = strrchr(indexPath, '\\') + 1;
+    size_t directoryLength = (size_t)(name - indexPath);
+    cached_index_t *indexes = NULL;
+    size_t numOfIndexes = 0;
+    size_t capacity = 0;
+    unsigned long long total = size;
+    WIN32_FIND_DATA found;
+    HANDLE search;
+    size_t i;
+
+    if (directoryLength + sizeof("*.idx") > MAX_PATH)
+        return;
+    memcpy(path, indexPath, directoryLength);
+    strcpy(path + directoryLength, "*.idx");
+
+    search = FindFirstFile(path, &found);
+    if (search == INVALID_HANDLE_VALUE)
+        return;
+
+    do
+    {
+        if ((found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || strcmp(found.cFileName, name) == 0)
+            continue;
+
+        if (numOfIndexes == capacity)
+        {
+            size_t newCapacity = capacity == 0 ? 16 : capacity * 2;
+            cached_index_t *newIndexes = realloc(indexes, newCapacity * sizeof(cached_index_t));
+
+            if (newIndexes == NULL)
+                break;
+            indexes = newIndexes;
+            capacity = newCapacity;
+        }
+
+        indexes[numOfIndexes].WriteTime = (unsigned long long)found.ftLastWriteTime.dwHighDateTime << 32 |
+                                          found.ftLastWriteTime.dwLowDateTime;
+        indexes[numOfIndexes].Size = (unsigned long long)found.nFileSizeHigh << 32 | found.nFileSizeLow;
+        strcpy(indexes[numOfIndexes].Name, found.cFileName);
+        total += indexes[numOfIndexes].Size;
+        numOfIndexes++;
+    }
+    while (FindNextFile(search, &found));
+    FindClose(search);
+
+    /* The index files in use by other viewers are not deleted and stay counted */
+    if (numOfIndexes > 0)
+        qsort(indexes, numOfIndexes, sizeof(cached_index_t), CompareWriteTimes);
+    for (i = 0; i < numOfIndexes && total > CacheBudget; i++)
+        if (directoryLength + strlen(indexes[i].Name) < MAX_PATH)
+        {
+            strcpy(path + directoryLength, indexes[i].Name);
+            if (DeleteFile(path))
+                total -= indexes[i].Size;
+        }
+
+    free(indexes);
+}
+
+/*  Saves the complete line index of the file for the next opening. The index file
+    is written under a temporary name and renamed, so it is never seen incomplete.
+    The index files written least recently are deleted to keep all of them within
+    the budget, an index larger than the budget is not saved. The saving stops
+    when the loading of the model is cancelled
+INPUT:
+    const model_t *model - pointer on model structure with the complete index
+RETURN:
+    error_t - error code
+*/
+error_t SaveIndexCache(const model_t *model)
+{
+    const line_index_t *index = &model->Index;
+    index_header_t header;
+    char indexPath[MAX_PATH];
+    char tempPath[MAX_PATH];
+    unsigned long long numOfBlocks = (index->Count + LINE_INDEX_BLOCK - 1) / LINE_INDEX_BLOCK;
+    HANDLE file;
+    error_t err;
+
+    if (FillHeader(model, &header, indexPath) != SUCCESS)
+        return NO_INPUT_FILE;
+    header.Count = index->Count;
+    header.NumOfWide = index->NumOfWide;
+    header.MaxLength = model->MaxLength;
+    header.MaxPlainColumns = model->MaxPlainColumns;
+
+    /* The tab size may be changed while the index is saved, the widths must match it */
+    AcquireSRWLockShared((SRWLOCK *)&model->Lock);
+    header.MaxColumns = model->MaxColumns;
+    header.MaxTabColumns = model->MaxTabColumns;
+    header.TabSize = model->TabSize;
+    ReleaseSRWLockShared((SRWLOCK *)&model->Lock);
+    header.TabWords = model->TabWords;
+    header.NumOfTabLines = model->NumOfTabLines;
+    header.IsUtf8 = model->IsUtf8;
+
+    if (GetIndexFileSize(&header) > CacheBudget)
+        return NO_INPUT_FILE;
+    TrimIndexCache(indexPath, GetIndexFileSize(&header));
+
+    strcpy(tempPath, indexPath);
+    strcpy(tempPath + strlen(tempPath) - sizeof(".idx") + 1, ".tmp");
+
+    file = CreateFile(tempPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NO_INPUT_FILE;
+
+    err = WriteBytes(model, file, &header, sizeof(header));
+    if (err == SUCCESS)
+        err = WriteBytes(model, file, index->Checkpoints, numOfBlocks * sizeof(offset_t));
+    if (err == SUCCESS)
+        err = WriteBytes(model, file, index->Wide, (unsigned long long)index->NumOfWide * LINE_INDEX_BLOCK * sizeof(offset_t));
+    if (err == SUCCESS)
+        err = WriteBytes(model, file, model->TabLines, model->TabWords * sizeof(unsigned long long));
+    if (err == SUCCESS)
+        err = WriteBytes(model, file, index->WideBlocks, numOfBlocks * sizeof(unsigned long));
+    if (err == SUCCESS)
+        err = WriteBytes(model, file, index->Deltas, index->Count * sizeof(unsigned short));
+    CloseHandle(file);
+
+    if (err == SUCCESS && !MoveFileEx(tempPath, indexPath, MOVEFILE_REPLACE_EXISTING))
+        err = NO_INPUT_FILE;
+    if (err != SUCCESS)
+        DeleteFile(tempPath);
+
+    return err;
+}
@@ -0,0 +1,47 @@
+#ifndef __INDEX_CACHE_H_INCLUDED
+#define __INDEX_CACHE_H_INCLUDED
+
+#include "fileModel.h"
+
+#define INDEX_CACHE_VERSION 3                   /* Version of the index file format */
+#define INDEX_CACHE_DIRECTORY "textViewerIndex" /* Directory of the index files in the temporary directory */
+#define INDEX_CACHE_MIN_SIZE (16ul << 20)       /* Smaller files are split on lines faster than the index is read */
+#define INDEX_CACHE_SAMPLES 16                  /* The number of sampled parts of the file */
+#define INDEX_CACHE_SAMPLE_SIZE 4096            /* The number of characters in one sampled part */
+#define INDEX_CACHE_BUDGET (1ul << 30)          /* Default disk budget of all the index files in bytes */
+
+/*  Sets the disk budget of the index files of all the files
+INPUT:
+    unsigned long bytes - the number of bytes
+*/
+void SetIndexCacheBudget(unsigned long bytes);
+
+/*  Attaches the line index saved for the file when it was opened before. The
+    index file is found by the full path of the file and is used only when the
+    size, the last write time and the hash of the sampled parts of the file are
+    the same. The index file is mapped, nothing is read line by line. The index
+    file of a changed or damaged file is deleted
+INPUT:
+    model_t *model - pointer on model structure with the mapped file and empty index
+    int *tabSize - the tab size the widths of the lines having tabs were counted for
+OUTPUT:
+    model_t *model - pointer on model structure with the complete index if operation
+                     ended successfully, otherwise the index is left empty
+RETURN:
+    error_t - error code, NO_INPUT_FILE if there is no valid index file
+*/
+error_t LoadIndexCache(model_t *model, int *tabSize);
+
+/*  Saves the complete line index of the file for the next opening. The index file
+    is written under a temporary name and renamed, so it is never seen incomplete.
+    The index files written least recently are deleted to keep all of them within
+    the budget, an index larger than the budget is not saved. The saving stops
+    when the loading of the model is cancelled
+INPUT:
+    const model_t *model - pointer on model structure with the complete index
+RETURN:
+    error_t - error code
+*/
+error_t SaveIndexCache(const model_t *model);
+
+#endif // __INDEX_CACHE_H_INCLUDED
@@ -0,0 +1,742 @@
+#include "inflate.h"
+#include "blockCache.h"
+#include <string.h>
+
+#define GZIP_ID1 0x1F               /* The first character of a gzip member */
+#define GZIP_ID2 0x8B               /* The second character of a gzip member */
+#define GZIP_DEFLATE 8              /* The only compression method of gzip */
+#define GZIP_FHCRC 0x02             /* The header has a CRC16 */
+#define GZIP_FEXTRA 0x04            /* The header has extra fields */
+#define GZIP_FNAME 0x08             /* The header has the original file name */
+#define GZIP_FCOMMENT 0x10          /* The header has a comment */
+#define GZIP_TRAILER 8              /* CRC32 and the size of the member output */
+#define END_OF_BLOCK 256            /* The literal/length symbol ending the block */
+
+/* Base values and the extra bits of the length and the distance symbols */
+static const unsigned short lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                              35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const unsigned char lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                              3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const unsigned short distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                                257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                                8193, 12289, 16385, 24577};
+static const unsigned char distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                                7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+/* Order of the code lengths of the code length code */
+static const unsigned char codeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+/*  Prepares the reading of the compressed file
+INPUT:
+    compressed_input_t *input - pointer on input structure
+    HANDLE mapping - file mapping object of the compressed file
+    offset_t size - the number of characters in the compressed file
+*/
+void InitCompressedInput(compressed_input_t *input, HANDLE mapping, offset_t size)
+{
+    input->Mapping = mapping;
+    input->Size = size;
+    input->View = NULL;
+    input->Data = NULL;
+    input->Length = 0;
+    input->Next = 0;
+    input->Offset = 0;
+}
+
+/*  Moves the reading to the offset
+INPUT:
+    compressed_input_t *input - pointer on input structure
+    offset_t offset - offset in the compressed file
+*/
+void SeekCompressedInput(compressed_input_t *input, offset_t offset)
+{
+    ClearCompressedInput(input);
+    input->Offset = offset;
+}
+
+/*  Makes the next characters available in Data, the read ones are dropped
+INPUT:
+    compressed_input_t *input - pointer on input structure
+RETURN:
+    error_t - error code, DAMAGED_FILE at the end of the file
+*/
+error_t FillCompressedInput(compressed_input_t *input)
+{
+    offset_t offset = input->Offset + input->Next;
+    offset_t size = input->Size - offset;
+    const unsigned char *data;
+
+    if (offset >= input->Size)
+        return DAMAGED_FILE;
+    if (size > INPUT_VIEW)
+        size = INPUT_VIEW;
+
+    SeekCompressedInput(input, offset);
+    data = (const unsigned char *)MapFileRange(input->Mapping, offset, (size_t)size, &input->View);
+    if (data == NULL)
+    {
+        input->View = NULL;
+        return MEMORY_SHORTAGE;
+    }
+
+    input->Data = data;
+    input->Length = (size_t)size;
+    return SUCCESS;
+}
+
+/*  Copies the characters at the offset, the input is moved to them if they are not mapped
+INPUT:
+    compressed_input_t *input - pointer on input structure
+    offset_t offset - offset in the compressed file
+    unsigned char *bytes - buffer receiving the characters
+    size_t count - the number of characters, less than INPUT_VIEW
+RETURN:
+    error_t - error code, DAMAGED_FILE if the file ends before
+*/
+error_t ReadCompressedInput(compressed_input_t *input, offset_t offset, unsigned char *bytes, size_t count)
+{
+    error_t err;
+
+    if (offset + count > input->Size)
+        return DAMAGED_FILE;
+
+    if (offset < input->Offset || offset + count > input->Offset + input->Length)
+    {
+        SeekCompressedInput(input, offset);
+        err = FillCompressedInput(input);
+        if (err != SUCCESS)
+            return err;
+    }
+
+    memcpy(bytes, input->Data + (offset - input->Offset), count);
+    return SUCCESS;
+}
+
+/*  Unmaps the characters of the input
+INPUT:
+    compressed_input_t *input - pointer on input structure
+*/
+void ClearCompressedInput(compressed_input_t *input)
+{
+    if (input->View != NULL)
+        UnmapViewOfFile(input->View);
+
+    input->Offset += input->Next;
+    input->View = NULL;
+    input->Data = NULL;
+    input->Length = 0;
+    input->Next = 0;
+}
+
+/*  Takes the next characters of the input into the bit buffer while there is room
+    for them, the end of the input is not an error here
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+*/
+static void PrefetchBits(inflate_t *inflate)
+{
+    compressed_input_t *input = &inflate->Input;
+
+    while (inflate->BitCount <= 56)
+    {
+        if (input->Next == input->Length &&
+            (input->Offset + input->Next >= input->Size || FillCompressedInput(input) != SUCCESS))
+            return;
+
+        inflate->BitBuffer |= (unsigned long long)input->Data[input->Next++] << inflate->BitCount;
+        inflate->BitCount += 8;
+    }
+}
+
+/*  Makes the bits available in the bit buffer
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+    int count - the number of bits, at most 32
+RETURN:
+    error_t - error code, DAMAGED_FILE if the input ends before
+*/
+static error_t NeedBits(inflate_t *inflate, int count)
+{
+    if (inflate->BitCount < count)
+        PrefetchBits(inflate);
+
+    return inflate->BitCount < count ? DAMAGED_FILE : SUCCESS;
+}
+
+/*  Takes the bits from the bit buffer, they must be available
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+    int count - the number of bits
+RETURN:
+    unsigned long - the bits, the first one is the lowest
+*/
+static unsigned long TakeBits(inflate_t *inflate, int count)
+{
+    unsigned long bits = (unsigned long)(inflate->BitBuffer & ((1ull << count) - 1));
+
+    inflate->BitBuffer >>= count;
+    inflate->BitCount -= count;
+    return bits;
+}
+
+/*  Reads the bits of the input
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+    int count - the number of bits, at most 32
+    unsigned long *bits - the read bits
+RETURN:
+    error_t - error code
+*/
+static error_t ReadBits(inflate_t *inflate, int count, unsigned long *bits)
+{
+    error_t err = NeedBits(inflate, count);
+
+    if (err == SUCCESS)
+        *bits = TakeBits(inflate, count);
+    return err;
+}
+
+/*  Drops the bits up to the next byte boundary of the input
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+*/
+static void AlignToByte(inflate_t *inflate)
+{
+    TakeBits(inflate, inflate->BitCount % 8);
+}
+
+/*  Builds the canonical Huffman code from the code lengths of the symbols
+INPUT:
+    huffman_t *code - pointer on code structure
+    const unsigned char *lengths - the code length of every symbol, zero for unused ones
+    int numOfSymbols - the number of symbols
+RETURN:
+    error_t - error code, DAMAGED_FILE if the lengths are over-subscribed
+*/
+static error_t BuildHuffman(huffman_t *code, const unsigned char *lengths, int numOfSymbols)
+{
+    unsigned short offsets[16];
+    unsigned short nextCode[16];
+    int left = 1;
+    int len;
+    int symbol;
+
+    memset(code->Count, 0, sizeof(code->Count));
+    for (symbol = 0; symbol < numOfSymbols; symbol++)
+        code->Count[lengths[symbol]]++;
+    code->Count[0] = 0;
+
+    /* More codes of a length than the shorter ones leave room for cannot be decoded */
+    for (len = 1; len < 16; len++)
+    {
+        left = 2 * left - code->Count[len];
+        if (left < 0)
+            return DAMAGED_FILE;
+    }
+
+    offsets[1] = 0;
+    nextCode[1] = 0;
+    for (len = 1; len < 15; len++)
+    {
+        offsets[len + 1] = offsets[len] + code->Count[len];
+        nextCode[len + 1] = (nextCode[len] + code->Count[len]) << 1;
+    }
+
+    memset(code->Fast, 0, sizeof(code->Fast));
+    for (symbol = 0; symbol < numOfSymbols; symbol++)
+    {
+        unsigned reversed = 0;
+        unsigned bits;
+        int i;
+
+        len = lengths[symbol];
+        if (len == 0)
+            continue;
+
+        code->Symbol[offsets[len]++] = (unsigned short)symbol;
+        bits = nextCode[len]++;
+        if (len > FAST_BITS)
+            continue;
+
+        /* The codes are stored from the highest bit, the input is read from the lowest one */
+        for (i = 0; i < len; i++)
+            reversed |= ((bits >> i) & 1) << (len - 1 - i);
+        for (i = reversed; i < (1 << FAST_BITS); i += 1 << len)
+            code->Fast[i] = (unsigned short)(len << 9 | symbol);
+    }
+
+    return SUCCESS;
+}
+
+/*  Decodes one symbol, the short codes are found by one lookup
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+    const huffman_t *code - pointer on code structure
+    int *symbol - the decoded symbol
+RETURN:
+    error_t - error code
+*/
+static error_t DecodeSymbol(inflate_t *inflate, const huffman_t *code, int *symbol)
+{
+    int first = 0;
+    int index = 0;
+    int bits = 0;
+    int len;
+
+    if (inflate->BitCount < 15)
+        PrefetchBits(inflate);
+
+    if (inflate->BitCount >= FAST_BITS)
+    {
+        unsigned fast = code->Fast[inflate->BitBuffer & ((1 << FAST_BITS) - 1)];
+
+        if (fast != 0)
+        {
+            TakeBits(inflate, fast >> 9);
+            *symbol = fast & 0x1FF;
+            return SUCCESS;
+        }
+    }
+
+    /* The long codes and the codes at the end of the input are decoded bit by bit */
+    for (len = 1; len < 16; len++)
+    {
+        if (inflate->BitCount == 0)
+            return DAMAGED_FILE;
+
+        bits |= TakeBits(inflate, 1);
+        if (bits - code->Count[len] < first)
+        {
+            *symbol = code->Symbol[index + (bits - first)];
+            return SUCCESS;
+        }
+        index += code->Count[len];
+        first = (first + code->Count[len]) << 1;
+        bits <<= 1;
+    }
+
+    return DAMAGED_FILE;
+}
+
+/*  Reads the code lengths of the dynamic block and builds its codes
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+RETURN:
+    error_t - error code
+*/
+static error_t ReadDynamicCodes(inflate_t *inflate)
+{
+    unsigned char lengths[288 + 32];
+    unsigned long numOfLengths, numOfDistances, numOfCodeLengths;
+    unsigned long i, bits;
+    error_t err;
+
+    if ((err = ReadBits(inflate, 5, &numOfLengths)) != SUCCESS ||
+        (err = ReadBits(inflate, 5, &numOfDistances)) != SUCCESS ||
+        (err = ReadBits(inflate, 4, &numOfCodeLengths)) != SUCCESS)
+        return err;
+    numOfLengths += 257;
+    numOfDistances += 1;
+    numOfCodeLengths += 4;
+    if (numOfLengths > 286 || numOfDistances > 30)
+        return DAMAGED_FILE;
+
+    /* The lengths are coded by the code length code */
+    memset(lengths, 0, 19);
+    for (i = 0; i < numOfCodeLengths; i++)
+    {
+        if ((err = ReadBits(inflate, 3, &bits)) != SUCCESS)
+            return err;
+        lengths[codeLengthOrder[i]] = (unsigned char)bits;
+    }
+    if ((err = BuildHuffman(&inflate->Lengths, lengths, 19)) != SUCCESS)
+        return err;
+
+    for (i = 0; i < numOfLengths + numOfDistances;)
+    {
+        unsigned char repeated = 0;
+        unsigned long count;
+        int symbol;
+
+        if ((err = DecodeSymbol(inflate, &inflate->Lengths, &symbol)) != SUCCESS)
+            return err;
+        if (symbol < 16)
+        {
+            lengths[i++] = (unsigned char)symbol;
+            continue;
+        }
+
+        if (symbol == 16)
+        {
+            if (i == 0)
+                return DAMAGED_FILE;
+            repeated = lengths[i - 1];
+            err = ReadBits(inflate, 2, &count);
+            count += 3;
+        }
+        else if (symbol == 17)
+        {
+            err = ReadBits(inflate, 3, &count);
+            count += 3;
+        }
+        else
+        {
+            err = ReadBits(inflate, 7, &count);
+            count += 11;
+        }
+        if (err != SUCCESS)
+            return err;
+        if (i + count > numOfLengths + numOfDistances)
+            return DAMAGED_FILE;
+
+        while (count-- > 0)
+            lengths[i++] = repeated;
+    }
+
+    /* The block cannot end without the end-of-block code */
+    if (lengths[END_OF_BLOCK] == 0)
+        return DAMAGED_FILE;
+
+    if ((err = BuildHuffman(&inflate->Lengths, lengths, numOfLengths)) != SUCCESS)
+        return err;
+    return BuildHuffman(&inflate->Distances, lengths + numOfLengths, numOfDistances);
+}
+
+/*  Builds the codes of the block compressed with the fixed codes
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+RETURN:
+    error_t - error code
+*/
+static error_t BuildFixedCodes(inflate_t *inflate)
+{
+    unsigned char lengths[288];
+    int symbol;
+
+    for (symbol = 0; symbol < 288; symbol++)
+        lengths[symbol] = symbol < 144 ? 8 : symbol < 256 ? 9 : symbol < 280 ? 7 : 8;
+    BuildHuffman(&inflate->Lengths, lengths, 288);
+
+    memset(lengths, 5, 30);
+    return BuildHuffman(&inflate->Distances, lengths, 30);
+}
+
+/*  Reads the header of the next deflate block
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+RETURN:
+    error_t - error code
+*/
+static error_t ReadBlockHeader(inflate_t *inflate)
+{
+    unsigned long isLast, type, length, complement;
+    error_t err;
+
+    if ((err = ReadBits(inflate, 1, &isLast)) != SUCCESS || (err = ReadBits(inflate, 2, &type)) != SUCCESS)
+        return err;
+    inflate->IsLastBlock = isLast != 0;
+
+    switch (type)
+    {
+        case 0:
+            /* The stored characters start at the byte boundary after their lengths */
+            AlignToByte(inflate);
+            if ((err = ReadBits(inflate, 16, &length)) != SUCCESS ||
+                (err = ReadBits(inflate, 16, &complement)) != SUCCESS)
+                return err;
+            if (length != (~complement & 0xFFFF))
+                return DAMAGED_FILE;
+            inflate->Stored = length;
+            inflate->State = INFLATE_STORED;
+            return SUCCESS;
+        case 1:
+            inflate->State = INFLATE_CODES;
+            return BuildFixedCodes(inflate);
+        case 2:
+            inflate->State = INFLATE_CODES;
+            return ReadDynamicCodes(inflate);
+        default:
+            return DAMAGED_FILE;
+    }
+}
+
+/*  Skips the header of the next gzip member, the decoding ends if there is no member
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+RETURN:
+    error_t - error code
+*/
+static error_t ReadMemberHeader(inflate_t *inflate)
+{
+    unsigned long id1, id2, method, flags, bits, length;
+    error_t err;
+
+    AlignToByte(inflate);
+    PrefetchBits(inflate);
+
+    /* The zero padding or garbage after the last member is ignored as gzip does */
+    if (inflate->BitCount < 16 || (inflate->BitBuffer & 0xFF) != GZIP_ID1 ||
+        ((inflate->BitBuffer >> 8) & 0xFF) != GZIP_ID2)
+    {
+        inflate->State = INFLATE_END;
+        return SUCCESS;
+    }
+
+    if ((err = ReadBits(inflate, 8, &id1)) != SUCCESS || (err = ReadBits(inflate, 8, &id2)) != SUCCESS ||
+        (err = ReadBits(inflate, 8, &method)) != SUCCESS || (err = ReadBits(inflate, 8, &flags)) != SUCCESS)
+        return err;
+    if (method != GZIP_DEFLATE)
+        return UNSUPPORTED_FORMAT;
+
+    /* The modification time, the extra flags and the operating system */
+    for (length = 0; length < 6 && err == SUCCESS; length++)
+        err = ReadBits(inflate, 8, &bits);
+
+    if (err == SUCCESS && (flags & GZIP_FEXTRA))
+    {
+        err = ReadBits(inflate, 16, &length);
+        while (err == SUCCESS && length-- > 0)
+            err = ReadBits(inflate, 8, &bits);
+    }
+    if (err == SUCCESS && (flags & GZIP_FNAME))
+        while ((err = ReadBits(inflate, 8, &bits)) == SUCCESS && bits != 0);
+    if (err == SUCCESS && (flags & GZIP_FCOMMENT))
+        while ((err = ReadBits(inflate, 8, &bits)) == SUCCESS && bits != 0);
+    if (err == SUCCESS && (flags & GZIP_FHCRC))
+        err = ReadBits(inflate, 16, &bits);
+
+    inflate->IsLastBlock = 0;
+    inflate->State = INFLATE_BLOCK;
+    return err;
+}
+
+/*  Skips the trailer of the gzip member
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+RETURN:
+    error_t - error code
+*/
+static error_t ReadMemberTrailer(inflate_t *inflate)
+{
+    unsigned long bits;
+    error_t err = SUCCESS;
+    int i;
+
+    AlignToByte(inflate);
+    for (i = 0; i < GZIP_TRAILER && err == SUCCESS; i++)
+        err = ReadBits(inflate, 8, &bits);
+
+    inflate->State = INFLATE_MEMBER;
+    return err;
+}
+
+/*  Copies the characters of the stored block
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+    char *buffer - buffer receiving the characters
+    size_t size - the size of the buffer
+    size_t *produced - the number of characters in the buffer
+RETURN:
+    error_t - error code
+*/
+static error_t CopyStored(inflate_t *inflate, char *buffer, size_t size, size_t *produced)
+{
+    compressed_input_t *input = &inflate->Input;
+
+    while (inflate->Stored > 0 && *produced < size)
+    {
+        unsigned char c;
+
+        /* The prefetched characters are used before the input */
+        if (inflate->BitCount >= 8)
+            c = (unsigned char)TakeBits(inflate, 8);
+        else if (input->Next < input->Length || FillCompressedInput(input) == SUCCESS)
+            c = input->Data[input->Next++];
+        else
+            return DAMAGED_FILE;
+
+        inflate->Window[inflate->Out++ % INFLATE_WINDOW] = c;
+        buffer[(*produced)++] = (char)c;
+        inflate->Stored--;
+    }
+
+    if (inflate->Stored == 0)
+        inflate->State = inflate->IsLastBlock ? INFLATE_TRAILER : INFLATE_BLOCK;
+    return SUCCESS;
+}
+
+/*  Decodes the characters of the compressed block
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+    char *buffer - buffer receiving the characters
+    size_t size - the size of the buffer
+    size_t *produced - the number of characters in the buffer
+RETURN:
+    error_t - error code
+*/
+static error_t DecodeCodes(inflate_t *inflate, char *buffer, size_t size, size_t *produced)
+{
+    unsigned long bits;
+    int symbol;
+    error_t err;
+
+    while (*produced < size)
+    {
+        /* The copy of the previous characters may be interrupted by the full buffer */
+        if (inflate->CopyLength > 0)
+        {
+            unsigned char c = inflate->Window[(inflate->Out - inflate->CopyDistance) % INFLATE_WINDOW];
+
+            inflate->Window[inflate->Out++ % INFLATE_WINDOW] = c;
+            buffer[(*produced)++] = (char)c;
+            inflate->CopyLength--;
+            continue;
+        }
+
+        if ((err = DecodeSymbol(inflate, &inflate->Lengths, &symbol)) != SUCCESS)
+            return err;
+
+        if (symbol < END_OF_BLOCK)
+        {
+            inflate->Window[inflate->Out++ % INFLATE_WINDOW] = (unsigned char)symbol;
+            buffer[(*produced)++] = (char)symbol;
+            continue;
+        }
+        if (symbol == END_OF_BLOCK)
+        {
+            inflate->State = inflate->IsLastBlock ? INFLATE_TRAILER : INFLATE_BLOCK;
+            return SUCCESS;
+        }
+
+        symbol -= END_OF_BLOCK + 1;
+        if (symbol >= 29 || (err = ReadBits(inflate, lengthExtra[symbol], &bits)) != SUCCESS)
+            return DAMAGED_FILE;
+        inflate->CopyLength = lengthBase[symbol] + bits;
+
+        if ((err = DecodeSymbol(inflate, &inflate->Distances, &symbol)) != SUCCESS)
+            return err;
+        if (symbol >= 30 || (err = ReadBits(inflate, distanceExtra[symbol], &bits)) != SUCCESS)
+            return DAMAGED_FILE;
+        inflate->CopyDistance = distanceBase[symbol] + bits;
+        if (inflate->CopyDistance > INFLATE_WINDOW)
+            return DAMAGED_FILE;
+    }
+
+    return SUCCESS;
+}
+
+/*  Starts the decoding at the beginning of a gzip member or at a block boundary
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+    HANDLE mapping - file mapping object of the compressed file
+    offset_t size - the number of characters in the compressed file
+    offset_t bitOffset - offset of the member or the block in bits
+    const unsigned char *window - the 32 KB of the output before the block, NULL at a member
+    offset_t out - the number of output characters before the start
+RETURN:
+    error_t - error code
+*/
+error_t InitInflate(inflate_t *inflate, HANDLE mapping, offset_t size, offset_t bitOffset,
+                    const unsigned char *window, offset_t out)
+{
+    unsigned long bits;
+    offset_t i;
+
+    InitCompressedInput(&inflate->Input, mapping, size);
+    SeekCompressedInput(&inflate->Input, bitOffset / 8);
+    inflate->BitBuffer = 0;
+    inflate->BitCount = 0;
+    inflate->State = window != NULL ? INFLATE_BLOCK : INFLATE_MEMBER;
+    inflate->IsLastBlock = 0;
+    inflate->Stored = 0;
+    inflate->CopyLength = 0;
+    inflate->CopyDistance = 0;
+    inflate->Out = out;
+
+    if (window != NULL)
+        for (i = 0; i < INFLATE_WINDOW; i++)
+            inflate->Window[(out + i) % INFLATE_WINDOW] = window[i];
+
+    /* A block may start inside a character */
+    return bitOffset % 8 != 0 ? ReadBits(inflate, (int)(bitOffset % 8), &bits) : SUCCESS;
+}
+
+/*  Decodes the characters until the buffer is full, the stream ends or a block
+    boundary is reached, so the caller may remember the boundaries as seek points
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+    char *buffer - buffer receiving the characters
+    size_t size - the size of the buffer
+    size_t *produced - the number of decoded characters
+RETURN:
+    error_t - error code
+*/
+error_t Inflate(inflate_t *inflate, char *buffer, size_t size, size_t *produced)
+{
+    error_t err = SUCCESS;
+
+    *produced = 0;
+    while (*produced < size && err == SUCCESS)
+    {
+        switch (inflate->State)
+        {
+            case INFLATE_MEMBER:
+                if (*produced > 0)
+                    return SUCCESS;
+                err = ReadMemberHeader(inflate);
+                break;
+            case INFLATE_BLOCK:
+                if (*produced > 0)
+                    return SUCCESS;
+                err = ReadBlockHeader(inflate);
+                break;
+            case INFLATE_STORED:
+                err = CopyStored(inflate, buffer, size, produced);
+                break;
+            case INFLATE_CODES:
+                err = DecodeCodes(inflate, buffer, size, produced);
+                break;
+            case INFLATE_TRAILER:
+                err = ReadMemberTrailer(inflate);
+                break;
+            default:
+                return SUCCESS;
+        }
+    }
+
+    return err;
+}
+
+/*  Returns the offset of the next unused bit of the input
+INPUT:
+    const inflate_t *inflate - pointer on decoder structure
+RETURN:
+    offset_t - offset in bits
+*/
+offset_t GetInflateBitOffset(const inflate_t *inflate)
+{
+    return (inflate->Input.Offset + inflate->Input.Next) * 8 - inflate->BitCount;
+}
+
+/*  Copies the last 32 KB of the output in their order
+INPUT:
+    const inflate_t *inflate - pointer on decoder structure
+    unsigned char *window - buffer of INFLATE_WINDOW characters
+*/
+void GetInflateWindow(const inflate_t *inflate, unsigned char *window)
+{
+    offset_t i;
+
+    for (i = 0; i < INFLATE_WINDOW; i++)
+        window[i] = inflate->Window[(inflate->Out + i) % INFLATE_WINDOW];
+}
+
+/*  Clears the decoder
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+*/
+void ClearInflate(inflate_t *inflate)
+{
+    ClearCompressedInput(&inflate->Input);
+    inflate->State = INFLATE_END;
+}
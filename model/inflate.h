@@ -0,0 +1,148 @@
+#ifndef __INFLATE_H_INCLUDED
+#define __INFLATE_H_INCLUDED
+
+#include <windows.h>
+#include "../error/error.h"
+#include "modelTypes.h"
+
+#define INFLATE_WINDOW 32768            /* The distance of the back references in deflate */
+#define INPUT_VIEW (4ul << 20)          /* The number of compressed characters mapped at once */
+#define FAST_BITS 9                     /* Codes not longer than it are decoded by one lookup */
+
+/*  Sequential reader of the compressed file through mapped views */
+typedef struct
+{
+    HANDLE Mapping;                 /* File mapping object of the compressed file, not owned */
+    offset_t Size;                  /* The number of characters in the compressed file */
+    const char *View;               /* Mapped view to be unmapped or NULL */
+    const unsigned char *Data;      /* Mapped characters starting at Offset */
+    size_t Length;                  /* The number of mapped characters */
+    size_t Next;                    /* Index of the next unread character in Data */
+    offset_t Offset;                /* Offset of Data in the file */
+} compressed_input_t;
+
+/*  Canonical Huffman code */
+typedef struct
+{
+    unsigned short Count[16];               /* The number of codes of every length */
+    unsigned short Symbol[288];             /* Symbols ordered by their codes */
+    unsigned short Fast[1 << FAST_BITS];    /* Length << 9 | symbol for the short codes or 0 */
+} huffman_t;
+
+/*  Position of the decoder in the gzip stream */
+typedef enum
+{
+    INFLATE_MEMBER,     /* Before the header of a gzip member */
+    INFLATE_BLOCK,      /* Before the header of a deflate block */
+    INFLATE_STORED,     /* Inside a stored block */
+    INFLATE_CODES,      /* Inside a compressed block */
+    INFLATE_TRAILER,    /* After the last block of a member */
+    INFLATE_END,        /* After the last member */
+} inflate_state_t;
+
+/*  Decoder of gzip files which may stop at any output character and may
+    start at any block boundary given the preceding 32 KB of the output */
+typedef struct
+{
+    compressed_input_t Input;       /* The compressed characters */
+    unsigned long long BitBuffer;   /* Bits read from the input but not used yet */
+    int BitCount;                   /* The number of bits in BitBuffer */
+    inflate_state_t State;          /* Current position in the stream */
+    int IsLastBlock;                /* Nonzero while the last block of the member is decoded */
+    unsigned long Stored;           /* Characters left in the stored block */
+    unsigned long CopyLength;       /* Characters left to copy from the window */
+    unsigned long CopyDistance;     /* Distance of the copied characters */
+    huffman_t Lengths;              /* Code of the literals and the lengths of the block */
+    huffman_t Distances;            /* Code of the distances of the block */
+    unsigned char Window[INFLATE_WINDOW];   /* The last output characters, circular */
+    offset_t Out;                   /* The number of output characters */
+} inflate_t;
+
+/*  Prepares the reading of the compressed file
+INPUT:
+    compressed_input_t *input - pointer on input structure
+    HANDLE mapping - file mapping object of the compressed file
+    offset_t size - the number of characters in the compressed file
+*/
+void InitCompressedInput(compressed_input_t *input, HANDLE mapping, offset_t size);
+
+/*  Moves the reading to the offset
+INPUT:
+    compressed_input_t *input - pointer on input structure
+    offset_t offset - offset in the compressed file
+*/
+void SeekCompressedInput(compressed_input_t *input, offset_t offset);
+
+/*  Makes the next characters available in Data, the read ones are dropped
+INPUT:
+    compressed_input_t *input - pointer on input structure
+RETURN:
+    error_t - error code, DAMAGED_FILE at the end of the file
+*/
+error_t FillCompressedInput(compressed_input_t *input);
+
+/*  Copies the characters at the offset, the input is moved to them if they are not mapped
+INPUT:
+    compressed_input_t *input - pointer on input structure
+    offset_t offset - offset in the compressed file
+    unsigned char *bytes - buffer receiving the characters
+    size_t count - the number of characters, less than INPUT_VIEW
+RETURN:
+    error_t - error code, DAMAGED_FILE if the file ends before
+*/
+error_t ReadCompressedInput(compressed_input_t *input, offset_t offset, unsigned char *bytes, size_t count);
+
+/*  Unmaps the characters of the input
+INPUT:
+    compressed_input_t *input - pointer on input structure
+*/
+void ClearCompressedInput(compressed_input_t *input);
+
+/*  Starts the decoding at the beginning of a gzip member or at a block boundary
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+    HANDLE mapping - file mapping object of the compressed file
+    offset_t size - the number of characters in the compressed file
+    offset_t bitOffset - offset of the member or the block in bits
+    const unsigned char *window - the 32 KB of the output before the block, NULL at a member
+    offset_t out - the number of output characters before the start
+RETURN:
+    error_t - error code
+*/
+error_t InitInflate(inflate_t *inflate, HANDLE mapping, offset_t size, offset_t bitOffset,
+                    const unsigned char *window, offset_t out);
+
+/*  Decodes the characters until the buffer is full, the stream ends or a block
+    boundary is reached, so the caller may remember the boundaries as seek points
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+    char *buffer - buffer receiving the characters
+    size_t size - the size of the buffer
+    size_t *produced - the number of decoded characters
+RETURN:
+    error_t - error code
+*/
+error_t Inflate(inflate_t *inflate, char *buffer, size_t size, size_t *produced);
+
+/*  Returns the offset of the next unused bit of the input
+INPUT:
+    const inflate_t *inflate - pointer on decoder structure
+RETURN:
+    offset_t - offset in bits
+*/
+offset_t GetInflateBitOffset(const inflate_t *inflate);
+
+/*  Copies the last 32 KB of the output in their order
+INPUT:
+    const inflate_t *inflate - pointer on decoder structure
+    unsigned char *window - buffer of INFLATE_WINDOW characters
+*/
+void GetInflateWindow(const inflate_t *inflate, unsigned char *window);
+
+/*  Clears the decoder
+INPUT:
+    inflate_t *inflate - pointer on decoder structure
+*/
+void ClearInflate(inflate_t *inflate);
+
+#endif // __INFLATE_H_INCLUDED
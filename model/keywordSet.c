@@ -0,0 +1,293 @@
+#include "keywordSet.h"
+#include <string.h>
+
+/*  Initializes the keyword set
+INPUT:
+    keyword_set_t *set - pointer on keyword set structure
+OUTPUT:
+    keyword_set_t *set - pointer on empty keyword set structure
+*/
+void InitKeywordSet(keyword_set_t *set)
+{
+    set->Next = NULL;
+    set->Lengths = NULL;
+    set->NumOfStates = 0;
+    memset(set->Classes, 0, sizeof(set->Classes));
+    set->NumOfClasses = 0;
+    set->NumOfKeywords = 0;
+}
+
+/*  Checks whether the character separates the keywords
+INPUT:
+    char c - the character
+RETURN:
+    int - nonzero for a space, a tab or a line break
+*/
+static int IsSeparator(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/*  Finds the next keyword of the text
+INPUT:
+    const char *text - the keywords
+    size_t length - the number of characters of the text
+    size_t *pos - position the search starts at, receives the position after the keyword
+    size_t *keywordLength - the number of characters of the keyword
+RETURN:
+    const char * - the keyword or NULL at the end of the text
+*/
+static const char *NextKeyword(const char *text, size_t length, size_t *pos, size_t *keywordLength)
+{
+    size_t start = *pos;
+    size_t end;
+
+    while (start < length && IsSeparator(text[start]))
+        start++;
+    if (start == length)
+        return NULL;
+
+    for (end = start; end < length && !IsSeparator(text[end]); end++)
+        ;
+    *pos = end;
+    *keywordLength = end - start;
+    return text + start;
+}
+
+/*  Gives the bytes of the keywords their classes, the letters of both cases share
+    the class when the case is ignored
+INPUT:
+    keyword_set_t *set - pointer on keyword set structure
+    const char *text - the keywords
+    size_t length - the number of characters of the text
+    int ignoreCase - nonzero if the case of the ASCII letters is ignored
+*/
+static void SplitClasses(keyword_set_t *set, const char *text, size_t length, int ignoreCase)
+{
+    unsigned char isUsed[256];
+    size_t i;
+    int c;
+
+    memset(isUsed, 0, sizeof(isUsed));
+    for (i = 0; i < length; i++)
+        if (!IsSeparator(text[i]))
+            isUsed[(unsigned char)text[i]] = 1;
+
+    set->NumOfClasses = 1;
+    for (c = 0; c < 256; c++)
+    {
+        if (ignoreCase && c >= 'A' && c <= 'Z')
+            continue;
+        if (isUsed[c] || (ignoreCase && c >= 'a' && c <= 'z' && isUsed[c - 'a' + 'A']))
+            set->Classes[c] = (unsigned char)set->NumOfClasses++;
+        else
+            set->Classes[c] = 0;
+    }
+    if (ignoreCase)
+        for (c = 'A'; c <= 'Z'; c++)
+            set->Classes[c] = set->Classes[c - 'A' + 'a'];
+}
+
+/*  Builds the failure transitions breadth first, so the state of the longest proper
+    suffix of every state is complete when the state is reached. The missing
+    transitions of the state become the ones of that suffix state
+INPUT:
+    keyword_set_t *set - pointer on keyword set structure with the trie of the keywords
+RETURN:
+    error_t - error code
+*/
+static error_t CompleteTransitions(keyword_set_t *set)
+{
+    int classes = set->NumOfClasses;
+    int *queue = malloc((size_t)set->NumOfStates * sizeof(int));
+    int *fail = malloc((size_t)set->NumOfStates * sizeof(int));
+    int head = 0;
+    int tail = 0;
+    int c;
+
+    if (queue == NULL || fail == NULL)
+    {
+        free(queue);
+        free(fail);
+        return MEMORY_SHORTAGE;
+    }
+
+    for (c = 0; c < classes; c++)
+    {
+        int child = set->Next[c];
+
+        if (child < 0)
+            set->Next[c] = 0;
+        else
+        {
+            fail[child] = 0;
+            queue[tail++] = child;
+        }
+    }
+
+    while (head < tail)
+    {
+        int state = queue[head++];
+        int *next = set->Next + (size_t)state * classes;
+        const int *suffix = set->Next + (size_t)fail[state] * classes;
+
+        /* The shorter keyword ending here is covered by the longer one */
+        if (set->Lengths[state] == 0)
+            set->Lengths[state] = set->Lengths[fail[state]];
+
+        for (c = 0; c < classes; c++)
+        {
+            if (next[c] < 0)
+                next[c] = suffix[c];
+            else
+            {
+                fail[next[c]] = suffix[c];
+                queue[tail++] = next[c];
+            }
+        }
+    }
+
+    free(queue);
+    free(fail);
+    return SUCCESS;
+}
+
+/*  Compiles the keywords separated by spaces, tabs or line breaks. The empty text
+    gives the empty set
+INPUT:
+    keyword_set_t *set - pointer on initialized keyword set structure
+    const char *text - the keywords in UTF-8
+    size_t length - the number of characters of the text
+    int ignoreCase - nonzero if the case of the ASCII letters is ignored
+OUTPUT:
+    keyword_set_t *set - pointer on compiled keyword set structure
+RETURN:
+    error_t - error code, BAD_PATTERN if there are too many keywords or a keyword is too long
+*/
+error_t CompileKeywordSet(keyword_set_t *set, const char *text, size_t length, int ignoreCase)
+{
+    const char *keyword;
+    size_t keywordLength;
+    size_t pos = 0;
+    size_t total = 0;
+    size_t i;
+    int numOfKeywords = 0;
+    error_t err;
+
+    ClearKeywordSet(set);
+
+    /* The trie has not more states than the characters of the keywords */
+    while ((keyword = NextKeyword(text, length, &pos, &keywordLength)) != NULL)
+    {
+        if (keywordLength > MAX_KEYWORD_LENGTH || ++numOfKeywords > MAX_KEYWORDS)
+            return BAD_PATTERN;
+        total += keywordLength;
+    }
+    if (numOfKeywords == 0)
+        return SUCCESS;
+    if (total + 1 > MAX_KEYWORD_STATES)
+        return BAD_PATTERN;
+
+    SplitClasses(set, text, length, ignoreCase);
+    set->Next = malloc((total + 1) * set->NumOfClasses * sizeof(int));
+    set->Lengths = calloc(total + 1, sizeof(int));
+    if (set->Next == NULL || set->Lengths == NULL)
+    {
+        ClearKeywordSet(set);
+        return MEMORY_SHORTAGE;
+    }
+    for (i = 0; i < (total + 1) * set->NumOfClasses; i++)
+        set->Next[i] = -1;
+
+    set->NumOfStates = 1;
+    pos = 0;
+    while ((keyword = NextKeyword(text, length, &pos, &keywordLength)) != NULL)
+    {
+        int state = 0;
+
+        for (i = 0; i < keywordLength; i++)
+        {
+            int *next = set->Next + (size_t)state * set->NumOfClasses + set->Classes[(unsigned char)keyword[i]];
+
+            if (*next < 0)
+                *next = set->NumOfStates++;
+            state = *next;
+        }
+        set->Lengths[state] = (int)keywordLength;
+    }
+    set->NumOfKeywords = numOfKeywords;
+
+    err = CompleteTransitions(set);
+    if (err != SUCCESS)
+        ClearKeywordSet(set);
+
+    return err;
+}
+
+/*  Finds the characters covered by the keyword occurrences, the overlapping and
+    adjacent occurrences are joined in one span. The spans are separated by at least
+    one character, so (size + 1) / 2 elements are always enough
+INPUT:
+    const keyword_set_t *set - pointer on compiled keyword set structure
+    const char *text - pointer on the text
+    size_t size - the number of characters in the text
+    keyword_span_t *spans - array for the spans in the order of their positions
+    size_t maxSpans - the number of elements of the array, the search stops when it is full
+RETURN:
+    size_t - the number of found spans
+*/
+size_t FindKeywords(const keyword_set_t *set, const char *text, size_t size, keyword_span_t *spans, size_t maxSpans)
+{
+    const unsigned char *chars = (const unsigned char *)text;
+    size_t count = 0;
+    size_t i;
+    int state = 0;
+
+    if (set->NumOfStates == 0 || maxSpans == 0)
+        return 0;
+
+    /* The longest keyword ending at a character covers all the others ending there */
+    for (i = 0; i < size; i++)
+    {
+        size_t start;
+        int length;
+
+        state = set->Next[(size_t)state * set->NumOfClasses + set->Classes[chars[i]]];
+        length = set->Lengths[state];
+        if (length == 0)
+            continue;
+
+        /* The occurrence may reach back over several spans found before */
+        start = i + 1 - length;
+        while (count > 0 && spans[count - 1].Start + spans[count - 1].Length >= start)
+        {
+            count--;
+            if (spans[count].Start < start)
+                start = spans[count].Start;
+        }
+        if (count == maxSpans)
+            break;
+
+        spans[count].Start = start;
+        spans[count].Length = i + 1 - start;
+        count++;
+    }
+
+    return count;
+}
+
+/*  Releases the keyword set
+INPUT:
+    keyword_set_t *set - pointer on keyword set structure
+OUTPUT:
+    keyword_set_t *set - pointer on empty keyword set structure
+*/
+void ClearKeywordSet(keyword_set_t *set)
+{
+    if (set == NULL)
+        return;
+
+    free(set->Next);
+    free(set->Lengths);
+    InitKeywordSet(set);
+}
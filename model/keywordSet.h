@@ -0,0 +1,77 @@
+#ifndef __KEYWORD_SET_H_INCLUDED
+#define __KEYWORD_SET_H_INCLUDED
+
+#include <stdlib.h>
+#include "../error/error.h"
+#include "modelTypes.h"
+
+#define MAX_KEYWORDS 4096           /* The maximum number of keywords in the set */
+#define MAX_KEYWORD_LENGTH 256      /* The maximum number of characters of one keyword */
+#define MAX_KEYWORD_STATES 65536    /* The maximum number of states of the automaton */
+
+/* Characters of the text covered by the keyword occurrences */
+typedef struct
+{
+    size_t Start;       /* Position of the first character */
+    size_t Length;      /* The number of characters */
+} keyword_span_t;
+
+/*  Set of keywords compiled to one Aho-Corasick automaton. The transitions of
+    every state are complete, so each character of the text takes one lookup
+    whatever the number of keywords. The case of the ASCII letters may be ignored,
+    the other characters, including the UTF-8 sequences, are compared as they are */
+typedef struct
+{
+    int *Next;                      /* Transitions of the states by the byte classes */
+    int *Lengths;                   /* Length of the longest keyword ending in every state, 0 if none */
+    int NumOfStates;                /* The number of states, 0 if there are no keywords */
+    unsigned char Classes[256];     /* Class of every byte, the bytes absent from the keywords share class 0 */
+    int NumOfClasses;               /* The number of byte classes */
+    int NumOfKeywords;              /* The number of keywords */
+} keyword_set_t;
+
+/*  Initializes the keyword set
+INPUT:
+    keyword_set_t *set - pointer on keyword set structure
+OUTPUT:
+    keyword_set_t *set - pointer on empty keyword set structure
+*/
+void InitKeywordSet(keyword_set_t *set);
+
+/*  Compiles the keywords separated by spaces, tabs or line breaks. The empty text
+    gives the empty set
+INPUT:
+    keyword_set_t *set - pointer on initialized keyword set structure
+    const char *text - the keywords in UTF-8
+    size_t length - the number of characters of the text
+    int ignoreCase - nonzero if the case of the ASCII letters is ignored
+OUTPUT:
+    keyword_set_t *set - pointer on compiled keyword set structure
+RETURN:
+    error_t - error code, BAD_PATTERN if there are too many keywords or a keyword is too long
+*/
+error_t CompileKeywordSet(keyword_set_t *set, const char *text, size_t length, int ignoreCase);
+
+/*  Finds the characters covered by the keyword occurrences, the overlapping and
+    adjacent occurrences are joined in one span. The spans are separated by at least
+    one character, so (size + 1) / 2 elements are always enough
+INPUT:
+    const keyword_set_t *set - pointer on compiled keyword set structure
+    const char *text - pointer on the text
+    size_t size - the number of characters in the text
+    keyword_span_t *spans - array for the spans in the order of their positions
+    size_t maxSpans - the number of elements of the array, the search stops when it is full
+RETURN:
+    size_t - the number of found spans
+*/
+size_t FindKeywords(const keyword_set_t *set, const char *text, size_t size, keyword_span_t *spans, size_t maxSpans);
+
+/*  Releases the keyword set
+INPUT:
+    keyword_set_t *set - pointer on keyword set structure
+OUTPUT:
+    keyword_set_t *set - pointer on empty keyword set structure
+*/
+void ClearKeywordSet(keyword_set_t *set);
+
+#endif // __KEYWORD_SET_H_INCLUDED
@@ -0,0 +1,674 @@
+#include "lineFilter.h"
+#include "../thread/threadPool.h"
+#include <string.h>
+
+#define TASKS_PER_THREAD 4          /* Tasks per pool thread to even out the load */
+#define MIN_LINES 256               /* Initial number of kept lines of a task */
+
+/* Lines kept by one task */
+typedef struct
+{
+    index_t *Lines;             /* The kept lines in ascending order */
+    index_t NumOfLines;         /* The number of kept lines */
+    index_t Capacity;           /* The number of allocated lines */
+    error_t Error;              /* Result of the task */
+} filter_task_t;
+
+/* Parallel filtering, a task filters the lines starting in its chunk or checks its part of the kept lines */
+typedef struct
+{
+    line_filter_t *Filter;      /* Pointer on the filter */
+    const model_t *Model;       /* Pointer on the filtered model */
+    offset_t Start;             /* The first offset of the filtered lines */
+    offset_t End;               /* The lines starting before this offset are filtered */
+    offset_t ChunkSize;         /* The number of characters of one task */
+    index_t TaskLines;          /* The number of kept lines checked by one task */
+    filter_task_t *Tasks;       /* Results of the tasks */
+} parallel_filter_t;
+
+/* Predicate of the filter prepared for one task */
+typedef struct
+{
+    literal_t Literal;              /* The literal or the literal required by the expression */
+    const literal_t *Required;      /* Literal, NULL if the expression requires nothing known */
+    pattern_matcher_t *Matcher;     /* Matcher of the expression, NULL for the literal */
+    char *Buffer;                   /* Window of the file read by blocks, NULL for the mapped file */
+} filter_context_t;
+
+/*  Initializes the filter
+INPUT:
+    line_filter_t *filter - pointer on filter structure
+OUTPUT:
+    line_filter_t *filter - pointer on filter structure keeping no lines
+*/
+void InitLineFilter(line_filter_t *filter)
+{
+    InitPattern(&filter->Pattern);
+    filter->Text = NULL;
+    filter->Length = 0;
+    filter->IgnoreCase = 0;
+    filter->Lines = NULL;
+    filter->NumOfLines = 0;
+    filter->Capacity = 0;
+    filter->FilteredSize = 0;
+    filter->Model = NULL;
+    filter->LoadId = 0;
+}
+
+/*  Checks whether the filter has a literal or a regular expression
+INPUT:
+    const line_filter_t *filter - pointer on filter structure
+RETURN:
+    int - nonzero if the filter is set
+*/
+int HasLineFilter(const line_filter_t *filter)
+{
+    return filter->Text != NULL || filter->Pattern.NumOfOps > 0;
+}
+
+/*  Prepares the predicate of the filter for a task
+INPUT:
+    const line_filter_t *filter - pointer on filter structure
+    const model_t *model - pointer on model structure
+    filter_context_t *context - pointer on context structure
+RETURN:
+    error_t - error code
+*/
+static error_t OpenContext(const line_filter_t *filter, const model_t *model, filter_context_t *context)
+{
+    context->Required = NULL;
+    context->Matcher = NULL;
+    context->Buffer = NULL;
+
+    if (filter->Text != NULL)
+    {
+        InitLiteral(&context->Literal, filter->Text, filter->Length, filter->IgnoreCase);
+        context->Required = &context->Literal;
+    }
+    else
+    {
+        if (filter->Pattern.RequiredLength > 0)
+        {
+            InitLiteral(&context->Literal, filter->Pattern.Required, filter->Pattern.RequiredLength,
+                        filter->Pattern.IgnoreCase);
+            context->Required = &context->Literal;
+        }
+
+        context->Matcher = malloc(sizeof(pattern_matcher_t));
+        if (context->Matcher == NULL)
+            return MEMORY_SHORTAGE;
+        if (InitMatcher(context->Matcher, &filter->Pattern) != SUCCESS)
+        {
+            free(context->Matcher);
+            context->Matcher = NULL;
+            return MEMORY_SHORTAGE;
+        }
+    }
+
+    if (model->Data == NULL && (context->Buffer = malloc(FILTER_WINDOW)) == NULL)
+        return MEMORY_SHORTAGE;
+
+    return SUCCESS;
+}
+
+/*  Releases the predicate of the task
+INPUT:
+    filter_context_t *context - pointer on context structure
+*/
+static void CloseContext(filter_context_t *context)
+{
+    if (context->Matcher != NULL)
+    {
+        ClearMatcher(context->Matcher);
+        free(context->Matcher);
+    }
+    free(context->Buffer);
+}
+
+/*  Appends the line to the lines kept by the task
+INPUT:
+    filter_task_t *task - pointer on task structure
+    index_t line - index of the model line
+*/
+static void AddLine(filter_task_t *task, index_t line)
+{
+    if (task->NumOfLines == task->Capacity)
+    {
+        index_t capacity = task->Capacity > 0 ? 2 * task->Capacity : MIN_LINES;
+        index_t *tmp = FITS_IN_MEMORY(capacity, sizeof(index_t))
+                     ? realloc(task->Lines, (size_t)capacity * sizeof(index_t)) : NULL;
+
+        if (tmp == NULL)
+        {
+            task->Error = MEMORY_SHORTAGE;
+            return;
+        }
+        task->Lines = tmp;
+        task->Capacity = capacity;
+    }
+
+    task->Lines[task->NumOfLines++] = line;
+}
+
+/*  Gets the length of the line without the line break
+INPUT:
+    const char *line - the characters of the line
+    size_t length - the number of characters up to the line break or the end of the text
+RETURN:
+    size_t - the number of characters without the carriage return
+*/
+static size_t CutLineBreak(const char *line, size_t length)
+{
+    return length > 0 && line[length - 1] == '\r' ? length - 1 : length;
+}
+
+/*  Filters the whole lines of the text. With a literal only the lines containing
+    it are examined, the literal itself keeps them, the expression is matched
+    with them. Without a literal every line is matched
+INPUT:
+    const parallel_filter_t *job - pointer on parallel filter structure
+    filter_task_t *task - pointer on task structure
+    filter_context_t *context - pointer on context structure of the task
+    const char *text - the lines, the last one may have no line break
+    size_t size - the number of characters of the lines
+    offset_t offset - offset of the text in the model
+    index_t line - the first line of the text
+*/
+static void FilterText(const parallel_filter_t *job, filter_task_t *task, filter_context_t *context,
+                       const char *text, size_t size, offset_t offset, index_t line)
+{
+    const model_t *model = job->Model;
+    size_t pos = 0;
+
+    while (pos < size && task->Error == SUCCESS)
+    {
+        const char *lineBreak;
+        size_t start = pos;
+        size_t end;
+
+        if (context->Required != NULL)
+        {
+            size_t found = FindLiteral(context->Required, text + pos, size - pos);
+
+            if (found == size - pos)
+                break;
+
+            /* The text starts with a line, so the line of the occurrence starts in it */
+            line = FindModelLine(model, offset + pos + found);
+            start = (size_t)(GetModelLineOffset(model, line) - offset);
+        }
+
+        lineBreak = memchr(text + start, '\n', size - start);
+        end = lineBreak != NULL ? (size_t)(lineBreak - text) : size;
+        if (context->Matcher == NULL ||
+            IsLineMatched(context->Matcher, text + start, CutLineBreak(text + start, end - start)))
+            AddLine(task, line);
+
+        pos = end + 1;
+        line++;
+    }
+}
+
+/*  Filters the lines starting in the chunk of the task. The file read by blocks
+    is read in windows, the long line is filtered by its first window only
+INPUT:
+    void *arg - pointer on parallel filter structure
+    unsigned long index - index of the task
+*/
+static void FilterChunk(void *arg, unsigned long index)
+{
+    parallel_filter_t *job = arg;
+    const model_t *model = job->Model;
+    filter_task_t *task = &job->Tasks[index];
+    offset_t first = job->Start + index * job->ChunkSize;
+    offset_t last = job->End - first > job->ChunkSize ? first + job->ChunkSize : job->End;
+    filter_context_t context;
+    index_t line;
+    index_t endLine;
+    offset_t pos;
+    offset_t stop;
+
+    task->Lines = NULL;
+    task->NumOfLines = 0;
+    task->Capacity = 0;
+    task->Error = SUCCESS;
+
+    /* The chunk takes the lines starting in it */
+    line = FindModelLine(model, first);
+    if (GetModelLineOffset(model, line) < first)
+        line++;
+    endLine = FindModelLine(model, last);
+    if (GetModelLineOffset(model, endLine) < last)
+        endLine++;
+    if (line >= endLine)
+        return;
+    pos = GetModelLineOffset(model, line);
+    stop = GetModelLineOffset(model, endLine);
+
+    task->Error = OpenContext(job->Filter, model, &context);
+    if (task->Error != SUCCESS)
+    {
+        CloseContext(&context);
+        return;
+    }
+
+    if (model->Data != NULL)
+    {
+        offset_t size = stop - pos;
+        const char *text = GetModelText(model, pos, NULL, &size);
+
+        FilterText(job, task, &context, text, (size_t)size, pos, line);
+    }
+
+    while (context.Buffer != NULL && pos < stop && task->Error == SUCCESS)
+    {
+        offset_t size = stop - pos < FILTER_WINDOW ? stop - pos : FILTER_WINDOW;
+        const char *text = GetModelText(model, pos, context.Buffer, &size);
+        size_t part = (size_t)size;
+
+        if (size == 0)
+            break;
+
+        /* The window ends at the last line break, the line longer than the window is cut */
+        if (pos + size < stop)
+        {
+            while (part > 0 && text[part - 1] != '\n')
+                part--;
+            if (part == 0)
+            {
+                FilterText(job, task, &context, text, (size_t)size, pos, line);
+                line++;
+                pos = GetModelLineOffset(model, line);
+                continue;
+            }
+        }
+
+        FilterText(job, task, &context, text, part, pos, line);
+        pos += part;
+        if (pos < stop)
+            line = FindModelLine(model, pos);
+    }
+
+    CloseContext(&context);
+}
+
+/*  Checks again the part of the kept lines of the task, the lines still kept are
+    moved to the start of the part. The line of the file read by blocks is
+    checked by its first window only
+INPUT:
+    void *arg - pointer on parallel filter structure
+    unsigned long index - index of the task
+*/
+static void RefineChunk(void *arg, unsigned long index)
+{
+    parallel_filter_t *job = arg;
+    const model_t *model = job->Model;
+    filter_task_t *task = &job->Tasks[index];
+    index_t first = index * job->TaskLines;
+    index_t *lines = job->Filter->Lines + first;
+    index_t count = 0;
+    filter_context_t context;
+    index_t i;
+
+    task->Lines = lines;
+    task->NumOfLines = 0;
+    task->Capacity = 0;
+    task->Error = OpenContext(job->Filter, model, &context);
+    if (task->Error != SUCCESS)
+    {
+        CloseContext(&context);
+        return;
+    }
+
+    if (first < job->Filter->NumOfLines)
+        count = job->Filter->NumOfLines - first < job->TaskLines ? job->Filter->NumOfLines - first : job->TaskLines;
+    for (i = 0; i < count; i++)
+    {
+        offset_t size = GetModelLineLength(model, lines[i]);
+        const char *text;
+
+        if (context.Buffer != NULL && size > FILTER_WINDOW)
+            size = FILTER_WINDOW;
+        text = GetModelText(model, GetModelLineOffset(model, lines[i]), context.Buffer, &size);
+
+        if (context.Required != NULL && FindLiteral(context.Required, text, (size_t)size) == size)
+            continue;
+        if (context.Matcher == NULL || IsLineMatched(context.Matcher, text, (size_t)size))
+            lines[task->NumOfLines++] = lines[i];
+    }
+
+    CloseContext(&context);
+}
+
+/*  Splits the work between the pool threads, a single task runs in the calling thread
+INPUT:
+    pool_task_t function - the task
+    parallel_filter_t *job - pointer on parallel filter structure
+    index_t numOfTasks - the number of tasks, at least one
+*/
+static void RunFilterTasks(pool_task_t function, parallel_filter_t *job, index_t numOfTasks)
+{
+    if (numOfTasks > 1)
+        RunParallel(function, job, (unsigned long)numOfTasks);
+    else
+        function(job, 0);
+}
+
+/*  Filters the lines starting after FilteredSize and appends the kept ones in the order of the tasks
+INPUT:
+    line_filter_t *filter - pointer on filter structure
+    const model_t *model - pointer on model structure
+    offset_t end - the end of the lines of the model
+RETURN:
+    error_t - error code
+*/
+static error_t FilterLines(line_filter_t *filter, const model_t *model, offset_t end)
+{
+    parallel_filter_t job;
+    index_t maxTasks = GetThreadPoolLimit() * TASKS_PER_THREAD;
+    index_t numOfTasks = (end - filter->FilteredSize + FILTER_CHUNK - 1) / FILTER_CHUNK;
+    index_t count = 0;
+    error_t err = SUCCESS;
+    index_t i;
+
+    if (numOfTasks > maxTasks)
+        numOfTasks = maxTasks;
+    job.Filter = filter;
+    job.Model = model;
+    job.Start = filter->FilteredSize;
+    job.End = end;
+    job.ChunkSize = (end - job.Start + numOfTasks - 1) / numOfTasks;
+    job.TaskLines = 0;
+    job.Tasks = malloc((size_t)numOfTasks * sizeof(filter_task_t));
+    if (job.Tasks == NULL)
+        return MEMORY_SHORTAGE;
+
+    RunFilterTasks(FilterChunk, &job, numOfTasks);
+
+    for (i = 0; i < numOfTasks; i++)
+    {
+        if (job.Tasks[i].Error != SUCCESS && err == SUCCESS)
+            err = job.Tasks[i].Error;
+        count += job.Tasks[i].NumOfLines;
+    }
+
+    if (err == SUCCESS && filter->NumOfLines + count > filter->Capacity)
+    {
+        index_t capacity = filter->Capacity > 0 ? filter->Capacity : MIN_LINES;
+        index_t *tmp;
+
+        while (capacity < filter->NumOfLines + count)
+            capacity *= 2;
+        tmp = FITS_IN_MEMORY(capacity, sizeof(index_t))
+            ? realloc(filter->Lines, (size_t)capacity * sizeof(index_t)) : NULL;
+        if (tmp != NULL)
+        {
+            filter->Lines = tmp;
+            filter->Capacity = capacity;
+        }
+        else
+            err = MEMORY_SHORTAGE;
+    }
+
+    for (i = 0; i < numOfTasks; i++)
+    {
+        if (err == SUCCESS)
+        {
+            memcpy(filter->Lines + filter->NumOfLines, job.Tasks[i].Lines,
+                   (size_t)job.Tasks[i].NumOfLines * sizeof(index_t));
+            filter->NumOfLines += job.Tasks[i].NumOfLines;
+        }
+        free(job.Tasks[i].Lines);
+    }
+    free(job.Tasks);
+
+    if (err == SUCCESS)
+        filter->FilteredSize = end;
+
+    return err;
+}
+
+/*  Checks the kept lines again with the refined filter, the parts of the tasks
+    are joined in place
+INPUT:
+    line_filter_t *filter - pointer on filter structure
+    const model_t *model - pointer on model structure
+RETURN:
+    error_t - error code
+*/
+static error_t RefineLines(line_filter_t *filter, const model_t *model)
+{
+    parallel_filter_t job;
+    index_t maxTasks = GetThreadPoolLimit() * TASKS_PER_THREAD;
+    index_t numOfTasks = (filter->NumOfLines + FILTER_TASK_LINES - 1) / FILTER_TASK_LINES;
+    index_t count = 0;
+    error_t err = SUCCESS;
+    index_t i;
+
+    if (filter->NumOfLines == 0)
+        return SUCCESS;
+    if (numOfTasks > maxTasks)
+        numOfTasks = maxTasks;
+    job.Filter = filter;
+    job.Model = model;
+    job.Start = 0;
+    job.End = 0;
+    job.ChunkSize = 0;
+    job.TaskLines = (filter->NumOfLines + numOfTasks - 1) / numOfTasks;
+    job.Tasks = malloc((size_t)numOfTasks * sizeof(filter_task_t));
+    if (job.Tasks == NULL)
+        return MEMORY_SHORTAGE;
+
+    RunFilterTasks(RefineChunk, &job, numOfTasks);
+
+    /* The parts of the tasks follow each other, so the move goes forward only */
+    for (i = 0; i < numOfTasks && err == SUCCESS; i++)
+    {
+        err = job.Tasks[i].Error;
+        memmove(filter->Lines + count, job.Tasks[i].Lines, (size_t)job.Tasks[i].NumOfLines * sizeof(index_t));
+        count += job.Tasks[i].NumOfLines;
+    }
+    free(job.Tasks);
+
+    /* The lines of the failed task are lost, so everything is filtered again next time */
+    filter->NumOfLines = err == SUCCESS ? count : 0;
+    if (err != SUCCESS)
+        filter->FilteredSize = 0;
+
+    return err;
+}
+
+/*  Drops the kept lines the model took back, they are filtered again
+INPUT:
+    line_filter_t *filter - pointer on filter structure
+    const model_t *model - pointer on model structure
+    offset_t end - the end of the lines of the model
+*/
+static void TrimLines(line_filter_t *filter, const model_t *model, offset_t end)
+{
+    filter->NumOfLines = FindFilterRow(filter, model->NumOfLines);
+    filter->FilteredSize = end;
+}
+
+/*  Checks whether every occurrence of the text contains the literal of the filter
+INPUT:
+    const line_filter_t *filter - pointer on filter structure
+    const char *text - the new literal or the literal required by the new expression
+    size_t length - the number of characters of the text
+    int ignoreCase - nonzero if the case of the ASCII letters of the text is ignored
+RETURN:
+    int - nonzero if the text contains the literal
+*/
+static int ContainsFilterText(const line_filter_t *filter, const char *text, size_t length, int ignoreCase)
+{
+    size_t i, j;
+
+    /* The letter found in either case may miss the letter of the given case */
+    if (filter->Text == NULL || (ignoreCase && !filter->IgnoreCase))
+        return 0;
+
+    for (i = 0; i + filter->Length <= length; i++)
+    {
+        for (j = 0; j < filter->Length; j++)
+        {
+            char c = text[i + j];
+            char old = filter->Text[j];
+
+            if (filter->IgnoreCase && c >= 'A' && c <= 'Z')
+                c |= 0x20;
+            if (filter->IgnoreCase && old >= 'A' && old <= 'Z')
+                old |= 0x20;
+            if (c != old)
+                break;
+        }
+        if (j == filter->Length)
+            return 1;
+    }
+
+    return 0;
+}
+
+/*  Sets the literal or the regular expression and filters the lines of the model.
+    When every line containing the new literal or a match of the new expression
+    contains the previous literal as well, only the lines kept so far are checked
+INPUT:
+    line_filter_t *filter - pointer on filter structure
+    const model_t *model - pointer on model structure, the loader must not change its lines
+    const char *text - the literal without line breaks or the regular expression in UTF-8
+    size_t length - the number of characters of the text, at least one
+    int isRegex - nonzero if the text is a regular expression
+    int ignoreCase - nonzero if the case of the ASCII letters is ignored
+RETURN:
+    error_t - error code, BAD_PATTERN leaves the previous filter as it is
+*/
+error_t SetLineFilter(line_filter_t *filter, const model_t *model, const char *text, size_t length, int isRegex,
+                      int ignoreCase)
+{
+    pattern_t pattern;
+    char *literal = NULL;
+    int isRefined;
+    offset_t end;
+    error_t err;
+
+    if (length == 0)
+        return BAD_PATTERN;
+
+    InitPattern(&pattern);
+    if (isRegex)
+    {
+        err = CompilePattern(&pattern, text, length, ignoreCase);
+        if (err != SUCCESS)
+            return err;
+        isRefined = ContainsFilterText(filter, pattern.Required, pattern.RequiredLength, ignoreCase);
+    }
+    else
+    {
+        literal = malloc(length);
+        if (literal == NULL)
+            return MEMORY_SHORTAGE;
+        memcpy(literal, text, length);
+        isRefined = ContainsFilterText(filter, literal, length, ignoreCase);
+    }
+    isRefined = isRefined && filter->Model == model && filter->LoadId == model->LoadId;
+
+    ClearPattern(&filter->Pattern);
+    free(filter->Text);
+    filter->Pattern = pattern;
+    filter->Text = literal;
+    filter->Length = literal != NULL ? length : 0;
+    filter->IgnoreCase = ignoreCase;
+
+    if (!isRefined)
+    {
+        filter->NumOfLines = 0;
+        filter->FilteredSize = 0;
+        filter->Model = model;
+        filter->LoadId = model->LoadId;
+        return UpdateLineFilter(filter, model);
+    }
+
+    /* The kept lines are checked again, the lines appended since are filtered as usual */
+    end = model->NumOfLines > 0 ? GetModelLineOffset(model, model->NumOfLines) : 0;
+    if (filter->FilteredSize > end)
+        TrimLines(filter, model, end);
+    err = RefineLines(filter, model);
+    if (err != SUCCESS)
+        return err;
+
+    return UpdateLineFilter(filter, model);
+}
+
+/*  Filters the lines loaded or appended since the last call. The line taken back
+    by the model to be extended is filtered again
+INPUT:
+    line_filter_t *filter - pointer on filter structure
+    const model_t *model - pointer on model structure, the loader must not change its lines
+RETURN:
+    error_t - error code
+*/
+error_t UpdateLineFilter(line_filter_t *filter, const model_t *model)
+{
+    offset_t end;
+
+    if (!HasLineFilter(filter))
+        return SUCCESS;
+
+    /* The lines of another file are filtered from the start */
+    if (filter->Model != model || filter->LoadId != model->LoadId)
+    {
+        filter->NumOfLines = 0;
+        filter->FilteredSize = 0;
+        filter->Model = model;
+        filter->LoadId = model->LoadId;
+    }
+
+    end = model->NumOfLines > 0 ? GetModelLineOffset(model, model->NumOfLines) : 0;
+    if (filter->FilteredSize > end)
+        TrimLines(filter, model, end);
+    if (filter->FilteredSize >= end)
+        return SUCCESS;
+
+    return FilterLines(filter, model, end);
+}
+
+/*  Finds the first kept line not before the line
+INPUT:
+    const line_filter_t *filter - pointer on filter structure
+    index_t line - index of the model line
+RETURN:
+    index_t - index of the kept line, NumOfLines if every kept line is before the line
+*/
+index_t FindFilterRow(const line_filter_t *filter, index_t line)
+{
+    index_t low = 0;
+    index_t high = filter->NumOfLines;
+
+    while (low < high)
+    {
+        index_t middle = low + (high - low) / 2;
+
+        if (filter->Lines[middle] < line)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+/*  Releases the filter
+INPUT:
+    line_filter_t *filter - pointer on filter structure
+OUTPUT:
+    line_filter_t *filter - pointer on filter structure keeping no lines
+*/
+void ClearLineFilter(line_filter_t *filter)
+{
+    if (filter == NULL)
+        return;
+
+    ClearPattern(&filter->Pattern);
+    free(filter->Text);
+    free(filter->Lines);
+    InitLineFilter(filter);
+}
@@ -0,0 +1,88 @@
+#ifndef __LINE_FILTER_H_INCLUDED
+#define __LINE_FILTER_H_INCLUDED
+
+#include "fileModel.h"
+#include "regexPattern.h"
+
+#define FILTER_CHUNK (1ul << 20)        /* Minimum number of characters of the lines filtered by one task */
+#define FILTER_WINDOW (4ul << 20)       /* The number of characters read at once from the file read by blocks */
+#define FILTER_TASK_LINES 4096          /* Minimum number of kept lines checked again by one task */
+
+/*  Lines of the model containing a literal or a match of a regular expression.
+    The numbers of the kept lines are stored in ascending order, so the row of
+    the filtered view is an index in them. The lines are filtered in parallel
+    and a refined literal checks only the lines kept by the previous one */
+typedef struct
+{
+    pattern_t Pattern;          /* The regular expression, no instructions for the literal */
+    char *Text;                 /* The literal or NULL for the regular expression */
+    size_t Length;              /* The number of characters of the literal */
+    int IgnoreCase;             /* Nonzero if the case of the ASCII letters is ignored */
+    index_t *Lines;             /* The kept lines in ascending order */
+    index_t NumOfLines;         /* The number of kept lines */
+    index_t Capacity;           /* The number of allocated elements of Lines */
+    offset_t FilteredSize;      /* The lines starting before this offset are filtered */
+    const model_t *Model;       /* The filtered model */
+    unsigned long LoadId;       /* LoadId of the model the lines belong to */
+} line_filter_t;
+
+/*  Initializes the filter
+INPUT:
+    line_filter_t *filter - pointer on filter structure
+OUTPUT:
+    line_filter_t *filter - pointer on filter structure keeping no lines
+*/
+void InitLineFilter(line_filter_t *filter);
+
+/*  Checks whether the filter has a literal or a regular expression
+INPUT:
+    const line_filter_t *filter - pointer on filter structure
+RETURN:
+    int - nonzero if the filter is set
+*/
+int HasLineFilter(const line_filter_t *filter);
+
+/*  Sets the literal or the regular expression and filters the lines of the model.
+    When every line containing the new literal or a match of the new expression
+    contains the previous literal as well, only the lines kept so far are checked
+INPUT:
+    line_filter_t *filter - pointer on filter structure
+    const model_t *model - pointer on model structure, the loader must not change its lines
+    const char *text - the literal without line breaks or the regular expression in UTF-8
+    size_t length - the number of characters of the text, at least one
+    int isRegex - nonzero if the text is a regular expression
+    int ignoreCase - nonzero if the case of the ASCII letters is ignored
+RETURN:
+    error_t - error code, BAD_PATTERN leaves the previous filter as it is
+*/
+error_t SetLineFilter(line_filter_t *filter, const model_t *model, const char *text, size_t length, int isRegex,
+                      int ignoreCase);
+
+/*  Filters the lines loaded or appended since the last call. The line taken back
+    by the model to be extended is filtered again
+INPUT:
+    line_filter_t *filter - pointer on filter structure
+    const model_t *model - pointer on model structure, the loader must not change its lines
+RETURN:
+    error_t - error code
+*/
+error_t UpdateLineFilter(line_filter_t *filter, const model_t *model);
+
+/*  Finds the first kept line not before the line
+INPUT:
+    const line_filter_t *filter - pointer on filter structure
+    index_t line - index of the model line
+RETURN:
+    index_t - index of the kept line, NumOfLines if every kept line is before the line
+*/
+index_t FindFilterRow(const line_filter_t *filter, index_t line);
+
+/*  Releases the filter
+INPUT:
+    line_filter_t *filter - pointer on filter structure
+OUTPUT:
+    line_filter_t *filter - pointer on filter structure keeping no lines
+*/
+void ClearLineFilter(line_filter_t *filter);
+
+#endif // __LINE_FILTER_H_INCLUDED
@@ -0,0 +1,297 @@
+#include "lineIndex.h"
+#include <string.h>
+
+#define MAX_DELTA 0xFFFF                    /* Maximum offset stored in 16 bits */
+#define MIN_CAPACITY (16 * LINE_INDEX_BLOCK) /* Initial number of lines in the index */
+
+/*  Initializes the line index
+INPUT:
+    line_index_t *index - pointer on line index structure
+OUTPUT:
+    line_index_t *index - pointer on empty line index structure
+*/
+void InitLineIndex(line_index_t *index)
+{
+    index->Checkpoints = NULL;
+    index->WideBlocks = NULL;
+    index->Deltas = NULL;
+    index->Wide = NULL;
+    index->Count = 0;
+    index->Capacity = 0;
+    index->NumOfWide = 0;
+    index->WideCapacity = 0;
+    index->Image = NULL;
+}
+
+/*  Makes the index use the arrays of the mapped index file. The arrays are
+    copied to the memory before the first change of the index
+INPUT:
+    line_index_t *index - pointer on empty line index structure
+    const void *image - mapped view of the index file, it is unmapped by the index
+    const offset_t *checkpoints - offsets of the first lines of the blocks
+    const unsigned long *wideBlocks - numbers of the blocks in wide or NARROW_BLOCK
+    const unsigned short *deltas - offsets of the lines from their checkpoints
+    const offset_t *wide - offsets from the checkpoints for the widened blocks
+    index_t count - the number of line starts
+    unsigned long numOfWide - the number of widened blocks
+*/
+void AttachLineIndex(line_index_t *index, const void *image, const offset_t *checkpoints,
+                     const unsigned long *wideBlocks, const unsigned short *deltas,
+                     const offset_t *wide, index_t count, unsigned long numOfWide)
+{
+    /* The arrays are not changed while the image is attached */
+    index->Checkpoints = (offset_t *)checkpoints;
+    index->WideBlocks = (unsigned long *)wideBlocks;
+    index->Deltas = (unsigned short *)deltas;
+    index->Wide = (offset_t *)wide;
+    index->Count = count;
+    index->Capacity = count;
+    index->NumOfWide = numOfWide;
+    index->WideCapacity = numOfWide;
+    index->Image = image;
+}
+
+/*  Copies the arrays of the attached index file to the memory and unmaps the file
+INPUT:
+    line_index_t *index - pointer on line index structure with the attached image
+RETURN:
+    error_t - error code
+*/
+static error_t DetachLineIndex(line_index_t *index)
+{
+    index_t capacity = (index->Count + LINE_INDEX_BLOCK - 1) / LINE_INDEX_BLOCK * LINE_INDEX_BLOCK;
+    size_t numOfBlocks;
+    line_index_t copy;
+
+    if (capacity < MIN_CAPACITY)
+        capacity = MIN_CAPACITY;
+    if (!FITS_IN_MEMORY(capacity, sizeof(offset_t)))
+        return MEMORY_SHORTAGE;
+    numOfBlocks = (size_t)capacity / LINE_INDEX_BLOCK;
+
+    copy = *index;
+    copy.Checkpoints = malloc(numOfBlocks * sizeof(offset_t));
+    copy.WideBlocks = malloc(numOfBlocks * sizeof(unsigned long));
+    copy.Deltas = malloc((size_t)capacity * sizeof(unsigned short));
+    copy.Wide = malloc(((size_t)index->NumOfWide + 1) * LINE_INDEX_BLOCK * sizeof(offset_t));
+    if (copy.Checkpoints == NULL || copy.WideBlocks == NULL || copy.Deltas == NULL || copy.Wide == NULL)
+    {
+        free(copy.Checkpoints);
+        free(copy.WideBlocks);
+        free(copy.Deltas);
+        free(copy.Wide);
+        return MEMORY_SHORTAGE;
+    }
+
+    numOfBlocks = (size_t)(index->Count + LINE_INDEX_BLOCK - 1) / LINE_INDEX_BLOCK;
+    memcpy(copy.Checkpoints, index->Checkpoints, numOfBlocks * sizeof(offset_t));
+    memcpy(copy.WideBlocks, index->WideBlocks, numOfBlocks * sizeof(unsigned long));
+    memcpy(copy.Deltas, index->Deltas, (size_t)index->Count * sizeof(unsigned short));
+    memcpy(copy.Wide, index->Wide, (size_t)index->NumOfWide * LINE_INDEX_BLOCK * sizeof(offset_t));
+
+    UnmapViewOfFile(index->Image);
+    copy.Capacity = capacity;
+    copy.WideCapacity = index->NumOfWide + 1;
+    copy.Image = NULL;
+    *index = copy;
+    return SUCCESS;
+}
+
+/*  Doubles the capacity of the index
+INPUT:
+    line_index_t *index - pointer on line index structure
+RETURN:
+    error_t - error code
+*/
+static error_t GrowLineIndex(line_index_t *index)
+{
+    index_t capacity = index->Capacity < MIN_CAPACITY ? MIN_CAPACITY : index->Capacity * 2;
+    offset_t *checkpoints;
+    unsigned long *wideBlocks;
+    unsigned short *deltas;
+
+    if (!FITS_IN_MEMORY(capacity, sizeof(offset_t)))
+        return MEMORY_SHORTAGE;
+
+    /* Every array is replaced only when all of them are reallocated */
+    checkpoints = realloc(index->Checkpoints, (size_t)capacity / LINE_INDEX_BLOCK * sizeof(offset_t));
+    if (checkpoints == NULL)
+        return MEMORY_SHORTAGE;
+    index->Checkpoints = checkpoints;
+
+    wideBlocks = realloc(index->WideBlocks, (size_t)capacity / LINE_INDEX_BLOCK * sizeof(unsigned long));
+    if (wideBlocks == NULL)
+        return MEMORY_SHORTAGE;
+    index->WideBlocks = wideBlocks;
+
+    deltas = realloc(index->Deltas, (size_t)capacity * sizeof(unsigned short));
+    if (deltas == NULL)
+        return MEMORY_SHORTAGE;
+    index->Deltas = deltas;
+
+    index->Capacity = capacity;
+    return SUCCESS;
+}
+
+/*  Moves the block to 64-bit relative offsets
+INPUT:
+    line_index_t *index - pointer on line index structure
+    index_t block - index of the block
+RETURN:
+    error_t - error code
+*/
+static error_t WidenBlock(line_index_t *index, index_t block)
+{
+    offset_t *wide;
+    index_t first = block * LINE_INDEX_BLOCK;
+    index_t line;
+
+    if (index->NumOfWide == index->WideCapacity)
+    {
+        unsigned long capacity = index->WideCapacity < 16 ? 16 : index->WideCapacity * 2;
+
+        wide = realloc(index->Wide, capacity * LINE_INDEX_BLOCK * sizeof(offset_t));
+        if (wide == NULL)
+            return MEMORY_SHORTAGE;
+
+        index->Wide = wide;
+        index->WideCapacity = capacity;
+    }
+
+    wide = index->Wide + index->NumOfWide * LINE_INDEX_BLOCK;
+    for (line = first; line < index->Count; line++)
+        wide[line - first] = index->Deltas[line];
+
+    index->WideBlocks[block] = index->NumOfWide++;
+    return SUCCESS;
+}
+
+/*  Appends the offset of the next line start, the offsets must not decrease
+INPUT:
+    line_index_t *index - pointer on line index structure
+    offset_t offset - offset of the line start from the beginning of the data
+RETURN:
+    error_t - error code
+*/
+error_t AppendLineOffset(line_index_t *index, offset_t offset)
+{
+    index_t block = index->Count / LINE_INDEX_BLOCK;
+    offset_t delta;
+
+    if (index->Image != NULL && DetachLineIndex(index) != SUCCESS)
+        return MEMORY_SHORTAGE;
+    if (index->Count == index->Capacity && GrowLineIndex(index) != SUCCESS)
+        return MEMORY_SHORTAGE;
+
+    /* The first line of the block becomes its checkpoint */
+    if (index->Count % LINE_INDEX_BLOCK == 0)
+    {
+        index->Checkpoints[block] = offset;
+        index->WideBlocks[block] = NARROW_BLOCK;
+    }
+
+    delta = offset - index->Checkpoints[block];
+    if (index->WideBlocks[block] == NARROW_BLOCK && delta > MAX_DELTA &&
+        WidenBlock(index, block) != SUCCESS)
+        return MEMORY_SHORTAGE;
+
+    if (index->WideBlocks[block] == NARROW_BLOCK)
+        index->Deltas[index->Count] = (unsigned short)delta;
+    else
+        index->Wide[index->WideBlocks[block] * LINE_INDEX_BLOCK + index->Count % LINE_INDEX_BLOCK] = delta;
+
+    index->Count++;
+    return SUCCESS;
+}
+
+/*  Removes the last line start, the next one may be appended at another offset
+INPUT:
+    line_index_t *index - pointer on nonempty line index structure
+*/
+void RemoveLastLineOffset(line_index_t *index)
+{
+    /* A widened block stays wide, the freed entry is written again by the next append */
+    index->Count--;
+}
+
+/*  Returns the offset of the line start in O(1)
+INPUT:
+    const line_index_t *index - pointer on line index structure
+    index_t line - index of the line, less than Count
+RETURN:
+    offset_t - offset of the line start
+*/
+offset_t GetLineOffset(const line_index_t *index, index_t line)
+{
+    index_t block = line / LINE_INDEX_BLOCK;
+
+    if (index->WideBlocks[block] == NARROW_BLOCK)
+        return index->Checkpoints[block] + index->Deltas[line];
+
+    return index->Checkpoints[block] +
+           index->Wide[index->WideBlocks[block] * LINE_INDEX_BLOCK + line % LINE_INDEX_BLOCK];
+}
+
+/*  Finds the line containing the offset in O(log n)
+INPUT:
+    const line_index_t *index - pointer on nonempty line index structure
+    offset_t offset - offset from the beginning of the data
+RETURN:
+    index_t - index of the last line starting not after the offset
+*/
+index_t FindLineByOffset(const line_index_t *index, offset_t offset)
+{
+    index_t l = 0;
+    index_t r = (index->Count - 1) / LINE_INDEX_BLOCK;
+
+    /* Searching for the block by the checkpoints */
+    while (l < r)
+    {
+        index_t midle = r - (r - l) / 2;
+
+        if (index->Checkpoints[midle] <= offset)
+            l = midle;
+        else
+            r = midle - 1;
+    }
+
+    /* Searching for the line inside the block */
+    r = l * LINE_INDEX_BLOCK + LINE_INDEX_BLOCK - 1;
+    if (r > index->Count - 1)
+        r = index->Count - 1;
+    l *= LINE_INDEX_BLOCK;
+    while (l < r)
+    {
+        index_t midle = r - (r - l) / 2;
+
+        if (GetLineOffset(index, midle) <= offset)
+            l = midle;
+        else
+            r = midle - 1;
+    }
+
+    return l;
+}
+
+/*  Clears the line index
+INPUT:
+    line_index_t *index - pointer on line index structure
+OUTPUT:
+    line_index_t *index - pointer on line index structure filled with zero values
+*/
+void ClearLineIndex(line_index_t *index)
+{
+    if (index == NULL)
+        return;
+
+    if (index->Image != NULL)
+        UnmapViewOfFile(index->Image);
+    else
+    {
+        free(index->Checkpoints);
+        free(index->WideBlocks);
+        free(index->Deltas);
+        free(index->Wide);
+    }
+    InitLineIndex(index);
+}
@@ -0,0 +1,95 @@
+#ifndef __LINE_INDEX_H_INCLUDED
+#define __LINE_INDEX_H_INCLUDED
+
+#include <stdlib.h>
+#include "../error/error.h"
+#include "modelTypes.h"
+
+#define LINE_INDEX_BLOCK 64                 /* The number of lines between two 64-bit checkpoints */
+#define NARROW_BLOCK ((unsigned long)-1)    /* Marks the block with 16-bit offsets */
+
+/*  Compact index of line start offsets. Every LINE_INDEX_BLOCK lines a 64-bit
+    checkpoint is stored, the lines of the block keep 16-bit offsets relative to it.
+    A block whose lines do not fit in 64 KB is widened to 64-bit relative offsets.
+    Memory per line: about 2.2 bytes when the average line is shorter than 1 KB
+    (2 bytes of delta and 12 bytes of block header per 64 lines), at most 10.2
+    bytes for wide blocks, which are used only when lines are longer than 1 KB */
+typedef struct
+{
+    offset_t *Checkpoints;              /* Offsets of the first lines of the blocks */
+    unsigned long *WideBlocks;          /* Number of the block in Wide or NARROW_BLOCK */
+    unsigned short *Deltas;             /* Offsets of the lines from their checkpoints */
+    offset_t *Wide;                     /* Offsets from the checkpoints for the widened blocks */
+    index_t Count;                      /* The number of stored line starts */
+    index_t Capacity;                   /* The number of line starts fitting in the arrays */
+    unsigned long NumOfWide;            /* The number of widened blocks */
+    unsigned long WideCapacity;         /* The number of widened blocks fitting in Wide */
+    const void *Image;                  /* Mapped index file the arrays point into or NULL if they are allocated */
+} line_index_t;
+
+/*  Initializes the line index
+INPUT:
+    line_index_t *index - pointer on line index structure
+OUTPUT:
+    line_index_t *index - pointer on empty line index structure
+*/
+void InitLineIndex(line_index_t *index);
+
+/*  Makes the index use the arrays of the mapped index file. The arrays are
+    copied to the memory before the first change of the index
+INPUT:
+    line_index_t *index - pointer on empty line index structure
+    const void *image - mapped view of the index file, it is unmapped by the index
+    const offset_t *checkpoints - offsets of the first lines of the blocks
+    const unsigned long *wideBlocks - numbers of the blocks in wide or NARROW_BLOCK
+    const unsigned short *deltas - offsets of the lines from their checkpoints
+    const offset_t *wide - offsets from the checkpoints for the widened blocks
+    index_t count - the number of line starts
+    unsigned long numOfWide - the number of widened blocks
+*/
+void AttachLineIndex(line_index_t *index, const void *image, const offset_t *checkpoints,
+                     const unsigned long *wideBlocks, const unsigned short *deltas,
+                     const offset_t *wide, index_t count, unsigned long numOfWide);
+
+/*  Appends the offset of the next line start, the offsets must not decrease
+INPUT:
+    line_index_t *index - pointer on line index structure
+    offset_t offset - offset of the line start from the beginning of the data
+RETURN:
+    error_t - error code
+*/
+error_t AppendLineOffset(line_index_t *index, offset_t offset);
+
+/*  Removes the last line start, the next one may be appended at another offset
+INPUT:
+    line_index_t *index - pointer on nonempty line index structure
+*/
+void RemoveLastLineOffset(line_index_t *index);
+
+/*  Returns the offset of the line start in O(1)
+INPUT:
+    const line_index_t *index - pointer on line index structure
+    index_t line - index of the line, less than Count
+RETURN:
+    offset_t - offset of the line start
+*/
+offset_t GetLineOffset(const line_index_t *index, index_t line);
+
+/*  Finds the line containing the offset in O(log n)
+INPUT:
+    const line_index_t *index - pointer on nonempty line index structure
+    offset_t offset - offset from the beginning of the data
+RETURN:
+    index_t - index of the last line starting not after the offset
+*/
+index_t FindLineByOffset(const line_index_t *index, offset_t offset);
+
+/*  Clears the line index
+INPUT:
+    line_index_t *index - pointer on line index structure
+OUTPUT:
+    line_index_t *index - pointer on line index structure filled with zero values
+*/
+void ClearLineIndex(line_index_t *index);
+
+#endif // __LINE_INDEX_H_INCLUDED
@@ -0,0 +1,562 @@
+#include "lineScanner.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define SCANNER_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#endif
+
+#ifdef __GNUC__
+    #define TARGET_SSE2 __attribute__((target("sse2")))
+    #define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define TARGET_SSE2
+    #define TARGET_AVX2
+#endif
+
+#define SCAN_BLOCK 64           /* The number of characters processed by one vector iteration */
+#define MIN_CAPACITY 1024       /* Initial number of entries in the array of line starts */
+#define MIN_CHUNK (2ul << 20)   /* Minimum number of characters scanned by one parallel task */
+#define CHUNKS_PER_THREAD 4     /* Chunks per pool thread to even out the load */
+
+/* Scanning function of the particular instruction set */
+typedef error_t (*scan_func_t)(line_starts_t *starts, const char *cur, const char *end);
+
+/* Shared state of the parallel scan */
+typedef struct
+{
+    const char *Data;           /* Pointer on the data */
+    offset_t Size;              /* The number of characters in the data */
+    offset_t ChunkSize;         /* The number of characters in one chunk */
+    line_starts_t *Chunks;      /* Line starts found in every chunk */
+    error_t *Errors;            /* Result of the scan of every chunk */
+    size_t *Offsets;            /* Position of the chunk line starts in the result */
+    const char **Result;        /* Array of the joined line starts */
+} parallel_scan_t;
+
+/*  Initializes the array of line starts
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+    const char *lineStart - beginning of the first line or NULL if it lies before the scanned data
+OUTPUT:
+    line_starts_t *starts - pointer on empty line starts structure
+*/
+void InitLineStarts(line_starts_t *starts, const char *lineStart)
+{
+    starts->Starts = NULL;
+    starts->Count = 0;
+    starts->Capacity = 0;
+    starts->MaxLength = 0;
+    starts->LineStart = lineStart;
+    starts->HasNonAscii = 0;
+    starts->TabLines = NULL;
+    starts->NumOfTabLines = 0;
+    starts->TabCapacity = 0;
+}
+
+/*  Makes room for the specified number of line starts
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+    size_t extra - the number of entries that must fit without reallocation
+RETURN:
+    error_t - error code
+*/
+static error_t ReserveLineStarts(line_starts_t *starts, size_t extra)
+{
+    size_t capacity = starts->Capacity * 2;
+    const char **tmp;
+
+    if (starts->Capacity - starts->Count >= extra)
+        return SUCCESS;
+
+    if (capacity < MIN_CAPACITY)
+        capacity = MIN_CAPACITY;
+    if (capacity < starts->Count + extra)
+        capacity = starts->Count + extra;
+
+    tmp = realloc(starts->Starts, capacity * sizeof(char *));
+    if (tmp == NULL)
+        return MEMORY_SHORTAGE;
+
+    starts->Starts = tmp;
+    starts->Capacity = capacity;
+    return SUCCESS;
+}
+
+/*  Appends the line start to the array
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+    const char *start - pointer on the beginning of the line
+RETURN:
+    error_t - error code
+*/
+error_t AppendLineStart(line_starts_t *starts, const char *start)
+{
+    if (ReserveLineStarts(starts, 1) != SUCCESS)
+        return MEMORY_SHORTAGE;
+
+    starts->Starts[starts->Count++] = start;
+    return SUCCESS;
+}
+
+/*  Appends the number of the line to the lines having tabs unless it is already there
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+    size_t line - number of the line, not less than the last stored one
+RETURN:
+    error_t - error code
+*/
+static error_t AppendTabLine(line_starts_t *starts, size_t line)
+{
+    if (starts->NumOfTabLines > 0 && starts->TabLines[starts->NumOfTabLines - 1] == line)
+        return SUCCESS;
+
+    if (starts->NumOfTabLines == starts->TabCapacity)
+    {
+        size_t capacity = starts->TabCapacity < MIN_CAPACITY ? MIN_CAPACITY : starts->TabCapacity * 2;
+        size_t *tmp = realloc(starts->TabLines, capacity * sizeof(size_t));
+
+        if (tmp == NULL)
+            return MEMORY_SHORTAGE;
+        starts->TabLines = tmp;
+        starts->TabCapacity = capacity;
+    }
+
+    starts->TabLines[starts->NumOfTabLines++] = line;
+    return SUCCESS;
+}
+
+/*  Registers the found line break, the room for it must be already reserved
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+    const char *lineBreak - pointer on the line break character
+*/
+static void RecordLineBreak(line_starts_t *starts, const char *lineBreak)
+{
+    if (starts->LineStart != NULL)
+    {
+        offset_t len = lineBreak - starts->LineStart;
+
+        if (len > 0 && lineBreak[-1] == '\r')
+            len--;
+        if (starts->MaxLength < len)
+            starts->MaxLength = len;
+    }
+
+    starts->LineStart = lineBreak + 1;
+    starts->Starts[starts->Count++] = starts->LineStart;
+}
+
+/*  Returns the index of the lowest set bit
+INPUT:
+    unsigned long long mask - nonzero bit mask
+RETURN:
+    unsigned - index of the bit
+*/
+static unsigned CountTrailingZeros(unsigned long long mask)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(mask);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+
+    _BitScanForward64(&index, mask);
+    return index;
+#else
+    unsigned index = 0;
+
+    for (; (mask & 1) == 0; mask >>= 1)
+        index++;
+    return index;
+#endif
+}
+
+/*  Registers all line breaks of the block
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+    const char *block - pointer on the beginning of the block
+    unsigned long long mask - bit mask of the line break positions in the block
+*/
+static void RecordBlock(line_starts_t *starts, const char *block, unsigned long long mask)
+{
+    for (; mask != 0; mask &= mask - 1)
+        RecordLineBreak(starts, block + CountTrailingZeros(mask));
+}
+
+/*  Registers the line breaks and the tabs of the block in the order they follow
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+    const char *block - pointer on the beginning of the block
+    unsigned long long mask - bit mask of the line break positions in the block
+    unsigned long long tabMask - nonzero bit mask of the tab positions in the block
+RETURN:
+    error_t - error code
+*/
+static error_t RecordBlockWithTabs(line_starts_t *starts, const char *block, unsigned long long mask,
+                                   unsigned long long tabMask)
+{
+    unsigned long long all = mask | tabMask;
+
+    for (; all != 0; all &= all - 1)
+    {
+        unsigned index = CountTrailingZeros(all);
+
+        if ((tabMask >> index & 1) == 0)
+            RecordLineBreak(starts, block + index);
+        else if (AppendTabLine(starts, starts->Count) != SUCCESS)
+            return MEMORY_SHORTAGE;
+    }
+
+    return SUCCESS;
+}
+
+/*  Scans the data one line at a time (used for tails and as a fallback)
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+    const char *cur - pointer on the beginning of the data
+    const char *end - pointer past the end of the data
+RETURN:
+    error_t - error code
+*/
+static error_t ScanScalar(line_starts_t *starts, const char *cur, const char *end)
+{
+    const char *next;
+
+    for (next = cur; next < end && !starts->HasNonAscii; next++)
+        starts->HasNonAscii = (unsigned char)*next >= 0x80;
+
+    while (cur < end)
+    {
+        const char *lineBreak = memchr(cur, '\n', end - cur);
+        const char *lineEnd = lineBreak != NULL ? lineBreak : end;
+
+        if (memchr(cur, '\t', lineEnd - cur) != NULL && AppendTabLine(starts, starts->Count) != SUCCESS)
+            return MEMORY_SHORTAGE;
+        if (lineBreak == NULL)
+            break;
+
+        if (ReserveLineStarts(starts, 1) != SUCCESS)
+            return MEMORY_SHORTAGE;
+
+        RecordLineBreak(starts, lineBreak);
+        cur = lineBreak + 1;
+    }
+
+    return SUCCESS;
+}
+
+#ifdef SCANNER_X86
+
+/*  Scans the data with SSE2 instructions, 64 characters per iteration
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+    const char *cur - pointer on the beginning of the data
+    const char *end - pointer past the end of the data
+RETURN:
+    error_t - error code
+*/
+TARGET_SSE2 static error_t ScanSse2(line_starts_t *starts, const char *cur, const char *end)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i tab = _mm_set1_epi8('\t');
+    __m128i high = _mm_setzero_si128();
+
+    for (; end - cur >= SCAN_BLOCK; cur += SCAN_BLOCK)
+    {
+        __m128i bytes0 = _mm_loadu_si128((const __m128i *)cur);
+        __m128i bytes1 = _mm_loadu_si128((const __m128i *)(cur + 16));
+        __m128i bytes2 = _mm_loadu_si128((const __m128i *)(cur + 32));
+        __m128i bytes3 = _mm_loadu_si128((const __m128i *)(cur + 48));
+        unsigned long long mask0 = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes0, newline));
+        unsigned long long mask1 = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes1, newline));
+        unsigned long long mask2 = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes2, newline));
+        unsigned long long mask3 = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes3, newline));
+        unsigned long long mask = mask0 | mask1 << 16 | mask2 << 32 | mask3 << 48;
+        __m128i tabs0 = _mm_cmpeq_epi8(bytes0, tab);
+        __m128i tabs1 = _mm_cmpeq_epi8(bytes1, tab);
+        __m128i tabs2 = _mm_cmpeq_epi8(bytes2, tab);
+        __m128i tabs3 = _mm_cmpeq_epi8(bytes3, tab);
+
+        /* The high bits of all characters are collected and checked once */
+        high = _mm_or_si128(high, _mm_or_si128(_mm_or_si128(bytes0, bytes1), _mm_or_si128(bytes2, bytes3)));
+
+        /* The positions of the tabs are needed only in the rare blocks having them */
+        if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(tabs0, tabs1), _mm_or_si128(tabs2, tabs3))) != 0)
+        {
+            unsigned long long tabMask = (unsigned long long)(unsigned)_mm_movemask_epi8(tabs0) |
+                                         (unsigned long long)(unsigned)_mm_movemask_epi8(tabs1) << 16 |
+                                         (unsigned long long)(unsigned)_mm_movemask_epi8(tabs2) << 32 |
+                                         (unsigned long long)(unsigned)_mm_movemask_epi8(tabs3) << 48;
+
+            if (ReserveLineStarts(starts, SCAN_BLOCK) != SUCCESS ||
+                RecordBlockWithTabs(starts, cur, mask, tabMask) != SUCCESS)
+                return MEMORY_SHORTAGE;
+            continue;
+        }
+        if (mask == 0)
+            continue;
+
+        if (ReserveLineStarts(starts, SCAN_BLOCK) != SUCCESS)
+            return MEMORY_SHORTAGE;
+        RecordBlock(starts, cur, mask);
+    }
+
+    if (_mm_movemask_epi8(high) != 0)
+        starts->HasNonAscii = 1;
+    return ScanScalar(starts, cur, end);
+}
+
+/*  Scans the data with AVX2 instructions, 64 characters per iteration
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+    const char *cur - pointer on the beginning of the data
+    const char *end - pointer past the end of the data
+RETURN:
+    error_t - error code
+*/
+TARGET_AVX2 static error_t ScanAvx2(line_starts_t *starts, const char *cur, const char *end)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    __m256i high = _mm256_setzero_si256();
+
+    for (; end - cur >= SCAN_BLOCK; cur += SCAN_BLOCK)
+    {
+        __m256i bytes0 = _mm256_loadu_si256((const __m256i *)cur);
+        __m256i bytes1 = _mm256_loadu_si256((const __m256i *)(cur + 32));
+        unsigned long long mask0 = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes0, newline));
+        unsigned long long mask1 = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes1, newline));
+        unsigned long long mask = mask0 | mask1 << 32;
+        __m256i tabs0 = _mm256_cmpeq_epi8(bytes0, tab);
+        __m256i tabs1 = _mm256_cmpeq_epi8(bytes1, tab);
+
+        high = _mm256_or_si256(high, _mm256_or_si256(bytes0, bytes1));
+        if (!_mm256_testz_si256(tabs0, tabs0) || !_mm256_testz_si256(tabs1, tabs1))
+        {
+            unsigned long long tabMask = (unsigned long long)(unsigned)_mm256_movemask_epi8(tabs0) |
+                                         (unsigned long long)(unsigned)_mm256_movemask_epi8(tabs1) << 32;
+
+            if (ReserveLineStarts(starts, SCAN_BLOCK) != SUCCESS ||
+                RecordBlockWithTabs(starts, cur, mask, tabMask) != SUCCESS)
+                return MEMORY_SHORTAGE;
+            continue;
+        }
+        if (mask == 0)
+            continue;
+
+        if (ReserveLineStarts(starts, SCAN_BLOCK) != SUCCESS)
+            return MEMORY_SHORTAGE;
+        RecordBlock(starts, cur, mask);
+    }
+
+    if (_mm256_movemask_epi8(high) != 0)
+        starts->HasNonAscii = 1;
+    return ScanScalar(starts, cur, end);
+}
+
+#endif // SCANNER_X86
+
+/*  Chooses the scanning function for the instruction set of the processor
+RETURN:
+    scan_func_t - the fastest supported scanning function
+*/
+static scan_func_t ChooseScanner(void)
+{
+#if defined(SCANNER_X86) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return ScanAvx2;
+    if (__builtin_cpu_supports("sse2"))
+        return ScanSse2;
+#elif defined(SCANNER_X86) && defined(_MSC_VER)
+    int info[4];
+
+    __cpuid(info, 0);
+    if (info[0] >= 7)
+    {
+        int features[4];
+
+        /* AVX2 also needs the OS to save the YMM registers */
+        __cpuid(features, 1);
+        __cpuidex(info, 7, 0);
+        if ((features[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6 && (info[1] & (1 << 5)))
+            return ScanAvx2;
+    }
+    __cpuid(info, 1);
+    if (info[3] & (1 << 26))
+        return ScanSse2;
+#endif
+
+    return ScanScalar;
+}
+
+/*  Finds all line breaks in the data in one pass, appends the beginnings of the lines
+    following them and updates the maximum length of the lines ended in the data.
+    The characters above 127 and the lines having tabs are noticed by the same loads
+    to keep the ASCII files fast.
+    The scan is bounded by the length only, so zero bytes are ordinary characters.
+    The fastest available instruction set (AVX2, SSE2 or scalar) is chosen at runtime
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+    const char *data - pointer on the data
+    offset_t size - the number of characters in the data
+RETURN:
+    error_t - error code
+*/
+error_t ScanLineStarts(line_starts_t *starts, const char *data, offset_t size)
+{
+    static scan_func_t scan = NULL;
+
+    /* The choice is the same for every thread, so the race here is harmless */
+    if (scan == NULL)
+        scan = ChooseScanner();
+
+    return scan(starts, data, data + size);
+}
+
+/*  Scans one chunk of the data, the line containing its beginning is unknown
+INPUT:
+    void *arg - pointer on parallel scan structure
+    unsigned long index - index of the chunk
+*/
+static void ScanChunk(void *arg, unsigned long index)
+{
+    parallel_scan_t *scan = arg;
+    offset_t offset = index * scan->ChunkSize;
+    offset_t size = scan->Size - offset;
+
+    if (size > scan->ChunkSize)
+        size = scan->ChunkSize;
+
+    InitLineStarts(&scan->Chunks[index], NULL);
+    scan->Errors[index] = ScanLineStarts(&scan->Chunks[index], scan->Data + offset, size);
+}
+
+/*  Copies the line starts of one chunk to its place in the result
+INPUT:
+    void *arg - pointer on parallel scan structure
+    unsigned long index - index of the chunk
+*/
+static void CopyChunk(void *arg, unsigned long index)
+{
+    parallel_scan_t *scan = arg;
+
+    memcpy(scan->Result + scan->Offsets[index], scan->Chunks[index].Starts,
+           scan->Chunks[index].Count * sizeof(char *));
+}
+
+/*  Does the same as ScanLineStarts, but splits large data into chunks scanned on the
+    thread pool. The partial results are joined by a prefix sum over the numbers of
+    lines in the chunks, so the result is the same as the one of the sequential scan,
+    including the numbers of the lines having tabs
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+    const char *data - pointer on the data
+    offset_t size - the number of characters in the data
+RETURN:
+    error_t - error code
+*/
+error_t ScanLineStartsParallel(line_starts_t *starts, const char *data, offset_t size)
+{
+    parallel_scan_t scan;
+    unsigned long numOfChunks;
+    size_t total = 0;
+    unsigned long i;
+    error_t err = SUCCESS;
+
+    scan.ChunkSize = size / (GetThreadPoolLimit() * CHUNKS_PER_THREAD) + 1;
+    if (scan.ChunkSize < MIN_CHUNK)
+        scan.ChunkSize = MIN_CHUNK;
+
+    numOfChunks = (size + scan.ChunkSize - 1) / scan.ChunkSize;
+    if (numOfChunks <= 1)
+        return ScanLineStarts(starts, data, size);
+
+    scan.Data = data;
+    scan.Size = size;
+    scan.Chunks = calloc(numOfChunks, sizeof(line_starts_t));
+    scan.Errors = calloc(numOfChunks, sizeof(error_t));
+    scan.Offsets = calloc(numOfChunks, sizeof(size_t));
+    if (scan.Chunks == NULL || scan.Errors == NULL || scan.Offsets == NULL)
+    {
+        free(scan.Chunks);
+        free(scan.Errors);
+        free(scan.Offsets);
+        return MEMORY_SHORTAGE;
+    }
+
+    RunParallel(ScanChunk, &scan, numOfChunks);
+
+    /* Joining the chunks: offsets of the results and lengths of the lines crossing the borders */
+    for (i = 0; i < numOfChunks && err == SUCCESS; i++)
+    {
+        line_starts_t *chunk = &scan.Chunks[i];
+        size_t j;
+
+        err = scan.Errors[i];
+        scan.Offsets[i] = starts->Count + total;
+        total += chunk->Count;
+
+        /* The line 0 of the chunk is the one open at its beginning */
+        for (j = 0; j < chunk->NumOfTabLines && err == SUCCESS; j++)
+            err = AppendTabLine(starts, scan.Offsets[i] + chunk->TabLines[j]);
+
+        if (starts->MaxLength < chunk->MaxLength)
+            starts->MaxLength = chunk->MaxLength;
+        if (chunk->HasNonAscii)
+            starts->HasNonAscii = 1;
+
+        if (chunk->Count == 0)
+            continue;
+
+        /* The first line of the chunk began in one of the previous ones */
+        if (starts->LineStart != NULL)
+        {
+            const char *lineBreak = chunk->Starts[0] - 1;
+            offset_t len = lineBreak - starts->LineStart;
+
+            if (len > 0 && lineBreak[-1] == '\r')
+                len--;
+            if (starts->MaxLength < len)
+                starts->MaxLength = len;
+        }
+        starts->LineStart = chunk->Starts[chunk->Count - 1];
+    }
+
+    if (err == SUCCESS)
+        err = ReserveLineStarts(starts, total);
+
+    if (err == SUCCESS)
+    {
+        scan.Result = starts->Starts;
+        RunParallel(CopyChunk, &scan, numOfChunks);
+        starts->Count += total;
+    }
+
+    for (i = 0; i < numOfChunks; i++)
+        ClearLineStarts(&scan.Chunks[i]);
+    free(scan.Chunks);
+    free(scan.Errors);
+    free(scan.Offsets);
+
+    return err;
+}
+
+/*  Clears the array of line starts
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+OUTPUT:
+    line_starts_t *starts - pointer on line starts structure filled with zero values
+*/
+void ClearLineStarts(line_starts_t *starts)
+{
+    if (starts == NULL)
+        return;
+
+    free(starts->Starts);
+    free(starts->TabLines);
+    InitLineStarts(starts, NULL);
+}
@@ -0,0 +1,78 @@
+#ifndef __LINE_SCANNER_H_INCLUDED
+#define __LINE_SCANNER_H_INCLUDED
+
+#include <stdlib.h>
+#include "../error/error.h"
+#include "../thread/threadPool.h"
+#include "modelTypes.h"
+
+/*  Growable array of line starts filled by the scanner */
+typedef struct
+{
+    const char **Starts;          /* Pointers on the beginnings of lines */
+    size_t Count;                 /* Number of stored line starts */
+    size_t Capacity;              /* Number of allocated entries */
+    offset_t MaxLength;           /* Maximum length of the lines ended in the scanned data */
+    const char *LineStart;        /* Beginning of the line being scanned or NULL if it is unknown */
+    int HasNonAscii;              /* Nonzero if the scanned data has characters above 127 */
+    size_t *TabLines;             /* Lines having tabs, increasing, the line k starts at Starts[k - 1]
+                                     and the line 0 is the one open before the data */
+    size_t NumOfTabLines;         /* Number of stored lines having tabs */
+    size_t TabCapacity;           /* Number of allocated entries for them */
+} line_starts_t;
+
+/*  Initializes the array of line starts
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+    const char *lineStart - beginning of the first line or NULL if it lies before the scanned data
+OUTPUT:
+    line_starts_t *starts - pointer on empty line starts structure
+*/
+void InitLineStarts(line_starts_t *starts, const char *lineStart);
+
+/*  Appends the line start to the array
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+    const char *start - pointer on the beginning of the line
+RETURN:
+    error_t - error code
+*/
+error_t AppendLineStart(line_starts_t *starts, const char *start);
+
+/*  Finds all line breaks in the data in one pass, appends the beginnings of the lines
+    following them and updates the maximum length of the lines ended in the data.
+    The characters above 127 and the lines having tabs are noticed by the same loads
+    to keep the ASCII files fast.
+    The scan is bounded by the length only, so zero bytes are ordinary characters.
+    The fastest available instruction set (AVX2, SSE2 or scalar) is chosen at runtime
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+    const char *data - pointer on the data
+    offset_t size - the number of characters in the data
+RETURN:
+    error_t - error code
+*/
+error_t ScanLineStarts(line_starts_t *starts, const char *data, offset_t size);
+
+/*  Does the same as ScanLineStarts, but splits large data into chunks scanned on the
+    thread pool. The partial results are joined by a prefix sum over the numbers of
+    lines in the chunks, so the result is the same as the one of the sequential scan,
+    including the numbers of the lines having tabs
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+    const char *data - pointer on the data
+    offset_t size - the number of characters in the data
+RETURN:
+    error_t - error code
+*/
+error_t ScanLineStartsParallel(line_starts_t *starts, const char *data, offset_t size);
+
+/*  Clears the array of line starts
+INPUT:
+    line_starts_t *starts - pointer on line starts structure
+OUTPUT:
+    line_starts_t *starts - pointer on line starts structure filled with zero values
+*/
+void ClearLineStarts(line_starts_t *starts);
+
+#endif // __LINE_SCANNER_H_INCLUDED
@@ -0,0 +1,435 @@
+#include "literalSearch.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define FINDER_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#endif
+
+#ifdef __GNUC__
+    #define TARGET_SSE2 __attribute__((target("sse2")))
+    #define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define TARGET_SSE2
+    #define TARGET_AVX2
+#endif
+
+/* Searching function of the particular instruction set, size is not less than the length of the literal */
+typedef size_t (*find_func_t)(const literal_t *literal, const unsigned char *text, size_t size);
+
+/*  Lowers the ASCII letter
+INPUT:
+    unsigned char c - the character
+RETURN:
+    unsigned char - the lowered letter or the same character
+*/
+static unsigned char LowerAscii(unsigned char c)
+{
+    return c >= 'A' && c <= 'Z' ? c | 0x20 : c;
+}
+
+/*  Prepares the searched sequence
+INPUT:
+    literal_t *literal - pointer on literal structure
+    const char *text - the characters, they must live while the literal is used
+    size_t length - the number of characters, at least one
+    int ignoreCase - nonzero if the case of the ASCII letters is ignored
+OUTPUT:
+    literal_t *literal - pointer on literal structure ready for the search
+*/
+void InitLiteral(literal_t *literal, const char *text, size_t length, int ignoreCase)
+{
+    unsigned char first = (unsigned char)text[0];
+    unsigned char last = (unsigned char)text[length - 1];
+
+    literal->Text = text;
+    literal->Length = length;
+    literal->IgnoreCase = ignoreCase;
+
+    /* Setting 0x20 turns the capital letter into the small one and only the two cases give the small letter */
+    literal->First = ignoreCase ? LowerAscii(first) : first;
+    literal->FirstMask = ignoreCase && literal->First >= 'a' && literal->First <= 'z' ? 0x20 : 0;
+    literal->Last = ignoreCase ? LowerAscii(last) : last;
+    literal->LastMask = ignoreCase && literal->Last >= 'a' && literal->Last <= 'z' ? 0x20 : 0;
+}
+
+/*  Compares the literal with the characters
+INPUT:
+    const literal_t *literal - pointer on literal structure
+    const unsigned char *text - pointer on at least Length characters
+RETURN:
+    int - nonzero if the characters are the occurrence of the literal
+*/
+static int IsLiteralAt(const literal_t *literal, const unsigned char *text)
+{
+    const unsigned char *pattern = (const unsigned char *)literal->Text;
+    size_t i;
+
+    if (!literal->IgnoreCase)
+        return memcmp(text, pattern, literal->Length) == 0;
+
+    for (i = 0; i < literal->Length; i++)
+        if (LowerAscii(text[i]) != LowerAscii(pattern[i]))
+            return 0;
+
+    return 1;
+}
+
+/*  Checks the first and the last characters of the literal at the position
+INPUT:
+    const literal_t *literal - pointer on literal structure
+    const unsigned char *text - pointer on at least Length characters
+RETURN:
+    int - nonzero if both characters match
+*/
+static int HasLiteralEnds(const literal_t *literal, const unsigned char *text)
+{
+    return (text[0] | literal->FirstMask) == literal->First &&
+           (text[literal->Length - 1] | literal->LastMask) == literal->Last;
+}
+
+/*  Finds the first occurrence one position at a time
+INPUT:
+    const literal_t *literal - pointer on literal structure
+    const unsigned char *text - pointer on the text
+    size_t size - the number of characters in the text, not less than the length of the literal
+RETURN:
+    size_t - position of the occurrence, size if there is none
+*/
+static size_t FindScalar(const literal_t *literal, const unsigned char *text, size_t size)
+{
+    size_t count = size - literal->Length + 1;
+    size_t i;
+
+    for (i = 0; i < count; i++)
+        if (HasLiteralEnds(literal, text + i) && IsLiteralAt(literal, text + i))
+            return i;
+
+    return size;
+}
+
+/*  Finds the last occurrence one position at a time
+INPUT:
+    const literal_t *literal - pointer on literal structure
+    const unsigned char *text - pointer on the text
+    size_t size - the number of characters in the text, not less than the length of the literal
+RETURN:
+    size_t - position of the occurrence, size if there is none
+*/
+static size_t FindLastScalar(const literal_t *literal, const unsigned char *text, size_t size)
+{
+    size_t i = size - literal->Length + 1;
+
+    while (i-- > 0)
+        if (HasLiteralEnds(literal, text + i) && IsLiteralAt(literal, text + i))
+            return i;
+
+    return size;
+}
+
+#ifdef FINDER_X86
+
+/*  Returns the index of the lowest set bit
+INPUT:
+    unsigned mask - nonzero mask
+RETURN:
+    unsigned - index of the bit
+*/
+static unsigned GetLowestBit(unsigned mask)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#elif defined(_MSC_VER)
+    unsigned long index;
+
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    unsigned index = 0;
+
+    for (; (mask & 1) == 0; mask >>= 1)
+        index++;
+    return index;
+#endif
+}
+
+/*  Returns the index of the highest set bit
+INPUT:
+    unsigned mask - nonzero mask
+RETURN:
+    unsigned - index of the bit
+*/
+static unsigned GetHighestBit(unsigned mask)
+{
+#if defined(__GNUC__)
+    return 31 - __builtin_clz(mask);
+#elif defined(_MSC_VER)
+    unsigned long index;
+
+    _BitScanReverse(&index, mask);
+    return index;
+#else
+    unsigned index = 0;
+
+    for (; mask > 1; mask >>= 1)
+        index++;
+    return index;
+#endif
+}
+
+/*  Marks the positions of the SSE2 block where the first and the last characters of the literal match
+INPUT:
+    const literal_t *literal - pointer on literal structure
+    const unsigned char *text - the first position of the block
+RETURN:
+    unsigned - bit mask of 16 positions
+*/
+TARGET_SSE2 static unsigned GetEndsSse2(const literal_t *literal, const unsigned char *text)
+{
+    __m128i head = _mm_or_si128(_mm_loadu_si128((const __m128i *)text), _mm_set1_epi8((char)literal->FirstMask));
+    __m128i tail = _mm_or_si128(_mm_loadu_si128((const __m128i *)(text + literal->Length - 1)),
+                                _mm_set1_epi8((char)literal->LastMask));
+
+    return (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, _mm_set1_epi8((char)literal->First)),
+                                                     _mm_cmpeq_epi8(tail, _mm_set1_epi8((char)literal->Last))));
+}
+
+/*  Finds the first occurrence with SSE2 instructions, 16 positions per iteration
+INPUT:
+    const literal_t *literal - pointer on literal structure
+    const unsigned char *text - pointer on the text
+    size_t size - the number of characters in the text, not less than the length of the literal
+RETURN:
+    size_t - position of the occurrence, size if there is none
+*/
+TARGET_SSE2 static size_t FindSse2(const literal_t *literal, const unsigned char *text, size_t size)
+{
+    size_t count = size - literal->Length + 1;
+    size_t i;
+
+    for (i = 0; count - i >= 16; i += 16)
+    {
+        unsigned mask = GetEndsSse2(literal, text + i);
+
+        for (; mask != 0; mask &= mask - 1)
+            if (IsLiteralAt(literal, text + i + GetLowestBit(mask)))
+                return i + GetLowestBit(mask);
+    }
+
+    return i + FindScalar(literal, text + i, size - i);
+}
+
+/*  Finds the last occurrence with SSE2 instructions, 16 positions per iteration
+INPUT:
+    const literal_t *literal - pointer on literal structure
+    const unsigned char *text - pointer on the text
+    size_t size - the number of characters in the text, not less than the length of the literal
+RETURN:
+    size_t - position of the occurrence, size if there is none
+*/
+TARGET_SSE2 static size_t FindLastSse2(const literal_t *literal, const unsigned char *text, size_t size)
+{
+    size_t count = size - literal->Length + 1;
+    size_t found;
+
+    for (; count >= 16; count -= 16)
+    {
+        unsigned mask = GetEndsSse2(literal, text + count - 16);
+
+        for (; mask != 0; mask &= ~(1u << GetHighestBit(mask)))
+            if (IsLiteralAt(literal, text + count - 16 + GetHighestBit(mask)))
+                return count - 16 + GetHighestBit(mask);
+    }
+
+    /* The positions before the blocks are left */
+    found = FindLastScalar(literal, text, count + literal->Length - 1);
+    return found < count ? found : size;
+}
+
+/*  Marks the positions of the AVX2 block where the first and the last characters of the literal match
+INPUT:
+    const literal_t *literal - pointer on literal structure
+    const unsigned char *text - the first position of the block
+RETURN:
+    unsigned - bit mask of 32 positions
+*/
+TARGET_AVX2 static unsigned GetEndsAvx2(const literal_t *literal, const unsigned char *text)
+{
+    __m256i head = _mm256_or_si256(_mm256_loadu_si256((const __m256i *)text),
+                                   _mm256_set1_epi8((char)literal->FirstMask));
+    __m256i tail = _mm256_or_si256(_mm256_loadu_si256((const __m256i *)(text + literal->Length - 1)),
+                                   _mm256_set1_epi8((char)literal->LastMask));
+
+    return (unsigned)_mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(head, _mm256_set1_epi8((char)literal->First)),
+                         _mm256_cmpeq_epi8(tail, _mm256_set1_epi8((char)literal->Last))));
+}
+
+/*  Finds the first occurrence with AVX2 instructions, 32 positions per iteration
+INPUT:
+    const literal_t *literal - pointer on literal structure
+    const unsigned char *text - pointer on the text
+    size_t size - the number of characters in the text, not less than the length of the literal
+RETURN:
+    size_t - position of the occurrence, size if there is none
+*/
+TARGET_AVX2 static size_t FindAvx2(const literal_t *literal, const unsigned char *text, size_t size)
+{
+    size_t count = size - literal->Length + 1;
+    size_t i;
+
+    for (i = 0; count - i >= 32; i += 32)
+    {
+        unsigned mask = GetEndsAvx2(literal, text + i);
+
+        for (; mask != 0; mask &= mask - 1)
+            if (IsLiteralAt(literal, text + i + GetLowestBit(mask)))
+                return i + GetLowestBit(mask);
+    }
+
+    return i + FindScalar(literal, text + i, size - i);
+}
+
+/*  Finds the last occurrence with AVX2 instructions, 32 positions per iteration
+INPUT:
+    const literal_t *literal - pointer on literal structure
+    const unsigned char *text - pointer on the text
+    size_t size - the number of characters in the text, not less than the length of the literal
+RETURN:
+    size_t - position of the occurrence, size if there is none
+*/
+TARGET_AVX2 static size_t FindLastAvx2(const literal_t *literal, const unsigned char *text, size_t size)
+{
+    size_t count = size - literal->Length + 1;
+    size_t found;
+
+    for (; count >= 32; count -= 32)
+    {
+        unsigned mask = GetEndsAvx2(literal, text + count - 32);
+
+        for (; mask != 0; mask &= ~(1u << GetHighestBit(mask)))
+            if (IsLiteralAt(literal, text + count - 32 + GetHighestBit(mask)))
+                return count - 32 + GetHighestBit(mask);
+    }
+
+    /* The positions before the blocks are left */
+    found = FindLastScalar(literal, text, count + literal->Length - 1);
+    return found < count ? found : size;
+}
+
+#endif // FINDER_X86
+
+/*  Chooses the searching functions for the instruction set of the processor
+INPUT:
+    find_func_t *find - the function finding the first occurrence
+    find_func_t *findLast - the function finding the last occurrence
+*/
+static void ChooseFinders(find_func_t *find, find_func_t *findLast)
+{
+#if defined(FINDER_X86) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        *find = FindAvx2;
+        *findLast = FindLastAvx2;
+        return;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        *find = FindSse2;
+        *findLast = FindLastSse2;
+        return;
+    }
+#elif defined(FINDER_X86) && defined(_MSC_VER)
+    int info[4];
+
+    __cpuid(info, 0);
+    if (info[0] >= 7)
+    {
+        int features[4];
+
+        /* AVX2 also needs the OS to save the YMM registers */
+        __cpuid(features, 1);
+        __cpuidex(info, 7, 0);
+        if ((features[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6 && (info[1] & (1 << 5)))
+        {
+            *find = FindAvx2;
+            *findLast = FindLastAvx2;
+            return;
+        }
+    }
+    __cpuid(info, 1);
+    if (info[3] & (1 << 26))
+    {
+        *find = FindSse2;
+        *findLast = FindLastSse2;
+        return;
+    }
+#endif
+
+    *find = FindScalar;
+    *findLast = FindLastScalar;
+}
+
+/*  Runs the chosen searching function
+INPUT:
+    const literal_t *literal - pointer on literal structure
+    const char *text - pointer on the text
+    size_t size - the number of characters in the text
+    int isLast - nonzero to find the last occurrence
+RETURN:
+    size_t - position of the occurrence, size if there is none
+*/
+static size_t RunFinder(const literal_t *literal, const char *text, size_t size, int isLast)
+{
+    static find_func_t find = NULL;
+    static find_func_t findLast = NULL;
+
+    if (size < literal->Length)
+        return size;
+
+    /* The choice is the same for every thread, so the race here is harmless */
+    if (find == NULL || findLast == NULL)
+    {
+        find_func_t first;
+        find_func_t last;
+
+        ChooseFinders(&first, &last);
+        findLast = last;
+        find = first;
+    }
+
+    return (isLast ? findLast : find)(literal, (const unsigned char *)text, size);
+}
+
+/*  Finds the first occurrence of the literal lying wholly in the text. The first
+    and the last characters of the literal are compared with a block of positions
+    at once and only the positions where both match are compared entirely.
+    The fastest available instruction set (AVX2, SSE2 or scalar) is chosen at runtime
+INPUT:
+    const literal_t *literal - pointer on literal structure
+    const char *text - pointer on the text
+    size_t size - the number of characters in the text
+RETURN:
+    size_t - position of the occurrence, size if there is none
+*/
+size_t FindLiteral(const literal_t *literal, const char *text, size_t size)
+{
+    return RunFinder(literal, text, size, 0);
+}
+
+/*  Finds the last occurrence of the literal lying wholly in the text in the same way
+INPUT:
+    const literal_t *literal - pointer on literal structure
+    const char *text - pointer on the text
+    size_t size - the number of characters in the text
+RETURN:
+    size_t - position of the occurrence, size if there is none
+*/
+size_t FindLastLiteral(const literal_t *literal, const char *text, size_t size)
+{
+    return RunFinder(literal, text, size, 1);
+}
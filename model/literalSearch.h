@@ -0,0 +1,54 @@
+#ifndef __LITERAL_SEARCH_H_INCLUDED
+#define __LITERAL_SEARCH_H_INCLUDED
+
+#include <stdlib.h>
+#include "modelTypes.h"
+
+/*  Searched sequence of characters. The case of the ASCII letters may be ignored,
+    the other characters, including the UTF-8 sequences, are compared as they are */
+typedef struct
+{
+    const char *Text;           /* The characters, not owned */
+    size_t Length;              /* The number of characters, at least one */
+    int IgnoreCase;             /* Nonzero if the ASCII letters match in either case */
+    unsigned char First;        /* The first character, lowered when the case is ignored */
+    unsigned char FirstMask;    /* Bit set in the text characters before they are compared with First */
+    unsigned char Last;         /* The last character, lowered when the case is ignored */
+    unsigned char LastMask;     /* Bit set in the text characters before they are compared with Last */
+} literal_t;
+
+/*  Prepares the searched sequence
+INPUT:
+    literal_t *literal - pointer on literal structure
+    const char *text - the characters, they must live while the literal is used
+    size_t length - the number of characters, at least one
+    int ignoreCase - nonzero if the case of the ASCII letters is ignored
+OUTPUT:
+    literal_t *literal - pointer on literal structure ready for the search
+*/
+void InitLiteral(literal_t *literal, const char *text, size_t length, int ignoreCase);
+
+/*  Finds the first occurrence of the literal lying wholly in the text. The first
+    and the last characters of the literal are compared with a block of positions
+    at once and only the positions where both match are compared entirely.
+    The fastest available instruction set (AVX2, SSE2 or scalar) is chosen at runtime
+INPUT:
+    const literal_t *literal - pointer on literal structure
+    const char *text - pointer on the text
+    size_t size - the number of characters in the text
+RETURN:
+    size_t - position of the occurrence, size if there is none
+*/
+size_t FindLiteral(const literal_t *literal, const char *text, size_t size);
+
+/*  Finds the last occurrence of the literal lying wholly in the text in the same way
+INPUT:
+    const literal_t *literal - pointer on literal structure
+    const char *text - pointer on the text
+    size_t size - the number of characters in the text
+RETURN:
+    size_t - position of the occurrence, size if there is none
+*/
+size_t FindLastLiteral(const literal_t *literal, const char *text, size_t size);
+
+#endif // __LITERAL_SEARCH_H_INCLUDED
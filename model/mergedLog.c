@@ -0,0 +1,453 @@
+#include "mergedLog.h"
+#include <limits.h>
+#include <string.h>
+
+#define NO_CHECKPOINT ((index_t)-1)     /* Row of the free checkpoint slot */
+
+/*  Initializes the merged log
+INPUT:
+    merged_log_t *merge - pointer on merged log structure
+OUTPUT:
+    merged_log_t *merge - pointer on merged log structure without files
+*/
+void InitMergedLog(merged_log_t *merge)
+{
+    merge->Sources = NULL;
+    merge->NumOfSources = 0;
+    merge->Format = TIME_ISO8601;
+    merge->NumOfRows = 0;
+    merge->CheckpointRows = NULL;
+    merge->Cursors = NULL;
+}
+
+/*  Frees the slots of all the cached checkpoints
+INPUT:
+    merged_log_t *merge - pointer on merged log structure
+*/
+static void DropCheckpoints(merged_log_t *merge)
+{
+    int slot;
+
+    for (slot = 0; slot < MERGE_CACHE; slot++)
+        merge->CheckpointRows[slot] = NO_CHECKPOINT;
+}
+
+/*  Copies the start of the file name without the directory as the tag of the file
+INPUT:
+    char *tag - buffer of MERGE_TAG_LENGTH characters
+    const char *name - the path of the file
+*/
+static void SetSourceTag(char *tag, const char *name)
+{
+    const char *start = name;
+    const char *c;
+
+    for (c = name; *c; c++)
+        if (*c == '\\' || *c == '/')
+            start = c + 1;
+
+    strncpy(tag, start, MERGE_TAG_LENGTH - 1);
+    tag[MERGE_TAG_LENGTH - 1] = 0;
+}
+
+/*  Starts loading the files in the background, every file notifies the window
+    with its own LoadId
+INPUT:
+    merged_log_t *merge - pointer on merged log structure without files
+    const char *const *names - the paths of the files
+    int count - the number of files, from 1 to MAX_MERGED_FILES
+    time_format_t format - format of the timestamps
+    int tabSize - the distance between the tab stops in columns
+    HWND hwnd - window receiving the notifications
+RETURN:
+    error_t - error code, the files opened so far are closed on failure, TOO_MANY_FILES
+              if there are more than MAX_MERGED_FILES files
+*/
+error_t OpenMergedLog(merged_log_t *merge, const char *const *names, int count, time_format_t format, int tabSize,
+                      HWND hwnd)
+{
+    int i;
+
+    if (count < 1 || count > MAX_MERGED_FILES)
+        return TOO_MANY_FILES;
+
+    merge->Sources = calloc((size_t)count, sizeof(merge_source_t));
+    merge->CheckpointRows = malloc(MERGE_CACHE * sizeof(index_t));
+    merge->Cursors = malloc((size_t)MERGE_CACHE * count * sizeof(merge_cursor_t));
+    if (merge->Sources == NULL || merge->CheckpointRows == NULL || merge->Cursors == NULL)
+    {
+        ClearMergedLog(merge);
+        return MEMORY_SHORTAGE;
+    }
+    DropCheckpoints(merge);
+    merge->Format = format;
+
+    for (i = 0; i < count; i++)
+    {
+        merge_source_t *source = &merge->Sources[i];
+        error_t error;
+
+        InitModel(&source->Model);
+        InitTimeIndex(&source->Times);
+        InitTimeIndex(&source->NextTimes);
+        SetModelTabSize(&source->Model, tabSize);
+        SetSourceTag(source->Tag, names[i]);
+        merge->NumOfSources = i + 1;
+
+        if ((error = FillModel(&source->Model, names[i], hwnd)) != SUCCESS)
+        {
+            ClearMergedLog(merge);
+            return error;
+        }
+        SetTimeIndexFormat(&source->Times, format);
+    }
+
+    return SUCCESS;
+}
+
+/*  Finds the file being loaded with the identifier
+INPUT:
+    const merged_log_t *merge - pointer on merged log structure
+    unsigned long loadId - identifier of the loading
+RETURN:
+    int - index of the file, -1 if there is none
+*/
+int FindMergedSource(const merged_log_t *merge, unsigned long loadId)
+{
+    int i;
+
+    for (i = 0; i < merge->NumOfSources; i++)
+        if (merge->Sources[i].Model.LoadId == loadId)
+            return i;
+
+    return -1;
+}
+
+/*  Locks the line indexes of all the files in the order of the files
+INPUT:
+    merged_log_t *merge - pointer on merged log structure
+*/
+void LockMergedLog(merged_log_t *merge)
+{
+    int i;
+
+    for (i = 0; i < merge->NumOfSources; i++)
+        LockModel(&merge->Sources[i].Model);
+}
+
+/*  Unlocks the line indexes locked by LockMergedLog
+INPUT:
+    merged_log_t *merge - pointer on merged log structure
+*/
+void UnlockMergedLog(merged_log_t *merge)
+{
+    int i;
+
+    for (i = merge->NumOfSources - 1; i >= 0; i--)
+        UnlockModel(&merge->Sources[i].Model);
+}
+
+/*  Sets the format of the timestamps, the files are merged again if it is new.
+    The files take their NextTimes sampled in the format, the others are sampled
+    by UpdateMergedLog
+INPUT:
+    merged_log_t *merge - pointer on locked merged log structure
+    time_format_t format - format of the timestamps
+*/
+void SetMergedLogFormat(merged_log_t *merge, time_format_t format)
+{
+    int i;
+
+    if (merge->NumOfSources == 0 || merge->Format == format)
+        return;
+
+    merge->Format = format;
+    DropCheckpoints(merge);
+    for (i = 0; i < merge->NumOfSources; i++)
+    {
+        merge_source_t *source = &merge->Sources[i];
+
+        if (HasTimeIndex(&source->NextTimes) && source->NextTimes.Format == format)
+        {
+            time_index_t times = source->Times;
+
+            source->Times = source->NextTimes;
+            source->NextTimes = times;
+        }
+        ClearTimeIndex(&source->NextTimes);
+        SetTimeIndexFormat(&source->Times, format);
+    }
+}
+
+/*  Samples the timestamps of the lines loaded since the last call. The cached
+    checkpoints are dropped when the number of lines changes
+INPUT:
+    merged_log_t *merge - pointer on locked merged log structure
+RETURN:
+    error_t - error code
+*/
+error_t UpdateMergedLog(merged_log_t *merge)
+{
+    index_t numOfRows = 0;
+    int i;
+
+    for (i = 0; i < merge->NumOfSources; i++)
+    {
+        error_t error = UpdateTimeIndex(&merge->Sources[i].Times, &merge->Sources[i].Model);
+
+        if (error != SUCCESS)
+            return error;
+        numOfRows += merge->Sources[i].Model.NumOfLines;
+    }
+
+    /* The appended lines may take the rows of any time */
+    if (numOfRows != merge->NumOfRows)
+    {
+        merge->NumOfRows = numOfRows;
+        DropCheckpoints(merge);
+    }
+
+    return SUCCESS;
+}
+
+/*  Finds the first line of the file with the merge key at or after the time. The
+    key reaches the time at the first line with the timestamp reaching it
+INPUT:
+    const merge_source_t *source - pointer on the file
+    timestamp_t time - the time
+RETURN:
+    index_t - index of the line, NumOfLines if every key is earlier
+*/
+static index_t FindSourceLine(const merge_source_t *source, timestamp_t time)
+{
+    index_t line;
+
+    /* The lines before the first timestamp have the least key */
+    if (time == LLONG_MIN)
+        return 0;
+    if (!FindTimeLine(&source->Times, &source->Model, time, &line))
+        return source->Model.NumOfLines;
+
+    return line;
+}
+
+/*  Counts the rows with the merge key before the time
+INPUT:
+    const merged_log_t *merge - pointer on merged log structure
+    timestamp_t time - the time
+RETURN:
+    index_t - the number of rows
+*/
+static index_t CountRowsBefore(const merged_log_t *merge, timestamp_t time)
+{
+    index_t count = 0;
+    int i;
+
+    for (i = 0; i < merge->NumOfSources; i++)
+        count += FindSourceLine(&merge->Sources[i], time);
+
+    return count;
+}
+
+/*  Places the cursors at the row without merging the rows before it. The key of
+    the row is the latest time with fewer rows before it, so it is found by the
+    binary search over the times. The rows with this key are taken in the order
+    of the files
+INPUT:
+    const merged_log_t *merge - pointer on merged log structure
+    index_t row - the row, less than NumOfRows
+    merge_cursor_t *cursors - NumOfSources cursors
+*/
+static void SeekRow(const merged_log_t *merge, index_t row, merge_cursor_t *cursors)
+{
+    timestamp_t low = LLONG_MIN;
+    timestamp_t high = LLONG_MAX;
+    index_t rest;
+    int i;
+
+    /* The lines before the first timestamps, all the lines of the files without them, are not searched */
+    if (CountRowsBefore(merge, LLONG_MIN + 1) > row)
+        high = LLONG_MIN;
+
+    /* The rows before LLONG_MIN are none, so the time stays at or after it */
+    while (low < high)
+    {
+        unsigned long long distance = (unsigned long long)high - (unsigned long long)low;
+        timestamp_t middle = (timestamp_t)((unsigned long long)low + distance / 2 + 1);
+
+        if (CountRowsBefore(merge, middle) <= row)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+
+    rest = row - CountRowsBefore(merge, low);
+    for (i = 0; i < merge->NumOfSources; i++)
+    {
+        const merge_source_t *source = &merge->Sources[i];
+        index_t first = FindSourceLine(source, low);
+        index_t end = low < LLONG_MAX ? FindSourceLine(source, low + 1) : source->Model.NumOfLines;
+        index_t taken = end - first < rest ? end - first : rest;
+
+        cursors[i].Line = first + taken;
+        if (taken > 0)
+            cursors[i].Key = low;
+        else if (cursors[i].Line == 0)
+            cursors[i].Key = LLONG_MIN;
+        else
+            cursors[i].Key = low - 1;
+        rest -= taken;
+    }
+}
+
+/*  Takes the row with the least merge key from the cursors
+INPUT:
+    const merged_log_t *merge - pointer on merged log structure
+    merge_cursor_t *cursors - NumOfSources cursors
+    merged_row_t *row - the row or NULL
+RETURN:
+    int - nonzero if the row is taken, zero at the end of the files
+*/
+static int NextRow(const merged_log_t *merge, merge_cursor_t *cursors, merged_row_t *row)
+{
+    int best = -1;
+    timestamp_t bestKey = 0;
+    int i;
+
+    for (i = 0; i < merge->NumOfSources; i++)
+    {
+        const merge_source_t *source = &merge->Sources[i];
+        timestamp_t key = cursors[i].Key;
+        timestamp_t time;
+
+        if (cursors[i].Line >= source->Model.NumOfLines)
+            continue;
+        if (ReadLineTime(&source->Times, &source->Model, cursors[i].Line, key < 0 ? -1 : key, &time) && time > key)
+            key = time;
+        if (best < 0 || key < bestKey)
+        {
+            best = i;
+            bestKey = key;
+        }
+    }
+
+    if (best < 0)
+        return 0;
+
+    if (row != NULL)
+    {
+        row->Source = best;
+        row->Line = cursors[best].Line;
+    }
+    cursors[best].Line++;
+    cursors[best].Key = bestKey;
+    return 1;
+}
+
+/*  Checks whether the cached checkpoint is at the lines of the cursors
+INPUT:
+    const merged_log_t *merge - pointer on merged log structure
+    size_t slot - the slot of the checkpoint
+    const merge_cursor_t *cursors - NumOfSources cursors
+RETURN:
+    int - nonzero if the lines are the same
+*/
+static int IsSameCheckpoint(const merged_log_t *merge, size_t slot, const merge_cursor_t *cursors)
+{
+    const merge_cursor_t *cached = merge->Cursors + slot * merge->NumOfSources;
+    int i;
+
+    for (i = 0; i < merge->NumOfSources; i++)
+        if (cached[i].Line != cursors[i].Line)
+            return 0;
+
+    return 1;
+}
+
+/*  Finds the consecutive rows
+INPUT:
+    merged_log_t *merge - pointer on locked and updated merged log structure
+    index_t row - the first row
+    merged_row_t *rows - array for the rows
+    index_t count - the number of rows
+RETURN:
+    index_t - the number of found rows, less than count at the end of the files
+*/
+index_t GetMergedRows(merged_log_t *merge, index_t row, merged_row_t *rows, index_t count)
+{
+    merge_cursor_t cursors[MAX_MERGED_FILES];
+    size_t cursorsSize = merge->NumOfSources * sizeof(merge_cursor_t);
+    index_t current = row / MERGE_STEP * MERGE_STEP;
+    index_t found = 0;
+    size_t slot = (size_t)(row / MERGE_STEP) & (MERGE_CACHE - 1);
+
+    if (merge->NumOfSources == 0 || row >= merge->NumOfRows)
+        return 0;
+
+    if (merge->CheckpointRows[slot] != current)
+    {
+        SeekRow(merge, current, merge->Cursors + slot * merge->NumOfSources);
+        merge->CheckpointRows[slot] = current;
+    }
+    memcpy(cursors, merge->Cursors + slot * merge->NumOfSources, cursorsSize);
+
+    while (found < count)
+    {
+        /* The merged rows reaching a checkpoint save the seek, a sought one not matching them is replaced */
+        if (current % MERGE_STEP == 0)
+        {
+            slot = (size_t)(current / MERGE_STEP) & (MERGE_CACHE - 1);
+            if (merge->CheckpointRows[slot] == NO_CHECKPOINT
+                || (merge->CheckpointRows[slot] == current && !IsSameCheckpoint(merge, slot, cursors)))
+            {
+                memcpy(merge->Cursors + slot * merge->NumOfSources, cursors, cursorsSize);
+                merge->CheckpointRows[slot] = current;
+            }
+        }
+
+        if (!NextRow(merge, cursors, current >= row ? &rows[found] : NULL))
+            break;
+        if (current >= row)
+            found++;
+        current++;
+    }
+
+    return found;
+}
+
+/*  Finds the first row with the merge key at or after the time
+INPUT:
+    const merged_log_t *merge - pointer on locked and updated merged log structure
+    timestamp_t time - the time
+RETURN:
+    index_t - the row, NumOfRows if every key is earlier
+*/
+index_t FindMergedTimeRow(const merged_log_t *merge, timestamp_t time)
+{
+    return CountRowsBefore(merge, time);
+}
+
+/*  Releases the merged log and closes the files
+INPUT:
+    merged_log_t *merge - pointer on merged log structure
+OUTPUT:
+    merged_log_t *merge - pointer on merged log structure without files
+*/
+void ClearMergedLog(merged_log_t *merge)
+{
+    int i;
+
+    if (merge == NULL)
+        return;
+
+    for (i = 0; i < merge->NumOfSources; i++)
+    {
+        ClearTimeIndex(&merge->Sources[i].Times);
+        ClearTimeIndex(&merge->Sources[i].NextTimes);
+        ClearModel(&merge->Sources[i].Model);
+    }
+    free(merge->Sources);
+    free(merge->CheckpointRows);
+    free(merge->Cursors);
+    InitMergedLog(merge);
+}
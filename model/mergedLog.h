@@ -0,0 +1,146 @@
+#ifndef __MERGED_LOG_H_INCLUDED
+#define __MERGED_LOG_H_INCLUDED
+
+#include "fileModel.h"
+#include "timeIndex.h"
+
+#define MAX_MERGED_FILES 64         /* The maximum number of merged files */
+#define MERGE_STEP 256              /* The number of rows between the merge checkpoints */
+#define MERGE_CACHE 4096            /* The number of cached merge checkpoints, a power of two */
+#define MERGE_TAG_LENGTH 12         /* Size of the name of the file shown before its rows, with the zero */
+
+/* Row of the merged files */
+typedef struct
+{
+    int Source;                 /* Index of the file */
+    index_t Line;               /* Index of the line in the file */
+} merged_row_t;
+
+/* Position of the merge in one file */
+typedef struct
+{
+    index_t Line;               /* The next line of the file */
+    timestamp_t Key;            /* Merge key of the line before it, LLONG_MIN before the first timestamp */
+} merge_cursor_t;
+
+/* One of the merged files */
+typedef struct
+{
+    model_t Model;                  /* The lines of the file */
+    time_index_t Times;             /* Timestamps of the sampled lines of the file */
+    time_index_t NextTimes;         /* Timestamps sampled in the background in another format */
+    char Tag[MERGE_TAG_LENGTH];     /* The start of the file name shown before its rows */
+} merge_source_t;
+
+/*  Lines of several files interleaved by their timestamps. The merge key of a
+    line is the latest timestamp of the file up to it, so the lines without
+    timestamps follow the line they continue and every file is in the order of
+    the keys. The rows are the lines in the order of the keys, the equal keys in
+    the order of the files. Such an order needs no merging from the first row:
+    the rows before a time are the lines of every file before its first line
+    at the time, found by the time index of the file, so the position of a row
+    is found by the binary search over the times. The positions of the rows every
+    MERGE_STEP rows are cached as merge checkpoints and the rows after them are
+    merged line by line, the merged rows check the sought checkpoints they reach */
+typedef struct
+{
+    merge_source_t *Sources;        /* The merged files */
+    int NumOfSources;               /* The number of files */
+    time_format_t Format;           /* Format of the timestamps of the files */
+    index_t NumOfRows;              /* The number of lines of the files when the checkpoints were taken */
+    index_t *CheckpointRows;        /* The row of every cached checkpoint, (index_t)-1 if the slot is free */
+    merge_cursor_t *Cursors;        /* NumOfSources cursors of every cached checkpoint */
+} merged_log_t;
+
+/*  Initializes the merged log
+INPUT:
+    merged_log_t *merge - pointer on merged log structure
+OUTPUT:
+    merged_log_t *merge - pointer on merged log structure without files
+*/
+void InitMergedLog(merged_log_t *merge);
+
+/*  Starts loading the files in the background, every file notifies the window
+    with its own LoadId
+INPUT:
+    merged_log_t *merge - pointer on merged log structure without files
+    const char *const *names - the paths of the files
+    int count - the number of files, from 1 to MAX_MERGED_FILES
+    time_format_t format - format of the timestamps
+    int tabSize - the distance between the tab stops in columns
+    HWND hwnd - window receiving the notifications
+RETURN:
+    error_t - error code, the files opened so far are closed on failure, TOO_MANY_FILES
+              if there are more than MAX_MERGED_FILES files
+*/
+error_t OpenMergedLog(merged_log_t *merge, const char *const *names, int count, time_format_t format, int tabSize,
+                      HWND hwnd);
+
+/*  Finds the file being loaded with the identifier
+INPUT:
+    const merged_log_t *merge - pointer on merged log structure
+    unsigned long loadId - identifier of the loading
+RETURN:
+    int - index of the file, -1 if there is none
+*/
+int FindMergedSource(const merged_log_t *merge, unsigned long loadId);
+
+/*  Locks the line indexes of all the files in the order of the files
+INPUT:
+    merged_log_t *merge - pointer on merged log structure
+*/
+void LockMergedLog(merged_log_t *merge);
+
+/*  Unlocks the line indexes locked by LockMergedLog
+INPUT:
+    merged_log_t *merge - pointer on merged log structure
+*/
+void UnlockMergedLog(merged_log_t *merge);
+
+/*  Sets the format of the timestamps, the files are merged again if it is new.
+    The files take their NextTimes sampled in the format, the others are sampled
+    by UpdateMergedLog
+INPUT:
+    merged_log_t *merge - pointer on locked merged log structure
+    time_format_t format - format of the timestamps
+*/
+void SetMergedLogFormat(merged_log_t *merge, time_format_t format);
+
+/*  Samples the timestamps of the lines loaded since the last call. The cached
+    checkpoints are dropped when the number of lines changes
+INPUT:
+    merged_log_t *merge - pointer on locked merged log structure
+RETURN:
+    error_t - error code
+*/
+error_t UpdateMergedLog(merged_log_t *merge);
+
+/*  Finds the consecutive rows
+INPUT:
+    merged_log_t *merge - pointer on locked and updated merged log structure
+    index_t row - the first row
+    merged_row_t *rows - array for the rows
+    index_t count - the number of rows
+RETURN:
+    index_t - the number of found rows, less than count at the end of the files
+*/
+index_t GetMergedRows(merged_log_t *merge, index_t row, merged_row_t *rows, index_t count);
+
+/*  Finds the first row with the merge key at or after the time
+INPUT:
+    const merged_log_t *merge - pointer on locked and updated merged log structure
+    timestamp_t time - the time
+RETURN:
+    index_t - the row, NumOfRows if every key is earlier
+*/
+index_t FindMergedTimeRow(const merged_log_t *merge, timestamp_t time);
+
+/*  Releases the merged log and closes the files
+INPUT:
+    merged_log_t *merge - pointer on merged log structure
+OUTPUT:
+    merged_log_t *merge - pointer on merged log structure without files
+*/
+void ClearMergedLog(merged_log_t *merge);
+
+#endif // __MERGED_LOG_H_INCLUDED
@@ -0,0 +1,19 @@
+#ifndef __MODEL_TYPES_H_INCLUDED
+#define __MODEL_TYPES_H_INCLUDED
+
+#include <stdint.h>
+
+/* Offset or size in characters, files are larger than 4 GB even where long is 32-bit */
+typedef unsigned long long offset_t;
+
+/* Index or number of lines and rows */
+typedef unsigned long long index_t;
+
+/*  Checks that the array of the elements fits in the address space
+INPUT:
+    count - the number of elements
+    size - the size of one element
+*/
+#define FITS_IN_MEMORY(count, size) ((count) <= SIZE_MAX / (size))
+
+#endif // __MODEL_TYPES_H_INCLUDED
@@ -0,0 +1,1759 @@
+#include "regexPattern.h"
+#include <string.h>
+#include <limits.h>
+
+#define MAX_PATTERN_DEPTH 256       /* The maximum nesting of the groups and the repetitions */
+#define REPEAT_INFINITE -1          /* Upper bound of the repetition without a limit */
+#define MIN_NODES 64                /* Initial number of nodes of the syntax tree */
+#define MATCHER_LIST_SPACE 16       /* The average number of instructions per cached state the matcher keeps */
+
+/* Kinds of the instructions */
+enum
+{
+    OP_CHAR,            /* Consumes a character of the byte set X */
+    OP_SPLIT,           /* Continues at both X and Y */
+    OP_JUMP,            /* Continues at X */
+    OP_LINE_START,      /* Passes only at the start of the line */
+    OP_LINE_END,        /* Passes only at the end of the line */
+    OP_MATCH,           /* The match ends here */
+};
+
+/* Kinds of the nodes of the syntax tree */
+enum
+{
+    NODE_EMPTY,         /* Matches the empty string */
+    NODE_CHAR,          /* Character of the byte set Left */
+    NODE_CONCAT,        /* Right items starting at Left in the items follow each other */
+    NODE_ALTER,         /* One of Right items starting at Left in the items */
+    NODE_REPEAT,        /* The node Left repeated from Min to Max times */
+    NODE_LINE_START,    /* ^ */
+    NODE_LINE_END,      /* $ */
+};
+
+/* Acceptance of the cached states */
+#define STATE_ACCEPTS 1             /* A match ends at the state */
+#define STATE_ACCEPTS_AT_END 2      /* A match ends at the state if the line ends there */
+
+/* Positions the instructions are added at */
+#define AT_LINE_START 1
+#define AT_LINE_END 2
+
+/* Node of the syntax tree */
+typedef struct
+{
+    int Type;           /* Kind of the node */
+    int Left;           /* The byte set, the first item or the repeated node */
+    int Right;          /* The number of items */
+    int Min;            /* The minimum number of repetitions */
+    int Max;            /* The maximum number of repetitions or REPEAT_INFINITE */
+    int Height;         /* The number of nodes on the longest path down from the node */
+} regex_node_t;
+
+/* Growing list of the nodes */
+typedef struct
+{
+    int *Items;         /* The nodes */
+    int Count;          /* The number of nodes */
+    int Capacity;       /* The number of allocated nodes */
+} node_list_t;
+
+/* State of the parsing of the regular expression */
+typedef struct
+{
+    const unsigned char *Text;  /* The expression */
+    size_t Length;              /* The number of characters of the expression */
+    size_t Pos;                 /* Position of the next character */
+    pattern_t *Pattern;         /* The pattern receiving the byte sets */
+    int SetsCapacity;           /* The number of allocated byte sets of the pattern */
+    regex_node_t *Nodes;        /* Nodes of the syntax tree */
+    int NumOfNodes;             /* The number of nodes */
+    int NodesCapacity;          /* The number of allocated nodes */
+    node_list_t Items;          /* Items of the concatenations and the alternatives one after another */
+    error_t Error;              /* The first error of the parsing */
+} regex_parser_t;
+
+/* Literal every match of a node contains */
+typedef struct
+{
+    int IsExact;                        /* Nonzero if every match is exactly Exact */
+    char Exact[MAX_REQUIRED_LENGTH];    /* The matched characters when IsExact is set */
+    size_t ExactLength;                 /* The number of exactly matched characters */
+    char Best[MAX_REQUIRED_LENGTH];     /* The longest known characters every match contains */
+    size_t BestLength;                  /* The number of the contained characters */
+} required_t;
+
+static int ParseAlternation(regex_parser_t *parser);
+
+/*  Adds the byte to the set
+INPUT:
+    byte_set_t *set - pointer on byte set
+    unsigned c - the byte
+*/
+static void AddToSet(byte_set_t *set, unsigned c)
+{
+    set->Bits[c >> 5] |= 1u << (c & 31);
+}
+
+/*  Checks whether the byte is in the set
+INPUT:
+    const byte_set_t *set - pointer on byte set
+    unsigned c - the byte
+RETURN:
+    int - nonzero if the byte is in the set
+*/
+static int IsInSet(const byte_set_t *set, unsigned c)
+{
+    return (set->Bits[c >> 5] >> (c & 31)) & 1;
+}
+
+/*  Adds the bytes from first to last to the set
+INPUT:
+    byte_set_t *set - pointer on byte set
+    unsigned first - the first byte
+    unsigned last - the last byte
+*/
+static void AddRangeToSet(byte_set_t *set, unsigned first, unsigned last)
+{
+    unsigned c;
+
+    for (c = first; c <= last; c++)
+        AddToSet(set, c);
+}
+
+/*  Adds the other case of every ASCII letter of the set
+INPUT:
+    byte_set_t *set - pointer on byte set
+*/
+static void FoldSetCase(byte_set_t *set)
+{
+    unsigned c;
+
+    for (c = 'a'; c <= 'z'; c++)
+        if (IsInSet(set, c) || IsInSet(set, c - 'a' + 'A'))
+        {
+            AddToSet(set, c);
+            AddToSet(set, c - 'a' + 'A');
+        }
+}
+
+/*  Finds the only character of the set
+INPUT:
+    const byte_set_t *set - pointer on byte set
+    int ignoreCase - nonzero if the two cases of a letter are one character
+RETURN:
+    int - the character, lowered when the case is ignored, or -1 if the set has another number of characters
+*/
+static int GetSingleChar(const byte_set_t *set, int ignoreCase)
+{
+    int first = -1;
+    int count = 0;
+    unsigned c;
+
+    for (c = 0; c < 256; c++)
+        if (IsInSet(set, c))
+        {
+            if (count++ == 0)
+                first = (int)c;
+        }
+
+    if (count == 1)
+        return first;
+    if (count == 2 && ignoreCase && first >= 'A' && first <= 'Z' && IsInSet(set, first - 'A' + 'a'))
+        return first - 'A' + 'a';
+    return -1;
+}
+
+/*  Appends the node to the list
+INPUT:
+    node_list_t *list - pointer on node list
+    int node - the node
+RETURN:
+    int - nonzero if the node is appended
+*/
+static int AddToList(node_list_t *list, int node)
+{
+    if (list->Count == list->Capacity)
+    {
+        int capacity = list->Capacity > 0 ? 2 * list->Capacity : 8;
+        int *tmp = realloc(list->Items, capacity * sizeof(int));
+
+        if (tmp == NULL)
+            return 0;
+        list->Items = tmp;
+        list->Capacity = capacity;
+    }
+
+    list->Items[list->Count++] = node;
+    return 1;
+}
+
+/*  Adds the byte set to the pattern, the same set is shared
+INPUT:
+    regex_parser_t *parser - pointer on parser structure
+    const byte_set_t *set - the byte set
+RETURN:
+    int - index of the set in the pattern or -1 if there is not enough memory
+*/
+static int AddSet(regex_parser_t *parser, const byte_set_t *set)
+{
+    pattern_t *pattern = parser->Pattern;
+    int i;
+
+    for (i = 0; i < pattern->NumOfSets; i++)
+        if (memcmp(&pattern->Sets[i], set, sizeof(byte_set_t)) == 0)
+            return i;
+
+    if (pattern->NumOfSets == parser->SetsCapacity)
+    {
+        int capacity = parser->SetsCapacity > 0 ? 2 * parser->SetsCapacity : 16;
+        byte_set_t *tmp = realloc(pattern->Sets, capacity * sizeof(byte_set_t));
+
+        if (tmp == NULL)
+        {
+            parser->Error = MEMORY_SHORTAGE;
+            return -1;
+        }
+        pattern->Sets = tmp;
+        parser->SetsCapacity = capacity;
+    }
+
+    pattern->Sets[pattern->NumOfSets] = *set;
+    return pattern->NumOfSets++;
+}
+
+/*  Creates the node of the syntax tree
+INPUT:
+    regex_parser_t *parser - pointer on parser structure
+    int type - kind of the node
+    int left - the byte set, the first item or the repeated node
+    int right - the number of items
+    int min - the minimum number of repetitions
+    int max - the maximum number of repetitions
+RETURN:
+    int - the node or -1 in case of error
+*/
+static int NewNode(regex_parser_t *parser, int type, int left, int right, int min, int max)
+{
+    regex_node_t *node;
+    int height = 0;
+    int i;
+
+    if (type == NODE_REPEAT)
+        height = parser->Nodes[left].Height;
+    else if (type == NODE_CONCAT || type == NODE_ALTER)
+        for (i = 0; i < right; i++)
+            if (parser->Nodes[parser->Items.Items[left + i]].Height > height)
+                height = parser->Nodes[parser->Items.Items[left + i]].Height;
+
+    /* The tree is walked recursively, so its depth is limited */
+    if (height >= MAX_PATTERN_DEPTH)
+    {
+        parser->Error = BAD_PATTERN;
+        return -1;
+    }
+
+    if (parser->NumOfNodes == parser->NodesCapacity)
+    {
+        int capacity = parser->NodesCapacity > 0 ? 2 * parser->NodesCapacity : MIN_NODES;
+        regex_node_t *tmp = realloc(parser->Nodes, capacity * sizeof(regex_node_t));
+
+        if (tmp == NULL)
+        {
+            parser->Error = MEMORY_SHORTAGE;
+            return -1;
+        }
+        parser->Nodes = tmp;
+        parser->NodesCapacity = capacity;
+    }
+
+    node = &parser->Nodes[parser->NumOfNodes];
+    node->Type = type;
+    node->Left = left;
+    node->Right = right;
+    node->Min = min;
+    node->Max = max;
+    node->Height = height + 1;
+    return parser->NumOfNodes++;
+}
+
+/*  Creates the node of the character of the byte set
+INPUT:
+    regex_parser_t *parser - pointer on parser structure
+    const byte_set_t *set - the byte set
+RETURN:
+    int - the node or -1 in case of error
+*/
+static int NewCharNode(regex_parser_t *parser, const byte_set_t *set)
+{
+    int index = AddSet(parser, set);
+
+    return index >= 0 ? NewNode(parser, NODE_CHAR, index, 0, 0, 0) : -1;
+}
+
+/*  Creates the concatenation or the alternative of the nodes of the list, the only node stays as it is
+INPUT:
+    regex_parser_t *parser - pointer on parser structure
+    int type - NODE_CONCAT or NODE_ALTER
+    const node_list_t *list - the nodes, at least one
+RETURN:
+    int - the node or -1 in case of error
+*/
+static int NewListNode(regex_parser_t *parser, int type, const node_list_t *list)
+{
+    int first = parser->Items.Count;
+    int i;
+
+    if (list->Count == 1)
+        return list->Items[0];
+
+    for (i = 0; i < list->Count; i++)
+        if (!AddToList(&parser->Items, list->Items[i]))
+        {
+            parser->Error = MEMORY_SHORTAGE;
+            return -1;
+        }
+
+    return NewNode(parser, type, first, list->Count, 0, 0);
+}
+
+/*  Creates the node of any character except the ASCII ones, it is a whole UTF-8 sequence
+INPUT:
+    regex_parser_t *parser - pointer on parser structure
+RETURN:
+    int - the node or -1 in case of error
+*/
+static int NewNonAsciiNode(regex_parser_t *parser)
+{
+    byte_set_t set;
+    node_list_t list = {NULL, 0, 0};
+    int lead, trail, node = -1;
+
+    memset(&set, 0, sizeof(set));
+    AddRangeToSet(&set, 0xC0, 0xFF);
+    lead = NewCharNode(parser, &set);
+
+    memset(&set, 0, sizeof(set));
+    AddRangeToSet(&set, 0x80, 0xBF);
+    trail = NewCharNode(parser, &set);
+    if (trail >= 0)
+        trail = NewNode(parser, NODE_REPEAT, trail, 0, 0, REPEAT_INFINITE);
+
+    if (lead >= 0 && trail >= 0)
+    {
+        if (AddToList(&list, lead) && AddToList(&list, trail))
+            node = NewListNode(parser, NODE_CONCAT, &list);
+        else
+            parser->Error = MEMORY_SHORTAGE;
+    }
+
+    free(list.Items);
+    return node;
+}
+
+/*  Creates the node matching the ASCII characters of the set and optionally any other character
+INPUT:
+    regex_parser_t *parser - pointer on parser structure
+    const byte_set_t *set - the ASCII characters
+    int hasNonAscii - nonzero if the non-ASCII characters match too
+RETURN:
+    int - the node or -1 in case of error
+*/
+static int NewClassNode(regex_parser_t *parser, const byte_set_t *set, int hasNonAscii)
+{
+    node_list_t list = {NULL, 0, 0};
+    int ascii = NewCharNode(parser, set);
+    int node = -1;
+
+    if (ascii < 0 || !hasNonAscii)
+        return ascii;
+
+    node = NewNonAsciiNode(parser);
+    if (node >= 0)
+    {
+        if (AddToList(&list, ascii) && AddToList(&list, node))
+            node = NewListNode(parser, NODE_ALTER, &list);
+        else
+        {
+            parser->Error = MEMORY_SHORTAGE;
+            node = -1;
+        }
+    }
+
+    free(list.Items);
+    return node;
+}
+
+/*  Gets the set of the class escape \d, \w or \s
+INPUT:
+    unsigned c - the letter of the escape in the lower case
+    byte_set_t *set - pointer on byte set receiving the characters
+RETURN:
+    int - nonzero if the letter is a class escape
+*/
+static int AddEscapeClass(unsigned c, byte_set_t *set)
+{
+    switch (c)
+    {
+        case 'd':
+            AddRangeToSet(set, '0', '9');
+            return 1;
+        case 'w':
+            AddRangeToSet(set, '0', '9');
+            AddRangeToSet(set, 'A', 'Z');
+            AddRangeToSet(set, 'a', 'z');
+            AddToSet(set, '_');
+            return 1;
+        case 's':
+            AddToSet(set, ' ');
+            AddRangeToSet(set, '\t', '\r');
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/*  Adds the ASCII characters not in the set, except the line break
+INPUT:
+    byte_set_t *set - pointer on byte set receiving the characters
+    const byte_set_t *excluded - the characters not added
+*/
+static void AddAsciiComplement(byte_set_t *set, const byte_set_t *excluded)
+{
+    unsigned c;
+
+    for (c = 0; c < 128; c++)
+        if (c != '\n' && !IsInSet(excluded, c))
+            AddToSet(set, c);
+}
+
+/*  Gets the character of the escape in the expression
+INPUT:
+    unsigned c - the character after the backslash
+RETURN:
+    unsigned - the escaped character
+*/
+static unsigned GetEscapedChar(unsigned c)
+{
+    switch (c)
+    {
+        case 't':
+            return '\t';
+        case 'n':
+            return '\n';
+        case 'r':
+            return '\r';
+        case 'f':
+            return '\f';
+        case 'v':
+            return '\v';
+        default:
+            return c;
+    }
+}
+
+/*  Adds the characters of the named class [:name:], the position is after [:
+INPUT:
+    regex_parser_t *parser - pointer on parser structure
+    byte_set_t *set - pointer on byte set receiving the characters
+RETURN:
+    int - nonzero if the class is known
+*/
+static int AddNamedClass(regex_parser_t *parser, byte_set_t *set)
+{
+    static const char *names[] = {"alpha", "digit", "alnum", "upper", "lower", "space", "blank",
+                                  "punct", "xdigit", "cntrl", "print", "graph"};
+    const char *name = (const char *)parser->Text + parser->Pos;
+    size_t rest = parser->Length - parser->Pos;
+    size_t i;
+    unsigned c;
+
+    for (i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        size_t length = strlen(names[i]);
+
+        if (rest >= length + 2 && memcmp(name, names[i], length) == 0 && name[length] == ':' &&
+            name[length + 1] == ']')
+        {
+            parser->Pos += length + 2;
+            break;
+        }
+    }
+    if (i == sizeof(names) / sizeof(names[0]))
+        return 0;
+
+    for (c = 0; c < 128; c++)
+    {
+        int isUpper = c >= 'A' && c <= 'Z';
+        int isLower = c >= 'a' && c <= 'z';
+        int isDigit = c >= '0' && c <= '9';
+        int isGraph = c > ' ' && c < 127;
+        int has = 0;
+
+        switch (i)
+        {
+            case 0: has = isUpper || isLower; break;
+            case 1: has = isDigit; break;
+            case 2: has = isUpper || isLower || isDigit; break;
+            case 3: has = isUpper; break;
+            case 4: has = isLower; break;
+            case 5: has = c == ' ' || (c >= '\t' && c <= '\r'); break;
+            case 6: has = c == ' ' || c == '\t'; break;
+            case 7: has = isGraph && !isUpper && !isLower && !isDigit; break;
+            case 8: has = isDigit || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'); break;
+            case 9: has = c < ' ' || c == 127; break;
+            case 10: has = isGraph || c == ' '; break;
+            case 11: has = isGraph; break;
+        }
+        if (has)
+            AddToSet(set, c);
+    }
+
+    return 1;
+}
+
+/*  Reads the UTF-8 sequence of the lead byte, a stray byte is a sequence of its own
+INPUT:
+    regex_parser_t *parser - pointer on parser structure, the position is after the lead byte
+    unsigned lead - the lead byte
+    node_list_t *list - pointer on node list receiving the nodes of the bytes
+RETURN:
+    int - nonzero on success
+*/
+static int ReadSequence(regex_parser_t *parser, unsigned lead, node_list_t *list)
+{
+    int count = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+    byte_set_t set;
+
+    for (;;)
+    {
+        int node;
+
+        memset(&set, 0, sizeof(set));
+        AddToSet(&set, lead);
+        node = NewCharNode(parser, &set);
+        if (node < 0)
+            return 0;
+        if (!AddToList(list, node))
+        {
+            parser->Error = MEMORY_SHORTAGE;
+            return 0;
+        }
+
+        if (count-- == 0 || parser->Pos == parser->Length ||
+            parser->Text[parser->Pos] < 0x80 || parser->Text[parser->Pos] >= 0xC0)
+            return 1;
+        lead = parser->Text[parser->Pos++];
+    }
+}
+
+/*  Parses the bracket expression, the position is after [
+INPUT:
+    regex_parser_t *parser - pointer on parser structure
+RETURN:
+    int - the node or -1 in case of error
+*/
+static int ParseBracket(regex_parser_t *parser)
+{
+    byte_set_t set;
+    byte_set_t ascii;
+    node_list_t items = {NULL, 0, 0};
+    node_list_t sequence = {NULL, 0, 0};
+    int isNegated = 0;
+    int hasNonAscii = 0;
+    int isFirst = 1;
+    int node = -1;
+
+    memset(&set, 0, sizeof(set));
+    if (parser->Pos < parser->Length && parser->Text[parser->Pos] == '^')
+    {
+        isNegated = 1;
+        parser->Pos++;
+    }
+
+    for (;;)
+    {
+        unsigned c;
+        unsigned last;
+
+        if (parser->Pos == parser->Length)
+        {
+            parser->Error = BAD_PATTERN;
+            goto done;
+        }
+
+        c = parser->Text[parser->Pos++];
+        if (c == ']' && !isFirst)
+            break;
+        isFirst = 0;
+
+        if (c == '[' && parser->Pos < parser->Length && parser->Text[parser->Pos] == ':')
+        {
+            parser->Pos++;
+            if (!AddNamedClass(parser, &set))
+            {
+                parser->Error = BAD_PATTERN;
+                goto done;
+            }
+            continue;
+        }
+
+        if (c == '\\')
+        {
+            byte_set_t escaped;
+
+            if (parser->Pos == parser->Length)
+            {
+                parser->Error = BAD_PATTERN;
+                goto done;
+            }
+            c = parser->Text[parser->Pos++];
+
+            memset(&escaped, 0, sizeof(escaped));
+            if (AddEscapeClass(c, &escaped))
+            {
+                AddEscapeClass(c, &set);
+                continue;
+            }
+            if (c >= 'A' && c <= 'Z' && AddEscapeClass(c - 'A' + 'a', &escaped))
+            {
+                AddAsciiComplement(&set, &escaped);
+                hasNonAscii = 1;
+                continue;
+            }
+            c = GetEscapedChar(c);
+        }
+
+        /* The non-ASCII characters are whole sequences, they cannot make ranges */
+        if (c >= 0x80)
+        {
+            sequence.Count = 0;
+            if (!ReadSequence(parser, c, &sequence) ||
+                (node = NewListNode(parser, NODE_CONCAT, &sequence)) < 0)
+                goto done;
+            if (!AddToList(&items, node))
+            {
+                parser->Error = MEMORY_SHORTAGE;
+                goto done;
+            }
+            node = -1;
+            continue;
+        }
+
+        last = c;
+        if (parser->Pos + 1 < parser->Length && parser->Text[parser->Pos] == '-' &&
+            parser->Text[parser->Pos + 1] != ']')
+        {
+            last = parser->Text[parser->Pos + 1];
+            parser->Pos += 2;
+            if (last == '\\' && parser->Pos < parser->Length)
+                last = GetEscapedChar(parser->Text[parser->Pos++]);
+            if (last >= 0x80 || last < c)
+            {
+                parser->Error = BAD_PATTERN;
+                goto done;
+            }
+        }
+        AddRangeToSet(&set, c, last);
+    }
+
+    if (parser->Pattern->IgnoreCase)
+        FoldSetCase(&set);
+
+    /* The negated class keeps only the ASCII characters out, the listed sequences are not excluded */
+    if (isNegated)
+    {
+        memset(&ascii, 0, sizeof(ascii));
+        AddAsciiComplement(&ascii, &set);
+        set = ascii;
+        hasNonAscii = !hasNonAscii;
+        items.Count = 0;
+    }
+
+    node = NewClassNode(parser, &set, hasNonAscii);
+    if (node >= 0 && items.Count > 0)
+    {
+        if (AddToList(&items, node))
+            node = NewListNode(parser, NODE_ALTER, &items);
+        else
+        {
+            parser->Error = MEMORY_SHORTAGE;
+            node = -1;
+        }
+    }
+
+done:
+    free(items.Items);
+    free(sequence.Items);
+    return parser->Error == SUCCESS ? node : -1;
+}
+
+/*  Parses the atom: a character, a class, a group or an anchor
+INPUT:
+    regex_parser_t *parser - pointer on parser structure
+RETURN:
+    int - the node or -1 in case of error
+*/
+static int ParseAtom(regex_parser_t *parser)
+{
+    byte_set_t set;
+    node_list_t sequence = {NULL, 0, 0};
+    unsigned c = parser->Text[parser->Pos++];
+    int node;
+
+    memset(&set, 0, sizeof(set));
+    switch (c)
+    {
+        case '(':
+            if (parser->Length - parser->Pos >= 2 && parser->Text[parser->Pos] == '?' &&
+                parser->Text[parser->Pos + 1] == ':')
+                parser->Pos += 2;
+            node = ParseAlternation(parser);
+            if (node < 0)
+                return -1;
+            if (parser->Pos == parser->Length || parser->Text[parser->Pos] != ')')
+            {
+                parser->Error = BAD_PATTERN;
+                return -1;
+            }
+            parser->Pos++;
+            return node;
+        case '[':
+            return ParseBracket(parser);
+        case '.':
+            AddAsciiComplement(&set, &set);
+            return NewClassNode(parser, &set, 1);
+        case '^':
+            return NewNode(parser, NODE_LINE_START, 0, 0, 0, 0);
+        case '$':
+            return NewNode(parser, NODE_LINE_END, 0, 0, 0, 0);
+        case '*':
+        case '+':
+        case '?':
+        case ')':
+            parser->Error = BAD_PATTERN;
+            return -1;
+        case '\\':
+            if (parser->Pos == parser->Length)
+            {
+                parser->Error = BAD_PATTERN;
+                return -1;
+            }
+            c = parser->Text[parser->Pos++];
+            if (AddEscapeClass(c, &set))
+                return NewCharNode(parser, &set);
+            if (c >= 'A' && c <= 'Z' && AddEscapeClass(c - 'A' + 'a', &set))
+            {
+                byte_set_t complement;
+
+                memset(&complement, 0, sizeof(complement));
+                AddAsciiComplement(&complement, &set);
+                return NewClassNode(parser, &complement, 1);
+            }
+            c = GetEscapedChar(c);
+            break;
+        default:
+            break;
+    }
+
+    if (c >= 0x80)
+    {
+        node = ReadSequence(parser, c, &sequence) ? NewListNode(parser, NODE_CONCAT, &sequence) : -1;
+        free(sequence.Items);
+        return node;
+    }
+
+    AddToSet(&set, c);
+    if (parser->Pattern->IgnoreCase)
+        FoldSetCase(&set);
+    return NewCharNode(parser, &set);
+}
+
+/*  Reads the number of the bound
+INPUT:
+    regex_parser_t *parser - pointer on parser structure
+    size_t *pos - position of the number, it is moved after it
+    int *number - the number, it is not read beyond MAX_PATTERN_REPEAT + 1
+RETURN:
+    int - nonzero if there is a number
+*/
+static int ReadBound(const regex_parser_t *parser, size_t *pos, int *number)
+{
+    size_t start = *pos;
+
+    *number = 0;
+    while (*pos < parser->Length && parser->Text[*pos] >= '0' && parser->Text[*pos] <= '9')
+    {
+        if (*number <= MAX_PATTERN_REPEAT)
+            *number = *number * 10 + (parser->Text[*pos] - '0');
+        (*pos)++;
+    }
+
+    return *pos > start;
+}
+
+/*  Parses the atom with the following repetitions. The brace not starting
+    a valid bound {n}, {n,} or {n,m} is an ordinary character
+INPUT:
+    regex_parser_t *parser - pointer on parser structure
+RETURN:
+    int - the node or -1 in case of error
+*/
+static int ParseRepeat(regex_parser_t *parser)
+{
+    int node = ParseAtom(parser);
+
+    while (node >= 0 && parser->Pos < parser->Length)
+    {
+        unsigned c = parser->Text[parser->Pos];
+        int min, max;
+
+        if (c == '*' || c == '+' || c == '?')
+        {
+            min = c == '+' ? 1 : 0;
+            max = c == '?' ? 1 : REPEAT_INFINITE;
+            parser->Pos++;
+        }
+        else if (c == '{')
+        {
+            size_t pos = parser->Pos + 1;
+
+            if (!ReadBound(parser, &pos, &min))
+                break;
+            max = min;
+            if (pos < parser->Length && parser->Text[pos] == ',')
+            {
+                pos++;
+                if (!ReadBound(parser, &pos, &max))
+                    max = REPEAT_INFINITE;
+            }
+            if (pos == parser->Length || parser->Text[pos] != '}')
+                break;
+            parser->Pos = pos + 1;
+
+            if (min > MAX_PATTERN_REPEAT || max > MAX_PATTERN_REPEAT || (max != REPEAT_INFINITE && max < min))
+            {
+                parser->Error = BAD_PATTERN;
+                return -1;
+            }
+        }
+        else
+            break;
+
+        node = NewNode(parser, NODE_REPEAT, node, 0, min, max);
+    }
+
+    return node;
+}
+
+/*  Parses the concatenation, it ends before | or ) or at the end of the expression
+INPUT:
+    regex_parser_t *parser - pointer on parser structure
+RETURN:
+    int - the node or -1 in case of error
+*/
+static int ParseConcat(regex_parser_t *parser)
+{
+    node_list_t list = {NULL, 0, 0};
+    int node = 0;
+
+    while (node >= 0 && parser->Pos < parser->Length && parser->Text[parser->Pos] != '|' &&
+           parser->Text[parser->Pos] != ')')
+    {
+        node = ParseRepeat(parser);
+        if (node >= 0 && !AddToList(&list, node))
+        {
+            parser->Error = MEMORY_SHORTAGE;
+            node = -1;
+        }
+    }
+
+    if (node >= 0)
+        node = list.Count > 0 ? NewListNode(parser, NODE_CONCAT, &list) : NewNode(parser, NODE_EMPTY, 0, 0, 0, 0);
+
+    free(list.Items);
+    return node;
+}
+
+/*  Parses the alternatives separated by |
+INPUT:
+    regex_parser_t *parser - pointer on parser structure
+RETURN:
+    int - the node or -1 in case of error
+*/
+static int ParseAlternation(regex_parser_t *parser)
+{
+    node_list_t list = {NULL, 0, 0};
+    int node;
+
+    for (;;)
+    {
+        node = ParseConcat(parser);
+        if (node < 0)
+            break;
+        if (!AddToList(&list, node))
+        {
+            parser->Error = MEMORY_SHORTAGE;
+            node = -1;
+            break;
+        }
+
+        if (parser->Pos == parser->Length || parser->Text[parser->Pos] != '|')
+        {
+            node = NewListNode(parser, NODE_ALTER, &list);
+            break;
+        }
+        parser->Pos++;
+    }
+
+    free(list.Items);
+    return node;
+}
+
+/*  Counts the instructions of the node
+INPUT:
+    const regex_parser_t *parser - pointer on parser structure
+    int node - the node
+RETURN:
+    long long - the number of instructions, it is not counted beyond MAX_PATTERN_OPS
+*/
+static long long CountOps(const regex_parser_t *parser, int node)
+{
+    const regex_node_t *cur = &parser->Nodes[node];
+    long long count = 0;
+    long long child;
+    int i;
+
+    switch (cur->Type)
+    {
+        case NODE_CHAR:
+        case NODE_LINE_START:
+        case NODE_LINE_END:
+            return 1;
+        case NODE_CONCAT:
+        case NODE_ALTER:
+            for (i = 0; i < cur->Right && count <= MAX_PATTERN_OPS; i++)
+                count += CountOps(parser, parser->Items.Items[cur->Left + i]);
+            return cur->Type == NODE_ALTER ? count + 2 * (cur->Right - 1) : count;
+        case NODE_REPEAT:
+            child = CountOps(parser, cur->Left);
+            if (child > MAX_PATTERN_OPS)
+                return child;
+            if (cur->Max == REPEAT_INFINITE)
+                return cur->Min == 0 ? child + 2 : cur->Min * child + 1;
+            return cur->Min * child + (long long)(cur->Max - cur->Min) * (child + 1);
+        default:
+            return 0;
+    }
+}
+
+/*  Appends the instruction to the pattern, the space is reserved beforehand
+INPUT:
+    pattern_t *pattern - pointer on pattern structure
+    int type - kind of the instruction
+    int x - the byte set or the first target
+    int y - the second target
+RETURN:
+    int - index of the instruction
+*/
+static int AddOp(pattern_t *pattern, int type, int x, int y)
+{
+    pattern_op_t *op = &pattern->Ops[pattern->NumOfOps];
+
+    op->Type = type;
+    op->X = x;
+    op->Y = y;
+    return pattern->NumOfOps++;
+}
+
+/*  Appends the instructions of the node to the pattern. The targets
+    which are not known yet link the instructions waiting for them
+INPUT:
+    pattern_t *pattern - pointer on pattern structure
+    const regex_parser_t *parser - pointer on parser structure
+    int node - the node
+*/
+static void EmitNode(pattern_t *pattern, const regex_parser_t *parser, int node)
+{
+    const regex_node_t *cur = &parser->Nodes[node];
+    int waiting = -1;
+    int loop;
+    int i;
+
+    switch (cur->Type)
+    {
+        case NODE_CHAR:
+            AddOp(pattern, OP_CHAR, cur->Left, 0);
+            break;
+        case NODE_LINE_START:
+            AddOp(pattern, OP_LINE_START, 0, 0);
+            break;
+        case NODE_LINE_END:
+            AddOp(pattern, OP_LINE_END, 0, 0);
+            break;
+        case NODE_CONCAT:
+            for (i = 0; i < cur->Right; i++)
+                EmitNode(pattern, parser, parser->Items.Items[cur->Left + i]);
+            break;
+        case NODE_ALTER:
+            /* Every alternative but the last one is tried by a split and jumps to the end */
+            for (i = 0; i < cur->Right - 1; i++)
+            {
+                int split = AddOp(pattern, OP_SPLIT, pattern->NumOfOps + 1, 0);
+
+                EmitNode(pattern, parser, parser->Items.Items[cur->Left + i]);
+                waiting = AddOp(pattern, OP_JUMP, waiting, 0);
+                pattern->Ops[split].Y = pattern->NumOfOps;
+            }
+            EmitNode(pattern, parser, parser->Items.Items[cur->Left + cur->Right - 1]);
+            while (waiting >= 0)
+            {
+                int previous = pattern->Ops[waiting].X;
+
+                pattern->Ops[waiting].X = pattern->NumOfOps;
+                waiting = previous;
+            }
+            break;
+        case NODE_REPEAT:
+            if (cur->Max == REPEAT_INFINITE && cur->Min == 0)
+            {
+                loop = AddOp(pattern, OP_SPLIT, pattern->NumOfOps + 1, 0);
+                EmitNode(pattern, parser, cur->Left);
+                AddOp(pattern, OP_JUMP, loop, 0);
+                pattern->Ops[loop].Y = pattern->NumOfOps;
+                break;
+            }
+
+            for (i = 0; i < cur->Min; i++)
+            {
+                loop = pattern->NumOfOps;
+                EmitNode(pattern, parser, cur->Left);
+            }
+            if (cur->Max == REPEAT_INFINITE)
+            {
+                AddOp(pattern, OP_SPLIT, loop, pattern->NumOfOps + 1);
+                break;
+            }
+
+            /* Every optional copy may be skipped to the end */
+            for (i = cur->Min; i < cur->Max; i++)
+            {
+                waiting = AddOp(pattern, OP_SPLIT, pattern->NumOfOps + 1, waiting);
+                EmitNode(pattern, parser, cur->Left);
+            }
+            while (waiting >= 0)
+            {
+                int previous = pattern->Ops[waiting].Y;
+
+                pattern->Ops[waiting].Y = pattern->NumOfOps;
+                waiting = previous;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/*  Keeps the characters if they are longer than the best known ones
+INPUT:
+    required_t *required - pointer on required literal structure
+    const char *text - the characters
+    size_t length - the number of characters
+*/
+static void UpdateBest(required_t *required, const char *text, size_t length)
+{
+    if (length > required->BestLength)
+    {
+        memcpy(required->Best, text, length);
+        required->BestLength = length;
+    }
+}
+
+/*  Finds the literal every match of the node contains
+INPUT:
+    const pattern_t *pattern - pointer on pattern structure
+    const regex_parser_t *parser - pointer on parser structure
+    int node - the node
+    required_t *required - pointer on required literal structure receiving the literal
+*/
+static void FindRequired(const pattern_t *pattern, const regex_parser_t *parser, int node, required_t *required)
+{
+    const regex_node_t *cur = &parser->Nodes[node];
+    required_t item;
+    int c, i;
+
+    required->IsExact = 0;
+    required->ExactLength = 0;
+    required->BestLength = 0;
+
+    switch (cur->Type)
+    {
+        case NODE_CHAR:
+            c = GetSingleChar(&pattern->Sets[cur->Left], pattern->IgnoreCase);
+            if (c >= 0)
+            {
+                required->IsExact = 1;
+                required->Exact[0] = (char)c;
+                required->ExactLength = 1;
+                UpdateBest(required, required->Exact, 1);
+            }
+            break;
+        case NODE_EMPTY:
+        case NODE_LINE_START:
+        case NODE_LINE_END:
+            required->IsExact = 1;
+            break;
+        case NODE_CONCAT:
+            /* The exact items following each other make one run of characters */
+            required->IsExact = 1;
+            for (i = 0; i < cur->Right; i++)
+            {
+                FindRequired(pattern, parser, parser->Items.Items[cur->Left + i], &item);
+                if (item.IsExact && required->ExactLength + item.ExactLength <= MAX_REQUIRED_LENGTH)
+                {
+                    memcpy(required->Exact + required->ExactLength, item.Exact, item.ExactLength);
+                    required->ExactLength += item.ExactLength;
+                    continue;
+                }
+
+                UpdateBest(required, required->Exact, required->ExactLength);
+                UpdateBest(required, item.Best, item.BestLength);
+                required->IsExact = 0;
+                required->ExactLength = 0;
+                if (item.IsExact)
+                {
+                    memcpy(required->Exact, item.Exact, item.ExactLength);
+                    required->ExactLength = item.ExactLength;
+                }
+            }
+            UpdateBest(required, required->Exact, required->ExactLength);
+            break;
+        case NODE_REPEAT:
+            if (cur->Min == 0)
+                break;
+            FindRequired(pattern, parser, cur->Left, &item);
+            UpdateBest(required, item.Best, item.BestLength);
+            if (item.IsExact)
+            {
+                /* The exact repetitions are as many copies of the characters as fit */
+                for (i = 0; i < cur->Min && required->ExactLength + item.ExactLength <= MAX_REQUIRED_LENGTH; i++)
+                {
+                    memcpy(required->Exact + required->ExactLength, item.Exact, item.ExactLength);
+                    required->ExactLength += item.ExactLength;
+                }
+                required->IsExact = i == cur->Min && cur->Max == cur->Min;
+                UpdateBest(required, required->Exact, required->ExactLength);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/*  Splits the bytes on the classes, the bytes of a class are in the same byte sets
+INPUT:
+    pattern_t *pattern - pointer on pattern structure
+*/
+static void SplitClasses(pattern_t *pattern)
+{
+    int map[2 * 256];
+    int numOfClasses = 1;
+    int i;
+    unsigned c;
+
+    memset(pattern->Classes, 0, sizeof(pattern->Classes));
+    for (i = 0; i < pattern->NumOfSets; i++)
+    {
+        int count = 0;
+
+        /* Every class is split on the bytes in the set and out of it */
+        for (c = 0; c < 2 * (unsigned)numOfClasses; c++)
+            map[c] = -1;
+        for (c = 0; c < 256; c++)
+        {
+            int key = 2 * pattern->Classes[c] + IsInSet(&pattern->Sets[i], c);
+
+            if (map[key] < 0)
+                map[key] = count++;
+            pattern->Classes[c] = (unsigned char)map[key];
+        }
+        numOfClasses = count;
+    }
+
+    pattern->NumOfClasses = numOfClasses;
+}
+
+/*  Initializes the pattern
+INPUT:
+    pattern_t *pattern - pointer on pattern structure
+OUTPUT:
+    pattern_t *pattern - pointer on pattern structure without instructions
+*/
+void InitPattern(pattern_t *pattern)
+{
+    pattern->Ops = NULL;
+    pattern->NumOfOps = 0;
+    pattern->Sets = NULL;
+    pattern->NumOfSets = 0;
+    memset(pattern->Classes, 0, sizeof(pattern->Classes));
+    pattern->NumOfClasses = 1;
+    pattern->IgnoreCase = 0;
+    pattern->RequiredLength = 0;
+}
+
+/*  Compiles the regular expression. The syntax is the POSIX extended one:
+    . [] [^] * + ? {n,m} | () ^ $, the classes \d \w \s \D \W \S and [:name:],
+    and \ before a special character. The dot and the negated classes match
+    a whole UTF-8 sequence, the non-ASCII characters listed in a negated class
+    are not excluded from it
+INPUT:
+    pattern_t *pattern - pointer on initialized pattern structure
+    const char *text - the regular expression in UTF-8
+    size_t length - the number of characters of the expression
+    int ignoreCase - nonzero if the case of the ASCII letters is ignored
+OUTPUT:
+    pattern_t *pattern - pointer on compiled pattern structure
+RETURN:
+    error_t - error code, BAD_PATTERN if the expression is not valid
+*/
+error_t CompilePattern(pattern_t *pattern, const char *text, size_t length, int ignoreCase)
+{
+    regex_parser_t parser;
+    required_t required;
+    long long numOfOps = 0;
+    int root = -1;
+
+    ClearPattern(pattern);
+    if (length == 0 || length > MAX_PATTERN_LENGTH)
+        return BAD_PATTERN;
+    pattern->IgnoreCase = ignoreCase;
+
+    parser.Text = (const unsigned char *)text;
+    parser.Length = length;
+    parser.Pos = 0;
+    parser.Pattern = pattern;
+    parser.SetsCapacity = 0;
+    parser.Nodes = NULL;
+    parser.NumOfNodes = 0;
+    parser.NodesCapacity = 0;
+    parser.Items.Items = NULL;
+    parser.Items.Count = 0;
+    parser.Items.Capacity = 0;
+    parser.Error = SUCCESS;
+
+    root = ParseAlternation(&parser);
+    /* Only an unmatched parenthesis stops the parsing before the end */
+    if (root >= 0 && parser.Pos < parser.Length)
+        parser.Error = BAD_PATTERN;
+
+    if (parser.Error == SUCCESS)
+    {
+        numOfOps = CountOps(&parser, root) + 1;
+        if (numOfOps > MAX_PATTERN_OPS)
+            parser.Error = BAD_PATTERN;
+    }
+    if (parser.Error == SUCCESS && (pattern->Ops = malloc((size_t)numOfOps * sizeof(pattern_op_t))) == NULL)
+        parser.Error = MEMORY_SHORTAGE;
+
+    if (parser.Error == SUCCESS)
+    {
+        EmitNode(pattern, &parser, root);
+        AddOp(pattern, OP_MATCH, 0, 0);
+
+        FindRequired(pattern, &parser, root, &required);
+        memcpy(pattern->Required, required.Best, required.BestLength);
+        pattern->RequiredLength = required.BestLength;
+        SplitClasses(pattern);
+    }
+
+    free(parser.Nodes);
+    free(parser.Items.Items);
+    if (parser.Error != SUCCESS)
+        ClearPattern(pattern);
+
+    return parser.Error;
+}
+
+/*  Releases the compiled pattern
+INPUT:
+    pattern_t *pattern - pointer on pattern structure
+OUTPUT:
+    pattern_t *pattern - pointer on pattern structure without instructions
+*/
+void ClearPattern(pattern_t *pattern)
+{
+    if (pattern == NULL)
+        return;
+
+    free(pattern->Ops);
+    free(pattern->Sets);
+    InitPattern(pattern);
+}
+
+/*  Starts the new generation of the marks, the instructions added before it can be added again
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+*/
+static void NextGeneration(pattern_matcher_t *matcher)
+{
+    if (matcher->Generation == INT_MAX)
+    {
+        memset(matcher->Marks, 0, matcher->Pattern->NumOfOps * sizeof(int));
+        matcher->Generation = 0;
+    }
+    matcher->Generation++;
+}
+
+/*  Adds the instruction and the ones following it without consuming characters to the list.
+    The instructions added in the current generation are skipped. The line end which
+    is not known to be reached is kept in the list as it is
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+    int pc - the instruction
+    int where - AT_LINE_START and AT_LINE_END flags of the position
+    int *list - the list
+    int *count - the number of instructions in the list
+*/
+static void AddClosure(pattern_matcher_t *matcher, int pc, int where, int *list, int *count)
+{
+    const pattern_op_t *ops = matcher->Pattern->Ops;
+    int *stack = matcher->Stack;
+    int depth = 0;
+
+    stack[depth++] = pc;
+    while (depth > 0)
+    {
+        pc = stack[--depth];
+        if (matcher->Marks[pc] == matcher->Generation)
+            continue;
+        matcher->Marks[pc] = matcher->Generation;
+
+        switch (ops[pc].Type)
+        {
+            case OP_JUMP:
+                stack[depth++] = ops[pc].X;
+                break;
+            case OP_SPLIT:
+                stack[depth++] = ops[pc].Y;
+                stack[depth++] = ops[pc].X;
+                break;
+            case OP_LINE_START:
+                if (where & AT_LINE_START)
+                    stack[depth++] = pc + 1;
+                break;
+            case OP_LINE_END:
+                if (where & AT_LINE_END)
+                    stack[depth++] = pc + 1;
+                else
+                    list[(*count)++] = pc;
+                break;
+            default:
+                list[(*count)++] = pc;
+                break;
+        }
+    }
+}
+
+/*  Compares the instructions for qsort
+INPUT:
+    const void *a - pointer on the first instruction
+    const void *b - pointer on the second instruction
+RETURN:
+    int - the order of the instructions
+*/
+static int CompareOps(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/*  Drops all cached states
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+*/
+static void DropStates(pattern_matcher_t *matcher)
+{
+    matcher->NumOfStates = 0;
+    matcher->StartState = -1;
+    matcher->ListsSize = 0;
+    memset(matcher->Hash, 0, 2 * MATCHER_STATES * sizeof(int));
+}
+
+/*  Finds the acceptance of the state with the instructions
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+    const int *list - the instructions of the state
+    int count - the number of instructions
+RETURN:
+    unsigned char - STATE_ACCEPTS and STATE_ACCEPTS_AT_END flags
+*/
+static unsigned char GetAcceptance(pattern_matcher_t *matcher, const int *list, int count)
+{
+    const pattern_op_t *ops = matcher->Pattern->Ops;
+    int *ends = matcher->Threads[0];
+    int numOfEnds = 0;
+    int i;
+
+    for (i = 0; i < count; i++)
+        if (ops[list[i]].Type == OP_MATCH)
+            return STATE_ACCEPTS | STATE_ACCEPTS_AT_END;
+
+    /* The kept line ends pass at the end of the line */
+    NextGeneration(matcher);
+    for (i = 0; i < count; i++)
+        if (ops[list[i]].Type == OP_LINE_END)
+            AddClosure(matcher, list[i] + 1, AT_LINE_END, ends, &numOfEnds);
+    for (i = 0; i < numOfEnds; i++)
+        if (ops[ends[i]].Type == OP_MATCH)
+            return STATE_ACCEPTS_AT_END;
+
+    return 0;
+}
+
+/*  Finds the cached state with the sorted instructions or caches the new one
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+    const int *list - the instructions of the state
+    int count - the number of instructions
+RETURN:
+    int - the state or -1 if the cache is full
+*/
+static int AddState(pattern_matcher_t *matcher, const int *list, int count)
+{
+    unsigned long hash = 2166136261u;
+    unsigned long mask = 2 * MATCHER_STATES - 1;
+    unsigned long slot;
+    int numOfClasses = matcher->Pattern->NumOfClasses;
+    int state;
+    int i;
+
+    for (i = 0; i < count; i++)
+        hash = ((hash ^ (unsigned long)list[i]) * 16777619u) & 0xFFFFFFFFu;
+
+    for (slot = hash & mask; matcher->Hash[slot] != 0; slot = (slot + 1) & mask)
+    {
+        state = matcher->Hash[slot] - 1;
+        if (matcher->ListLengths[state] == count &&
+            memcmp(matcher->Lists + matcher->ListStarts[state], list, count * sizeof(int)) == 0)
+            return state;
+    }
+
+    if (matcher->NumOfStates == MATCHER_STATES || matcher->ListsSize + count > matcher->ListsCapacity)
+        return -1;
+
+    state = matcher->NumOfStates++;
+    memcpy(matcher->Lists + matcher->ListsSize, list, count * sizeof(int));
+    matcher->ListStarts[state] = matcher->ListsSize;
+    matcher->ListLengths[state] = count;
+    matcher->ListsSize += count;
+    matcher->Hash[slot] = state + 1;
+    for (i = 0; i < numOfClasses; i++)
+        matcher->Next[state * numOfClasses + i] = -1;
+    matcher->Flags[state] = GetAcceptance(matcher, list, count);
+
+    return state;
+}
+
+/*  Caches the state of the instructions of the work list, the full cache is dropped first
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+    int count - the number of instructions of the work list
+RETURN:
+    int - the state
+*/
+static int AddWorkState(pattern_matcher_t *matcher, int count)
+{
+    int state;
+
+    qsort(matcher->Work, count, sizeof(int), CompareOps);
+    state = AddState(matcher, matcher->Work, count);
+    if (state < 0)
+    {
+        DropStates(matcher);
+        state = AddState(matcher, matcher->Work, count);
+    }
+
+    return state;
+}
+
+/*  Gets the state at the start of the line
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+RETURN:
+    int - the state
+*/
+static int GetStartState(pattern_matcher_t *matcher)
+{
+    int count = 0;
+
+    if (matcher->StartState < 0)
+    {
+        NextGeneration(matcher);
+        AddClosure(matcher, 0, AT_LINE_START, matcher->Work, &count);
+        matcher->StartState = AddWorkState(matcher, count);
+    }
+
+    return matcher->StartState;
+}
+
+/*  Builds the transition of the state by the byte class. A match may start
+    at every position, so the first instruction is added to every state
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+    int state - the state
+    int byteClass - the class of the consumed byte
+RETURN:
+    int - the next state, the cache may be dropped to hold it
+*/
+static int BuildNext(pattern_matcher_t *matcher, int state, int byteClass)
+{
+    const pattern_t *pattern = matcher->Pattern;
+    const int *list = matcher->Lists + matcher->ListStarts[state];
+    int length = matcher->ListLengths[state];
+    unsigned c = 0;
+    int count = 0;
+    int next;
+    int i;
+
+    while (pattern->Classes[c] != byteClass)
+        c++;
+
+    NextGeneration(matcher);
+    for (i = 0; i < length; i++)
+        if (pattern->Ops[list[i]].Type == OP_CHAR && IsInSet(&pattern->Sets[pattern->Ops[list[i]].X], c))
+            AddClosure(matcher, list[i] + 1, 0, matcher->Work, &count);
+    AddClosure(matcher, 0, 0, matcher->Work, &count);
+
+    next = AddWorkState(matcher, count);
+    /* The dropped cache has no state to keep the transition in, the start state is dropped with it */
+    if (matcher->StartState >= 0)
+        matcher->Next[state * pattern->NumOfClasses + byteClass] = next;
+
+    return next;
+}
+
+/*  Prepares the matcher of the compiled pattern
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+    const pattern_t *pattern - the compiled pattern, it must live while the matcher is used
+RETURN:
+    error_t - error code
+*/
+error_t InitMatcher(pattern_matcher_t *matcher, const pattern_t *pattern)
+{
+    size_t numOfOps = (size_t)pattern->NumOfOps;
+
+    matcher->Pattern = pattern;
+    matcher->ListsCapacity = MATCHER_STATES * MATCHER_LIST_SPACE + numOfOps;
+    matcher->Next = malloc(MATCHER_STATES * pattern->NumOfClasses * sizeof(int));
+    matcher->Flags = malloc(MATCHER_STATES);
+    matcher->Lists = malloc(matcher->ListsCapacity * sizeof(int));
+    matcher->ListStarts = malloc(MATCHER_STATES * sizeof(size_t));
+    matcher->ListLengths = malloc(MATCHER_STATES * sizeof(int));
+    matcher->Hash = malloc(2 * MATCHER_STATES * sizeof(int));
+    matcher->Marks = calloc(numOfOps, sizeof(int));
+    matcher->Generation = 0;
+    matcher->Stack = malloc((2 * numOfOps + 1) * sizeof(int));
+    matcher->Work = malloc(numOfOps * sizeof(int));
+    matcher->Threads[0] = malloc(numOfOps * sizeof(int));
+    matcher->Threads[1] = malloc(numOfOps * sizeof(int));
+    matcher->Starts[0] = malloc(numOfOps * sizeof(size_t));
+    matcher->Starts[1] = malloc(numOfOps * sizeof(size_t));
+
+    if (matcher->Next == NULL || matcher->Flags == NULL || matcher->Lists == NULL ||
+        matcher->ListStarts == NULL || matcher->ListLengths == NULL || matcher->Hash == NULL ||
+        matcher->Marks == NULL || matcher->Stack == NULL || matcher->Work == NULL ||
+        matcher->Threads[0] == NULL || matcher->Threads[1] == NULL ||
+        matcher->Starts[0] == NULL || matcher->Starts[1] == NULL)
+    {
+        ClearMatcher(matcher);
+        return MEMORY_SHORTAGE;
+    }
+
+    DropStates(matcher);
+    return SUCCESS;
+}
+
+/*  Checks whether the line contains a match. Every character is examined once
+    by the cached deterministic automaton
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+    const char *line - the characters of the line without the line break
+    size_t length - the number of characters of the line
+RETURN:
+    int - nonzero if the line contains a match
+*/
+int IsLineMatched(pattern_matcher_t *matcher, const char *line, size_t length)
+{
+    const unsigned char *text = (const unsigned char *)line;
+    const unsigned char *classes = matcher->Pattern->Classes;
+    int numOfClasses = matcher->Pattern->NumOfClasses;
+    int state;
+    size_t i;
+
+    /* The empty line is the start and the end at once, the states know only one of them */
+    if (length == 0)
+    {
+        int count = 0;
+        int j;
+
+        NextGeneration(matcher);
+        AddClosure(matcher, 0, AT_LINE_START | AT_LINE_END, matcher->Work, &count);
+        for (j = 0; j < count; j++)
+            if (matcher->Pattern->Ops[matcher->Work[j]].Type == OP_MATCH)
+                return 1;
+        return 0;
+    }
+
+    state = GetStartState(matcher);
+    for (i = 0; i < length; i++)
+    {
+        int next;
+
+        if (matcher->Flags[state] & STATE_ACCEPTS)
+            return 1;
+
+        next = matcher->Next[state * numOfClasses + classes[text[i]]];
+        state = next >= 0 ? next : BuildNext(matcher, state, classes[text[i]]);
+    }
+
+    return matcher->Flags[state] != 0;
+}
+
+/*  Adds the thread of the instruction and the ones following it without consuming characters
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+    int list - the list of threads, 0 or 1
+    int *count - the number of threads in the list
+    int pc - the instruction
+    size_t start - start of the match the threads follow
+    int where - AT_LINE_START and AT_LINE_END flags of the position
+*/
+static void AddThreads(pattern_matcher_t *matcher, int list, int *count, int pc, size_t start, int where)
+{
+    int first = *count;
+
+    AddClosure(matcher, pc, where, matcher->Threads[list], count);
+    for (; first < *count; first++)
+        matcher->Starts[list][first] = start;
+}
+
+/*  Gets the flags of the position in the line
+INPUT:
+    size_t pos - the position
+    size_t length - the number of characters of the line
+RETURN:
+    int - AT_LINE_START and AT_LINE_END flags
+*/
+static int GetPlace(size_t pos, size_t length)
+{
+    return (pos == 0 ? AT_LINE_START : 0) | (pos == length ? AT_LINE_END : 0);
+}
+
+/*  Finds the leftmost match starting at the position or after it, the longest one
+    of the matches starting there
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+    const char *line - the characters of the line without the line break
+    size_t length - the number of characters of the line
+    size_t from - position the match may start at
+    size_t *start - position of the match
+    size_t *matchLength - the number of characters of the match, it may be 0
+RETURN:
+    int - nonzero if a match is found
+*/
+int MatchLine(pattern_matcher_t *matcher, const char *line, size_t length, size_t from, size_t *start,
+              size_t *matchLength)
+{
+    const pattern_t *pattern = matcher->Pattern;
+    const unsigned char *text = (const unsigned char *)line;
+    size_t bestStart = 0;
+    size_t bestEnd = 0;
+    int isFound = 0;
+    int cur = 0;
+    int count = 0;
+    size_t pos;
+
+    /* The threads are kept in the order of their starts, so the earliest start takes the instruction */
+    NextGeneration(matcher);
+    AddThreads(matcher, cur, &count, 0, from, GetPlace(from, length));
+    for (pos = from;; pos++)
+    {
+        const int *threads = matcher->Threads[cur];
+        const size_t *starts = matcher->Starts[cur];
+        int nextCount = 0;
+        int i;
+
+        for (i = 0; i < count; i++)
+            if (pattern->Ops[threads[i]].Type == OP_MATCH &&
+                (!isFound || starts[i] < bestStart || (starts[i] == bestStart && pos > bestEnd)))
+            {
+                isFound = 1;
+                bestStart = starts[i];
+                bestEnd = pos;
+            }
+        if (pos == length)
+            break;
+
+        /* The threads starting after the found match cannot give a better one */
+        NextGeneration(matcher);
+        for (i = 0; i < count && (!isFound || starts[i] <= bestStart); i++)
+        {
+            const pattern_op_t *op = &pattern->Ops[threads[i]];
+
+            if (op->Type == OP_CHAR && IsInSet(&pattern->Sets[op->X], text[pos]))
+                AddThreads(matcher, 1 - cur, &nextCount, threads[i] + 1, starts[i], GetPlace(pos + 1, length));
+        }
+        if (!isFound)
+            AddThreads(matcher, 1 - cur, &nextCount, 0, pos + 1, GetPlace(pos + 1, length));
+
+        cur = 1 - cur;
+        count = nextCount;
+        if (count == 0)
+            break;
+    }
+
+    if (isFound)
+    {
+        *start = bestStart;
+        *matchLength = bestEnd - bestStart;
+    }
+    return isFound;
+}
+
+/*  Releases the matcher
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+*/
+void ClearMatcher(pattern_matcher_t *matcher)
+{
+    if (matcher == NULL)
+        return;
+
+    free(matcher->Next);
+    free(matcher->Flags);
+    free(matcher->Lists);
+    free(matcher->ListStarts);
+    free(matcher->ListLengths);
+    free(matcher->Hash);
+    free(matcher->Marks);
+    free(matcher->Stack);
+    free(matcher->Work);
+    free(matcher->Threads[0]);
+    free(matcher->Threads[1]);
+    free(matcher->Starts[0]);
+    free(matcher->Starts[1]);
+
+    matcher->Next = NULL;
+    matcher->Flags = NULL;
+    matcher->Lists = NULL;
+    matcher->ListStarts = NULL;
+    matcher->ListLengths = NULL;
+    matcher->Hash = NULL;
+    matcher->Marks = NULL;
+    matcher->Stack = NULL;
+    matcher->Work = NULL;
+    matcher->Threads[0] = matcher->Threads[1] = NULL;
+    matcher->Starts[0] = matcher->Starts[1] = NULL;
+}
@@ -0,0 +1,142 @@
+#ifndef __REGEX_PATTERN_H_INCLUDED
+#define __REGEX_PATTERN_H_INCLUDED
+
+#include <stdlib.h>
+#include "../error/error.h"
+#include "modelTypes.h"
+
+#define MAX_PATTERN_LENGTH 4096     /* The maximum number of characters of the pattern */
+#define MAX_PATTERN_OPS 32768       /* The maximum number of instructions of the compiled pattern */
+#define MAX_PATTERN_REPEAT 1000     /* The maximum bound of the {n,m} repetition */
+#define MAX_REQUIRED_LENGTH 64      /* The maximum length of the literal required in every match */
+#define MATCHER_STATES 1024         /* The number of cached states of the matcher, all are dropped when they are used up */
+
+/* Set of bytes, one bit per byte */
+typedef struct
+{
+    unsigned int Bits[256 / 32];
+} byte_set_t;
+
+/* Instruction of the compiled pattern */
+typedef struct
+{
+    int Type;       /* Kind of the instruction */
+    int X;          /* The byte set of the character, the target of the jump or the first target of the split */
+    int Y;          /* The second target of the split */
+} pattern_op_t;
+
+/*  Regular expression compiled to a nondeterministic automaton. Every line of
+    the text is matched separately, so ^ and $ are the line start and end.
+    The case of the ASCII letters may be ignored, the other characters,
+    including the UTF-8 sequences, are compared as they are */
+typedef struct
+{
+    pattern_op_t *Ops;                      /* The instructions, the first one starts the match */
+    int NumOfOps;                           /* The number of instructions, 0 if there is no pattern */
+    byte_set_t *Sets;                       /* Byte sets of the characters */
+    int NumOfSets;                          /* The number of byte sets */
+    unsigned char Classes[256];             /* Class of every byte, the bytes of a class are in the same sets */
+    int NumOfClasses;                       /* The number of byte classes */
+    int IgnoreCase;                         /* Nonzero if the ASCII letters match in either case */
+    char Required[MAX_REQUIRED_LENGTH];     /* Characters every match contains, lowered when the case is ignored */
+    size_t RequiredLength;                  /* The number of required characters, 0 if none are known */
+} pattern_t;
+
+/*  Matcher of the lines with the pattern. The states of the deterministic automaton
+    are built as the text needs them and cached. One matcher is used by one thread */
+typedef struct
+{
+    const pattern_t *Pattern;   /* The matched pattern */
+    int *Next;                  /* Transitions of the cached states by the byte classes, -1 if not built yet */
+    unsigned char *Flags;       /* Acceptance of the cached states */
+    int *Lists;                 /* Instructions of the cached states one after another */
+    size_t ListsSize;           /* The number of used elements of Lists */
+    size_t ListsCapacity;       /* The number of allocated elements of Lists */
+    size_t *ListStarts;         /* Position of the instructions of every state in Lists */
+    int *ListLengths;           /* The number of instructions of every state */
+    int *Hash;                  /* Open addressing table of the states by their instructions, state + 1 or 0 */
+    int NumOfStates;            /* The number of cached states */
+    int StartState;             /* The state at the line start or -1 if it is not cached */
+    int *Marks;                 /* Generation every instruction was last added at */
+    int Generation;             /* The current generation of Marks */
+    int *Stack;                 /* Instructions waiting to be added */
+    int *Work;                  /* Instructions of the state being built */
+    int *Threads[2];            /* Instructions of the threads at the current and the next position */
+    size_t *Starts[2];          /* Start of the match every thread follows */
+} pattern_matcher_t;
+
+/*  Initializes the pattern
+INPUT:
+    pattern_t *pattern - pointer on pattern structure
+OUTPUT:
+    pattern_t *pattern - pointer on pattern structure without instructions
+*/
+void InitPattern(pattern_t *pattern);
+
+/*  Compiles the regular expression. The syntax is the POSIX extended one:
+    . [] [^] * + ? {n,m} | () ^ $, the classes \d \w \s \D \W \S and [:name:],
+    and \ before a special character. The dot and the negated classes match
+    a whole UTF-8 sequence, the non-ASCII characters listed in a negated class
+    are not excluded from it
+INPUT:
+    pattern_t *pattern - pointer on initialized pattern structure
+    const char *text - the regular expression in UTF-8
+    size_t length - the number of characters of the expression
+    int ignoreCase - nonzero if the case of the ASCII letters is ignored
+OUTPUT:
+    pattern_t *pattern - pointer on compiled pattern structure
+RETURN:
+    error_t - error code, BAD_PATTERN if the expression is not valid
+*/
+error_t CompilePattern(pattern_t *pattern, const char *text, size_t length, int ignoreCase);
+
+/*  Releases the compiled pattern
+INPUT:
+    pattern_t *pattern - pointer on pattern structure
+OUTPUT:
+    pattern_t *pattern - pointer on pattern structure without instructions
+*/
+void ClearPattern(pattern_t *pattern);
+
+/*  Prepares the matcher of the compiled pattern
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+    const pattern_t *pattern - the compiled pattern, it must live while the matcher is used
+RETURN:
+    error_t - error code
+*/
+error_t InitMatcher(pattern_matcher_t *matcher, const pattern_t *pattern);
+
+/*  Checks whether the line contains a match. Every character is examined once
+    by the cached deterministic automaton
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+    const char *line - the characters of the line without the line break
+    size_t length - the number of characters of the line
+RETURN:
+    int - nonzero if the line contains a match
+*/
+int IsLineMatched(pattern_matcher_t *matcher, const char *line, size_t length);
+
+/*  Finds the leftmost match starting at the position or after it, the longest one
+    of the matches starting there
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+    const char *line - the characters of the line without the line break
+    size_t length - the number of characters of the line
+    size_t from - position the match may start at
+    size_t *start - position of the match
+    size_t *matchLength - the number of characters of the match, it may be 0
+RETURN:
+    int - nonzero if a match is found
+*/
+int MatchLine(pattern_matcher_t *matcher, const char *line, size_t length, size_t from, size_t *start,
+              size_t *matchLength);
+
+/*  Releases the matcher
+INPUT:
+    pattern_matcher_t *matcher - pointer on matcher structure
+*/
+void ClearMatcher(pattern_matcher_t *matcher);
+
+#endif // __REGEX_PATTERN_H_INCLUDED
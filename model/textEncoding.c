@@ -0,0 +1,888 @@
+#include "textEncoding.h"
+#include "blockCache.h"
+#include "utf8Columns.h"
+#include "../thread/threadPool.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define TRANSCODER_X86
+    #include <emmintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#endif
+
+#ifdef __GNUC__
+    #define TARGET_SSE2 __attribute__((target("sse2")))
+#else
+    #define TARGET_SSE2
+#endif
+
+#define VECTOR_SIZE 16          /* The number of input characters checked by one vector compare */
+#define LOOKBEHIND 2            /* The input characters before the chunk needed to find a split surrogate pair */
+#define LOOKAHEAD 4             /* The input characters after the chunk needed to finish its last character */
+#define MIN_OUTS 256            /* Initial number of remembered output offsets */
+#define NUM_OF_LETTERS 10       /* The number of frequent letters counted to tell the code pages apart */
+#define UTF8_MARGIN 8           /* Minimum number of valid UTF-8 sequences per damaged one */
+
+/* Transcoding function of the particular instruction set, the characters of the
+   chunk are converted, the characters up to available may be looked at */
+typedef size_t (*transcode_func_t)(const transcoded_file_t *file, const unsigned char *in, size_t size, size_t available,
+                                   char *out);
+
+/* Characters 0x80-0xFF of the Windows Cyrillic code page */
+static const unsigned short cp1251Chars[128] =
+{
+    0x0402, 0x0403, 0x201A, 0x0453, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x20AC, 0x2030, 0x0409, 0x2039, 0x040A, 0x040C, 0x040B, 0x040F,
+    0x0452, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0xFFFD, 0x2122, 0x0459, 0x203A, 0x045A, 0x045C, 0x045B, 0x045F,
+    0x00A0, 0x040E, 0x045E, 0x0408, 0x00A4, 0x0490, 0x00A6, 0x00A7,
+    0x0401, 0x00A9, 0x0404, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x0407,
+    0x00B0, 0x00B1, 0x0406, 0x0456, 0x0491, 0x00B5, 0x00B6, 0x00B7,
+    0x0451, 0x2116, 0x0454, 0x00BB, 0x0458, 0x0405, 0x0455, 0x0457,
+    0x0410, 0x0411, 0x0412, 0x0413, 0x0414, 0x0415, 0x0416, 0x0417,
+    0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E, 0x041F,
+    0x0420, 0x0421, 0x0422, 0x0423, 0x0424, 0x0425, 0x0426, 0x0427,
+    0x0428, 0x0429, 0x042A, 0x042B, 0x042C, 0x042D, 0x042E, 0x042F,
+    0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+    0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F,
+    0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+    0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+};
+
+/* Characters 0x80-0xFF of the KOI8-R code page */
+static const unsigned short koi8rChars[128] =
+{
+    0x2500, 0x2502, 0x250C, 0x2510, 0x2514, 0x2518, 0x251C, 0x2524,
+    0x252C, 0x2534, 0x253C, 0x2580, 0x2584, 0x2588, 0x258C, 0x2590,
+    0x2591, 0x2592, 0x2593, 0x2320, 0x25A0, 0x2219, 0x221A, 0x2248,
+    0x2264, 0x2265, 0x00A0, 0x2321, 0x00B0, 0x00B2, 0x00B7, 0x00F7,
+    0x2550, 0x2551, 0x2552, 0x0451, 0x2553, 0x2554, 0x2555, 0x2556,
+    0x2557, 0x2558, 0x2559, 0x255A, 0x255B, 0x255C, 0x255D, 0x255E,
+    0x255F, 0x2560, 0x2561, 0x0401, 0x2562, 0x2563, 0x2564, 0x2565,
+    0x2566, 0x2567, 0x2568, 0x2569, 0x256A, 0x256B, 0x256C, 0x00A9,
+    0x044E, 0x0430, 0x0431, 0x0446, 0x0434, 0x0435, 0x0444, 0x0433,
+    0x0445, 0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E,
+    0x043F, 0x044F, 0x0440, 0x0441, 0x0442, 0x0443, 0x0436, 0x0432,
+    0x044C, 0x044B, 0x0437, 0x0448, 0x044D, 0x0449, 0x0447, 0x044A,
+    0x042E, 0x0410, 0x0411, 0x0426, 0x0414, 0x0415, 0x0424, 0x0413,
+    0x0425, 0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E,
+    0x041F, 0x042F, 0x0420, 0x0421, 0x0422, 0x0423, 0x0416, 0x0412,
+    0x042C, 0x042B, 0x0417, 0x0428, 0x042D, 0x0429, 0x0427, 0x042A,
+};
+
+/* The most frequent Russian lowercase letters: o, e, a, i, n, t, s, r, v, l */
+static const unsigned short frequentLetters[NUM_OF_LETTERS] =
+{
+    0x043E, 0x0435, 0x0430, 0x0438, 0x043D, 0x0442, 0x0441, 0x0440, 0x0432, 0x043B,
+};
+
+/*  Returns the table of the code page
+INPUT:
+    encoding_t encoding - single-byte encoding
+RETURN:
+    const unsigned short * - characters 0x80-0xFF of the code page
+*/
+static const unsigned short *GetCodePage(encoding_t encoding)
+{
+    return encoding == ENCODING_KOI8R ? koi8rChars : cp1251Chars;
+}
+
+/*  Writes the character as UTF-8
+INPUT:
+    unsigned long code - code point of the character
+    char *out - buffer of at least four characters
+RETURN:
+    size_t - the number of written characters
+*/
+static size_t EncodeUtf8(unsigned long code, char *out)
+{
+    if (code < 0x80)
+    {
+        out[0] = (char)code;
+        return 1;
+    }
+    if (code < 0x800)
+    {
+        out[0] = (char)(0xC0 | code >> 6);
+        out[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+    }
+    if (code < 0x10000)
+    {
+        out[0] = (char)(0xE0 | code >> 12);
+        out[1] = (char)(0x80 | (code >> 6 & 0x3F));
+        out[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | code >> 18);
+    out[1] = (char)(0x80 | (code >> 12 & 0x3F));
+    out[2] = (char)(0x80 | (code >> 6 & 0x3F));
+    out[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+/*  Fills the UTF-8 sequences of the characters of the code page
+INPUT:
+    encoded_char_t *page - array of 256 sequences
+    const unsigned short *table - characters 0x80-0xFF of the code page
+*/
+static void BuildCodePage(encoded_char_t *page, const unsigned short *table)
+{
+    int i;
+
+    for (i = 0; i < 256; i++)
+    {
+        memset(page[i].Bytes, 0, sizeof(page[i].Bytes));
+        page[i].Length = (unsigned char)EncodeUtf8(i < 0x80 ? (unsigned long)i : table[i - 0x80], page[i].Bytes);
+    }
+}
+
+/*  Reads one UTF-16 code unit
+INPUT:
+    const unsigned char *in - pointer on the unit
+    int isBigEndian - nonzero if the high byte goes first
+RETURN:
+    unsigned long - the code unit
+*/
+static unsigned long GetUnit(const unsigned char *in, int isBigEndian)
+{
+    return isBigEndian ? (unsigned long)in[0] << 8 | in[1] : (unsigned long)in[1] << 8 | in[0];
+}
+
+/*  Converts the UTF-16 units starting before stop, a surrogate pair starting
+    at the last unit is finished from the characters after stop. A CR not
+    followed by LF ends the line alone, so it becomes LF
+INPUT:
+    const unsigned char *in - pointer on the beginning of the chunk
+    size_t pos - offset of the first unit
+    size_t stop - offset where the conversion stops
+    size_t available - the number of characters that may be looked at
+    int isBigEndian - nonzero if the high byte goes first
+    char **out - pointer on the output, moved past the written characters
+RETURN:
+    size_t - offset of the unit after the converted ones
+*/
+static size_t ConvertUtf16(const unsigned char *in, size_t pos, size_t stop, size_t available,
+                           int isBigEndian, char **out)
+{
+    char *cur = *out;   /* The output is kept in a local, so the stores cannot change it */
+
+    while (pos + 2 <= stop)
+    {
+        unsigned long code = GetUnit(in + pos, isBigEndian);
+
+        pos += 2;
+        /* The ASCII and two-character sequences are written without branching on the length */
+        if (code < 0x800 && code != '\r')
+        {
+            int isLong = code >= 0x80;
+
+            cur[0] = (char)(isLong ? 0xC0 | code >> 6 : code);
+            cur[1] = (char)(0x80 | (code & 0x3F));
+            cur += 1 + isLong;
+            continue;
+        }
+        if (code >= 0xD800 && code < 0xE000)
+        {
+            unsigned long low = pos + 2 <= available ? GetUnit(in + pos, isBigEndian) : 0;
+
+            if (code < 0xDC00 && low >= 0xDC00 && low < 0xE000)
+            {
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                pos += 2;
+            }
+            else
+                code = REPLACEMENT_CHAR;
+        }
+        else if (code == '\r' && (pos + 2 > available || GetUnit(in + pos, isBigEndian) != '\n'))
+            code = '\n';
+
+        cur += EncodeUtf8(code, cur);
+    }
+
+    *out = cur;
+    return pos;
+}
+
+/*  Converts the characters of the single-byte code page starting before stop. The
+    sequences are taken from the table whole, so the mix of ASCII and other letters
+    costs no branches
+INPUT:
+    const encoded_char_t *page - UTF-8 sequences of the characters of the code page
+    const unsigned char *in - pointer on the beginning of the chunk
+    size_t pos - offset of the first character
+    size_t stop - offset where the conversion stops
+    size_t available - the number of characters that may be looked at
+    char **out - pointer on the output, moved past the written characters
+*/
+static void ConvertBytes(const encoded_char_t *page, const unsigned char *in, size_t pos, size_t stop,
+                         size_t available, char **out)
+{
+    char *cur = *out;   /* The output is kept in a local, so the stores cannot change it */
+
+    for (; pos < stop; pos++)
+    {
+        const encoded_char_t *encoded = &page[in[pos]];
+
+        /* The output bound leaves room for the whole array after the last character */
+        memcpy(cur, encoded->Bytes, sizeof(encoded->Bytes));
+        cur += encoded->Length;
+        if (in[pos] == '\r' && (pos + 1 >= available || in[pos + 1] != '\n'))
+            cur[-1] = '\n';
+    }
+
+    *out = cur;
+}
+
+/*  Copies the UTF-8 chunk and turns every CR not followed by LF into LF
+INPUT:
+    const unsigned char *in - pointer on the beginning of the chunk
+    size_t size - the number of characters in the chunk
+    size_t available - the number of characters that may be looked at
+    char *out - buffer of size characters
+RETURN:
+    size_t - the number of written characters
+*/
+static size_t CopyUtf8Cr(const unsigned char *in, size_t size, size_t available, char *out)
+{
+    char *cr = out;
+    char *end = out + size;
+
+    memcpy(out, in, size);
+    while ((cr = memchr(cr, '\r', end - cr)) != NULL)
+    {
+        size_t pos = cr - out;
+
+        if (pos + 1 >= available || in[pos + 1] != '\n')
+            *cr = '\n';
+        cr++;
+    }
+
+    return size;
+}
+
+/*  Transcodes the chunk one character after another
+INPUT:
+    const transcoded_file_t *file - pointer on opened transcoded file structure
+    const unsigned char *in - pointer on the beginning of the chunk
+    size_t size - the number of characters in the chunk
+    size_t available - the number of characters that may be looked at
+    char *out - buffer of the maximal output size of the chunk
+RETURN:
+    size_t - the number of written characters
+*/
+static size_t TranscodeScalar(const transcoded_file_t *file, const unsigned char *in, size_t size, size_t available,
+                              char *out)
+{
+    char *start = out;
+
+    if (file->Encoding == ENCODING_UTF8_CR)
+        return CopyUtf8Cr(in, size, available, out);
+
+    if (file->Encoding == ENCODING_UTF16LE || file->Encoding == ENCODING_UTF16BE)
+        ConvertUtf16(in, 0, size, available, file->Encoding == ENCODING_UTF16BE, &out);
+    else
+        ConvertBytes(file->Page, in, 0, size, available, &out);
+
+    return out - start;
+}
+
+#ifdef TRANSCODER_X86
+/*  Transcodes the chunk with SSE2. The blocks of ASCII characters without CR
+    are stored as they are (UTF-16 units are packed to bytes), only the other
+    blocks are converted one character after another
+INPUT:
+    const transcoded_file_t *file - pointer on opened transcoded file structure
+    const unsigned char *in - pointer on the beginning of the chunk
+    size_t size - the number of characters in the chunk
+    size_t available - the number of characters that may be looked at
+    char *out - buffer of the maximal output size of the chunk
+RETURN:
+    size_t - the number of written characters
+*/
+TARGET_SSE2 static size_t TranscodeSse2(const transcoded_file_t *file, const unsigned char *in, size_t size, size_t available,
+                                        char *out)
+{
+    char *start = out;
+    size_t pos = 0;
+
+    if (file->Encoding == ENCODING_UTF8_CR)
+        return CopyUtf8Cr(in, size, available, out);
+
+    if (file->Encoding == ENCODING_UTF16LE || file->Encoding == ENCODING_UTF16BE)
+    {
+        const __m128i cr = _mm_set1_epi16('\r');
+        const __m128i high = _mm_set1_epi16((short)0xFF80);
+        const __m128i zero = _mm_setzero_si128();
+        int isBigEndian = file->Encoding == ENCODING_UTF16BE;
+
+        while (pos + VECTOR_SIZE <= size)
+        {
+            __m128i units = _mm_loadu_si128((const __m128i *)(in + pos));
+
+            if (isBigEndian)
+                units = _mm_or_si128(_mm_slli_epi16(units, 8), _mm_srli_epi16(units, 8));
+
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(units, high), zero)) == 0xFFFF &&
+                _mm_movemask_epi8(_mm_cmpeq_epi16(units, cr)) == 0)
+            {
+                _mm_storel_epi64((__m128i *)out, _mm_packus_epi16(units, units));
+                out += VECTOR_SIZE / 2;
+                pos += VECTOR_SIZE;
+            }
+            else
+                pos = ConvertUtf16(in, pos, pos + VECTOR_SIZE, available, isBigEndian, &out);
+        }
+        ConvertUtf16(in, pos, size, available, isBigEndian, &out);
+    }
+    else
+    {
+        const __m128i cr = _mm_set1_epi8('\r');
+
+        for (; pos + VECTOR_SIZE <= size; pos += VECTOR_SIZE)
+        {
+            __m128i bytes = _mm_loadu_si128((const __m128i *)(in + pos));
+
+            if (_mm_movemask_epi8(bytes) == 0 && _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, cr)) == 0)
+            {
+                _mm_storeu_si128((__m128i *)out, bytes);
+                out += VECTOR_SIZE;
+            }
+            else
+                ConvertBytes(file->Page, in, pos, pos + VECTOR_SIZE, available, &out);
+        }
+        ConvertBytes(file->Page, in, pos, size, available, &out);
+    }
+
+    return out - start;
+}
+#endif
+
+/*  Chooses the transcoding function for the processor
+RETURN:
+    transcode_func_t - the fastest supported function
+*/
+static transcode_func_t ChooseTranscoder(void)
+{
+#if defined(TRANSCODER_X86) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+        return TranscodeSse2;
+#elif defined(TRANSCODER_X86) && defined(_MSC_VER)
+    int info[4];
+
+    __cpuid(info, 1);
+    if (info[3] & (1 << 26))
+        return TranscodeSse2;
+#endif
+
+    return TranscodeScalar;
+}
+
+/*  Transcodes the chunk with the fastest available instruction set
+INPUT:
+    const transcoded_file_t *file - pointer on opened transcoded file structure
+    const unsigned char *in - pointer on the beginning of the chunk
+    size_t size - the number of characters in the chunk
+    size_t available - the number of characters that may be looked at
+    char *out - buffer of the maximal output size of the chunk
+RETURN:
+    size_t - the number of written characters
+*/
+static size_t TranscodeText(const transcoded_file_t *file, const unsigned char *in, size_t size, size_t available,
+                            char *out)
+{
+    static transcode_func_t transcode = NULL;
+
+    /* The choice is the same for every thread, so the race here is harmless */
+    if (transcode == NULL)
+        transcode = ChooseTranscoder();
+
+    return transcode(file, in, size, available, out);
+}
+
+/*  Returns the maximal output size of the chunk
+INPUT:
+    const transcoded_file_t *file - pointer on opened transcoded file structure
+    size_t size - the number of characters in the chunk
+RETURN:
+    size_t - the number of characters, at least one
+*/
+static size_t GetOutputBound(encoding_t encoding, size_t size)
+{
+    /* A UTF-16 unit gives at most three characters, a surrogate pair gives four */
+    if (encoding == ENCODING_UTF16LE || encoding == ENCODING_UTF16BE)
+        return (size / 2 + 1) * 3;
+    if (encoding == ENCODING_UTF8_CR)
+        return size + 1;
+
+    return size * 3 + 1;
+}
+
+/*  Transcodes the chunk of the file. The characters around the chunk are mapped
+    too: the pair split by the start of the chunk belongs to the previous chunk,
+    the pair or CR LF split by its end is finished by this chunk
+INPUT:
+    const transcoded_file_t *file - pointer on opened transcoded file structure
+    transcoded_chunk_t *chunk - chunk with the input offset
+OUTPUT:
+    transcoded_chunk_t *chunk - chunk with the allocated output or the error
+*/
+static void TranscodeChunk(const transcoded_file_t *file, transcoded_chunk_t *chunk)
+{
+    offset_t end = chunk->In + TRANSCODE_CHUNK < file->InSize ? chunk->In + TRANSCODE_CHUNK : file->InSize;
+    offset_t mapStart = chunk->In - file->Start >= LOOKBEHIND ? chunk->In - LOOKBEHIND : chunk->In;
+    offset_t mapEnd = file->InSize - end > LOOKAHEAD ? end + LOOKAHEAD : file->InSize;
+    const unsigned char *in;
+    const char *view;
+    size_t size = (size_t)(end - chunk->In);
+    size_t available = (size_t)(mapEnd - chunk->In);
+    size_t skip = 0;
+
+    chunk->Data = NULL;
+    chunk->Size = 0;
+    chunk->Error = SUCCESS;
+    if (size == 0)
+        return;
+
+    in = (const unsigned char *)MapFileRange(file->Mapping, mapStart, (size_t)(mapEnd - mapStart), &view);
+    if (in == NULL)
+    {
+        chunk->Error = MEMORY_SHORTAGE;
+        return;
+    }
+    in += chunk->In - mapStart;
+
+    /* The low surrogate after a high one was taken by the previous chunk */
+    if ((file->Encoding == ENCODING_UTF16LE || file->Encoding == ENCODING_UTF16BE) && mapStart < chunk->In)
+    {
+        int isBigEndian = file->Encoding == ENCODING_UTF16BE;
+        unsigned long previous = GetUnit(in - LOOKBEHIND, isBigEndian);
+        unsigned long first = GetUnit(in, isBigEndian);
+
+        if (previous >= 0xD800 && previous < 0xDC00 && first >= 0xDC00 && first < 0xE000)
+            skip = 2;
+    }
+
+    chunk->Data = malloc(GetOutputBound(file->Encoding, size));
+    if (chunk->Data == NULL)
+        chunk->Error = MEMORY_SHORTAGE;
+    else
+        chunk->Size = TranscodeText(file, in + skip, size - skip, available - skip, chunk->Data);
+
+    UnmapViewOfFile(view);
+}
+
+/*  Checks whether the lines of the text end with CR alone
+INPUT:
+    const char *text - pointer on the text
+    size_t size - the number of characters in the text
+RETURN:
+    int - nonzero if the text has CR and no LF
+*/
+static int HasCrLineBreaks(const char *text, size_t size)
+{
+    return memchr(text, '\n', size) == NULL && memchr(text, '\r', size) != NULL;
+}
+
+/*  Checks whether the text is UTF-8. A few damaged sequences are allowed, a log
+    may have them, while a text in a code page rarely has valid ones at all
+INPUT:
+    const unsigned char *text - pointer on the text
+    size_t size - the number of characters in the text
+    int isCut - nonzero if the text is the beginning of a longer one, so its last sequence may be incomplete
+RETURN:
+    int - nonzero if the valid sequences prevail
+*/
+static int IsMostlyUtf8(const unsigned char *text, size_t size, int isCut)
+{
+    size_t valid = 0;
+    size_t damaged = 0;
+    size_t pos = 0;
+
+    while (pos < size)
+    {
+        unsigned char lead = text[pos++];
+        size_t length;
+        size_t i;
+
+        if (lead < 0x80)
+            continue;
+        if (lead < 0xC2 || lead > 0xF4)
+        {
+            damaged++;
+            continue;
+        }
+        length = lead < 0xE0 ? 1 : lead < 0xF0 ? 2 : 3;
+
+        for (i = 0; i < length && pos < size && (text[pos] & 0xC0) == 0x80; i++)
+            pos++;
+        if (i == length)
+            valid++;
+        else if (pos < size || !isCut)
+            damaged++;
+    }
+
+    return valid >= damaged * UTF8_MARGIN;
+}
+
+/*  Counts the frequent Russian letters in the text read in the code page
+INPUT:
+    const unsigned short *table - characters 0x80-0xFF of the code page
+    const unsigned char *text - pointer on the text
+    size_t size - the number of characters in the text
+RETURN:
+    size_t - the number of frequent letters
+*/
+static size_t CountFrequentLetters(const unsigned short *table, const unsigned char *text, size_t size)
+{
+    size_t count = 0;
+    size_t pos;
+
+    for (pos = 0; pos < size; pos++)
+    {
+        if (text[pos] >= 0x80)
+        {
+            unsigned short code = table[text[pos] - 0x80];
+            int i;
+
+            for (i = 0; i < NUM_OF_LETTERS; i++)
+                if (code == frequentLetters[i])
+                {
+                    count++;
+                    break;
+                }
+        }
+    }
+
+    return count;
+}
+
+/*  Guesses the encoding of the text without the byte order mark. Most UTF-16
+    characters of a text file are in the Latin or Cyrillic range, so every
+    second character is zero or a few values, Latin text in UTF-16 has half of
+    its characters zero
+INPUT:
+    const unsigned char *text - pointer on the beginning of the file
+    size_t size - the number of characters
+    int isCut - nonzero if the file is longer
+RETURN:
+    encoding_t - the guessed encoding
+*/
+static encoding_t GuessEncoding(const unsigned char *text, size_t size, int isCut)
+{
+    size_t zeros[2] = { 0, 0 };
+    size_t pairs = size / 2;
+    size_t pos;
+
+    for (pos = 0; pos < size; pos++)
+        if (text[pos] == 0)
+            zeros[pos & 1]++;
+
+    if (pairs > 0 && zeros[1] > pairs / 4 && zeros[0] < zeros[1] / 8)
+        return ENCODING_UTF16LE;
+    if (pairs > 0 && zeros[0] > pairs / 4 && zeros[1] < zeros[0] / 8)
+        return ENCODING_UTF16BE;
+
+    if (IsMostlyUtf8(text, size, isCut))
+        return HasCrLineBreaks((const char *)text, size) ? ENCODING_UTF8_CR : ENCODING_UTF8;
+
+    /* The same bytes are different letters in the code pages, the real one gives the frequent letters */
+    if (CountFrequentLetters(koi8rChars, text, size) > CountFrequentLetters(cp1251Chars, text, size))
+        return ENCODING_KOI8R;
+    return ENCODING_CP1251;
+}
+
+/*  Finds the encoding of the file by the byte order mark or by the first
+    characters: the zeros of UTF-16, the valid UTF-8 sequences or the frequent
+    Cyrillic letters of the code pages. The CR line breaks are looked for in UTF-8
+INPUT:
+    HANDLE mapping - file mapping object
+    offset_t size - the number of characters in the file
+    offset_t *start - offset of the text after the byte order mark
+RETURN:
+    encoding_t - encoding of the file
+*/
+encoding_t DetectEncoding(HANDLE mapping, offset_t size, offset_t *start)
+{
+    size_t sampleSize = size < ENCODING_SAMPLE ? (size_t)size : ENCODING_SAMPLE;
+    const unsigned char *sample;
+    const char *view;
+    encoding_t encoding;
+
+    *start = 0;
+    if (sampleSize == 0)
+        return ENCODING_UTF8;
+
+    sample = (const unsigned char *)MapFileRange(mapping, 0, sampleSize, &view);
+    if (sample == NULL)
+        return ENCODING_UTF8;
+
+    if (sampleSize >= 3 && sample[0] == 0xEF && sample[1] == 0xBB && sample[2] == 0xBF)
+    {
+        /* The mark of UTF-8 takes no column, the text is read as it is */
+        encoding = HasCrLineBreaks((const char *)sample + 3, sampleSize - 3) ? ENCODING_UTF8_CR : ENCODING_UTF8;
+    }
+    else if (sampleSize >= 2 && sample[0] == 0xFF && sample[1] == 0xFE)
+    {
+        encoding = ENCODING_UTF16LE;
+        *start = 2;
+    }
+    else if (sampleSize >= 2 && sample[0] == 0xFE && sample[1] == 0xFF)
+    {
+        encoding = ENCODING_UTF16BE;
+        *start = 2;
+    }
+    else
+        encoding = GuessEncoding(sample, sampleSize, sampleSize < size);
+
+    UnmapViewOfFile(view);
+    return encoding;
+}
+
+/*  Initializes the transcoded file
+INPUT:
+    transcoded_file_t *file - pointer on transcoded file structure
+OUTPUT:
+    transcoded_file_t *file - pointer on transcoded file structure filled with zero values
+*/
+void InitTranscodedFile(transcoded_file_t *file)
+{
+    file->Encoding = ENCODING_UTF8;
+    file->Mapping = NULL;
+    file->InSize = 0;
+    file->Start = 0;
+    InitializeSRWLock(&file->Lock);
+    file->Outs = NULL;
+    file->NumOfOuts = 0;
+    file->Capacity = 0;
+    file->NextIn = 0;
+    file->OutSize = 0;
+    file->NumOfChunks = 0;
+    file->NextChunk = 0;
+}
+
+/*  Prepares the transcoding of the file
+INPUT:
+    transcoded_file_t *file - pointer on transcoded file structure
+    HANDLE mapping - file mapping object
+    offset_t size - the number of characters in the file
+    encoding_t encoding - encoding of the file
+    offset_t start - offset of the text after the byte order mark
+*/
+void OpenTranscodedFile(transcoded_file_t *file, HANDLE mapping, offset_t size, encoding_t encoding, offset_t start)
+{
+    file->Encoding = encoding;
+    file->Mapping = mapping;
+    file->InSize = size;
+    file->Start = start;
+    file->NextIn = start;
+
+    if (encoding == ENCODING_CP1251 || encoding == ENCODING_KOI8R)
+        BuildCodePage(file->Page, GetCodePage(encoding));
+}
+
+/*  Remembers the output offset of the next chunk
+INPUT:
+    transcoded_file_t *file - pointer on opened transcoded file structure
+    offset_t out - output offset of the chunk
+RETURN:
+    error_t - error code
+*/
+static error_t AddChunkOut(transcoded_file_t *file, offset_t out)
+{
+    error_t err = SUCCESS;
+
+    AcquireSRWLockExclusive(&file->Lock);
+    if (file->NumOfOuts == file->Capacity)
+    {
+        offset_t capacity = file->Capacity == 0 ? MIN_OUTS : file->Capacity * 2;
+        offset_t *outs = realloc(file->Outs, (size_t)capacity * sizeof(offset_t));
+
+        if (outs == NULL)
+            err = MEMORY_SHORTAGE;
+        else
+        {
+            file->Outs = outs;
+            file->Capacity = capacity;
+        }
+    }
+    if (err == SUCCESS)
+        file->Outs[file->NumOfOuts++] = out;
+    ReleaseSRWLockExclusive(&file->Lock);
+
+    return err;
+}
+
+/*  Transcodes one chunk of the batch, called by the thread pool
+INPUT:
+    void *arg - pointer on opened transcoded file structure
+    unsigned long index - index of the chunk in the batch
+*/
+static void TranscodeBatchChunk(void *arg, unsigned long index)
+{
+    transcoded_file_t *file = arg;
+
+    TranscodeChunk(file, &file->Chunks[index]);
+}
+
+/*  Transcodes the next chunks of the first pass in parallel
+INPUT:
+    transcoded_file_t *file - pointer on opened transcoded file structure
+*/
+static void TranscodeBatch(transcoded_file_t *file)
+{
+    unsigned long count = 0;
+
+    while (count < TRANSCODE_BATCH && file->NextIn < file->InSize)
+    {
+        file->Chunks[count++].In = file->NextIn;
+        file->NextIn = file->InSize - file->NextIn > TRANSCODE_CHUNK ? file->NextIn + TRANSCODE_CHUNK : file->InSize;
+    }
+
+    RunParallel(TranscodeBatchChunk, file, count);
+    file->NumOfChunks = count;
+    file->NextChunk = 0;
+}
+
+/*  Transcodes the next chunk of the first pass and remembers its output offset.
+    The chunks are transcoded in parallel batches and returned one by one
+INPUT:
+    transcoded_file_t *file - pointer on opened transcoded file structure
+    const char **data - the transcoded characters valid until the next call
+    size_t *size - the number of transcoded characters, zero at the end of the file
+RETURN:
+    error_t - error code
+*/
+error_t TranscodeNextPiece(transcoded_file_t *file, const char **data, size_t *size)
+{
+    error_t err = SUCCESS;
+
+    *data = NULL;
+    *size = 0;
+
+    while (*size == 0 && err == SUCCESS)
+    {
+        /* The previous chunk is not needed after it is split on lines */
+        if (file->NextChunk > 0)
+        {
+            free(file->Chunks[file->NextChunk - 1].Data);
+            file->Chunks[file->NextChunk - 1].Data = NULL;
+        }
+
+        if (file->NextChunk < file->NumOfChunks)
+        {
+            transcoded_chunk_t *chunk = &file->Chunks[file->NextChunk++];
+
+            err = chunk->Error;
+            if (err == SUCCESS)
+                err = AddChunkOut(file, file->OutSize);
+            *data = chunk->Data;
+            *size = chunk->Size;
+        }
+        else if (file->NextIn < file->InSize)
+            TranscodeBatch(file);
+        else
+            break;
+    }
+
+    if (err != SUCCESS)
+        *size = 0;
+    file->OutSize += *size;
+    return err;
+}
+
+/*  Finds the chunk containing the output offset
+INPUT:
+    transcoded_file_t *file - pointer on opened transcoded file structure
+    offset_t offset - offset in the output
+    offset_t *index - index of the last chunk starting at the offset or before it
+    offset_t *out - output offset of the chunk
+RETURN:
+    int - nonzero if the chunk is known
+*/
+static int FindChunk(transcoded_file_t *file, offset_t offset, offset_t *index, offset_t *out)
+{
+    offset_t low = 0;
+    offset_t high;
+    int isFound;
+
+    AcquireSRWLockShared(&file->Lock);
+    high = file->NumOfOuts;
+    while (high - low > 1)
+    {
+        offset_t middle = low + (high - low) / 2;
+
+        if (file->Outs[middle] <= offset)
+            low = middle;
+        else
+            high = middle;
+    }
+    isFound = file->NumOfOuts > 0;
+    if (isFound)
+    {
+        *index = low;
+        *out = file->Outs[low];
+    }
+    ReleaseSRWLockShared(&file->Lock);
+
+    return isFound;
+}
+
+/*  Transcodes the characters already found by the first pass again from their chunks
+INPUT:
+    void *decoder - pointer on opened transcoded file structure
+    offset_t offset - offset of the first character in the output
+    char *buffer - buffer receiving the characters
+    size_t size - the number of characters to transcode
+RETURN:
+    size_t - the number of transcoded characters, less than size at the end of the output
+*/
+size_t ReadTranscodedRange(void *decoder, offset_t offset, char *buffer, size_t size)
+{
+    transcoded_file_t *file = decoder;
+    transcoded_chunk_t chunk;
+    offset_t index;
+    offset_t out;
+    size_t copied = 0;
+
+    while (copied < size && FindChunk(file, offset + copied, &index, &out))
+    {
+        offset_t from = offset + copied - out;
+        size_t count;
+
+        chunk.In = file->Start + index * TRANSCODE_CHUNK;
+        TranscodeChunk(file, &chunk);
+        if (chunk.Error != SUCCESS || from >= chunk.Size)
+        {
+            free(chunk.Data);
+            break;
+        }
+
+        count = chunk.Size - (size_t)from < size - copied ? chunk.Size - (size_t)from : size - copied;
+        memcpy(buffer + copied, chunk.Data + from, count);
+        copied += count;
+        free(chunk.Data);
+    }
+
+    return copied;
+}
+
+/*  Frees the transcoded chunks and the output offsets
+INPUT:
+    transcoded_file_t *file - pointer on transcoded file structure
+OUTPUT:
+    transcoded_file_t *file - pointer on transcoded file structure filled with zero values
+*/
+void ClearTranscodedFile(transcoded_file_t *file)
+{
+    unsigned long i;
+
+    for (i = 0; i < file->NumOfChunks; i++)
+        free(file->Chunks[i].Data);
+    free(file->Outs);
+
+    InitTranscodedFile(file);
+}
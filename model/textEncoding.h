@@ -0,0 +1,122 @@
+#ifndef __TEXT_ENCODING_H_INCLUDED
+#define __TEXT_ENCODING_H_INCLUDED
+
+#include <windows.h>
+#include "../error/error.h"
+#include "modelTypes.h"
+
+#define ENCODING_SAMPLE (64ul << 10)        /* The number of characters examined to find the encoding */
+#define TRANSCODE_CHUNK (1ul << 20)         /* The number of input characters transcoded at once, even */
+#define TRANSCODE_BATCH 16                  /* The number of chunks transcoded in parallel by the first pass */
+
+/* Encoding of the opened file */
+typedef enum
+{
+    ENCODING_UTF8,      /* UTF-8 or ASCII, the file is read as it is */
+    ENCODING_UTF8_CR,   /* UTF-8 or ASCII whose lines end with CR alone */
+    ENCODING_UTF16LE,   /* UTF-16, little endian */
+    ENCODING_UTF16BE,   /* UTF-16, big endian */
+    ENCODING_CP1251,    /* Windows Cyrillic code page */
+    ENCODING_KOI8R,     /* KOI8-R Cyrillic code page */
+} encoding_t;
+
+/*  UTF-8 sequence of a character of the code page */
+typedef struct
+{
+    char Bytes[4];              /* The sequence, the unused characters are zero */
+    unsigned char Length;       /* The number of characters in the sequence */
+} encoded_char_t;
+
+/*  Chunk of the input transcoded by the first pass */
+typedef struct
+{
+    offset_t In;                /* Offset of the chunk in the file */
+    char *Data;                 /* Transcoded characters */
+    size_t Size;                /* The number of transcoded characters */
+    error_t Error;              /* Result of the transcoding */
+} transcoded_chunk_t;
+
+/*  File in another encoding transcoded to UTF-8 chunk by chunk. The chunks
+    have the same size in the file, so the output offset of every chunk is
+    enough to transcode any part of the output again */
+typedef struct
+{
+    encoding_t Encoding;        /* Encoding of the file */
+    HANDLE Mapping;             /* File mapping object of the file, not owned */
+    offset_t InSize;            /* The number of characters in the file */
+    offset_t Start;             /* Offset of the text after the byte order mark */
+    encoded_char_t Page[256];   /* UTF-8 sequences of the characters of the single-byte code page */
+
+    SRWLOCK Lock;               /* Guards the output offsets of the chunks */
+    offset_t *Outs;             /* Output offset of every chunk transcoded by the first pass */
+    offset_t NumOfOuts;         /* The number of known output offsets */
+    offset_t Capacity;          /* The number of allocated output offsets */
+
+    offset_t NextIn;            /* Offset of the input not transcoded by the first pass */
+    offset_t OutSize;           /* The number of characters transcoded by the first pass */
+    transcoded_chunk_t Chunks[TRANSCODE_BATCH]; /* Chunks transcoded in parallel */
+    unsigned long NumOfChunks;  /* The number of chunks in the last batch */
+    unsigned long NextChunk;    /* Index of the chunk returned next */
+} transcoded_file_t;
+
+/*  Finds the encoding of the file by the byte order mark or by the first
+    characters: the zeros of UTF-16, the valid UTF-8 sequences or the frequent
+    Cyrillic letters of the code pages. The CR line breaks are looked for in UTF-8
+INPUT:
+    HANDLE mapping - file mapping object
+    offset_t size - the number of characters in the file
+    offset_t *start - offset of the text after the byte order mark
+RETURN:
+    encoding_t - encoding of the file
+*/
+encoding_t DetectEncoding(HANDLE mapping, offset_t size, offset_t *start);
+
+/*  Initializes the transcoded file
+INPUT:
+    transcoded_file_t *file - pointer on transcoded file structure
+OUTPUT:
+    transcoded_file_t *file - pointer on transcoded file structure filled with zero values
+*/
+void InitTranscodedFile(transcoded_file_t *file);
+
+/*  Prepares the transcoding of the file
+INPUT:
+    transcoded_file_t *file - pointer on transcoded file structure
+    HANDLE mapping - file mapping object
+    offset_t size - the number of characters in the file
+    encoding_t encoding - encoding of the file
+    offset_t start - offset of the text after the byte order mark
+*/
+void OpenTranscodedFile(transcoded_file_t *file, HANDLE mapping, offset_t size, encoding_t encoding, offset_t start);
+
+/*  Transcodes the next chunk of the first pass and remembers its output offset.
+    The chunks are transcoded in parallel batches and returned one by one
+INPUT:
+    transcoded_file_t *file - pointer on opened transcoded file structure
+    const char **data - the transcoded characters valid until the next call
+    size_t *size - the number of transcoded characters, zero at the end of the file
+RETURN:
+    error_t - error code
+*/
+error_t TranscodeNextPiece(transcoded_file_t *file, const char **data, size_t *size);
+
+/*  Transcodes the characters already found by the first pass again from their chunks
+INPUT:
+    void *decoder - pointer on opened transcoded file structure
+    offset_t offset - offset of the first character in the output
+    char *buffer - buffer receiving the characters
+    size_t size - the number of characters to transcode
+RETURN:
+    size_t - the number of transcoded characters, less than size at the end of the output
+*/
+size_t ReadTranscodedRange(void *decoder, offset_t offset, char *buffer, size_t size);
+
+/*  Frees the transcoded chunks and the output offsets
+INPUT:
+    transcoded_file_t *file - pointer on transcoded file structure
+OUTPUT:
+    transcoded_file_t *file - pointer on transcoded file structure filled with zero values
+*/
+void ClearTranscodedFile(transcoded_file_t *file);
+
+#endif // __TEXT_ENCODING_H_INCLUDED
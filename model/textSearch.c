@@ -0,0 +1,822 @@
+#include "textSearch.h"
+#include "../thread/threadPool.h"
+#include <string.h>
+
+#define TASKS_PER_THREAD 4          /* Tasks per pool thread to even out the load */
+#define MIN_MATCHES 64              /* Initial number of matches of a task */
+
+/* Matches found by one task */
+typedef struct
+{
+    search_match_t *Matches;    /* The matches in the order of their offsets */
+    index_t NumOfMatches;       /* The number of matches */
+    index_t Capacity;           /* The number of allocated matches */
+    int HasLiteral;             /* Nonzero if a line of the chunk contains the required literal */
+    int IsTruncated;            /* Nonzero if the task stopped at MAX_SEARCH_MATCHES */
+    error_t Error;              /* Result of the task */
+} search_task_t;
+
+/* Round of the search, one task searches the lines starting in one chunk */
+typedef struct
+{
+    search_t *Search;           /* Pointer on the search */
+    offset_t Start;             /* The first offset of the round */
+    offset_t End;               /* The lines starting before this offset are searched in the round */
+    index_t FirstChunk;         /* The chunk of Start */
+    search_task_t *Tasks;       /* Results of the tasks */
+} parallel_search_t;
+
+static unsigned long lastSearchId = 0;  /* Identifier of the last started search */
+
+/*  Initializes the search
+INPUT:
+    search_t *search - pointer on search structure
+OUTPUT:
+    search_t *search - pointer on search structure without pattern
+*/
+void InitSearch(search_t *search)
+{
+    int i;
+
+    InitPattern(&search->Pattern);
+    for (i = 0; i < SEARCH_MATCHERS; i++)
+    {
+        search->Matchers[i] = NULL;
+        search->IsMatcherBusy[i] = 0;
+    }
+    InitializeSRWLock(&search->MatchersLock);
+
+    InitializeSRWLock(&search->Lock);
+    search->Matches = NULL;
+    search->NumOfMatches = 0;
+    search->Capacity = 0;
+    search->SearchedSize = 0;
+    search->IsTruncated = 0;
+
+    search->Chunks = NULL;
+    search->ChunkBytes = 0;
+    search->SkipChunks = NULL;
+    search->SkipBytes = 0;
+    search->SkipSize = 0;
+
+    search->Model = NULL;
+    search->LoadId = 0;
+    search->Thread = NULL;
+    search->Cancel = 0;
+    search->IsFinished = 0;
+    search->IsStopped = 0;
+    search->Error = SUCCESS;
+    search->NotifyWindow = NULL;
+    search->SearchId = 0;
+}
+
+/*  Takes a free matcher of the pattern, it is created when the kept ones are taken
+INPUT:
+    search_t *search - pointer on search structure
+    int *slot - index of the kept matcher or -1 for the matcher of its own
+RETURN:
+    pattern_matcher_t * - the matcher or NULL if there is not enough memory
+*/
+static pattern_matcher_t *TakeMatcher(search_t *search, int *slot)
+{
+    pattern_matcher_t *matcher = NULL;
+    int i;
+
+    AcquireSRWLockExclusive(&search->MatchersLock);
+    for (i = 0; i < SEARCH_MATCHERS && search->IsMatcherBusy[i]; i++)
+        ;
+    if (i < SEARCH_MATCHERS)
+    {
+        search->IsMatcherBusy[i] = 1;
+        matcher = search->Matchers[i];
+    }
+    ReleaseSRWLockExclusive(&search->MatchersLock);
+    *slot = i < SEARCH_MATCHERS ? i : -1;
+
+    /* The taken slot belongs to the task, so its matcher is created without the lock */
+    if (matcher == NULL)
+    {
+        matcher = malloc(sizeof(pattern_matcher_t));
+        if (matcher != NULL && InitMatcher(matcher, &search->Pattern) != SUCCESS)
+        {
+            free(matcher);
+            matcher = NULL;
+        }
+        if (*slot >= 0)
+            search->Matchers[*slot] = matcher;
+    }
+
+    return matcher;
+}
+
+/*  Gives the matcher back, the matcher of its own is released
+INPUT:
+    search_t *search - pointer on search structure
+    pattern_matcher_t *matcher - the matcher
+    int slot - index of the kept matcher or -1
+*/
+static void ReturnMatcher(search_t *search, pattern_matcher_t *matcher, int slot)
+{
+    if (slot < 0)
+    {
+        ClearMatcher(matcher);
+        free(matcher);
+        return;
+    }
+
+    AcquireSRWLockExclusive(&search->MatchersLock);
+    search->IsMatcherBusy[slot] = 0;
+    ReleaseSRWLockExclusive(&search->MatchersLock);
+}
+
+/*  Releases the kept matchers, no task may run
+INPUT:
+    search_t *search - pointer on search structure
+*/
+static void ClearMatchers(search_t *search)
+{
+    int i;
+
+    for (i = 0; i < SEARCH_MATCHERS; i++)
+    {
+        if (search->Matchers[i] != NULL)
+        {
+            ClearMatcher(search->Matchers[i]);
+            free(search->Matchers[i]);
+        }
+        search->Matchers[i] = NULL;
+        search->IsMatcherBusy[i] = 0;
+    }
+}
+
+/*  Appends the matches of the line to the task
+INPUT:
+    search_task_t *task - pointer on task structure
+    pattern_matcher_t *matcher - the matcher
+    const char *line - the characters of the line without the line break
+    size_t length - the number of characters of the line
+    offset_t offset - offset of the line in the model
+    index_t lineIndex - the line
+*/
+static void AddLineMatches(search_task_t *task, pattern_matcher_t *matcher, const char *line, size_t length,
+                           offset_t offset, index_t lineIndex)
+{
+    size_t from = 0;
+    size_t start;
+    size_t matchLength;
+
+    while (from <= length && MatchLine(matcher, line, length, from, &start, &matchLength))
+    {
+        search_match_t *match;
+
+        if (task->NumOfMatches == MAX_SEARCH_MATCHES)
+        {
+            task->IsTruncated = 1;
+            return;
+        }
+        if (task->NumOfMatches == task->Capacity)
+        {
+            index_t capacity = task->Capacity > 0 ? 2 * task->Capacity : MIN_MATCHES;
+            search_match_t *tmp = realloc(task->Matches, (size_t)capacity * sizeof(search_match_t));
+
+            if (tmp == NULL)
+            {
+                task->Error = MEMORY_SHORTAGE;
+                return;
+            }
+            task->Matches = tmp;
+            task->Capacity = capacity;
+        }
+
+        match = &task->Matches[task->NumOfMatches++];
+        match->Line = lineIndex;
+        match->Offset = offset + start;
+        match->Length = matchLength;
+
+        /* The empty match does not stop the next one at the same place */
+        from = start + (matchLength > 0 ? matchLength : 1);
+    }
+}
+
+/*  Gets the length of the line without the line break
+INPUT:
+    const char *line - the characters of the line
+    size_t length - the number of characters up to the line break or the end of the text
+RETURN:
+    size_t - the number of characters without the carriage return
+*/
+static size_t CutLineBreak(const char *line, size_t length)
+{
+    return length > 0 && line[length - 1] == '\r' ? length - 1 : length;
+}
+
+/*  Searches the whole lines of the text. With the required literal only the lines
+    containing it are matched, otherwise every line is checked by the matcher
+INPUT:
+    parallel_search_t *job - pointer on round structure
+    search_task_t *task - pointer on task structure
+    pattern_matcher_t *matcher - the matcher
+    const literal_t *literal - the required literal or NULL
+    const char *text - the lines, the last one may have no line break
+    size_t size - the number of characters of the lines
+    offset_t offset - offset of the text in the model
+    index_t line - the first line of the text
+*/
+static void SearchLines(parallel_search_t *job, search_task_t *task, pattern_matcher_t *matcher,
+                        const literal_t *literal, const char *text, size_t size, offset_t offset, index_t line)
+{
+    const model_t *model = job->Search->Model;
+    size_t pos = 0;
+
+    while (pos < size && task->Error == SUCCESS && !task->IsTruncated && !job->Search->Cancel)
+    {
+        const char *lineBreak;
+        size_t start = pos;
+        size_t end;
+
+        if (literal != NULL)
+        {
+            size_t found = FindLiteral(literal, text + pos, size - pos);
+
+            if (found == size - pos)
+                break;
+            task->HasLiteral = 1;
+
+            /* The text starts with a line, so its start is not before pos */
+            start = pos + found;
+            while (start > pos && text[start - 1] != '\n')
+                start--;
+            line = FindModelLine(model, offset + start);
+        }
+
+        lineBreak = memchr(text + start, '\n', size - start);
+        end = lineBreak != NULL ? (size_t)(lineBreak - text) : size;
+        if (IsLineMatched(matcher, text + start, CutLineBreak(text + start, end - start)))
+            AddLineMatches(task, matcher, text + start, CutLineBreak(text + start, end - start), offset + start, line);
+
+        pos = end + 1;
+        line++;
+    }
+}
+
+/*  Checks whether the chunk has no line containing the required literal of the previous pattern
+INPUT:
+    const search_t *search - pointer on search structure
+    index_t chunk - the chunk
+    offset_t last - the end of the searched part of the chunk
+RETURN:
+    int - nonzero if the chunk may be skipped
+*/
+static int IsChunkSkipped(const search_t *search, index_t chunk, offset_t last)
+{
+    if (search->SkipChunks == NULL || last > search->SkipSize || chunk / 8 >= search->SkipBytes)
+        return 0;
+
+    return !(search->SkipChunks[chunk / 8] & (1 << (chunk % 8)));
+}
+
+/*  Searches the lines starting in the chunk, it is the task of the round. The file read
+    by blocks is read in windows, the long line is matched only in its first window
+INPUT:
+    void *arg - pointer on round structure
+    unsigned long index - the number of the chunk in the round
+*/
+static void SearchChunk(void *arg, unsigned long index)
+{
+    parallel_search_t *job = arg;
+    search_t *search = job->Search;
+    const model_t *model = search->Model;
+    search_task_t *task = &job->Tasks[index];
+    index_t chunk = job->FirstChunk + index;
+    offset_t first = chunk * SEARCH_CHUNK;
+    offset_t last = first + SEARCH_CHUNK;
+    const literal_t *required = NULL;
+    pattern_matcher_t *matcher;
+    literal_t literal;
+    char *buffer = NULL;
+    index_t line;
+    index_t endLine;
+    offset_t pos;
+    offset_t stop;
+    int slot;
+
+    task->Matches = NULL;
+    task->NumOfMatches = 0;
+    task->Capacity = 0;
+    task->HasLiteral = 0;
+    task->IsTruncated = 0;
+    task->Error = SUCCESS;
+
+    if (first < job->Start)
+        first = job->Start;
+    if (last > job->End)
+        last = job->End;
+    if (first >= last || IsChunkSkipped(search, chunk, last))
+        return;
+
+    /* The chunk takes the lines starting in it */
+    line = FindModelLine(model, first);
+    if (GetModelLineOffset(model, line) < first)
+        line++;
+    endLine = FindModelLine(model, last);
+    if (GetModelLineOffset(model, endLine) < last)
+        endLine++;
+    if (line >= endLine)
+        return;
+    pos = GetModelLineOffset(model, line);
+    stop = GetModelLineOffset(model, endLine);
+
+    if (search->Pattern.RequiredLength > 0)
+    {
+        InitLiteral(&literal, search->Pattern.Required, search->Pattern.RequiredLength, search->Pattern.IgnoreCase);
+        required = &literal;
+    }
+
+    matcher = TakeMatcher(search, &slot);
+    if (matcher == NULL || (model->Data == NULL && (buffer = malloc(SEARCH_WINDOW)) == NULL))
+    {
+        task->Error = MEMORY_SHORTAGE;
+        if (matcher != NULL)
+            ReturnMatcher(search, matcher, slot);
+        return;
+    }
+
+    if (model->Data != NULL)
+    {
+        offset_t size = stop - pos;
+        const char *text = GetModelText(model, pos, NULL, &size);
+
+        SearchLines(job, task, matcher, required, text, (size_t)size, pos, line);
+    }
+
+    while (buffer != NULL && pos < stop && task->Error == SUCCESS && !task->IsTruncated && !search->Cancel)
+    {
+        offset_t size = stop - pos < SEARCH_WINDOW ? stop - pos : SEARCH_WINDOW;
+        const char *text = GetModelText(model, pos, buffer, &size);
+        size_t part = (size_t)size;
+
+        if (size == 0)
+            break;
+
+        /* The window ends at the last line break, the line longer than the window is cut */
+        if (pos + size < stop)
+        {
+            while (part > 0 && text[part - 1] != '\n')
+                part--;
+            if (part == 0)
+            {
+                SearchLines(job, task, matcher, required, text, (size_t)size, pos, line);
+                line++;
+                pos = GetModelLineOffset(model, line);
+                continue;
+            }
+        }
+
+        SearchLines(job, task, matcher, required, text, part, pos, line);
+        pos += part;
+        if (pos < stop)
+            line = FindModelLine(model, pos);
+    }
+
+    free(buffer);
+    ReturnMatcher(search, matcher, slot);
+}
+
+/*  Drops the matches of the lines the model took back, they are searched again
+INPUT:
+    search_t *search - pointer on search structure
+    offset_t end - the end of the lines of the model
+*/
+static void TrimMatches(search_t *search, offset_t end)
+{
+    index_t low = 0;
+    index_t high;
+
+    AcquireSRWLockExclusive(&search->Lock);
+    high = search->NumOfMatches;
+    while (low < high)
+    {
+        index_t middle = low + (high - low) / 2;
+
+        if (search->Matches[middle].Offset < end)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    search->NumOfMatches = low;
+    search->SearchedSize = end;
+    ReleaseSRWLockExclusive(&search->Lock);
+}
+
+/*  Appends the matches of the tasks in their order and marks the chunks containing
+    the required literal, the task arrays are released
+INPUT:
+    search_t *search - pointer on search structure
+    parallel_search_t *job - pointer on round structure
+    unsigned long numOfTasks - the number of tasks of the round
+RETURN:
+    error_t - error code
+*/
+static error_t MergeTasks(search_t *search, parallel_search_t *job, unsigned long numOfTasks)
+{
+    index_t lastChunk = job->FirstChunk + numOfTasks - 1;
+    index_t count = 0;
+    error_t err = SUCCESS;
+    unsigned long i;
+
+    for (i = 0; i < numOfTasks; i++)
+    {
+        if (job->Tasks[i].Error != SUCCESS && err == SUCCESS)
+            err = job->Tasks[i].Error;
+        count += job->Tasks[i].NumOfMatches;
+    }
+
+    if (err == SUCCESS && search->Pattern.RequiredLength > 0 && lastChunk / 8 >= search->ChunkBytes)
+    {
+        index_t bytes = lastChunk / 8 + 1 > 2 * search->ChunkBytes ? lastChunk / 8 + 1 : 2 * search->ChunkBytes;
+        unsigned char *tmp = realloc(search->Chunks, (size_t)bytes);
+
+        if (tmp != NULL)
+        {
+            memset(tmp + search->ChunkBytes, 0, (size_t)(bytes - search->ChunkBytes));
+            search->Chunks = tmp;
+            search->ChunkBytes = bytes;
+        }
+        else
+            err = MEMORY_SHORTAGE;
+    }
+
+    AcquireSRWLockExclusive(&search->Lock);
+    if (err == SUCCESS && search->NumOfMatches + count > search->Capacity)
+    {
+        index_t capacity = search->Capacity > 0 ? search->Capacity : MIN_MATCHES;
+        search_match_t *tmp;
+
+        while (capacity < search->NumOfMatches + count)
+            capacity *= 2;
+        tmp = FITS_IN_MEMORY(capacity, sizeof(search_match_t))
+            ? realloc(search->Matches, (size_t)capacity * sizeof(search_match_t)) : NULL;
+        if (tmp != NULL)
+        {
+            search->Matches = tmp;
+            search->Capacity = capacity;
+        }
+        else
+            err = MEMORY_SHORTAGE;
+    }
+
+    for (i = 0; i < numOfTasks; i++)
+    {
+        search_task_t *task = &job->Tasks[i];
+        index_t chunk = job->FirstChunk + i;
+
+        if (err == SUCCESS && !search->IsTruncated)
+        {
+            index_t part = task->NumOfMatches;
+
+            if (part > MAX_SEARCH_MATCHES - search->NumOfMatches)
+                part = MAX_SEARCH_MATCHES - search->NumOfMatches;
+            memcpy(search->Matches + search->NumOfMatches, task->Matches, (size_t)part * sizeof(search_match_t));
+            search->NumOfMatches += part;
+            search->IsTruncated = part < task->NumOfMatches || task->IsTruncated;
+        }
+
+        /* The chunks after the limit are searched as well, so they stay valid for the refined pattern */
+        if (err == SUCCESS && task->HasLiteral)
+            search->Chunks[chunk / 8] |= 1 << (chunk % 8);
+        free(task->Matches);
+    }
+
+    if (err == SUCCESS)
+        search->SearchedSize = job->End;
+    ReleaseSRWLockExclusive(&search->Lock);
+
+    return err;
+}
+
+/*  Searches the lines in rounds while the model is locked only for one round, so
+    the loader publishes the new lines between them. The matches are notified
+    not more often than every SEARCH_NOTIFY_PERIOD
+INPUT:
+    LPVOID param - pointer on search structure
+RETURN:
+    DWORD - not used
+*/
+static DWORD WINAPI SearchThread(LPVOID param)
+{
+    search_t *search = param;
+    model_t *model = search->Model;
+    unsigned long maxTasks = GetThreadPoolLimit() * TASKS_PER_THREAD;
+    DWORD lastNotification = GetTickCount() - SEARCH_NOTIFY_PERIOD;
+    parallel_search_t job;
+    error_t err = SUCCESS;
+
+    job.Search = search;
+    while (err == SUCCESS && !search->Cancel && !search->IsTruncated)
+    {
+        offset_t end;
+        unsigned long numOfTasks;
+
+        LockModel(model);
+        end = model->NumOfLines > 0 ? GetModelLineOffset(model, model->NumOfLines) : 0;
+        if (search->SearchedSize > end)
+            TrimMatches(search, end);
+        if (search->SearchedSize >= end)
+        {
+            UnlockModel(model);
+            break;
+        }
+
+        job.Start = search->SearchedSize;
+        job.FirstChunk = job.Start / SEARCH_CHUNK;
+        numOfTasks = (end - 1) / SEARCH_CHUNK - job.FirstChunk + 1 < maxTasks
+                   ? (unsigned long)((end - 1) / SEARCH_CHUNK - job.FirstChunk + 1) : maxTasks;
+        job.End = (job.FirstChunk + numOfTasks) * SEARCH_CHUNK < end ? (job.FirstChunk + numOfTasks) * SEARCH_CHUNK
+                                                                     : end;
+        job.Tasks = malloc(numOfTasks * sizeof(search_task_t));
+        if (job.Tasks == NULL)
+        {
+            UnlockModel(model);
+            err = MEMORY_SHORTAGE;
+            break;
+        }
+        RunParallel(SearchChunk, &job, numOfTasks);
+        UnlockModel(model);
+
+        /* The round interrupted by the cancellation is not complete */
+        if (search->Cancel)
+        {
+            unsigned long i;
+
+            for (i = 0; i < numOfTasks; i++)
+                free(job.Tasks[i].Matches);
+        }
+        else
+            err = MergeTasks(search, &job, numOfTasks);
+        free(job.Tasks);
+
+        if (GetTickCount() - lastNotification >= SEARCH_NOTIFY_PERIOD)
+        {
+            PostMessage(search->NotifyWindow, WM_SEARCH_PROGRESS, FALSE, search->SearchId);
+            lastNotification = GetTickCount();
+        }
+    }
+
+    search->Error = err;
+    InterlockedExchange(&search->IsFinished, 1);
+    PostMessage(search->NotifyWindow, WM_SEARCH_PROGRESS, TRUE, search->SearchId);
+    return 0;
+}
+
+/*  Starts the thread searching the lines after SearchedSize
+INPUT:
+    search_t *search - pointer on search structure without thread
+RETURN:
+    error_t - error code
+*/
+static error_t RunSearch(search_t *search)
+{
+    search->Cancel = 0;
+    search->IsFinished = 0;
+    search->Error = SUCCESS;
+    search->SearchId = ++lastSearchId;
+    search->Thread = CreateThread(NULL, 0, SearchThread, search, 0, NULL);
+
+    return search->Thread != NULL ? SUCCESS : MEMORY_SHORTAGE;
+}
+
+/*  Checks whether every occurrence of the new literal contains the old one
+INPUT:
+    const pattern_t *pattern - the new pattern
+    const char *old - the old literal, lowered when the case was ignored
+    size_t oldLength - the number of characters of the old literal
+    int oldIgnoreCase - nonzero if the case was ignored in the old pattern
+RETURN:
+    int - nonzero if the new literal contains the old one
+*/
+static int ContainsLiteral(const pattern_t *pattern, const char *old, size_t oldLength, int oldIgnoreCase)
+{
+    size_t i, j;
+
+    /* The letter found in either case may miss the letter of the given case */
+    if (oldLength == 0 || (pattern->IgnoreCase && !oldIgnoreCase))
+        return 0;
+
+    for (i = 0; i + oldLength <= pattern->RequiredLength; i++)
+    {
+        for (j = 0; j < oldLength; j++)
+        {
+            char c = pattern->Required[i + j];
+
+            if (oldIgnoreCase && c >= 'A' && c <= 'Z')
+                c |= 0x20;
+            if (c != old[j])
+                break;
+        }
+        if (j == oldLength)
+            return 1;
+    }
+
+    return 0;
+}
+
+/*  Compiles the pattern and starts searching it in the lines of the model in
+    the background, the previous search is stopped and its matches are dropped.
+    When every match of the new pattern contains the required literal of the
+    previous one, the chunks without that literal are not read again
+INPUT:
+    search_t *search - pointer on search structure
+    model_t *model - pointer on model structure, it must live while the search runs
+    const char *text - the regular expression in UTF-8
+    size_t length - the number of characters of the expression
+    int ignoreCase - nonzero if the case of the ASCII letters is ignored
+    HWND hwnd - window receiving WM_SEARCH_PROGRESS
+RETURN:
+    error_t - error code, BAD_PATTERN leaves the previous search as it is
+*/
+error_t StartSearch(search_t *search, model_t *model, const char *text, size_t length, int ignoreCase, HWND hwnd)
+{
+    pattern_t pattern;
+    error_t err;
+
+    InitPattern(&pattern);
+    err = CompilePattern(&pattern, text, length, ignoreCase);
+    if (err != SUCCESS)
+        return err;
+
+    StopSearch(search);
+    ClearMatchers(search);
+
+    /* The chunks of the previous search stay valid for the lines before its last one */
+    free(search->SkipChunks);
+    search->SkipChunks = NULL;
+    search->SkipBytes = 0;
+    search->SkipSize = 0;
+    if (search->Chunks != NULL && search->Model == model && search->LoadId == model->LoadId &&
+        ContainsLiteral(&pattern, search->Pattern.Required, search->Pattern.RequiredLength, search->Pattern.IgnoreCase))
+    {
+        search->SkipChunks = search->Chunks;
+        search->SkipBytes = search->ChunkBytes;
+        LockModel(model);
+        if (search->SearchedSize > 0 && model->NumOfLines > 0)
+            search->SkipSize = GetModelLineOffset(model, FindModelLine(model, search->SearchedSize - 1));
+        UnlockModel(model);
+    }
+    else
+        free(search->Chunks);
+    search->Chunks = NULL;
+    search->ChunkBytes = 0;
+
+    ClearPattern(&search->Pattern);
+    search->Pattern = pattern;
+
+    AcquireSRWLockExclusive(&search->Lock);
+    search->NumOfMatches = 0;
+    search->SearchedSize = 0;
+    search->IsTruncated = 0;
+    ReleaseSRWLockExclusive(&search->Lock);
+
+    search->Model = model;
+    search->LoadId = model->LoadId;
+    search->NotifyWindow = hwnd;
+    search->IsStopped = 0;
+
+    return RunSearch(search);
+}
+
+/*  Finishes the search which posted its last notification and searches the lines
+    loaded or appended since. The matches of the line taken back by the model
+    to be extended are searched again
+INPUT:
+    search_t *search - pointer on search structure
+RETURN:
+    error_t - error code of the finished search
+*/
+error_t ContinueSearch(search_t *search)
+{
+    offset_t end;
+    error_t err;
+
+    /* The running search reaches the new lines itself, the finished one only exits */
+    if (search->Thread != NULL)
+    {
+        if (!search->IsFinished)
+            return SUCCESS;
+        WaitForSingleObject(search->Thread, INFINITE);
+        CloseHandle(search->Thread);
+        search->Thread = NULL;
+    }
+
+    /* The failed search is reported once and is not continued */
+    err = search->Error;
+    if (err != SUCCESS)
+    {
+        search->Error = SUCCESS;
+        search->IsStopped = 1;
+        return err;
+    }
+    if (search->Pattern.NumOfOps == 0 || search->IsStopped || search->IsTruncated)
+        return SUCCESS;
+
+    LockModel(search->Model);
+    end = search->Model->NumOfLines > 0 ? GetModelLineOffset(search->Model, search->Model->NumOfLines) : 0;
+    UnlockModel(search->Model);
+
+    return end != search->SearchedSize ? RunSearch(search) : SUCCESS;
+}
+
+/*  Stops the search, its matches stay
+INPUT:
+    search_t *search - pointer on search structure
+*/
+void StopSearch(search_t *search)
+{
+    if (search->Thread == NULL)
+        return;
+
+    if (!search->IsFinished)
+    {
+        InterlockedExchange(&search->Cancel, 1);
+        search->IsStopped = 1;
+    }
+    WaitForSingleObject(search->Thread, INFINITE);
+    CloseHandle(search->Thread);
+    search->Thread = NULL;
+}
+
+/*  Returns the number of matches found so far
+INPUT:
+    search_t *search - pointer on search structure
+RETURN:
+    index_t - the number of matches
+*/
+index_t GetSearchCount(search_t *search)
+{
+    index_t count;
+
+    AcquireSRWLockShared(&search->Lock);
+    count = search->NumOfMatches;
+    ReleaseSRWLockShared(&search->Lock);
+
+    return count;
+}
+
+/*  Finds the match found so far nearest to the offset in the direction
+INPUT:
+    search_t *search - pointer on search structure
+    offset_t offset - offset in the model
+    find_direction_t direction - FIND_FORWARD for the first match starting at the offset or after it,
+                                 FIND_BACKWARD for the last match starting before it
+    search_match_t *match - the found match
+RETURN:
+    int - nonzero if the match is found
+*/
+int FindSearchMatch(search_t *search, offset_t offset, find_direction_t direction, search_match_t *match)
+{
+    index_t low = 0;
+    index_t high;
+    int isFound;
+
+    AcquireSRWLockShared(&search->Lock);
+    high = search->NumOfMatches;
+    while (low < high)
+    {
+        index_t middle = low + (high - low) / 2;
+
+        if (search->Matches[middle].Offset < offset)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    /* The first match not before the offset is low, the last one before it is low - 1 */
+    if (direction == FIND_FORWARD)
+        isFound = low < search->NumOfMatches;
+    else
+        isFound = low-- > 0;
+    if (isFound)
+        *match = search->Matches[low];
+    ReleaseSRWLockShared(&search->Lock);
+
+    return isFound;
+}
+
+/*  Stops the search and releases its data
+INPUT:
+    search_t *search - pointer on search structure
+OUTPUT:
+    search_t *search - pointer on search structure without pattern
+*/
+void ClearSearch(search_t *search)
+{
+    if (search == NULL)
+        return;
+
+    StopSearch(search);
+    ClearMatchers(search);
+    ClearPattern(&search->Pattern);
+    free(search->Matches);
+    free(search->Chunks);
+    free(search->SkipChunks);
+    InitSearch(search);
+}
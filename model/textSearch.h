@@ -0,0 +1,128 @@
+#ifndef __TEXT_SEARCH_H_INCLUDED
+#define __TEXT_SEARCH_H_INCLUDED
+
+#include "fileModel.h"
+#include "regexPattern.h"
+
+/* Message posted to the window while the pattern is being searched
+   (wParam is nonzero when the search is finished, lParam is the SearchId of the search) */
+#define WM_SEARCH_PROGRESS (WM_APP + 4)
+
+#define SEARCH_CHUNK (256ul << 10)      /* The lines starting in this number of characters are searched by one task */
+#define SEARCH_WINDOW (4ul << 20)       /* The number of characters read at once from the file read by blocks */
+#define SEARCH_NOTIFY_PERIOD 200        /* Minimum interval between the progress notifications in milliseconds */
+#define MAX_SEARCH_MATCHES (1ul << 24)  /* The maximum number of kept matches */
+#define SEARCH_MATCHERS 64              /* The number of matchers kept for the tasks between the rounds */
+
+/* Match of the pattern */
+typedef struct
+{
+    index_t Line;           /* The line of the match */
+    offset_t Offset;        /* Offset of the match in the model */
+    offset_t Length;        /* The number of characters of the match, it may be 0 */
+} search_match_t;
+
+/*  Search of the pattern in the lines of the model in a background thread. The
+    matches are appended in the order of their offsets while the window reads them.
+    The chunks of the lines containing the required literal of the pattern are
+    remembered, so a refined pattern requiring the same literal skips the others */
+typedef struct
+{
+    pattern_t Pattern;                              /* The searched pattern */
+    pattern_matcher_t *Matchers[SEARCH_MATCHERS];   /* Matchers kept for the tasks, NULL if not created yet */
+    int IsMatcherBusy[SEARCH_MATCHERS];             /* Nonzero if the matcher is taken by a task */
+    SRWLOCK MatchersLock;                           /* Guards IsMatcherBusy */
+
+    SRWLOCK Lock;                   /* Guards the matches while the search appends them */
+    search_match_t *Matches;        /* The matches in the order of their offsets */
+    index_t NumOfMatches;           /* The number of matches */
+    index_t Capacity;               /* The number of allocated matches */
+    offset_t SearchedSize;          /* The lines starting before this offset are searched */
+    int IsTruncated;                /* Nonzero if the search stopped at MAX_SEARCH_MATCHES */
+
+    unsigned char *Chunks;          /* Bit set of the chunks whose lines contain the required literal */
+    index_t ChunkBytes;             /* The number of allocated bytes of Chunks */
+    unsigned char *SkipChunks;      /* Chunks of the previous pattern, the others are skipped, or NULL */
+    index_t SkipBytes;              /* The number of allocated bytes of SkipChunks */
+    offset_t SkipSize;              /* SkipChunks covers the lines starting before this offset */
+
+    model_t *Model;                 /* The searched model */
+    unsigned long LoadId;           /* LoadId of the model the chunks belong to */
+    HANDLE Thread;                  /* Thread searching the pattern or NULL */
+    volatile long Cancel;           /* Nonzero when the search must stop */
+    volatile long IsFinished;       /* Nonzero when the thread posted its last notification */
+    int IsStopped;                  /* Nonzero if the search was stopped before the end of the lines */
+    error_t Error;                  /* Result of the search */
+    HWND NotifyWindow;              /* Window receiving WM_SEARCH_PROGRESS */
+    unsigned long SearchId;         /* Identifier of the search sent with the notifications */
+} search_t;
+
+/*  Initializes the search
+INPUT:
+    search_t *search - pointer on search structure
+OUTPUT:
+    search_t *search - pointer on search structure without pattern
+*/
+void InitSearch(search_t *search);
+
+/*  Compiles the pattern and starts searching it in the lines of the model in
+    the background, the previous search is stopped and its matches are dropped.
+    When every match of the new pattern contains the required literal of the
+    previous one, the chunks without that literal are not read again
+INPUT:
+    search_t *search - pointer on search structure
+    model_t *model - pointer on model structure, it must live while the search runs
+    const char *text - the regular expression in UTF-8
+    size_t length - the number of characters of the expression
+    int ignoreCase - nonzero if the case of the ASCII letters is ignored
+    HWND hwnd - window receiving WM_SEARCH_PROGRESS
+RETURN:
+    error_t - error code, BAD_PATTERN leaves the previous search as it is
+*/
+error_t StartSearch(search_t *search, model_t *model, const char *text, size_t length, int ignoreCase, HWND hwnd);
+
+/*  Finishes the search which posted its last notification and searches the lines
+    loaded or appended since. The matches of the line taken back by the model
+    to be extended are searched again
+INPUT:
+    search_t *search - pointer on search structure
+RETURN:
+    error_t - error code of the finished search
+*/
+error_t ContinueSearch(search_t *search);
+
+/*  Stops the search, its matches stay
+INPUT:
+    search_t *search - pointer on search structure
+*/
+void StopSearch(search_t *search);
+
+/*  Returns the number of matches found so far
+INPUT:
+    search_t *search - pointer on search structure
+RETURN:
+    index_t - the number of matches
+*/
+index_t GetSearchCount(search_t *search);
+
+/*  Finds the match found so far nearest to the offset in the direction
+INPUT:
+    search_t *search - pointer on search structure
+    offset_t offset - offset in the model
+    find_direction_t direction - FIND_FORWARD for the first match starting at the offset or after it,
+                                 FIND_BACKWARD for the last match starting before it
+    search_match_t *match - the found match
+RETURN:
+    int - nonzero if the match is found
+*/
+int FindSearchMatch(search_t *search, offset_t offset, find_direction_t direction, search_match_t *match);
+
+/*  Stops the search and releases its data
+INPUT:
+    search_t *search - pointer on search structure
+OUTPUT:
+    search_t *search - pointer on search structure without pattern
+*/
+void ClearSearch(search_t *search);
+
+#endif // __TEXT_SEARCH_H_INCLUDED
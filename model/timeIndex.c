@@ -0,0 +1,849 @@
+#include "timeIndex.h"
+#include "../thread/threadPool.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TASKS_PER_THREAD 4                          /* Tasks per pool thread to even out the load */
+#define MIN_POINTS 256                              /* Initial number of allocated checkpoints */
+#define DAY_MS 86400000LL                           /* Milliseconds of a day */
+#define SYSLOG_YEAR (366 * DAY_MS)                  /* Syslog days are counted in a leap year */
+#define HALF_YEAR (183 * DAY_MS)                    /* A step back by more than this is the next year */
+
+/* Parallel sampling, a task parses the timestamps of its part of the sampled blocks */
+typedef struct
+{
+    const time_index_t *Index;  /* Pointer on the time index */
+    const model_t *Model;       /* Pointer on the indexed model */
+    index_t FirstSample;        /* Index of the first sampled block */
+    index_t NumOfSamples;       /* The number of sampled blocks */
+    index_t TaskSamples;        /* The number of blocks of one task */
+    index_t EndLine;            /* The lines before this one are looked through */
+    time_checkpoint_t *Slots;   /* Checkpoint of every sampled block, Line is EndLine if there is none */
+} parallel_sample_t;
+
+static const char *const months[12] =
+{
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+/*  Initializes the time index
+INPUT:
+    time_index_t *index - pointer on time index structure
+OUTPUT:
+    time_index_t *index - pointer on time index structure without format
+*/
+void InitTimeIndex(time_index_t *index)
+{
+    index->Format = TIME_ISO8601;
+    index->IsEnabled = 0;
+    index->Points = NULL;
+    index->NumOfPoints = 0;
+    index->Capacity = 0;
+    index->SampledLines = 0;
+    index->NumOfDisorders = 0;
+    index->Model = NULL;
+    index->LoadId = 0;
+}
+
+/*  Counts the days since 1970-01-01 of the date of the proleptic Gregorian calendar
+INPUT:
+    long long year - the year
+    int month - the month from 1 to 12
+    int day - the day of the month from 1
+RETURN:
+    long long - the number of days, negative before 1970
+*/
+static long long GetDays(long long year, int month, int day)
+{
+    long long era;
+    long long yearOfEra;
+    long long dayOfYear;
+
+    /* The year starts in March, so the leap day is the last one */
+    year -= month <= 2;
+    era = (year >= 0 ? year : year - 399) / 400;
+    yearOfEra = year - era * 400;
+    dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+
+    return era * 146097 + yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear - 719468;
+}
+
+/*  Finds the date of the day counted since 1970-01-01
+INPUT:
+    long long days - the number of days
+    long long *year - the year
+    int *month - the month from 1 to 12
+    int *day - the day of the month from 1
+*/
+static void GetDate(long long days, long long *year, int *month, int *day)
+{
+    long long era;
+    long long dayOfEra;
+    long long yearOfEra;
+    long long dayOfYear;
+    long long monthIndex;
+
+    days += 719468;
+    era = (days >= 0 ? days : days - 146096) / 146097;
+    dayOfEra = days - era * 146097;
+    yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    monthIndex = (5 * dayOfYear + 2) / 153;
+
+    *day = (int)(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+    *month = (int)(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+    *year = yearOfEra + era * 400 + (*month <= 2);
+}
+
+/*  Reads the decimal number of the fixed number of digits
+INPUT:
+    const char *text - the digits
+    size_t count - the number of digits
+    int *value - the number
+RETURN:
+    int - nonzero if all the characters are digits
+*/
+static int ReadDigits(const char *text, size_t count, int *value)
+{
+    size_t i;
+
+    *value = 0;
+    for (i = 0; i < count; i++)
+    {
+        if (text[i] < '0' || text[i] > '9')
+            return 0;
+        *value = *value * 10 + (text[i] - '0');
+    }
+
+    return 1;
+}
+
+/*  Reads the time of day hh:mm[:ss[.fff]], the fraction may have any number of digits
+INPUT:
+    const char *text - the characters
+    size_t length - the number of characters
+    int isSecondRequired - nonzero if the seconds must be present
+    timestamp_t *time - milliseconds since the start of the day
+RETURN:
+    size_t - the number of read characters, 0 if there is no time
+*/
+static size_t ReadTimeOfDay(const char *text, size_t length, int isSecondRequired, timestamp_t *time)
+{
+    int hour, minute, second = 0;
+    int scale = 100;
+    size_t pos = 5;
+
+    if (length < 5 || !ReadDigits(text, 2, &hour) || text[2] != ':' || !ReadDigits(text + 3, 2, &minute) ||
+        hour > 23 || minute > 59)
+        return 0;
+
+    if (length >= 8 && text[5] == ':' && ReadDigits(text + 6, 2, &second) && second <= 60)
+        pos = 8;
+    else if (isSecondRequired)
+        return 0;
+
+    *time = ((hour * 60LL + minute) * 60 + second) * 1000;
+    if (pos == 8 && pos + 1 < length && (text[pos] == '.' || text[pos] == ',') &&
+        text[pos + 1] >= '0' && text[pos + 1] <= '9')
+    {
+        for (pos++; pos < length && text[pos] >= '0' && text[pos] <= '9'; pos++, scale /= 10)
+            *time += (text[pos] - '0') * scale;
+    }
+
+    return pos;
+}
+
+/*  Parses the timestamp at the start of the line. The spaces, a bracket and
+    the syslog priority <n> before it are skipped
+INPUT:
+    time_format_t format - format of the timestamp
+    const char *text - the characters of the line start
+    size_t length - the number of characters
+    timestamp_t *time - the timestamp, the syslog one is counted from the start of the year
+RETURN:
+    int - nonzero if the line starts with a timestamp
+*/
+static int ParseTimestamp(time_format_t format, const char *text, size_t length, timestamp_t *time)
+{
+    size_t pos = 0;
+    timestamp_t dayTime;
+    int year, month, day;
+    int count;
+    size_t read;
+
+    while (pos < length && text[pos] == ' ')
+        pos++;
+    if (pos < length && text[pos] == '<')
+    {
+        while (pos < length && text[pos] != '>')
+            pos++;
+        pos++;
+    }
+    if (pos < length && (text[pos] == '[' || text[pos] == '('))
+        pos++;
+    if (pos >= length)
+        return 0;
+    text += pos;
+    length -= pos;
+
+    switch (format)
+    {
+        case TIME_ISO8601:
+            if (length < 19 || !ReadDigits(text, 4, &year) || text[4] != '-' || !ReadDigits(text + 5, 2, &month) ||
+                text[7] != '-' || !ReadDigits(text + 8, 2, &day) || (text[10] != 'T' && text[10] != ' ') ||
+                month < 1 || month > 12 || day < 1 || day > 31 ||
+                ReadTimeOfDay(text + 11, length - 11, 1, &dayTime) == 0)
+                return 0;
+            *time = GetDays(year, month, day) * DAY_MS + dayTime;
+            return 1;
+        case TIME_SYSLOG:
+            if (length < 15 || text[3] != ' ')
+                return 0;
+            for (month = 0; month < 12 && memcmp(text, months[month], 3) != 0; month++)
+                ;
+            if (month == 12 || (text[4] == ' ' ? !ReadDigits(text + 5, 1, &day) : !ReadDigits(text + 4, 2, &day)) ||
+                day < 1 || day > 31 || text[6] != ' ' || ReadTimeOfDay(text + 7, length - 7, 1, &dayTime) == 0)
+                return 0;
+            *time = (GetDays(2000, month + 1, day) - GetDays(2000, 1, 1)) * DAY_MS + dayTime;
+            return 1;
+        case TIME_EPOCH:
+        {
+            unsigned long long value = 0;
+            int scale = 100;
+
+            for (count = 0; count < (int)length && count < 20 && text[count] >= '0' && text[count] <= '9'; count++)
+                value = value * 10 + (text[count] - '0');
+            if ((size_t)count < length && text[count] >= '0' && text[count] <= '9')
+                return 0;
+
+            /* The number of digits tells the unit of the current times */
+            if (count >= 9 && count <= 11)
+            {
+                *time = (timestamp_t)value * 1000;
+                read = (size_t)count;
+                if (read + 1 < length && text[read] == '.' && text[read + 1] >= '0' && text[read + 1] <= '9')
+                    for (read++; read < length && text[read] >= '0' && text[read] <= '9'; read++, scale /= 10)
+                        *time += (text[read] - '0') * scale;
+            }
+            else if (count >= 12 && count <= 14)
+                *time = (timestamp_t)value;
+            else if (count >= 15 && count <= 17)
+                *time = (timestamp_t)(value / 1000);
+            else if (count >= 18 && count <= 19)
+                *time = (timestamp_t)(value / 1000000);
+            else
+                return 0;
+            return 1;
+        }
+        default:
+            return 0;
+    }
+}
+
+/*  Places the syslog time counted from the start of a year in the year nearest to
+    the base time, the times of other formats stay as they are
+INPUT:
+    const time_index_t *index - pointer on time index structure
+    timestamp_t time - the time
+    timestamp_t base - the time of the same or a near line
+RETURN:
+    timestamp_t - the time
+*/
+static timestamp_t AdjustTime(const time_index_t *index, timestamp_t time, timestamp_t base)
+{
+    if (index->Format != TIME_SYSLOG || base < 0)
+        return time;
+
+    time += base / SYSLOG_YEAR * SYSLOG_YEAR;
+    if (time + HALF_YEAR < base)
+        time += SYSLOG_YEAR;
+    else if (time > base + HALF_YEAR && time >= SYSLOG_YEAR)
+        time -= SYSLOG_YEAR;
+
+    return time;
+}
+
+/*  Finds the first line with a timestamp
+INPUT:
+    const time_index_t *index - pointer on time index structure
+    const model_t *model - pointer on model structure
+    index_t from - index of the first line
+    index_t to - the lines before this one are looked through
+    index_t *line - index of the line with the timestamp
+    timestamp_t *time - the timestamp, the syslog one is counted from the start of the year
+RETURN:
+    int - nonzero if the line is found
+*/
+static int FindStampedLine(const time_index_t *index, const model_t *model, index_t from, index_t to,
+                           index_t *line, timestamp_t *time)
+{
+    char buffer[TIME_TEXT_LIMIT];
+
+    for (; from < to; from++)
+    {
+        offset_t size = GetModelLineLength(model, from);
+        const char *text;
+
+        if (size > TIME_TEXT_LIMIT)
+            size = TIME_TEXT_LIMIT;
+        text = GetModelText(model, GetModelLineOffset(model, from), buffer, &size);
+        if (ParseTimestamp(index->Format, text, (size_t)size, time))
+        {
+            *line = from;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*  Parses the timestamps of the sampled blocks of the task. The times of a block
+    are placed in the syslog year of its first one, the times of the checkpoint
+    are moved to its own year when it is appended
+INPUT:
+    void *arg - pointer on parallel sample structure
+    unsigned long task - index of the task
+*/
+static void SampleLines(void *arg, unsigned long task)
+{
+    parallel_sample_t *job = arg;
+    index_t first = task * job->TaskSamples;
+    index_t last = job->NumOfSamples - first > job->TaskSamples ? first + job->TaskSamples : job->NumOfSamples;
+    index_t i;
+
+    for (i = first; i < last; i++)
+    {
+        time_checkpoint_t *slot = &job->Slots[i];
+        index_t from = (job->FirstSample + i) * TIME_SAMPLE_LINES;
+        index_t to = job->EndLine - from > TIME_SAMPLE_LINES ? from + TIME_SAMPLE_LINES : job->EndLine;
+        index_t found;
+        timestamp_t time;
+        timestamp_t previous;
+
+        if (!FindStampedLine(job->Index, job->Model, from, to, &slot->Line, &slot->Time))
+        {
+            slot->Line = job->EndLine;
+            continue;
+        }
+
+        slot->EndTime = slot->Time;
+        slot->IsOrdered = 1;
+        previous = slot->Time;
+        for (from = slot->Line + 1; FindStampedLine(job->Index, job->Model, from, to, &found, &time); from = found + 1)
+        {
+            time = AdjustTime(job->Index, time, previous);
+            if (time < slot->EndTime)
+                slot->IsOrdered = 0;
+            else
+                slot->EndTime = time;
+            previous = time;
+        }
+    }
+}
+
+/*  Drops the checkpoints of the lines from the line on
+INPUT:
+    time_index_t *index - pointer on time index structure
+    index_t line - index of the first dropped line
+*/
+static void TrimPoints(time_index_t *index, index_t line)
+{
+    while (index->NumOfPoints > 0 && index->Points[index->NumOfPoints - 1].Line >= line)
+    {
+        time_checkpoint_t *point = &index->Points[--index->NumOfPoints];
+
+        if (!point->IsOrdered)
+            index->NumOfDisorders--;
+    }
+}
+
+/*  Samples the blocks of the model from SampledLines in parallel and appends the checkpoints
+INPUT:
+    time_index_t *index - pointer on time index structure with SampledLines at the start of a block
+    const model_t *model - pointer on model structure
+    index_t endLine - the lines before this one are sampled
+RETURN:
+    error_t - error code
+*/
+static error_t SampleIndex(time_index_t *index, const model_t *model, index_t endLine)
+{
+    parallel_sample_t job;
+    index_t maxTasks = GetThreadPoolLimit() * TASKS_PER_THREAD;
+    index_t numOfTasks;
+    index_t i;
+
+    job.Index = index;
+    job.Model = model;
+    job.FirstSample = index->SampledLines / TIME_SAMPLE_LINES;
+    job.NumOfSamples = (endLine + TIME_SAMPLE_LINES - 1) / TIME_SAMPLE_LINES - job.FirstSample;
+    job.EndLine = endLine;
+    numOfTasks = (job.NumOfSamples + TIME_TASK_SAMPLES - 1) / TIME_TASK_SAMPLES;
+    if (numOfTasks > maxTasks)
+        numOfTasks = maxTasks;
+    job.TaskSamples = (job.NumOfSamples + numOfTasks - 1) / numOfTasks;
+
+    if (index->NumOfPoints + job.NumOfSamples > index->Capacity)
+    {
+        index_t capacity = index->Capacity > 0 ? index->Capacity : MIN_POINTS;
+        time_checkpoint_t *tmp;
+
+        while (capacity < index->NumOfPoints + job.NumOfSamples)
+            capacity *= 2;
+        tmp = FITS_IN_MEMORY(capacity, sizeof(time_checkpoint_t))
+            ? realloc(index->Points, (size_t)capacity * sizeof(time_checkpoint_t)) : NULL;
+        if (tmp == NULL)
+            return MEMORY_SHORTAGE;
+        index->Points = tmp;
+        index->Capacity = capacity;
+    }
+
+    /* The slots are the free checkpoints, the found ones are moved to the end of the index */
+    job.Slots = index->Points + index->NumOfPoints;
+    if (numOfTasks > 1)
+        RunParallel(SampleLines, &job, (unsigned long)numOfTasks);
+    else
+        SampleLines(&job, 0);
+
+    for (i = 0; i < job.NumOfSamples; i++)
+    {
+        time_checkpoint_t point = job.Slots[i];
+
+        if (point.Line == job.EndLine)
+            continue;
+
+        if (index->NumOfPoints > 0)
+        {
+            const time_checkpoint_t *last = &index->Points[index->NumOfPoints - 1];
+            timestamp_t time = AdjustTime(index, point.Time, last->Time);
+
+            point.EndTime += time - point.Time;
+            point.Time = time;
+            point.MaxTime = time > last->EndTime ? time : last->EndTime;
+        }
+        else
+            point.MaxTime = point.Time;
+        if (point.Time < point.MaxTime)
+            point.IsOrdered = 0;
+        if (point.EndTime < point.MaxTime)
+            point.EndTime = point.MaxTime;
+
+        if (!point.IsOrdered)
+            index->NumOfDisorders++;
+        index->Points[index->NumOfPoints++] = point;
+    }
+
+    index->SampledLines = endLine;
+    return SUCCESS;
+}
+
+/*  Sets the format of the timestamps, the checkpoints of another format are dropped.
+    The lines are sampled by UpdateTimeIndex
+INPUT:
+    time_index_t *index - pointer on time index structure
+    time_format_t format - format of the timestamps
+*/
+void SetTimeIndexFormat(time_index_t *index, time_format_t format)
+{
+    if (!index->IsEnabled || index->Format != format)
+    {
+        index->Format = format;
+        index->IsEnabled = 1;
+        index->Model = NULL;
+    }
+}
+
+/*  Checks whether the format of the timestamps is set
+INPUT:
+    const time_index_t *index - pointer on time index structure
+RETURN:
+    int - nonzero if the format is set
+*/
+int HasTimeIndex(const time_index_t *index)
+{
+    return index->IsEnabled;
+}
+
+/*  Samples the lines loaded or appended since the last call. The lines taken back
+    by the model to be extended are sampled again
+INPUT:
+    time_index_t *index - pointer on time index structure
+    const model_t *model - pointer on model structure, the loader must not change its lines
+RETURN:
+    error_t - error code
+*/
+error_t UpdateTimeIndex(time_index_t *index, const model_t *model)
+{
+    return UpdateTimeIndexPart(index, model, (index_t)-1);
+}
+
+/*  Samples at most the number of lines loaded or appended since the last call,
+    so a long sampling can be split into parts
+INPUT:
+    time_index_t *index - pointer on time index structure
+    const model_t *model - pointer on model structure, the loader must not change its lines
+    index_t numOfLines - the number of lines, a multiple of TIME_SAMPLE_LINES
+RETURN:
+    error_t - error code
+*/
+error_t UpdateTimeIndexPart(time_index_t *index, const model_t *model, index_t numOfLines)
+{
+    index_t endLine = model->NumOfLines > 0 ? model->NumOfLines - 1 : 0;
+
+    if (!index->IsEnabled)
+        return SUCCESS;
+
+    /* The lines of another file are sampled from the start */
+    if (index->Model != model || index->LoadId != model->LoadId)
+    {
+        index->NumOfPoints = 0;
+        index->SampledLines = 0;
+        index->NumOfDisorders = 0;
+        index->Model = model;
+        index->LoadId = model->LoadId;
+    }
+
+    /* The last line may be extended, it is looked through by the search */
+    if (index->SampledLines == endLine)
+        return SUCCESS;
+
+    /* The order and the latest time of the last block take all its lines */
+    if (index->SampledLines > endLine)
+        index->SampledLines = endLine;
+    index->SampledLines -= index->SampledLines % TIME_SAMPLE_LINES;
+    TrimPoints(index, index->SampledLines);
+    if (index->SampledLines == endLine)
+        return SUCCESS;
+
+    /* The part ends at a block, the next part starts there */
+    if (endLine - index->SampledLines > numOfLines)
+        endLine = index->SampledLines + numOfLines;
+
+    return SampleIndex(index, model, endLine);
+}
+
+/*  Checks whether every line of the model but the last one is sampled
+INPUT:
+    const time_index_t *index - pointer on time index structure
+    const model_t *model - pointer on model structure
+RETURN:
+    int - nonzero if UpdateTimeIndex has nothing to sample
+*/
+int IsTimeIndexUpdated(const time_index_t *index, const model_t *model)
+{
+    index_t endLine = model->NumOfLines > 0 ? model->NumOfLines - 1 : 0;
+
+    if (!index->IsEnabled)
+        return 1;
+
+    return index->Model == model && index->LoadId == model->LoadId && index->SampledLines == endLine;
+}
+
+/*  Finds the first checkpoint after the line
+INPUT:
+    const time_index_t *index - pointer on time index structure
+    index_t line - index of the line
+RETURN:
+    index_t - index of the checkpoint, NumOfPoints if every checkpoint is at or before the line
+*/
+static index_t FindNextPoint(const time_index_t *index, index_t line)
+{
+    index_t low = 0;
+    index_t high = index->NumOfPoints;
+
+    while (low < high)
+    {
+        index_t middle = low + (high - low) / 2;
+
+        if (index->Points[middle].Line <= line)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+/*  Parses the timestamp at the start of the line
+INPUT:
+    const time_index_t *index - pointer on time index structure with the format
+    const model_t *model - pointer on model structure
+    index_t line - index of the line
+    timestamp_t base - the time of a near line placing the syslog year, negative if it is unknown
+    timestamp_t *time - the timestamp
+RETURN:
+    int - nonzero if the line starts with a timestamp
+*/
+int ReadLineTime(const time_index_t *index, const model_t *model, index_t line, timestamp_t base, timestamp_t *time)
+{
+    index_t found;
+
+    if (!FindStampedLine(index, model, line, line + 1, &found, time))
+        return 0;
+
+    *time = AdjustTime(index, *time, base);
+    return 1;
+}
+
+/*  Finds the timestamp of the line or of the first line after it having one,
+    TIME_SCAN_LINES lines are looked through
+INPUT:
+    const time_index_t *index - pointer on updated time index structure
+    const model_t *model - pointer on model structure
+    index_t line - index of the line
+    timestamp_t *time - the timestamp
+RETURN:
+    int - nonzero if the timestamp is found
+*/
+int GetLineTime(const time_index_t *index, const model_t *model, index_t line, timestamp_t *time)
+{
+    index_t point = FindNextPoint(index, line);
+    index_t to = model->NumOfLines - line > TIME_SCAN_LINES ? line + TIME_SCAN_LINES : model->NumOfLines;
+    index_t found;
+
+    if (!index->IsEnabled || !FindStampedLine(index, model, line, to, &found, time))
+        return 0;
+
+    /* The syslog year is the one of the nearest checkpoint */
+    if (point > 0)
+        *time = AdjustTime(index, *time, index->Points[point - 1].Time);
+    else if (point < index->NumOfPoints)
+        *time = AdjustTime(index, *time, index->Points[point].Time);
+
+    return 1;
+}
+
+/*  Finds the first line with the timestamp at or after the time among the lines
+    between the checkpoints. The probes alternate between the guess interpolated
+    from the times at the ends and the middle, so the search takes the logarithm
+    of the lines even when the times are uneven. The lines without timestamps
+    belong to the next line having one
+INPUT:
+    const time_index_t *index - pointer on time index structure
+    const model_t *model - pointer on model structure
+    timestamp_t time - the time
+    index_t low - index of the first line
+    index_t high - the lines before this one are searched
+    timestamp_t lowTime - the time of the line before the first one, negative if it is unknown
+    timestamp_t highTime - the time of the line at high, less than lowTime if it is unknown
+    index_t *line - index of the line, it stays if the line is not found
+RETURN:
+    int - nonzero if the line is found
+*/
+static int SearchLines(const time_index_t *index, const model_t *model, timestamp_t time, index_t low,
+                       index_t high, timestamp_t lowTime, timestamp_t highTime, index_t *line)
+{
+    int isFound = 0;
+    int isInterpolated = 1;
+
+    while (low < high)
+    {
+        index_t middle = low + (high - low) / 2;
+        index_t found;
+        timestamp_t foundTime;
+
+        if (isInterpolated && lowTime >= 0 && highTime > lowTime && time > lowTime && time <= highTime)
+        {
+            middle = low + (index_t)((double)(time - lowTime) / (highTime - lowTime) * (high - low));
+            if (middle >= high)
+                middle = high - 1;
+        }
+        isInterpolated = !isInterpolated;
+
+        if (!FindStampedLine(index, model, middle, high, &found, &foundTime))
+        {
+            high = middle;
+            continue;
+        }
+
+        foundTime = AdjustTime(index, foundTime, lowTime);
+        if (foundTime >= time)
+        {
+            *line = found;
+            isFound = 1;
+            high = middle;
+            highTime = foundTime;
+        }
+        else
+        {
+            low = found + 1;
+            lowTime = foundTime;
+        }
+    }
+
+    return isFound;
+}
+
+/*  Finds the first line with the timestamp at or after the time looking through
+    the lines one by one
+INPUT:
+    const time_index_t *index - pointer on time index structure
+    const model_t *model - pointer on model structure
+    timestamp_t time - the time
+    index_t from - index of the first line
+    index_t to - the lines before this one are looked through
+    timestamp_t base - the time of the line before the first one placing the syslog year, negative if it is unknown
+    index_t *line - index of the line, it stays if the line is not found
+RETURN:
+    int - nonzero if the line is found
+*/
+static int ScanLines(const time_index_t *index, const model_t *model, timestamp_t time, index_t from, index_t to,
+                     timestamp_t base, index_t *line)
+{
+    index_t found;
+    timestamp_t foundTime;
+
+    for (; FindStampedLine(index, model, from, to, &found, &foundTime); from = found + 1)
+    {
+        foundTime = AdjustTime(index, foundTime, base);
+        if (foundTime >= time)
+        {
+            *line = found;
+            return 1;
+        }
+        base = foundTime;
+    }
+
+    return 0;
+}
+
+/*  Finds the first line with the timestamp at or after the time, the lines out of
+    order are looked through, so it is also the first line with the latest
+    timestamp so far at or after the time
+INPUT:
+    const time_index_t *index - pointer on updated time index structure
+    const model_t *model - pointer on model structure
+    timestamp_t time - the time
+    index_t *line - index of the line
+RETURN:
+    int - nonzero if the line is found, zero if every timestamp is earlier
+*/
+int FindTimeLine(const time_index_t *index, const model_t *model, timestamp_t time, index_t *line)
+{
+    index_t low = 0;
+    index_t high = index->NumOfPoints;
+    timestamp_t lowTime = -1;
+
+    if (!index->IsEnabled || model->NumOfLines == 0)
+        return 0;
+
+    /* The latest times of the checkpoints grow even where the times go back */
+    while (low < high)
+    {
+        index_t middle = low + (high - low) / 2;
+
+        if (index->Points[middle].MaxTime < time)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    if (low < index->NumOfPoints)
+        *line = index->Points[low].Line;
+
+    /* The lines after the block of the checkpoint up to the next one have no timestamps */
+    if (low > 0)
+    {
+        const time_checkpoint_t *point = &index->Points[low - 1];
+        index_t first = point->Line + 1;
+        index_t last = (point->Line / TIME_SAMPLE_LINES + 1) * TIME_SAMPLE_LINES;
+        timestamp_t highTime = -2;
+
+        lowTime = point->Time;
+        if (last > index->SampledLines)
+            last = index->SampledLines;
+        if (low < index->NumOfPoints && index->Points[low].Line == last)
+            highTime = index->Points[low].Time;
+
+        if (point->EndTime >= time && (point->IsOrdered
+            ? SearchLines(index, model, time, first, last, lowTime, highTime, line)
+            : ScanLines(index, model, time, first, last, lowTime, line)))
+            return 1;
+    }
+    if (low < index->NumOfPoints)
+        return 1;
+
+    /* The last lines are not sampled */
+    return ScanLines(index, model, time, index->SampledLines, model->NumOfLines, lowTime, line);
+}
+
+/*  Parses the time typed in the format of the index. The time of day alone,
+    hh:mm[:ss[.fff]], is taken on the day of the reference time
+INPUT:
+    const time_index_t *index - pointer on time index structure
+    const char *text - the text ending with zero
+    timestamp_t reference - the time giving the day
+    timestamp_t *time - the parsed time
+RETURN:
+    error_t - error code, BAD_TIME if the text is not a time
+*/
+error_t ParseTimeText(const time_index_t *index, const char *text, timestamp_t reference, timestamp_t *time)
+{
+    size_t length;
+    timestamp_t dayTime;
+
+    while (*text == ' ')
+        text++;
+    length = strlen(text);
+    while (length > 0 && text[length - 1] == ' ')
+        length--;
+
+    if (length > 0 && ReadTimeOfDay(text, length, 0, &dayTime) == length)
+    {
+        *time = (reference >= 0 ? reference / DAY_MS : (reference - DAY_MS + 1) / DAY_MS) * DAY_MS + dayTime;
+        return SUCCESS;
+    }
+
+    if (!ParseTimestamp(index->Format, text, length, time))
+        return BAD_TIME;
+
+    /* The typed syslog date is taken in the year of the reference */
+    *time = AdjustTime(index, *time, reference);
+    return SUCCESS;
+}
+
+/*  Writes the time in the format of the index
+INPUT:
+    const time_index_t *index - pointer on time index structure
+    timestamp_t time - the time
+    char *text - buffer of TIME_TEXT_SIZE characters for the text ending with zero
+*/
+void FormatTimeText(const time_index_t *index, timestamp_t time, char *text)
+{
+    long long days = time >= 0 ? time / DAY_MS : (time - DAY_MS + 1) / DAY_MS;
+    long long dayTime = time - days * DAY_MS;
+    long long year;
+    int month, day;
+
+    switch (index->Format)
+    {
+        case TIME_SYSLOG:
+            GetDate(GetDays(2000, 1, 1) + days % 366, &year, &month, &day);
+            sprintf(text, "%s %2d %02d:%02d:%02d", months[month - 1], day, (int)(dayTime / 3600000),
+                    (int)(dayTime / 60000 % 60), (int)(dayTime / 1000 % 60));
+            break;
+        case TIME_EPOCH:
+            sprintf(text, "%s%lld.%03d", time < 0 && time > -1000 ? "-" : "", time / 1000,
+                    (int)(time < 0 ? -time % 1000 : time % 1000));
+            break;
+        default:
+            GetDate(days, &year, &month, &day);
+            sprintf(text, "%04d-%02d-%02d %02d:%02d:%02d.%03d", (int)year, month, day, (int)(dayTime / 3600000),
+                    (int)(dayTime / 60000 % 60), (int)(dayTime / 1000 % 60), (int)(dayTime % 1000));
+            break;
+    }
+}
+
+/*  Releases the time index
+INPUT:
+    time_index_t *index - pointer on time index structure
+OUTPUT:
+    time_index_t *index - pointer on time index structure without format
+*/
+void ClearTimeIndex(time_index_t *index)
+{
+    if (index == NULL)
+        return;
+
+    free(index->Points);
+    InitTimeIndex(index);
+}
@@ -0,0 +1,175 @@
+#ifndef __TIME_INDEX_H_INCLUDED
+#define __TIME_INDEX_H_INCLUDED
+
+#include "fileModel.h"
+
+#define TIME_SAMPLE_LINES 1024      /* The number of lines of a sampled block */
+#define TIME_SCAN_LINES 64          /* The number of lines from a line looked through for its timestamp */
+#define TIME_TEXT_LIMIT 64          /* The number of characters of the line start holding the timestamp */
+#define TIME_TASK_SAMPLES 16        /* Minimum number of blocks sampled by one task */
+#define TIME_TEXT_SIZE 32           /* Size of the buffer of the formatted time */
+
+/* Format of the timestamps at the start of the lines */
+typedef enum
+{
+    TIME_ISO8601,       /* 2024-05-17T14:03:07.250+02:00, the date and the time may be separated by a space */
+    TIME_SYSLOG,        /* May 17 14:03:07, the year is counted from the start of the file */
+    TIME_EPOCH          /* Seconds since 1970 with an optional fraction, or milliseconds, microseconds, nanoseconds */
+} time_format_t;
+
+/*  Milliseconds since 1970-01-01 00:00:00 of the time shown in the file. The zone
+    of ISO 8601 timestamps is ignored, so the time of day is the one of the text */
+typedef long long timestamp_t;
+
+/* The first timestamp of a sampled block */
+typedef struct
+{
+    index_t Line;               /* Index of the line with the timestamp */
+    timestamp_t Time;           /* The timestamp */
+    timestamp_t MaxTime;        /* The latest timestamp of the lines up to this one */
+    timestamp_t EndTime;        /* The latest timestamp of the lines up to the end of the block */
+    int IsOrdered;              /* Nonzero if every timestamp from this one to the end of the block is the latest so far */
+} time_checkpoint_t;
+
+/*  Timestamps of the lines sampled in blocks of TIME_SAMPLE_LINES lines. Every
+    line of a block is parsed once, the first timestamp of the block is kept as
+    its checkpoint together with the latest time so far and the order of the
+    rest of the block. The latest times of the checkpoints grow even where the
+    times go back, so the first line at or after a time lies in the block of the
+    last checkpoint with the latest time before it or at the next checkpoint. It
+    is found by the binary search over the checkpoints and then over the lines of
+    the block, the probes are guessed by the interpolation of the times. A block
+    out of order is looked through line by line */
+typedef struct
+{
+    time_format_t Format;           /* Format of the timestamps */
+    int IsEnabled;                  /* Nonzero if the format is set */
+    time_checkpoint_t *Points;      /* The checkpoints in the order of the lines */
+    index_t NumOfPoints;            /* The number of checkpoints */
+    index_t Capacity;               /* The number of allocated checkpoints */
+    index_t SampledLines;           /* The lines before this one are sampled, the last line of the model is not */
+    index_t NumOfDisorders;         /* The number of checkpoints of the blocks out of order */
+    const model_t *Model;           /* The indexed model */
+    unsigned long LoadId;           /* LoadId of the model the checkpoints belong to */
+} time_index_t;
+
+/*  Initializes the time index
+INPUT:
+    time_index_t *index - pointer on time index structure
+OUTPUT:
+    time_index_t *index - pointer on time index structure without format
+*/
+void InitTimeIndex(time_index_t *index);
+
+/*  Sets the format of the timestamps, the checkpoints of another format are dropped.
+    The lines are sampled by UpdateTimeIndex
+INPUT:
+    time_index_t *index - pointer on time index structure
+    time_format_t format - format of the timestamps
+*/
+void SetTimeIndexFormat(time_index_t *index, time_format_t format);
+
+/*  Checks whether the format of the timestamps is set
+INPUT:
+    const time_index_t *index - pointer on time index structure
+RETURN:
+    int - nonzero if the format is set
+*/
+int HasTimeIndex(const time_index_t *index);
+
+/*  Samples the lines loaded or appended since the last call. The block of the
+    last sampled lines is sampled again, it may have got more lines
+INPUT:
+    time_index_t *index - pointer on time index structure
+    const model_t *model - pointer on model structure, the loader must not change its lines
+RETURN:
+    error_t - error code
+*/
+error_t UpdateTimeIndex(time_index_t *index, const model_t *model);
+
+/*  Samples at most the number of lines loaded or appended since the last call,
+    so a long sampling can be split into parts
+INPUT:
+    time_index_t *index - pointer on time index structure
+    const model_t *model - pointer on model structure, the loader must not change its lines
+    index_t numOfLines - the number of lines, a multiple of TIME_SAMPLE_LINES
+RETURN:
+    error_t - error code
+*/
+error_t UpdateTimeIndexPart(time_index_t *index, const model_t *model, index_t numOfLines);
+
+/*  Checks whether every line of the model but the last one is sampled
+INPUT:
+    const time_index_t *index - pointer on time index structure
+    const model_t *model - pointer on model structure
+RETURN:
+    int - nonzero if UpdateTimeIndex has nothing to sample
+*/
+int IsTimeIndexUpdated(const time_index_t *index, const model_t *model);
+
+/*  Parses the timestamp at the start of the line
+INPUT:
+    const time_index_t *index - pointer on time index structure with the format
+    const model_t *model - pointer on model structure
+    index_t line - index of the line
+    timestamp_t base - the time of a near line placing the syslog year, negative if it is unknown
+    timestamp_t *time - the timestamp
+RETURN:
+    int - nonzero if the line starts with a timestamp
+*/
+int ReadLineTime(const time_index_t *index, const model_t *model, index_t line, timestamp_t base, timestamp_t *time);
+
+/*  Finds the timestamp of the line or of the first line after it having one,
+    TIME_SCAN_LINES lines are looked through
+INPUT:
+    const time_index_t *index - pointer on updated time index structure
+    const model_t *model - pointer on model structure
+    index_t line - index of the line
+    timestamp_t *time - the timestamp
+RETURN:
+    int - nonzero if the timestamp is found
+*/
+int GetLineTime(const time_index_t *index, const model_t *model, index_t line, timestamp_t *time);
+
+/*  Finds the first line with the timestamp at or after the time, the lines out of
+    order are looked through, so it is also the first line with the latest
+    timestamp so far at or after the time
+INPUT:
+    const time_index_t *index - pointer on updated time index structure
+    const model_t *model - pointer on model structure
+    timestamp_t time - the time
+    index_t *line - index of the line
+RETURN:
+    int - nonzero if the line is found, zero if every timestamp is earlier
+*/
+int FindTimeLine(const time_index_t *index, const model_t *model, timestamp_t time, index_t *line);
+
+/*  Parses the time typed in the format of the index. The time of day alone,
+    hh:mm[:ss[.fff]], is taken on the day of the reference time
+INPUT:
+    const time_index_t *index - pointer on time index structure
+    const char *text - the text ending with zero
+    timestamp_t reference - the time giving the day
+    timestamp_t *time - the parsed time
+RETURN:
+    error_t - error code, BAD_TIME if the text is not a time
+*/
+error_t ParseTimeText(const time_index_t *index, const char *text, timestamp_t reference, timestamp_t *time);
+
+/*  Writes the time in the format of the index
+INPUT:
+    const time_index_t *index - pointer on time index structure
+    timestamp_t time - the time
+    char *text - buffer of TIME_TEXT_SIZE characters for the text ending with zero
+*/
+void FormatTimeText(const time_index_t *index, timestamp_t time, char *text);
+
+/*  Releases the time index
+INPUT:
+    time_index_t *index - pointer on time index structure
+OUTPUT:
+    time_index_t *index - pointer on time index structure without format
+*/
+void ClearTimeIndex(time_index_t *index);
+
+#endif // __TIME_INDEX_H_INCLUDED
@@ -0,0 +1,538 @@
+#include "utf8Columns.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define COUNTER_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#endif
+
+#ifdef __GNUC__
+    #define TARGET_SSE2 __attribute__((target("sse2")))
+    #define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define TARGET_SSE2
+    #define TARGET_AVX2
+#endif
+
+#define FIND_BLOCK 64   /* The number of characters skipped at once while the column is searched */
+
+/* Counting function of the particular instruction set, the characters whose
+   sequences begin before stop are counted, the sequences may continue up to end */
+typedef offset_t (*count_func_t)(const unsigned char *cur, const unsigned char *stop, const unsigned char *end);
+
+/* Range of the code points of the wide characters */
+typedef struct
+{
+    unsigned long First;    /* The first code point of the range */
+    unsigned long Last;     /* The last code point of the range */
+} char_range_t;
+
+/* The wide and fullwidth characters of East Asian Width, ordered, the neighbouring ranges are merged */
+static const char_range_t wideChars[] =
+{
+    {0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x23E9, 0x23EC}, {0x23F0, 0x23F0},
+    {0x23F3, 0x23F3}, {0x25FD, 0x25FE}, {0x2614, 0x2615}, {0x2648, 0x2653}, {0x267F, 0x267F},
+    {0x2693, 0x2693}, {0x26A1, 0x26A1}, {0x26AA, 0x26AB}, {0x26BD, 0x26BE}, {0x26C4, 0x26C5},
+    {0x26CE, 0x26CE}, {0x26D4, 0x26D4}, {0x26EA, 0x26EA}, {0x26F2, 0x26F3}, {0x26F5, 0x26F5},
+    {0x26FA, 0x26FA}, {0x26FD, 0x26FD}, {0x2705, 0x2705}, {0x270A, 0x270B}, {0x2728, 0x2728},
+    {0x274C, 0x274C}, {0x274E, 0x274E}, {0x2753, 0x2755}, {0x2757, 0x2757}, {0x2795, 0x2797},
+    {0x27B0, 0x27B0}, {0x27BF, 0x27BF}, {0x2B1B, 0x2B1C}, {0x2B50, 0x2B50}, {0x2B55, 0x2B55},
+    {0x2E80, 0x303E}, {0x3041, 0x33FF}, {0x3400, 0x4DBF}, {0x4E00, 0x9FFF}, {0xA000, 0xA4CF},
+    {0xA960, 0xA97F}, {0xAC00, 0xD7A3}, {0xF900, 0xFAFF}, {0xFE10, 0xFE19}, {0xFE30, 0xFE6F},
+    {0xFF00, 0xFF60}, {0xFFE0, 0xFFE6}, {0x16FE0, 0x16FE4}, {0x17000, 0x18CFF}, {0x1B000, 0x1B2FF},
+    {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF}, {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F251},
+    {0x1F300, 0x1F64F}, {0x1F680, 0x1F6FF}, {0x1F7E0, 0x1F7EB}, {0x1F900, 0x1F9FF}, {0x1FA70, 0x1FAFF},
+    {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD},
+};
+
+/* The invisible format characters and variation selectors, ordered. Only the ones
+   encoded by three characters are here, so the ASCII and two-byte ones keep one column */
+static const char_range_t zeroWidthChars[] =
+{
+    {0x200B, 0x200F}, {0x2060, 0x2064}, {0xFE00, 0xFE0F}, {0xFEFF, 0xFEFF},
+};
+
+/*  Checks whether the character is in one of the ordered ranges
+INPUT:
+    const char_range_t *ranges - ordered ranges
+    size_t count - the number of ranges
+    unsigned long code - code point of the character
+RETURN:
+    int - nonzero if the character is in a range
+*/
+static int IsInRanges(const char_range_t *ranges, size_t count, unsigned long code)
+{
+    size_t first = 0;
+    size_t last = count;
+
+    while (first < last)
+    {
+        size_t middle = (first + last) / 2;
+
+        if (code < ranges[middle].First)
+            last = middle;
+        else if (code > ranges[middle].Last)
+            first = middle + 1;
+        else
+            return 1;
+    }
+
+    return 0;
+}
+
+/*  Returns the number of display columns taken by the character, two for the wide
+    East Asian characters, zero for the invisible ones like the byte order mark
+    and one for the others
+INPUT:
+    unsigned long code - code point of the character
+RETURN:
+    int - the number of columns
+*/
+int GetCharColumns(unsigned long code)
+{
+    /* Every wide or invisible character is encoded by three or four characters */
+    if (code < wideChars[0].First)
+        return 1;
+
+    if (IsInRanges(zeroWidthChars, sizeof(zeroWidthChars) / sizeof(zeroWidthChars[0]), code))
+        return 0;
+    return IsInRanges(wideChars, sizeof(wideChars) / sizeof(wideChars[0]), code) ? 2 : 1;
+}
+
+/*  Decodes one UTF-8 character, a damaged sequence gives REPLACEMENT_CHAR
+INPUT:
+    const char *text - pointer on the first character of the sequence
+    size_t size - the number of characters available
+    unsigned long *code - code point of the character
+RETURN:
+    size_t - the number of characters of the sequence, at least one
+*/
+size_t DecodeUtf8Char(const char *text, size_t size, unsigned long *code)
+{
+    const unsigned char *bytes = (const unsigned char *)text;
+    size_t length;
+    size_t i;
+
+    if (bytes[0] < 0x80)
+    {
+        *code = bytes[0];
+        return 1;
+    }
+
+    if (bytes[0] < 0xC0 || bytes[0] >= 0xF8)
+    {
+        *code = REPLACEMENT_CHAR;
+        return 1;
+    }
+
+    length = bytes[0] >= 0xF0 ? 4 : bytes[0] >= 0xE0 ? 3 : 2;
+    *code = bytes[0] & (0x7F >> length);
+    for (i = 1; i < length; i++)
+    {
+        /* The valid part of the sequence is taken with it, the next character starts a new one */
+        if (i >= size || (bytes[i] & 0xC0) != 0x80)
+        {
+            *code = REPLACEMENT_CHAR;
+            return i;
+        }
+        *code = *code << 6 | (bytes[i] & 0x3F);
+    }
+
+    if (*code > 0x10FFFF || (*code >= 0xD800 && *code <= 0xDFFF))
+        *code = REPLACEMENT_CHAR;
+    return length;
+}
+
+/*  Counts the columns of the characters one at a time (used for tails, the blocks
+    with long sequences and as a fallback)
+INPUT:
+    const unsigned char *cur - pointer on the beginning of the text
+    const unsigned char *stop - the characters whose sequences begin before it are counted
+    const unsigned char *end - pointer past the end of the text
+RETURN:
+    offset_t - the number of columns
+*/
+static offset_t CountScalar(const unsigned char *cur, const unsigned char *stop, const unsigned char *end)
+{
+    offset_t columns = 0;
+
+    for (; cur < stop; cur++)
+    {
+        unsigned long code;
+
+        /* The bytes continuing a sequence are counted with its first one */
+        if (*cur < 0x80 || (*cur >= 0xC0 && *cur < 0xE0))
+            columns++;
+        else if (*cur >= 0xE4 && *cur <= 0xE9 && end - cur >= 3 && (*cur > 0xE4 || cur[1] >= 0xB8) &&
+                 (cur[1] & 0xC0) == 0x80 && (cur[2] & 0xC0) == 0x80)
+            columns += 2;   /* U+4E00..U+9FFF, the ideographs are wide */
+        else if (*cur >= 0xE0)
+        {
+            DecodeUtf8Char((const char *)cur, end - cur, &code);
+            columns += GetCharColumns(code);
+        }
+    }
+
+    return columns;
+}
+
+#ifdef COUNTER_X86
+
+/*  Returns the number of set bits
+INPUT:
+    unsigned mask - bit mask
+RETURN:
+    unsigned - the number of bits
+*/
+static unsigned CountBits(unsigned mask)
+{
+#if defined(__GNUC__)
+    return __builtin_popcount(mask);
+#else
+    mask = mask - ((mask >> 1) & 0x55555555u);
+    mask = (mask & 0x33333333u) + ((mask >> 2) & 0x33333333u);
+    return (((mask + (mask >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+#endif
+}
+
+/*  Counts the columns with SSE2 instructions, 16 characters per iteration
+INPUT:
+    const unsigned char *cur - pointer on the beginning of the text
+    const unsigned char *stop - the characters whose sequences begin before it are counted
+    const unsigned char *end - pointer past the end of the text
+RETURN:
+    offset_t - the number of columns
+*/
+TARGET_SSE2 static offset_t CountSse2(const unsigned char *cur, const unsigned char *stop, const unsigned char *end)
+{
+    const __m128i lastTrail = _mm_set1_epi8(-65);       /* 0xBF, the last byte continuing a sequence */
+    const __m128i lastShortLead = _mm_set1_epi8(-33);   /* 0xDF, the last first byte of two-byte sequences */
+    offset_t columns = 0;
+
+    for (; stop - cur >= 16; cur += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)cur);
+        unsigned high = (unsigned)_mm_movemask_epi8(bytes);
+
+        if (high == 0)
+            columns += 16;
+        else if ((high & (unsigned)_mm_movemask_epi8(_mm_cmpgt_epi8(bytes, lastShortLead))) != 0)
+            columns += CountScalar(cur, cur + 16, end);
+        else
+            columns += CountBits((unsigned)_mm_movemask_epi8(_mm_cmpgt_epi8(bytes, lastTrail)));
+    }
+
+    return columns + CountScalar(cur, stop, end);
+}
+
+/*  Counts the columns with AVX2 instructions, 32 characters per iteration
+INPUT:
+    const unsigned char *cur - pointer on the beginning of the text
+    const unsigned char *stop - the characters whose sequences begin before it are counted
+    const unsigned char *end - pointer past the end of the text
+RETURN:
+    offset_t - the number of columns
+*/
+TARGET_AVX2 static offset_t CountAvx2(const unsigned char *cur, const unsigned char *stop, const unsigned char *end)
+{
+    const __m256i lastTrail = _mm256_set1_epi8(-65);
+    const __m256i lastShortLead = _mm256_set1_epi8(-33);
+    offset_t columns = 0;
+
+    for (; stop - cur >= 32; cur += 32)
+    {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)cur);
+        unsigned high = (unsigned)_mm256_movemask_epi8(bytes);
+
+        if (high == 0)
+            columns += 32;
+        else if ((high & (unsigned)_mm256_movemask_epi8(_mm256_cmpgt_epi8(bytes, lastShortLead))) != 0)
+            columns += CountScalar(cur, cur + 32, end);
+        else
+            columns += CountBits((unsigned)_mm256_movemask_epi8(_mm256_cmpgt_epi8(bytes, lastTrail)));
+    }
+
+    return columns + CountScalar(cur, stop, end);
+}
+
+#endif // COUNTER_X86
+
+/*  Chooses the counting function for the instruction set of the processor
+RETURN:
+    count_func_t - the fastest supported counting function
+*/
+static count_func_t ChooseCounter(void)
+{
+#if defined(COUNTER_X86) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return CountAvx2;
+    if (__builtin_cpu_supports("sse2"))
+        return CountSse2;
+#elif defined(COUNTER_X86) && defined(_MSC_VER)
+    int info[4];
+
+    __cpuid(info, 0);
+    if (info[0] >= 7)
+    {
+        int features[4];
+
+        /* AVX2 also needs the OS to save the YMM registers */
+        __cpuid(features, 1);
+        __cpuidex(info, 7, 0);
+        if ((features[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6 && (info[1] & (1 << 5)))
+            return CountAvx2;
+    }
+    __cpuid(info, 1);
+    if (info[3] & (1 << 26))
+        return CountSse2;
+#endif
+
+    return CountScalar;
+}
+
+/*  Counts the columns of the characters whose sequences begin before stop
+INPUT:
+    const unsigned char *cur - pointer on the beginning of the text
+    const unsigned char *stop - the characters whose sequences begin before it are counted
+    const unsigned char *end - pointer past the end of the text
+RETURN:
+    offset_t - the number of columns
+*/
+static offset_t CountRange(const unsigned char *cur, const unsigned char *stop, const unsigned char *end)
+{
+    static count_func_t count = NULL;
+
+    /* The choice is the same for every thread, so the race here is harmless */
+    if (count == NULL)
+        count = ChooseCounter();
+
+    return count(cur, stop, end);
+}
+
+/*  Counts the display columns of the UTF-8 text. The bytes continuing a sequence take
+    no column, so the ASCII and two-byte characters are counted by the vector compares
+    and only the blocks with longer sequences are decoded to look up the wide characters.
+    The fastest available instruction set (AVX2, SSE2 or scalar) is chosen at runtime
+INPUT:
+    const char *text - pointer on the text
+    offset_t size - the number of characters in the text
+RETURN:
+    offset_t - the number of columns, never more than size
+*/
+offset_t CountColumns(const char *text, offset_t size)
+{
+    const unsigned char *cur = (const unsigned char *)text;
+
+    return CountRange(cur, cur + size, cur + size);
+}
+
+/*  Finds the first character of the UTF-8 text that starts at the column or after it
+INPUT:
+    const char *text - pointer on the text
+    size_t size - the number of characters in the text
+    offset_t column - the column
+    offset_t *start - the column the found character starts at
+RETURN:
+    size_t - offset of the found character, size if every character starts before the column
+*/
+size_t FindColumn(const char *text, size_t size, offset_t column, offset_t *start)
+{
+    const unsigned char *cur = (const unsigned char *)text;
+    const unsigned char *end = cur + size;
+    offset_t columns = 0;
+
+    /* A character takes at least as many bytes as columns, so no one starts so far */
+    if (column >= size)
+    {
+        *start = CountColumns(text, size);
+        return size;
+    }
+
+    /* The whole blocks before the column are counted, the last one is walked */
+    for (; end - cur >= FIND_BLOCK; cur += FIND_BLOCK)
+    {
+        offset_t blockColumns = CountRange(cur, cur + FIND_BLOCK, end);
+
+        if (columns + blockColumns > column)
+            break;
+        columns += blockColumns;
+    }
+
+    for (; cur < end; cur++)
+    {
+        unsigned long code;
+
+        if (*cur >= 0x80 && *cur < 0xC0)
+            continue;
+        if (columns >= column)
+            break;
+
+        DecodeUtf8Char((const char *)cur, end - cur, &code);
+        columns += GetCharColumns(code);
+    }
+
+    *start = columns;
+    return cur - (const unsigned char *)text;
+}
+
+/*  Counts the display columns of the UTF-8 text having tabs, a tab takes the columns
+    up to the next tab stop. The parts between the tabs are counted by CountColumns
+INPUT:
+    const char *text - pointer on the text
+    offset_t size - the number of characters in the text
+    offset_t from - the column the text starts at
+    int tabSize - the distance between the tab stops
+RETURN:
+    offset_t - the column after the text
+*/
+offset_t CountTabColumns(const char *text, offset_t size, offset_t from, int tabSize)
+{
+    const char *end = text + size;
+    offset_t column = from;
+
+    while (text < end)
+    {
+        const char *tab = memchr(text, '\t', end - text);
+
+        if (tab == NULL)
+            return column + CountColumns(text, end - text);
+
+        column += CountColumns(text, tab - text);
+        column = (column / tabSize + 1) * tabSize;
+        text = tab + 1;
+    }
+
+    return column;
+}
+
+/*  Finds the first character of the UTF-8 text having tabs that starts at the column or after it
+INPUT:
+    const char *text - pointer on the text
+    size_t size - the number of characters in the text
+    offset_t from - the column the text starts at
+    offset_t column - the column
+    int tabSize - the distance between the tab stops
+    offset_t *start - the column the found character starts at
+RETURN:
+    size_t - offset of the found character, size if every character starts before the column
+*/
+size_t FindTabColumn(const char *text, size_t size, offset_t from, offset_t column, int tabSize, offset_t *start)
+{
+    size_t pos = 0;
+
+    *start = from;
+    while (pos < size && *start < column)
+    {
+        const char *tab = memchr(text + pos, '\t', size - pos);
+        size_t end = tab != NULL ? (size_t)(tab - text) : size;
+        offset_t reached;
+        size_t found = pos + FindColumn(text + pos, end - pos, column - *start, &reached);
+
+        *start += reached;
+        if (found < end || end == size)
+            return found;
+
+        /* The tab starts before the column if the text before it does */
+        pos = end;
+        if (*start >= column)
+            break;
+        *start = (*start / tabSize + 1) * tabSize;
+        pos++;
+    }
+
+    return pos;
+}
+
+/*  Returns the size of the text without the incomplete sequence at its end, so the
+    text read in parts is never decoded across the border of the parts
+INPUT:
+    const char *text - pointer on the text
+    size_t size - the number of characters in the text
+RETURN:
+    size_t - the number of characters to decode now
+*/
+size_t TrimUtf8(const char *text, size_t size)
+{
+    size_t i;
+
+    for (i = 1; i <= 3 && i <= size; i++)
+    {
+        unsigned char byte = text[size - i];
+
+        if (byte < 0x80)
+            return size;
+        if (byte >= 0xC0)
+        {
+            size_t length = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : 2;
+
+            return length > i ? size - i : size;
+        }
+    }
+
+    return size;
+}
+
+/*  Converts the characters starting in the first columns of the UTF-8 text to UTF-16,
+    a tab becomes a space as wide as the columns up to the next tab stop
+INPUT:
+    const char *text - pointer on the text
+    size_t size - the number of characters in the text
+    offset_t from - the column the text starts at
+    offset_t columns - the number of columns
+    int tabSize - the distance between the tab stops
+    wchar_t *chars - buffer of 2 * columns characters
+    int *widths - buffer of 2 * columns widths of the characters in columns,
+                  the second half of a surrogate pair has zero width
+    size_t *used - the number of converted characters of the text
+RETURN:
+    size_t - the number of UTF-16 characters
+*/
+size_t ConvertColumns(const char *text, size_t size, offset_t from, offset_t columns, int tabSize,
+                      wchar_t *chars, int *widths, size_t *used)
+{
+    size_t pos = 0;
+    size_t count = 0;
+    offset_t column = 0;
+
+    while (pos < size && column < columns)
+    {
+        unsigned long code;
+
+        if (((unsigned char)text[pos] & 0xC0) == 0x80)
+        {
+            pos++;
+            continue;
+        }
+        if (text[pos] == '\t')
+        {
+            widths[count] = tabSize - (int)((from + column) % tabSize);
+            column += widths[count];
+            chars[count++] = L' ';
+            pos++;
+            continue;
+        }
+
+        pos += DecodeUtf8Char(text + pos, size - pos, &code);
+        widths[count] = GetCharColumns(code);
+        column += widths[count];
+
+        /* The invisible characters are not drawn, so they never overflow the buffers */
+        if (widths[count] == 0)
+            continue;
+        if (code < 0x10000)
+            chars[count++] = (wchar_t)code;
+        else
+        {
+            chars[count++] = (wchar_t)(0xD800 + ((code - 0x10000) >> 10));
+            widths[count] = 0;
+            chars[count++] = (wchar_t)(0xDC00 + ((code - 0x10000) & 0x3FF));
+        }
+    }
+
+    *used = pos;
+    return count;
+}
@@ -0,0 +1,106 @@
+#ifndef __UTF8_COLUMNS_H_INCLUDED
+#define __UTF8_COLUMNS_H_INCLUDED
+
+#include <stdlib.h>
+#include "modelTypes.h"
+
+#define REPLACEMENT_CHAR 0xFFFD     /* Shown instead of a damaged UTF-8 sequence */
+
+/*  Returns the number of display columns taken by the character, two for the wide
+    East Asian characters, zero for the invisible ones like the byte order mark
+    and one for the others
+INPUT:
+    unsigned long code - code point of the character
+RETURN:
+    int - the number of columns
+*/
+int GetCharColumns(unsigned long code);
+
+/*  Decodes one UTF-8 character, a damaged sequence gives REPLACEMENT_CHAR
+INPUT:
+    const char *text - pointer on the first character of the sequence
+    size_t size - the number of characters available
+    unsigned long *code - code point of the character
+RETURN:
+    size_t - the number of characters of the sequence, at least one
+*/
+size_t DecodeUtf8Char(const char *text, size_t size, unsigned long *code);
+
+/*  Counts the display columns of the UTF-8 text. The bytes continuing a sequence take
+    no column, so the ASCII and two-byte characters are counted by the vector compares
+    and only the blocks with longer sequences are decoded to look up the wide characters.
+    The fastest available instruction set (AVX2, SSE2 or scalar) is chosen at runtime
+INPUT:
+    const char *text - pointer on the text
+    offset_t size - the number of characters in the text
+RETURN:
+    offset_t - the number of columns, never more than size
+*/
+offset_t CountColumns(const char *text, offset_t size);
+
+/*  Finds the first character of the UTF-8 text that starts at the column or after it
+INPUT:
+    const char *text - pointer on the text
+    size_t size - the number of characters in the text
+    offset_t column - the column
+    offset_t *start - the column the found character starts at
+RETURN:
+    size_t - offset of the found character, size if every character starts before the column
+*/
+size_t FindColumn(const char *text, size_t size, offset_t column, offset_t *start);
+
+/*  Counts the display columns of the UTF-8 text having tabs, a tab takes the columns
+    up to the next tab stop. The parts between the tabs are counted by CountColumns
+INPUT:
+    const char *text - pointer on the text
+    offset_t size - the number of characters in the text
+    offset_t from - the column the text starts at
+    int tabSize - the distance between the tab stops
+RETURN:
+    offset_t - the column after the text
+*/
+offset_t CountTabColumns(const char *text, offset_t size, offset_t from, int tabSize);
+
+/*  Finds the first character of the UTF-8 text having tabs that starts at the column or after it
+INPUT:
+    const char *text - pointer on the text
+    size_t size - the number of characters in the text
+    offset_t from - the column the text starts at
+    offset_t column - the column
+    int tabSize - the distance between the tab stops
+    offset_t *start - the column the found character starts at
+RETURN:
+    size_t - offset of the found character, size if every character starts before the column
+*/
+size_t FindTabColumn(const char *text, size_t size, offset_t from, offset_t column, int tabSize, offset_t *start);
+
+/*  Returns the size of the text without the incomplete sequence at its end, so the
+    text read in parts is never decoded across the border of the parts
+INPUT:
+    const char *text - pointer on the text
+    size_t size - the number of characters in the text
+RETURN:
+    size_t - the number of characters to decode now
+*/
+size_t TrimUtf8(const char *text, size_t size);
+
+/*  Converts the characters starting in the first columns of the UTF-8 text to UTF-16,
+    a tab becomes a space as wide as the columns up to the next tab stop
+INPUT:
+    const char *text - pointer on the text
+    size_t size - the number of characters in the text
+    offset_t from - the column the text starts at
+    offset_t columns - the number of columns
+    int tabSize - the distance between the tab stops
+    wchar_t *chars - buffer of 2 * columns characters
+    int *widths - buffer of 2 * columns widths of the characters in columns,
+                  the second half of a surrogate pair has zero width,
+                  the invisible characters are skipped
+    size_t *used - the number of converted characters of the text
+RETURN:
+    size_t - the number of UTF-16 characters
+*/
+size_t ConvertColumns(const char *text, size_t size, offset_t from, offset_t columns, int tabSize,
+                      wchar_t *chars, int *widths, size_t *used);
+
+#endif // __UTF8_COLUMNS_H_INCLUDED
@@ -0,0 +1,233 @@
+/*  Test driver of the block cache of the decoded files. The decoder copies the
+    characters from memory, so the cached blocks are compared with the same memory.
+    Build from the root of the repository:
+        gcc -O2 -o blockCacheTest tests/blockCacheTest.c model/blockCache.c
+    The driver prints the failed checks and returns the number of them */
+
+#include "../model/blockCache.h"
+#include <stdio.h>
+#include <string.h>
+
+#define DATA_SIZE (9 * BLOCK_SIZE + 12345)  /* The number of decoded characters, the last block is partial */
+#define NUM_OF_READERS 12                   /* The number of concurrent reading threads */
+#define NUM_OF_READS 3000                   /* The number of reads of every thread */
+#define MAX_READ (3 * BLOCK_SIZE)           /* The most characters of one read */
+
+/* Checks the condition and counts the failure */
+#define CHECK(condition) ((condition) ? (void)0 : Fail(#condition, __LINE__))
+
+/* Decoder copying the characters from memory */
+typedef struct
+{
+    const char *Data;           /* The decoded characters */
+    offset_t Available;         /* The number of characters decoded so far */
+    offset_t Damaged;           /* Offset of the damaged data, the decoding stops at it */
+    volatile LONG Calls;        /* The number of the decoded ranges */
+} memory_decoder_t;
+
+static volatile LONG failures = 0;          /* The number of failed checks */
+static char *data;                          /* The characters of the decoded file */
+static block_cache_t cache;                 /* The cache shared by the readers */
+
+/*  Reports the failed check
+INPUT:
+    const char *condition - text of the condition
+    int line - line of the check
+*/
+static void Fail(const char *condition, int line)
+{
+    if (InterlockedIncrement(&failures) <= 20)
+        printf("line %d: %s\n", line, condition);
+}
+
+/*  Returns the next random number, the sequence is the same for the same state
+INPUT:
+    unsigned long long *state - state of the random numbers
+RETURN:
+    unsigned long - the number from 0 to 2^31 - 1
+*/
+static unsigned long Random(unsigned long long *state)
+{
+    *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+    return (unsigned long)(*state >> 33);
+}
+
+/*  Copies the decoded characters from memory, see read_range_t
+*/
+static size_t ReadMemory(void *decoder, offset_t offset, char *buffer, size_t size)
+{
+    memory_decoder_t *memory = (memory_decoder_t*)decoder;
+    offset_t end = memory->Available < memory->Damaged ? memory->Available : memory->Damaged;
+
+    InterlockedIncrement(&memory->Calls);
+    if (offset >= end)
+        return 0;
+    if (size > end - offset)
+        size = (size_t)(end - offset);
+
+    memcpy(buffer, memory->Data + offset, size);
+    return size;
+}
+
+/*  Checks that no entry is pinned or loading after the reads
+*/
+static void CheckReleased(void)
+{
+    unsigned long i;
+
+    for (i = 0; i < cache.NumOfBlocks; i++)
+        CHECK(cache.Blocks[i].Pins == 0 && !cache.Blocks[i].IsLoading);
+}
+
+/*  Reads the ranges at random offsets, some of them cross several blocks or the end
+INPUT:
+    LPVOID parameter - the seed of the random numbers
+RETURN:
+    DWORD - 0
+*/
+static DWORD WINAPI ReadRandomRanges(LPVOID parameter)
+{
+    unsigned long long state = (unsigned long long)(size_t)parameter;
+    char *buffer = malloc(MAX_READ);
+    int i;
+
+    if (buffer == NULL)
+    {
+        Fail("buffer != NULL", __LINE__);
+        return 0;
+    }
+
+    for (i = 0; i < NUM_OF_READS; i++)
+    {
+        offset_t offset = ((offset_t)Random(&state) << 16 ^ Random(&state)) % (DATA_SIZE + 10);
+        offset_t size = Random(&state) % (i % 10 == 0 ? MAX_READ : 5000);
+        offset_t expected = offset >= DATA_SIZE ? 0 : size < DATA_SIZE - offset ? size : DATA_SIZE - offset;
+        offset_t copied = ReadBlocks(&cache, offset, buffer, size);
+
+        CHECK(copied == expected && memcmp(buffer, data + offset, (size_t)copied) == 0);
+    }
+
+    free(buffer);
+    return 0;
+}
+
+/*  The readers share the blocks of a cache smaller than the file, so the blocks
+    are evicted and decoded again while the others copy from them
+*/
+static void TestConcurrentReads(void)
+{
+    memory_decoder_t decoder = {NULL, DATA_SIZE, DATA_SIZE, 0};
+    HANDLE threads[NUM_OF_READERS];
+    int count = 0;
+    int i;
+
+    decoder.Data = data;
+    SetBlockCacheBudget(3 * BLOCK_SIZE);
+    InitBlockCache(&cache);
+    CHECK(OpenBlockCache(&cache, NULL, ReadMemory, &decoder, DATA_SIZE) == SUCCESS);
+    CHECK(cache.NumOfBlocks == 3);
+
+    for (i = 0; i < NUM_OF_READERS; i++)
+    {
+        threads[count] = CreateThread(NULL, 0, ReadRandomRanges, (LPVOID)(size_t)(i + 1), 0, NULL);
+        if (threads[count] != NULL)
+            count++;
+    }
+    CHECK(count == NUM_OF_READERS);
+    WaitForMultipleObjects(count, threads, TRUE, INFINITE);
+    for (i = 0; i < count; i++)
+        CloseHandle(threads[i]);
+
+    CheckReleased();
+    ClearBlockCache(&cache);
+}
+
+/*  The decoded output grows, the incomplete block is decoded again and the
+    complete ones are kept
+*/
+static void TestGrowingOutput(void)
+{
+    memory_decoder_t decoder = {NULL, BLOCK_SIZE + 100, DATA_SIZE, 0};
+    char *buffer = malloc(2 * BLOCK_SIZE);
+    LONG calls;
+
+    if (buffer == NULL)
+    {
+        Fail("buffer != NULL", __LINE__);
+        return;
+    }
+
+    decoder.Data = data;
+    SetBlockCacheBudget(BLOCK_CACHE_BUDGET);
+    InitBlockCache(&cache);
+    CHECK(OpenBlockCache(&cache, NULL, ReadMemory, &decoder, decoder.Available) == SUCCESS);
+    CHECK(ReadBlocks(&cache, BLOCK_SIZE - 50, buffer, 1000) == 150);
+    CHECK(memcmp(buffer, data + BLOCK_SIZE - 50, 150) == 0);
+    CHECK(decoder.Calls == 2);
+
+    /* Only the partial second block is decoded again */
+    decoder.Available = 2 * BLOCK_SIZE + 7;
+    SetBlockCacheSize(&cache, decoder.Available);
+    calls = decoder.Calls;
+    CHECK(ReadBlocks(&cache, BLOCK_SIZE - 50, buffer, 2 * BLOCK_SIZE) == BLOCK_SIZE + 57);
+    CHECK(memcmp(buffer, data + BLOCK_SIZE - 50, BLOCK_SIZE + 57) == 0);
+    CHECK(decoder.Calls == calls + 2);
+
+    /* The complete blocks are not decoded again */
+    calls = decoder.Calls;
+    CHECK(ReadBlocks(&cache, 0, buffer, 2 * BLOCK_SIZE) == 2 * BLOCK_SIZE);
+    CHECK(memcmp(buffer, data, 2 * BLOCK_SIZE) == 0);
+    CHECK(decoder.Calls == calls);
+
+    CheckReleased();
+    ClearBlockCache(&cache);
+    free(buffer);
+}
+
+/*  The decoding stops at the damaged data, the read ends before it
+*/
+static void TestDamagedData(void)
+{
+    memory_decoder_t decoder = {NULL, DATA_SIZE, 3 * BLOCK_SIZE + 999, 0};
+    char *buffer = malloc(2 * BLOCK_SIZE);
+
+    if (buffer == NULL)
+    {
+        Fail("buffer != NULL", __LINE__);
+        return;
+    }
+
+    decoder.Data = data;
+    InitBlockCache(&cache);
+    CHECK(OpenBlockCache(&cache, NULL, ReadMemory, &decoder, DATA_SIZE) == SUCCESS);
+    CHECK(ReadBlocks(&cache, 2 * BLOCK_SIZE + 1, buffer, 2 * BLOCK_SIZE) == BLOCK_SIZE + 998);
+    CHECK(memcmp(buffer, data + 2 * BLOCK_SIZE + 1, BLOCK_SIZE + 998) == 0);
+    CHECK(ReadBlocks(&cache, 3 * BLOCK_SIZE + 999, buffer, 10) == 0);
+    CHECK(ReadBlocks(&cache, 4 * BLOCK_SIZE, buffer, 10) == 0);
+
+    CheckReleased();
+    ClearBlockCache(&cache);
+    free(buffer);
+}
+
+int main(void)
+{
+    offset_t i;
+
+    data = malloc(DATA_SIZE);
+    if (data == NULL)
+    {
+        printf("FAILED: no memory\n");
+        return 1;
+    }
+    for (i = 0; i < DATA_SIZE; i++)
+        data[i] = (char)(i * 2654435761u >> 13);
+
+    TestConcurrentReads();
+    TestGrowingOutput();
+    TestDamagedData();
+
+    free(data);
+    printf("%s: %d failed checks\n", failures == 0 ? "OK" : "FAILED", (int)failures);
+    return (int)failures;
+}
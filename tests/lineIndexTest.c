@@ -0,0 +1,278 @@
+/*  Test driver of the line index and the line scanner. The line index keeps only the
+    offsets, so the offsets past 4 GB are appended without such a file. The scanned
+    lines are indexed at a base offset past 4 GB the same way the model indexes the
+    windows of a large file.
+    Build from the root of the repository:
+        gcc -O2 -o lineIndexTest tests/lineIndexTest.c model/lineIndex.c model/lineScanner.c thread/threadPool.c
+    The driver prints the failed checks and returns the number of them */
+
+#include "../model/lineIndex.h"
+#include "../model/lineScanner.h"
+#include <stdio.h>
+#include <string.h>
+
+#define FOUR_GB (1ull << 32)                /* The first offset not fitting in 32 bits */
+#define SCAN_SIZE (24ul << 20)              /* The number of scanned characters, several parallel chunks */
+
+/* Checks the condition and counts the failure */
+#define CHECK(condition) ((condition) ? (void)0 : Fail(#condition, __LINE__))
+
+static int failures = 0;                    /* The number of failed checks */
+static unsigned long long seed = 1;         /* State of the random numbers */
+
+/*  Reports the failed check
+INPUT:
+    const char *condition - text of the condition
+    int line - line of the check
+*/
+static void Fail(const char *condition, int line)
+{
+    if (failures++ < 20)
+        printf("line %d: %s\n", line, condition);
+}
+
+/*  Returns the next random number, the sequence is the same on every run
+RETURN:
+    unsigned long - the number from 0 to 2^31 - 1
+*/
+static unsigned long Random(void)
+{
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    return (unsigned long)(seed >> 33);
+}
+
+/*  Finds the last line starting not after the offset in the sorted offsets
+INPUT:
+    const offset_t *offsets - the line starts
+    index_t count - the number of lines
+    offset_t offset - the offset
+RETURN:
+    index_t - index of the line, 0 if the offset is before the first line
+*/
+static index_t FindReference(const offset_t *offsets, index_t count, offset_t offset)
+{
+    index_t low = 0;
+    index_t high = count;
+
+    while (low < high)
+    {
+        index_t middle = low + (high - low) / 2;
+
+        if (offsets[middle] <= offset)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low > 0 ? low - 1 : 0;
+}
+
+/*  Compares the index with the offsets, every line start and the offsets around
+    it are looked for
+INPUT:
+    const line_index_t *index - pointer on line index structure
+    const offset_t *offsets - the line starts
+    index_t count - the number of lines
+*/
+static void CheckIndex(const line_index_t *index, const offset_t *offsets, index_t count)
+{
+    index_t line;
+
+    CHECK(index->Count == count);
+    for (line = 0; line < count && line < index->Count; line++)
+    {
+        CHECK(GetLineOffset(index, line) == offsets[line]);
+        CHECK(FindLineByOffset(index, offsets[line]) == FindReference(offsets, count, offsets[line]));
+        CHECK(FindLineByOffset(index, offsets[line] + 1) == FindReference(offsets, count, offsets[line] + 1));
+        if (offsets[line] > 0)
+            CHECK(FindLineByOffset(index, offsets[line] - 1) == FindReference(offsets, count, offsets[line] - 1));
+    }
+}
+
+/*  Appends the short lines around 4 GB, the blocks crossing it keep 16-bit offsets
+*/
+static void TestNarrowBlocks(void)
+{
+    line_index_t index;
+    offset_t offsets[20000];
+    offset_t offset = FOUR_GB - 100000;
+    index_t i;
+
+    InitLineIndex(&index);
+    for (i = 0; i < 20000; i++)
+    {
+        offsets[i] = offset;
+        CHECK(AppendLineOffset(&index, offset) == SUCCESS);
+        offset += 1 + Random() % 20;
+    }
+
+    CHECK(offsets[0] < FOUR_GB && offsets[19999] > FOUR_GB);
+    CHECK(index.NumOfWide == 0);
+    CheckIndex(&index, offsets, 20000);
+    ClearLineIndex(&index);
+}
+
+/*  Appends the lines longer than 64 KB far past 4 GB, their blocks are widened
+*/
+static void TestWideBlocks(void)
+{
+    line_index_t index;
+    offset_t offsets[5000];
+    offset_t offset = 5 * FOUR_GB + 12345;
+    index_t i;
+
+    InitLineIndex(&index);
+    for (i = 0; i < 5000; i++)
+    {
+        offsets[i] = offset;
+        CHECK(AppendLineOffset(&index, offset) == SUCCESS);
+
+        /* A line of 4 GB and more now and then, the others are short or longer than 64 KB */
+        if (Random() % 500 == 0)
+            offset += FOUR_GB + Random();
+        else if (Random() % 10 == 0)
+            offset += 0x10000 + Random() % 1000000;
+        else
+            offset += Random() % 100;
+    }
+
+    CHECK(index.NumOfWide > 0);
+    CheckIndex(&index, offsets, 5000);
+    CHECK(FindLineByOffset(&index, offsets[4999] + FOUR_GB) == 4999);
+    ClearLineIndex(&index);
+}
+
+/*  Takes back the last line of the blocks crossing 4 GB and appends it at another offset
+*/
+static void TestRemoveLast(void)
+{
+    line_index_t index;
+    offset_t offsets[3000];
+    offset_t offset = FOUR_GB - 3000;
+    index_t i;
+
+    InitLineIndex(&index);
+    for (i = 0; i < 3000; i++)
+    {
+        offsets[i] = offset;
+        CHECK(AppendLineOffset(&index, offset) == SUCCESS);
+
+        /* The extended last line starts in the same place or after the lines longer than 64 KB */
+        if (i % 7 == 3)
+        {
+            RemoveLastLineOffset(&index);
+            offsets[i] = offset + (i % 2 ? 1 : 0x20000);
+            CHECK(AppendLineOffset(&index, offsets[i]) == SUCCESS);
+            offset = offsets[i];
+        }
+        offset += 1 + Random() % 3;
+    }
+
+    CheckIndex(&index, offsets, 3000);
+    ClearLineIndex(&index);
+}
+
+/*  Fills the data with the lines of random lengths, some of them have tabs or
+    characters above 127 and one is longer than a parallel chunk
+INPUT:
+    char *data - buffer of SCAN_SIZE characters
+*/
+static void FillLines(char *data)
+{
+    size_t i = 0;
+    int hasLongLine = 0;
+
+    while (i < SCAN_SIZE)
+    {
+        size_t length = Random() % 1000 == 0 ? Random() % 5000 + 70000 : Random() % 120;
+
+        if (!hasLongLine && i >= SCAN_SIZE / 3)
+        {
+            length = 5ul << 20;
+            hasLongLine = 1;
+        }
+        for (; length > 0 && i < SCAN_SIZE; length--, i++)
+            data[i] = (char)(Random() % 200 == 0 ? '\t' : Random() % 5000 == 0 ? 0xC3 : 'a' + Random() % 26);
+        if (i < SCAN_SIZE)
+            data[i++] = '\n';
+    }
+}
+
+/*  Scans the lines sequentially and in parallel and indexes them at a base offset
+    past 4 GB. The results of the scans are the same and the index finds every line
+    by the offsets of its characters
+*/
+static void TestScannedLines(void)
+{
+    char *data = malloc(SCAN_SIZE);
+    line_starts_t sequential;
+    line_starts_t parallel;
+    line_index_t index;
+    offset_t *offsets;
+    offset_t base = 3 * FOUR_GB - SCAN_SIZE / 2;
+    size_t i;
+
+    if (data == NULL)
+    {
+        Fail("data != NULL", __LINE__);
+        return;
+    }
+    FillLines(data);
+
+    InitLineStarts(&sequential, data);
+    InitLineStarts(&parallel, data);
+    CHECK(ScanLineStarts(&sequential, data, SCAN_SIZE) == SUCCESS);
+    CHECK(ScanLineStartsParallel(&parallel, data, SCAN_SIZE) == SUCCESS);
+
+    CHECK(sequential.Count == parallel.Count);
+    CHECK(sequential.MaxLength == parallel.MaxLength && sequential.MaxLength >= (5ul << 20));
+    CHECK(sequential.HasNonAscii == parallel.HasNonAscii && sequential.HasNonAscii);
+    CHECK(sequential.NumOfTabLines == parallel.NumOfTabLines && sequential.NumOfTabLines > 0);
+    CHECK(sequential.Count == parallel.Count &&
+          memcmp(sequential.Starts, parallel.Starts, sequential.Count * sizeof(char *)) == 0);
+    CHECK(sequential.NumOfTabLines == parallel.NumOfTabLines &&
+          memcmp(sequential.TabLines, parallel.TabLines, sequential.NumOfTabLines * sizeof(size_t)) == 0);
+
+    /* The first line starts at the base, the others after the scanned breaks */
+    offsets = malloc((sequential.Count + 1) * sizeof(offset_t));
+    InitLineIndex(&index);
+    if (offsets != NULL)
+    {
+        offsets[0] = base;
+        for (i = 0; i < sequential.Count; i++)
+            offsets[i + 1] = base + (offset_t)(sequential.Starts[i] - data);
+        for (i = 0; i <= sequential.Count; i++)
+            CHECK(AppendLineOffset(&index, offsets[i]) == SUCCESS);
+        CheckIndex(&index, offsets, sequential.Count + 1);
+
+        /* The characters are found in the lines the scanner broke them into */
+        for (i = 0; i < SCAN_SIZE; i += 4093)
+        {
+            index_t line = FindLineByOffset(&index, base + i);
+
+            CHECK(offsets[line] <= base + i && (line == sequential.Count || base + i < offsets[line + 1]));
+            CHECK(line == 0 || data[offsets[line] - base - 1] == '\n');
+        }
+    }
+    else
+        Fail("offsets != NULL", __LINE__);
+
+    ClearLineIndex(&index);
+    free(offsets);
+    ClearLineStarts(&sequential);
+    ClearLineStarts(&parallel);
+    free(data);
+}
+
+int main(void)
+{
+    SetThreadPoolLimit(4);
+
+    TestNarrowBlocks();
+    TestWideBlocks();
+    TestRemoveLast();
+    TestScannedLines();
+
+    printf("%s: %d failed checks\n", failures == 0 ? "OK" : "FAILED", failures);
+    return failures;
+}
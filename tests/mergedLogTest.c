@@ -0,0 +1,240 @@
+/*  Test driver of the merged log. Writes several log files with the timestamps going
+    back now and then, with continuation lines and with equal times in different files,
+    and compares the merged rows with the lines sorted by the running maximum of the
+    timestamps of their file, the equal keys in the order of the files.
+    Build from the root of the repository:
+        gcc -O2 -o mergedLogTest tests/mergedLogTest.c model/mergedLog.c model/timeIndex.c
+            model/fileModel.c model/indexCache.c model/blockCache.c model/lineIndex.c
+            model/lineScanner.c model/compressedFile.c model/inflate.c model/utf8Columns.c
+            model/textEncoding.c model/columnMap.c model/literalSearch.c model/regexPattern.c
+            model/textSearch.c thread/threadPool.c
+    The files are written to the current directory and removed at the end.
+    The driver prints the failed checks and returns the number of them */
+
+#include "../model/mergedLog.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_OF_FILES 3                      /* The number of merged files */
+#define NUM_OF_QUERIES 4000                 /* The number of random row queries */
+#define MAX_QUERY_ROWS 100                  /* The most rows of one query */
+
+/* Checks the condition and counts the failure */
+#define CHECK(condition) ((condition) ? (void)0 : Fail(#condition, __LINE__))
+
+/* Line of the files with its merge key */
+typedef struct
+{
+    timestamp_t Key;            /* The latest timestamp of the file up to the line */
+    int Source;                 /* Index of the file */
+    index_t Line;               /* Index of the line in the file */
+} reference_row_t;
+
+static int failures = 0;                    /* The number of failed checks */
+static unsigned long long seed = 1;         /* State of the random numbers */
+
+/*  Reports the failed check
+INPUT:
+    const char *condition - text of the condition
+    int line - line of the check
+*/
+static void Fail(const char *condition, int line)
+{
+    if (failures++ < 20)
+        printf("line %d: %s\n", line, condition);
+}
+
+/*  Returns the next random number, the sequence is the same on every run
+RETURN:
+    unsigned long - the number from 0 to 2^31 - 1
+*/
+static unsigned long Random(void)
+{
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    return (unsigned long)(seed >> 33);
+}
+
+/*  Orders the reference rows by the key, the file and the line
+INPUT:
+    const void *first - the first row
+    const void *second - the second row
+RETURN:
+    int - negative, zero or positive as the first row goes before, with or after the second
+*/
+static int CompareRows(const void *first, const void *second)
+{
+    const reference_row_t *a = (const reference_row_t*)first;
+    const reference_row_t *b = (const reference_row_t*)second;
+
+    if (a->Key != b->Key)
+        return a->Key < b->Key ? -1 : 1;
+    if (a->Source != b->Source)
+        return a->Source - b->Source;
+    if (a->Line != b->Line)
+        return a->Line < b->Line ? -1 : 1;
+
+    return 0;
+}
+
+/*  Writes the log file and appends its lines to the reference rows. The first lines
+    of the second file have no timestamps, the empty line after the last break is
+    a line of the file too
+INPUT:
+    const char *name - the path of the file
+    int source - index of the file
+    index_t numOfLines - the number of written lines
+    reference_row_t *rows - the reference rows
+    index_t *count - the number of the reference rows
+RETURN:
+    int - 1 if the file is written, 0 otherwise
+*/
+static int WriteLog(const char *name, int source, index_t numOfLines, reference_row_t *rows, index_t *count)
+{
+    FILE *file = fopen(name, "wb");
+    timestamp_t time = 1700000000000ll;
+    timestamp_t key = LLONG_MIN;
+    index_t line;
+
+    if (file == NULL)
+        return 0;
+
+    for (line = 0; line < numOfLines; line++)
+    {
+        if (source == 1 && line < 3)
+            fprintf(file, "preamble %d\n", (int)line);
+        else if (Random() % 4 == 0)
+            fprintf(file, "    continued %d\n", (int)line);
+        else
+        {
+            /* The steps of 250 ms give equal times in the files, some of them go back */
+            time += (timestamp_t)(Random() % 3) * 250;
+            if (Random() % 5 == 0)
+                time -= 500;
+            fprintf(file, "%lld.%03lld file %d line %d\n", time / 1000, time % 1000, source, (int)line);
+            if (time > key)
+                key = time;
+        }
+        rows[*count].Key = key;
+        rows[*count].Source = source;
+        rows[*count].Line = line;
+        (*count)++;
+    }
+    rows[*count].Key = key;
+    rows[*count].Source = source;
+    rows[*count].Line = numOfLines;
+    (*count)++;
+
+    return fclose(file) == 0;
+}
+
+/*  Compares the merged rows from the row with the reference rows
+INPUT:
+    merged_log_t *merge - pointer on locked and updated merged log structure
+    const reference_row_t *reference - the sorted reference rows
+    index_t numOfRows - the number of the reference rows
+    index_t row - the first row
+    index_t count - the number of rows
+*/
+static void CheckRows(merged_log_t *merge, const reference_row_t *reference, index_t numOfRows, index_t row,
+                      index_t count)
+{
+    merged_row_t rows[MAX_QUERY_ROWS];
+    index_t expected = row + count <= numOfRows ? count : numOfRows - row;
+    index_t found = GetMergedRows(merge, row, rows, count);
+    index_t i;
+
+    CHECK(found == expected);
+    for (i = 0; i < found && i < expected; i++)
+        CHECK(rows[i].Source == reference[row + i].Source && rows[i].Line == reference[row + i].Line);
+}
+
+/*  Merges the files and checks the rows taken at random, in sequence and by time,
+    half of the random rows are sought without the cached checkpoints
+INPUT:
+    const char *const *names - the paths of the files
+    const reference_row_t *reference - the sorted reference rows
+    index_t numOfRows - the number of the reference rows
+*/
+static void TestMergedRows(const char *const *names, const reference_row_t *reference, index_t numOfRows)
+{
+    merged_log_t merge;
+    index_t row;
+    int i;
+
+    InitMergedLog(&merge);
+    if (OpenMergedLog(&merge, names, NUM_OF_FILES, TIME_EPOCH, 8, NULL) != SUCCESS)
+    {
+        Fail("OpenMergedLog(&merge, names, NUM_OF_FILES, TIME_EPOCH, 8, NULL) == SUCCESS", __LINE__);
+        return;
+    }
+    for (i = 0; i < NUM_OF_FILES; i++)
+        if (merge.Sources[i].Model.Loader != NULL)
+            WaitForSingleObject(merge.Sources[i].Model.Loader, INFINITE);
+
+    LockMergedLog(&merge);
+    CHECK(UpdateMergedLog(&merge) == SUCCESS);
+    CHECK(merge.NumOfRows == numOfRows);
+
+    for (i = 0; i < NUM_OF_QUERIES && merge.NumOfRows == numOfRows; i++)
+    {
+        if (i % 2 == 1)
+        {
+            int slot;
+
+            for (slot = 0; slot < MERGE_CACHE; slot++)
+                merge.CheckpointRows[slot] = (index_t)-1;
+        }
+        row = i < 10 ? numOfRows - i - 1 : Random() % numOfRows;
+        CheckRows(&merge, reference, numOfRows, row, 1 + Random() % MAX_QUERY_ROWS);
+    }
+    for (row = 0; row < numOfRows && merge.NumOfRows == numOfRows; row += MAX_QUERY_ROWS)
+        CheckRows(&merge, reference, numOfRows, row, MAX_QUERY_ROWS);
+
+    /* The first row at or after the time is the first reference row with such a key */
+    for (i = 0; i < 500; i++)
+    {
+        timestamp_t time = reference[Random() % numOfRows].Key + (timestamp_t)(Random() % 3) - 1;
+        index_t expected = 0;
+
+        while (expected < numOfRows && reference[expected].Key < time)
+            expected++;
+        CHECK(FindMergedTimeRow(&merge, time) == expected);
+    }
+
+    UnlockMergedLog(&merge);
+    ClearMergedLog(&merge);
+}
+
+int main(void)
+{
+    static const index_t numOfLines[NUM_OF_FILES] = {200000, 50000, 120000};
+    char names[NUM_OF_FILES][32];
+    const char *paths[NUM_OF_FILES];
+    reference_row_t *reference = malloc((200000 + 50000 + 120000 + NUM_OF_FILES) * sizeof(reference_row_t));
+    index_t numOfRows = 0;
+    int isWritten = reference != NULL;
+    int i;
+
+    for (i = 0; i < NUM_OF_FILES && isWritten; i++)
+    {
+        sprintf(names[i], "mergedLogTest%d.log", i);
+        paths[i] = names[i];
+        isWritten = WriteLog(names[i], i, numOfLines[i], reference, &numOfRows);
+    }
+
+    if (isWritten)
+    {
+        qsort(reference, (size_t)numOfRows, sizeof(reference_row_t), CompareRows);
+        TestMergedRows(paths, reference, numOfRows);
+    }
+    else
+        Fail("isWritten", __LINE__);
+
+    for (i = 0; i < NUM_OF_FILES; i++)
+        remove(names[i]);
+    free(reference);
+
+    printf("%s: %d failed checks\n", failures == 0 ? "OK" : "FAILED", failures);
+    return failures;
+}
@@ -0,0 +1,200 @@
+/*  Test driver of the relayout scheduler. The scheduler takes the time from the
+    caller, so the bursts of size changes are replayed with made up times.
+    Build from the root of the repository:
+        gcc -O2 -o relayoutSchedulerTest tests/relayoutSchedulerTest.c controller/relayoutScheduler.c
+    The driver prints the failed checks and returns the number of them */
+
+#include "../controller/relayoutScheduler.h"
+#include <limits.h>
+#include <stdio.h>
+
+/* Checks the condition and counts the failure */
+#define CHECK(condition) ((condition) ? (void)0 : Fail(#condition, __LINE__))
+
+static int failures = 0;                    /* The number of failed checks */
+
+/*  Reports the failed check
+INPUT:
+    const char *condition - text of the condition
+    int line - line of the check
+*/
+static void Fail(const char *condition, int line)
+{
+    if (failures++ < 20)
+        printf("line %d: %s\n", line, condition);
+}
+
+/*  Calls StartRelayout every millisecond until it starts the relayout
+INPUT:
+    relayout_scheduler_t *scheduler - pointer on scheduler structure
+    unsigned long from - the first time
+    unsigned long to - the last time
+    long *width - the width of the started relayout
+    unsigned long *generation - the generation of the started relayout
+RETURN:
+    unsigned long - the time of the start, to + 1 if it is not started
+*/
+static unsigned long StartFirst(relayout_scheduler_t *scheduler, unsigned long from, unsigned long to,
+                                long *width, unsigned long *generation)
+{
+    long height;
+
+    for (; from != to + 1; from++)
+        if (StartRelayout(scheduler, from, width, &height, generation))
+            return from;
+
+    return to + 1;
+}
+
+/*  The requests closer than RELAYOUT_QUIET are built once, with the last size
+*/
+static void TestCoalescing(void)
+{
+    relayout_scheduler_t scheduler;
+    unsigned long generation;
+    long width;
+
+    InitRelayoutScheduler(&scheduler);
+    CHECK(!IsRelayoutBusy(&scheduler));
+    CHECK(GetRelayoutDelay(&scheduler, 1000) == NO_RELAYOUT);
+
+    CHECK(!RequestRelayout(&scheduler, 100, 50, 1000));
+    CHECK(!RequestRelayout(&scheduler, 120, 50, 1010));
+    CHECK(!RequestRelayout(&scheduler, 140, 50, 1030));
+    CHECK(IsRelayoutBusy(&scheduler));
+    CHECK(GetRelayoutDelay(&scheduler, 1030) == RELAYOUT_QUIET);
+    CHECK(GetRelayoutDelay(&scheduler, 1030 + RELAYOUT_QUIET - 1) == 1);
+
+    CHECK(StartFirst(&scheduler, 1030, 1300, &width, &generation) == 1030 + RELAYOUT_QUIET);
+    CHECK(width == 140);
+    CHECK(GetRelayoutDelay(&scheduler, 1300) == NO_RELAYOUT);
+    CHECK(StartFirst(&scheduler, 1300, 1400, &width, &generation) == 1401);
+
+    CHECK(FinishRelayout(&scheduler, generation));
+    CHECK(!IsRelayoutBusy(&scheduler));
+}
+
+/*  The requests coming every 10 ms postpone the relayout by RELAYOUT_MAX_DELAY at most,
+    the requests while it runs supersede it and are built after it
+INPUT:
+    unsigned long first - the time of the first request
+*/
+static void TestContinuousDrag(unsigned long first)
+{
+    relayout_scheduler_t scheduler;
+    unsigned long generation;
+    unsigned long started = 0;
+    unsigned long next;
+    unsigned long now;
+    int isStarted = 0;
+    long width;
+    long height;
+
+    InitRelayoutScheduler(&scheduler);
+    for (now = first; now - first <= 2 * RELAYOUT_MAX_DELAY; now += 10)
+    {
+        int isRunning = isStarted;
+
+        CHECK(RequestRelayout(&scheduler, (long)(now - first), 50, now) == isRunning);
+        CHECK(isRunning || GetRelayoutDelay(&scheduler, now) <= RELAYOUT_MAX_DELAY - (now - first));
+        CHECK(isRunning || GetRelayoutDelay(&scheduler, now) <= RELAYOUT_QUIET);
+
+        /* The timer fires after the returned delay, it is never later than the cap */
+        if (!isStarted && StartRelayout(&scheduler, now, &width, &height, &generation))
+        {
+            isStarted = 1;
+            started = now;
+        }
+    }
+
+    CHECK(isStarted && started - first == RELAYOUT_MAX_DELAY);
+    CHECK(width == RELAYOUT_MAX_DELAY && height == 50);
+
+    /* The running relayout is superseded, the requests since its start have waited for the cap */
+    CHECK(GetRelayoutDelay(&scheduler, now) == NO_RELAYOUT);
+    CHECK(!FinishRelayout(&scheduler, generation));
+    next = StartFirst(&scheduler, now, now + RELAYOUT_MAX_DELAY, &width, &generation);
+    CHECK(next == now);
+    CHECK(width == (long)(now - 10 - first));
+    CHECK(FinishRelayout(&scheduler, generation));
+    CHECK(!IsRelayoutBusy(&scheduler));
+}
+
+/*  The delays are counted across the wraparound of the millisecond counter
+*/
+static void TestWraparound(void)
+{
+    relayout_scheduler_t scheduler;
+    unsigned long generation;
+    long width;
+
+    InitRelayoutScheduler(&scheduler);
+    CHECK(!RequestRelayout(&scheduler, 100, 50, ULONG_MAX - 9));
+    CHECK(GetRelayoutDelay(&scheduler, ULONG_MAX) == RELAYOUT_QUIET - 9);
+    CHECK(GetRelayoutDelay(&scheduler, 10) == RELAYOUT_QUIET - 20);
+    CHECK(StartFirst(&scheduler, ULONG_MAX - 9, 100, &width, &generation) == RELAYOUT_QUIET - 10);
+    CHECK(FinishRelayout(&scheduler, generation));
+
+    /* The drag starting before the wraparound is capped after it */
+    TestContinuousDrag(ULONG_MAX - RELAYOUT_MAX_DELAY / 2);
+    TestContinuousDrag(ULONG_MAX - 4);
+}
+
+/*  The results of the superseded and of the dropped relayouts are not shown
+*/
+static void TestStaleGenerations(void)
+{
+    relayout_scheduler_t scheduler;
+    unsigned long first;
+    unsigned long second;
+    unsigned long third;
+    long width;
+
+    InitRelayoutScheduler(&scheduler);
+    RequestRelayout(&scheduler, 100, 50, 0);
+    CHECK(StartFirst(&scheduler, 0, 100, &width, &first) == RELAYOUT_QUIET);
+
+    /* A request while the relayout runs supersedes it */
+    CHECK(RequestRelayout(&scheduler, 200, 50, 50));
+    CHECK(!FinishRelayout(&scheduler, first));
+    CHECK(IsRelayoutBusy(&scheduler));
+    CHECK(StartFirst(&scheduler, 50, 200, &width, &second) == 50 + RELAYOUT_QUIET);
+    CHECK(second != first && width == 200);
+
+    /* The late result of the superseded relayout does not finish the running one */
+    CHECK(!FinishRelayout(&scheduler, first));
+    CHECK(IsRelayoutBusy(&scheduler));
+    CHECK(GetRelayoutDelay(&scheduler, 500) == NO_RELAYOUT);
+    CHECK(FinishRelayout(&scheduler, second));
+    CHECK(!IsRelayoutBusy(&scheduler));
+
+    /* The reset drops the running relayout, the generations keep growing */
+    RequestRelayout(&scheduler, 300, 50, 1000);
+    CHECK(StartFirst(&scheduler, 1000, 1100, &width, &third) == 1000 + RELAYOUT_QUIET);
+    ResetRelayoutScheduler(&scheduler);
+    CHECK(!IsRelayoutBusy(&scheduler));
+    CHECK(!FinishRelayout(&scheduler, third));
+    CHECK(!IsRelayoutBusy(&scheduler));
+    RequestRelayout(&scheduler, 400, 50, 2000);
+    CHECK(StartFirst(&scheduler, 2000, 2100, &width, &first) == 2000 + RELAYOUT_QUIET);
+    CHECK(first != third && !FinishRelayout(&scheduler, third) && FinishRelayout(&scheduler, first));
+
+    /* The generation skips zero, which is left for the idle state */
+    scheduler.Generation = ULONG_MAX;
+    RequestRelayout(&scheduler, 500, 50, 3000);
+    CHECK(StartFirst(&scheduler, 3000, 3100, &width, &first) == 3000 + RELAYOUT_QUIET);
+    CHECK(first == 1 && IsRelayoutBusy(&scheduler));
+    CHECK(!FinishRelayout(&scheduler, 0));
+    CHECK(FinishRelayout(&scheduler, first));
+}
+
+int main(void)
+{
+    TestCoalescing();
+    TestContinuousDrag(5000);
+    TestWraparound();
+    TestStaleGenerations();
+
+    printf("%s: %d failed checks\n", failures == 0 ? "OK" : "FAILED", failures);
+    return failures;
+}
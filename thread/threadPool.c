@@ -0,0 +1,211 @@
+#include "threadPool.h"
+
+#define MAX_POOL_THREADS 64     /* Upper bound of the number of the pool threads */
+
+/* Job placed into the pool queue */
+typedef struct pool_job_t
+{
+    pool_task_t Task;               /* Function executing one task */
+    void *Arg;                      /* Argument of the tasks */
+    long NumOfTasks;                /* The number of tasks */
+    volatile long Next;             /* Index of the next task to take */
+    volatile long Done;             /* The number of finished tasks */
+    unsigned long Workers;          /* The number of pool threads working on the job */
+    struct pool_job_t *NextJob;     /* Next job in the queue */
+} pool_job_t;
+
+/* The pool shared by all the modules */
+static struct
+{
+    CRITICAL_SECTION Lock;          /* Guards the queue and the counters */
+    CONDITION_VARIABLE WorkReady;   /* Signaled when a job is queued */
+    CONDITION_VARIABLE JobDone;     /* Signaled when a pool thread leaves a job */
+    pool_job_t *Jobs;               /* Queue of the running jobs */
+    unsigned long NumOfThreads;     /* The number of started pool threads */
+    volatile long Limit;            /* Maximum number of threads working on one job */
+} pool;
+
+static volatile long poolState = 0;   /* 0 - not initialized, 1 - initializing, 2 - ready */
+
+/*  Initializes the pool on the first use */
+static void InitThreadPool(void)
+{
+    if (InterlockedCompareExchange(&poolState, 1, 0) == 0)
+    {
+        SYSTEM_INFO info;
+
+        InitializeCriticalSection(&pool.Lock);
+        InitializeConditionVariable(&pool.WorkReady);
+        InitializeConditionVariable(&pool.JobDone);
+        pool.Jobs = NULL;
+        pool.NumOfThreads = 0;
+        if (pool.Limit == 0)
+        {
+            GetSystemInfo(&info);
+            pool.Limit = info.dwNumberOfProcessors;
+        }
+        InterlockedExchange(&poolState, 2);
+    }
+
+    while (poolState != 2)
+        Sleep(0);
+}
+
+/*  Sets the maximum number of threads working on one job
+INPUT:
+    unsigned long numOfThreads - the number of threads including the calling one,
+                                 0 means the number of processors
+*/
+void SetThreadPoolLimit(unsigned long numOfThreads)
+{
+    if (numOfThreads == 0)
+    {
+        SYSTEM_INFO info;
+
+        GetSystemInfo(&info);
+        numOfThreads = info.dwNumberOfProcessors;
+    }
+    if (numOfThreads > MAX_POOL_THREADS)
+        numOfThreads = MAX_POOL_THREADS;
+
+    InterlockedExchange(&pool.Limit, numOfThreads);
+}
+
+/*  Returns the maximum number of threads working on one job
+RETURN:
+    unsigned long - the number of threads including the calling one
+*/
+unsigned long GetThreadPoolLimit(void)
+{
+    InitThreadPool();
+    return pool.Limit;
+}
+
+/*  Executes the tasks of the job until all of them are taken
+INPUT:
+    pool_job_t *job - pointer on the job
+*/
+static void RunJobTasks(pool_job_t *job)
+{
+    long index;
+
+    while ((index = InterlockedIncrement(&job->Next) - 1) < job->NumOfTasks)
+    {
+        job->Task(job->Arg, index);
+        InterlockedIncrement(&job->Done);
+    }
+}
+
+/*  Finds the job which still has free tasks and free worker places, must be called under the lock
+RETURN:
+    pool_job_t * - pointer on the job or NULL if there is no such job
+*/
+static pool_job_t *FindJob(void)
+{
+    pool_job_t *job;
+
+    for (job = pool.Jobs; job != NULL; job = job->NextJob)
+        if (job->Next < job->NumOfTasks && job->Workers + 1 < (unsigned long)pool.Limit)
+            return job;
+
+    return NULL;
+}
+
+/*  Thread procedure of the pool threads
+INPUT:
+    LPVOID param - not used
+RETURN:
+    DWORD - never returns
+*/
+static DWORD WINAPI PoolThread(LPVOID param)
+{
+    EnterCriticalSection(&pool.Lock);
+    for (;;)
+    {
+        pool_job_t *job = FindJob();
+
+        if (job == NULL)
+        {
+            SleepConditionVariableCS(&pool.WorkReady, &pool.Lock, INFINITE);
+            continue;
+        }
+
+        job->Workers++;
+        LeaveCriticalSection(&pool.Lock);
+
+        RunJobTasks(job);
+
+        EnterCriticalSection(&pool.Lock);
+        job->Workers--;
+        WakeAllConditionVariable(&pool.JobDone);
+    }
+
+    return 0;
+}
+
+/*  Runs the tasks with indices from 0 to numOfTasks - 1 on the pool threads and
+    the calling thread, returns when all of them are finished. Several threads
+    may run jobs at the same time, the tasks may run jobs themselves
+INPUT:
+    pool_task_t task - function executing one task
+    void *arg - argument passed to every task
+    unsigned long numOfTasks - the number of tasks
+*/
+void RunParallel(pool_task_t task, void *arg, unsigned long numOfTasks)
+{
+    pool_job_t job;
+    pool_job_t **link;
+    unsigned long needed;
+
+    InitThreadPool();
+
+    /* Nothing to share with other threads */
+    if (numOfTasks <= 1 || pool.Limit <= 1)
+    {
+        unsigned long i;
+
+        for (i = 0; i < numOfTasks; i++)
+            task(arg, i);
+        return;
+    }
+
+    job.Task = task;
+    job.Arg = arg;
+    job.NumOfTasks = numOfTasks;
+    job.Next = 0;
+    job.Done = 0;
+    job.Workers = 0;
+    job.NextJob = NULL;
+
+    EnterCriticalSection(&pool.Lock);
+
+    /* Starting the missing threads, the job still completes if it fails */
+    needed = numOfTasks - 1;
+    if (needed > (unsigned long)pool.Limit - 1)
+        needed = pool.Limit - 1;
+    while (pool.NumOfThreads < needed)
+    {
+        HANDLE thread = CreateThread(NULL, 0, PoolThread, NULL, 0, NULL);
+
+        if (thread == NULL)
+            break;
+        CloseHandle(thread);
+        pool.NumOfThreads++;
+    }
+
+    for (link = &pool.Jobs; *link != NULL; link = &(*link)->NextJob);
+    *link = &job;
+    WakeAllConditionVariable(&pool.WorkReady);
+    LeaveCriticalSection(&pool.Lock);
+
+    /* The calling thread works too */
+    RunJobTasks(&job);
+
+    EnterCriticalSection(&pool.Lock);
+    while (job.Done < job.NumOfTasks || job.Workers > 0)
+        SleepConditionVariableCS(&pool.JobDone, &pool.Lock, INFINITE);
+
+    for (link = &pool.Jobs; *link != &job; link = &(*link)->NextJob);
+    *link = job.NextJob;
+    LeaveCriticalSection(&pool.Lock);
+}
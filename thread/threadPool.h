@@ -0,0 +1,32 @@
+#ifndef __THREAD_POOL_H_INCLUDED
+#define __THREAD_POOL_H_INCLUDED
+
+#include <windows.h>
+
+/* Task executed by the pool, index is the number of the task in the job */
+typedef void (*pool_task_t)(void *arg, unsigned long index);
+
+/*  Sets the maximum number of threads working on one job
+INPUT:
+    unsigned long numOfThreads - the number of threads including the calling one,
+                                 0 means the number of processors
+*/
+void SetThreadPoolLimit(unsigned long numOfThreads);
+
+/*  Returns the maximum number of threads working on one job
+RETURN:
+    unsigned long - the number of threads including the calling one
+*/
+unsigned long GetThreadPoolLimit(void);
+
+/*  Runs the tasks with indices from 0 to numOfTasks - 1 on the pool threads and
+    the calling thread, returns when all of them are finished. Several threads
+    may run jobs at the same time, the tasks may run jobs themselves
+INPUT:
+    pool_task_t task - function executing one task
+    void *arg - argument passed to every task
+    unsigned long numOfTasks - the number of tasks
+*/
+void RunParallel(pool_task_t task, void *arg, unsigned long numOfTasks);
+
+#endif // __THREAD_POOL_H_INCLUDED
@@ -1,4 +1,5 @@
 #include "fileScreenView.h"
+#include <string.h>
 
 /* Initializes the view
 INPUT:
@@ -12,13 +13,15 @@ void InitView(HWND hwnd, view_t *view)
     HDC hdc;
     TEXTMETRIC tm;
 
-    view->Data = NULL;
+    InitLayout(&view->Layout);
     view->NumOfLines = 0;
+    view->EstimatedNumOfLines = 0;
     view->VScrollPos = 0;
     view->Mode = DEFAULT;
+    view->RowsMode = DEFAULT;
     view->HScrollPos = 0;
-    view->HScale = 1;
-    view->VScale = 1;
+    view->HScrollStep = 1;
+    view->VScrollStep = 1;
     view->LinesInWindow = 0;
     view->SymbolsInWindowLine = 0;
     view->MaxLineLenght = 0;
@@ -32,6 +35,10 @@ void InitView(HWND hwnd, view_t *view)
 
     view->WindowWidth = 0;
     view->WindowHeight = 0;
+    view->MarkOffset = 0;
+    view->MarkLength = 0;
+    InitHighlighter(&view->Highlighter);
+    InitLineFilter(&view->Filter);
 }
 
 /*  Sets the font for displaying text
@@ -61,21 +68,29 @@ void SetViewFont(HWND hwnd, view_t *view, TCHAR *fontname, unsigned long height)
     view->Font.SymbolWidth = tm.tmAveCharWidth;
 }
 
-/*  Builds the view without layout
+/*  Returns the number of characters fitting in a row of the workspace
 INPUT:
-    view_t *view - pointer on view structure
-    model_t *model - pointer on model structure
+    const view_t *view - pointer on view structure
+    long windowWidth - the width of the workspace
 RETURN:
-    error_t - error code
+    unsigned long - the number of characters, at least one
 */
-static error_t BuildViewDefault(view_t *view, model_t *model)
+unsigned long GetViewColumns(const view_t *view, long windowWidth)
 {
-    unsigned long curLine = 0;
-    unsigned long modelLineIndex = 0;
-    unsigned long lineLen = view->WindowWidth / view->Font.SymbolWidth;
+    unsigned long columns = windowWidth / view->Font.SymbolWidth;
 
-    if (lineLen == 0)
-        lineLen = 1;
+    return columns == 0 ? 1 : columns;
+}
+
+/*  Builds the view without layout. The rows are the model lines themselves,
+    so only the window metrics are computed and nothing is allocated
+INPUT:
+    view_t *view - pointer on view structure
+    model_t *model - pointer on model structure
+*/
+static void BuildViewDefault(view_t *view, model_t *model)
+{
+    unsigned long lineLen = GetViewColumns(view, view->WindowWidth);
 
     view->SymbolsInWindowLine = lineLen;
     view->LinesInWindow = view->WindowHeight / view->Font.LineHeight;
@@ -83,21 +98,29 @@ static error_t BuildViewDefault(view_t *view, model_t *model)
         view->LinesInWindow = 1;
 
     /* Setting the maximum position value horizontally of the scroll caret */
-    view->MaxLineLenght = model->MaxLength;
+    view->MaxLineLenght = model->MaxColumns;
 
-    /* Counting the number of lines depending on the display mode */
     view->NumOfLines = model->NumOfLines;
+}
 
-    view->Data = calloc(view->NumOfLines, sizeof(char *));
-    if (view->Data == NULL)
+/*  Builds the view of the lines kept by the filter. The rows are the kept lines,
+    the lines appended since the last build are filtered first
+INPUT:
+    view_t *view - pointer on view structure
+    model_t *model - pointer on model structure
+RETURN:
+    error_t - error code
+*/
+static error_t BuildViewFilter(view_t *view, model_t *model)
+{
+    BuildViewDefault(view, model);
+
+    if (UpdateLineFilter(&view->Filter, model) != SUCCESS)
     {
         ClearView(view);
         return MEMORY_SHORTAGE;
     }
-
-    /* The actual construction of the view */
-    for (curLine = 0, modelLineIndex = 0; modelLineIndex < model->NumOfLines; ++modelLineIndex, ++curLine)
-        view->Data[curLine] = model->Lines[modelLineIndex];
+    view->NumOfLines = view->Filter.NumOfLines;
 
     return SUCCESS;
 }
@@ -111,13 +134,7 @@ RETURN:
 */
 static error_t BuildViewLayout(view_t *view, model_t *model)
 {
-    unsigned long curLine = 0;
-    unsigned long modelLineIndex = 0;
-    unsigned long lineLen = view->WindowWidth / view->Font.SymbolWidth;
-    unsigned long counter = 0;
-
-    if (lineLen == 0)
-        lineLen = 1;
+    unsigned long lineLen = GetViewColumns(view, view->WindowWidth);
 
     view->SymbolsInWindowLine = lineLen;
     view->LinesInWindow = view->WindowHeight / view->Font.LineHeight;
@@ -127,71 +144,158 @@ static error_t BuildViewLayout(view_t *view, model_t *model)
     /* Setting the maximum position value horizontally of the scroll caret */
     view->MaxLineLenght = lineLen;
 
-    /* Counting the number of lines depending on the display mode */
-    view->NumOfLines = 0;
-    for (; counter < model->NumOfLines - 1; counter++)
-        view->NumOfLines += (model->Lines[counter + 1] - model->Lines[counter]) / lineLen + 1;
-    view->NumOfLines += (&model->Data[model->Size] - model->Lines[counter]) / lineLen + 1;
-
-    view->Data = calloc(view->NumOfLines, sizeof(char *));
-    if (view->Data == NULL)
+    /* Rows are not stored, the layout only keeps the sums of the wrapped lines */
+    if (UpdateLayout(&view->Layout, model, lineLen) != SUCCESS)
     {
         ClearView(view);
         return MEMORY_SHORTAGE;
     }
+    view->NumOfLines = GetLayoutRows(&view->Layout);
+
+    return SUCCESS;
+}
 
-    /* The actual construction of the view */
+/*  Finds the model position shown in the upper left corner of the window
+INPUT:
+    const view_t *view - pointer on view structure with nonzero number of lines
+    index_t *line - index of the model line
+    offset_t *column - index of the character in the model line
+*/
+static void GetUpperLeft(const view_t *view, index_t *line, offset_t *column)
+{
+    index_t part;
+
+    if (view->RowsMode == DEFAULT)
     {
-        unsigned long count = 0;
-        unsigned long modelLineLen = 0;
-        char *pointerToLineStart = NULL;
+        *line = view->VScrollPos;
+        *column = view->HScrollPos;
+        return;
+    }
 
-        curLine = 0;
-        for (modelLineIndex = 0; modelLineIndex < model->NumOfLines - 1; modelLineIndex++)
-        {
-            pointerToLineStart = model->Lines[modelLineIndex];
-            count = 0;
-            modelLineLen = model->Lines[modelLineIndex + 1] - model->Lines[modelLineIndex];
+    /* The filter may be replaced since the rows were built, its last line is taken then */
+    if (view->RowsMode == FILTER)
+    {
+        *line = 0;
+        if (view->Filter.NumOfLines > 0)
+            *line = view->Filter.Lines[view->VScrollPos < view->Filter.NumOfLines ? view->VScrollPos
+                                                                                    : view->Filter.NumOfLines - 1];
+        *column = view->HScrollPos;
+        return;
+    }
 
-            /* Processing empty lines */
-            if (*pointerToLineStart == 0)
-            {
-                view->Data[curLine++] = pointerToLineStart;
-                continue;
-            }
+    FindLayoutLine(&view->Layout, view->VScrollPos, line, &part);
+    *column = part * view->Layout.Width;
+}
 
-            while(count * lineLen < modelLineLen)
-            {
-                view->Data[curLine++] = pointerToLineStart;
-                pointerToLineStart += lineLen;
-                ++count;
-            }
-        }
-        /* Processing last line */
-        modelLineLen = &model->Data[model->Size] - model->Lines[modelLineIndex];
-        pointerToLineStart = model->Lines[modelLineIndex];
-        count = 0;
+/*  Sets the range of the scrollbar. One scrollbar position covers the smallest
+    whole number of view positions keeping the range within MAX_SCROLL, so up to
+    MAX_SCROLL rows every row has its own position and the thumb lands on it exactly
+INPUT:
+    HWND hwnd - window handle with the scrollbar
+    int bar - SB_HORZ or SB_VERT
+    index_t maxPos - the largest position of the view
+RETURN:
+    index_t - the number of view positions of one scrollbar position
+*/
+static index_t SetScrollSteps(HWND hwnd, int bar, index_t maxPos)
+{
+    index_t step = maxPos > MAX_SCROLL ? (maxPos + MAX_SCROLL - 1) / MAX_SCROLL : 1;
 
-        if (*pointerToLineStart == 0)
-            view->Data[curLine++] = pointerToLineStart;
+    SetScrollRange(hwnd, bar, 0, (int)((maxPos + step - 1) / step), FALSE);
+    return step;
+}
 
-        while(count * lineLen < modelLineLen)
-        {
-            view->Data[curLine++] = pointerToLineStart;
-            pointerToLineStart += lineLen;
-            ++count;
-        }
+/*  Shows the scrollbars the rows need and sets their ranges and positions
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    view_t *view - pointer on built view structure
+*/
+static void UpdateScrollBars(HWND hwnd, view_t *view)
+{
+    if (view->Mode == LAYOUT || view->MaxLineLenght < view->SymbolsInWindowLine)
+    {
+        ShowScrollBar(hwnd, SB_HORZ, FALSE);
+    }
+    else
+    {
+        ShowScrollBar(hwnd, SB_HORZ, TRUE);
+        view->HScrollStep = SetScrollSteps(hwnd, SB_HORZ, view->MaxLineLenght - view->SymbolsInWindowLine);
+        SetHScroll(hwnd, view, view->HScrollPos);
+    }
+
+    if (view->LinesInWindow > view->EstimatedNumOfLines)
+    {
+        ShowScrollBar(hwnd, SB_VERT, FALSE);
+    }
+    else
+    {
+        ShowScrollBar(hwnd, SB_VERT, TRUE);
+        view->VScrollStep = SetScrollSteps(hwnd, SB_VERT, view->EstimatedNumOfLines - view->LinesInWindow);
+        SetVScroll(hwnd, view, view->VScrollPos);
+    }
+}
+
+/*  Rebuilds the view according to the new window sizes, the upper left corner
+    is found by the old rows before the layout is replaced
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    model_t *model - pointer on model structure
+    view_t *view - pointer on view structure
+    layout_t *layout - the layout exchanged with the one of the view or NULL
+    long windowWidth - the width of the workspace
+    long windowHeight - the height of the workspace
+RETURN:
+    error_t - error code
+*/
+static error_t RebuildView(HWND hwnd, model_t *model, view_t *view, layout_t *layout,
+                           long windowWidth, long windowHeight)
+{
+    int hasUpperLeft = view->NumOfLines > 0;
+    index_t upperLine = 0;
+    offset_t upperColumn = 0;
+
+    if (hasUpperLeft)
+        GetUpperLeft(view, &upperLine, &upperColumn);
+
+    if (layout != NULL)
+    {
+        layout_t old = view->Layout;
 
+        view->Layout = *layout;
+        *layout = old;
     }
 
-    /* Update number of lines in the view
-    (due to the integer division, their number was taken with a small margin) */
+    /* Rebuild the view, the layout is kept to be updated incrementally */
+    view->WindowHeight = windowHeight;
+    view->WindowWidth = windowWidth;
+    if(view->Mode == DEFAULT)
+        BuildViewDefault(view, model);
+    else if (view->Mode == FILTER)
     {
-        unsigned long i;
-        for(i = view->NumOfLines - 1; view->Data[i] == NULL; i--);
-        view->NumOfLines = i + 1;
+        if (BuildViewFilter(view, model) != SUCCESS)
+            return MEMORY_SHORTAGE;
     }
+    else if (BuildViewLayout(view, model) != SUCCESS)
+        return MEMORY_SHORTAGE;
+    view->RowsMode = view->Mode;
+
+    /* While the file is being loaded the total is estimated by the average line length */
+    view->EstimatedNumOfLines = view->NumOfLines;
+    if (model->IndexedSize > 0 && model->IndexedSize < model->Size)
+        view->EstimatedNumOfLines = (double)view->NumOfLines * model->Size / model->IndexedSize;
 
+    /* Keeping the same model position in the upper left corner */
+    if (hasUpperLeft && view->NumOfLines > 0)
+    {
+        if (view->Mode == DEFAULT)
+            view->VScrollPos = upperLine;
+        else if (view->Mode == FILTER)
+            view->VScrollPos = FindFilterRow(&view->Filter, upperLine);
+        else
+            view->VScrollPos = GetLayoutRow(&view->Layout, upperLine) + upperColumn / view->Layout.Width;
+    }
+
+    UpdateScrollBars(hwnd, view);
     return SUCCESS;
 }
 
@@ -199,91 +303,285 @@ static error_t BuildViewLayout(view_t *view, model_t *model)
     the necessary changes in the display of scrollbars
 INPUT:
     HWND hwnd - window handle for which the displaying will be performed
-    view_t *view - pointer on view structure
     model_t *model - pointer on model structure
-    long windowWidth - the width of the workspace or a negative number to use the past value
-    long windowHeight - the height of the workspace or a negative number to use the past value
+    view_t *view - pointer on view structure
+    long windowWidth - the width of the workspace
+    long windowHeight - the height of the workspace
 RETURN:
     error_t - error code
 */
 error_t ViewRectResize(HWND hwnd, model_t *model, view_t *view, long windowWidth, long windowHeight)
 {
-    error_t err;
-    const char *upperLeft = NULL;
+    return RebuildView(hwnd, model, view, NULL, windowWidth, windowHeight);
+}
 
-    if (view->Data != NULL)
-        upperLeft = view->Data[view->VScrollPos] + view->HScrollPos;
+/*  Rebuilds the view of the merged files according to the new window sizes. The
+    rows are the merged lines without layout, the tag of the file takes the
+    first MERGE_TAG_LENGTH columns of the window
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    merged_log_t *merge - pointer on locked merged log structure
+    view_t *view - pointer on view structure in the DEFAULT mode
+    long windowWidth - the width of the workspace
+    long windowHeight - the height of the workspace
+RETURN:
+    error_t - error code
+*/
+error_t MergedViewRectResize(HWND hwnd, merged_log_t *merge, view_t *view, long windowWidth, long windowHeight)
+{
+    unsigned long columns;
+    int i;
+
+    if (UpdateMergedLog(merge) != SUCCESS)
+    {
+        ClearView(view);
+        return MEMORY_SHORTAGE;
+    }
 
-    /* Rebuild the view */
-    ClearViewData(view);
     view->WindowHeight = windowHeight;
     view->WindowWidth = windowWidth;
-    if(view->Mode == DEFAULT)
-        err = BuildViewDefault(view, model);
-    else
-        err = BuildViewLayout(view, model);
-
-    if(err)
-        return err;
+    columns = GetViewColumns(view, windowWidth);
+    view->SymbolsInWindowLine = columns > MERGE_TAG_LENGTH ? columns - MERGE_TAG_LENGTH : 1;
+    view->LinesInWindow = view->WindowHeight / view->Font.LineHeight;
+    if (view->LinesInWindow == 0)
+        view->LinesInWindow = 1;
+    view->RowsMode = DEFAULT;
 
-    if (upperLeft != NULL)
+    /* Every file being loaded adds its own estimate of the lines */
+    view->NumOfLines = merge->NumOfRows;
+    view->EstimatedNumOfLines = 0;
+    view->MaxLineLenght = 0;
+    for (i = 0; i < merge->NumOfSources; i++)
     {
-        unsigned long r = view->NumOfLines;
-        unsigned long l = 0;
-        unsigned long midle = 0;
+        const model_t *model = &merge->Sources[i].Model;
 
-        while (TRUE)
-        {
-            midle = (r - l) / 2 + l;
-            if (upperLeft - view->Data[midle] >= view->Data[midle + 1] - view->Data[midle])
-                l = midle + 1;
-            else if (view->Data[midle] - upperLeft > 0)
-                r = midle - 1;
-            else
-                break;
-        }
-        view->VScrollPos = midle;
+        if (model->MaxColumns > view->MaxLineLenght)
+            view->MaxLineLenght = model->MaxColumns;
+        if (model->IndexedSize > 0 && model->IndexedSize < model->Size)
+            view->EstimatedNumOfLines += (double)model->NumOfLines * model->Size / model->IndexedSize;
+        else
+            view->EstimatedNumOfLines += model->NumOfLines;
     }
 
-    /* Update scrollbar status */
-    if (view->Mode == LAYOUT || view->MaxLineLenght < view->SymbolsInWindowLine)
-    {
-        ShowScrollBar(hwnd, SB_HORZ, FALSE);
-    }
+    UpdateScrollBars(hwnd, view);
+    return SUCCESS;
+}
+
+/*  Replaces the layout of the view with the one built in the background and
+    rebuilds the view for the window sizes the layout was built for
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    model_t *model - pointer on model structure
+    view_t *view - pointer on view structure
+    layout_t *layout - the new layout, it receives the old one of the view
+    long windowWidth - the width of the workspace
+    long windowHeight - the height of the workspace
+RETURN:
+    error_t - error code
+*/
+error_t ReplaceViewLayout(HWND hwnd, model_t *model, view_t *view, layout_t *layout,
+                          long windowWidth, long windowHeight)
+{
+    return RebuildView(hwnd, model, view, layout, windowWidth, windowHeight);
+}
+
+/*  Checks whether the last row of the view is shown
+INPUT:
+    const view_t *view - pointer on view structure
+RETURN:
+    int - nonzero if the view is scrolled to the bottom
+*/
+int IsViewAtBottom(const view_t *view)
+{
+    return view->VScrollPos + view->LinesInWindow >= view->NumOfLines;
+}
+
+/*  Finds the model character shown in the upper left corner of the window
+INPUT:
+    const model_t *model - pointer on model structure
+    const view_t *view - pointer on view structure
+RETURN:
+    offset_t - offset of the character, zero for the empty view
+*/
+offset_t GetViewOffset(const model_t *model, const view_t *view)
+{
+    index_t line;
+    offset_t column;
+    offset_t start;
+
+    if (view->NumOfLines == 0 || model->NumOfLines == 0)
+        return 0;
+
+    GetUpperLeft(view, &line, &column);
+    if (line >= model->NumOfLines)
+        line = model->NumOfLines - 1;
+
+    return GetModelLineOffset(model, line) + FindModelColumn(model, line, 0, 0, column, &start);
+}
+
+/*  Finds the model line shown in the upper row of the window
+INPUT:
+    const model_t *model - pointer on model structure
+    const view_t *view - pointer on view structure
+RETURN:
+    index_t - index of the line, zero for the empty view
+*/
+index_t GetViewLine(const model_t *model, const view_t *view)
+{
+    index_t line;
+    offset_t column;
+
+    if (view->NumOfLines == 0 || model->NumOfLines == 0)
+        return 0;
+
+    GetUpperLeft(view, &line, &column);
+    return line < model->NumOfLines ? line : model->NumOfLines - 1;
+}
+
+/*  Finds the row of the view showing the model character, the lines and the rows
+    are found by the binary search
+INPUT:
+    const model_t *model - pointer on model structure with nonzero number of lines
+    const view_t *view - pointer on view structure
+    offset_t offset - offset of the character
+    index_t *row - the row, the filtered view gives the first kept line not before the line of the character
+    offset_t *column - the column of the character in its line
+*/
+static void FindViewRow(const model_t *model, const view_t *view, offset_t offset, index_t *row, offset_t *column)
+{
+    index_t line = FindModelLine(model, offset);
+
+    *column = GetModelColumn(model, line, offset - GetModelLineOffset(model, line));
+    if (view->RowsMode == DEFAULT)
+        *row = line;
+    else if (view->RowsMode == FILTER)
+        *row = FindFilterRow(&view->Filter, line);
     else
-    {
-        ShowScrollBar(hwnd, SB_HORZ, TRUE);
-        view->HScale = (double)MAX_SCROLL / (view->MaxLineLenght - view->SymbolsInWindowLine);
-        SetScrollRange(hwnd, SB_HORZ, 0, MAX_SCROLL, FALSE);
-        SetHScroll(hwnd, view, view->HScrollPos);
-    }
+        *row = GetLayoutRow(&view->Layout, line) + *column / view->Layout.Width;
+}
 
-    if (view->LinesInWindow > view->NumOfLines)
-    {
-        ShowScrollBar(hwnd, SB_VERT, FALSE);
-    }
+/*  Scrolls the view horizontally to show the column, the column out of the window
+    is moved to its middle
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    view_t *view - pointer on view structure
+    offset_t column - the column
+*/
+static void ShowViewColumn(HWND hwnd, view_t *view, offset_t column)
+{
+    offset_t half = view->SymbolsInWindowLine / 2;
+
+    /* The horizontal scrollbar is only shown for the lines wider than the window */
+    if (view->RowsMode != LAYOUT && view->MaxLineLenght >= view->SymbolsInWindowLine &&
+        (column < view->HScrollPos || column >= view->HScrollPos + view->SymbolsInWindowLine))
+        SetHScroll(hwnd, view, column > half ? column - half : 0);
+}
+
+/*  Scrolls the view to show the model line in the upper row. The filtered view
+    shows the first kept line not before it
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    const model_t *model - pointer on model structure
+    view_t *view - pointer on view structure
+    index_t line - index of the line, the lines after the last one go to the last one
+*/
+void GoToViewLine(HWND hwnd, const model_t *model, view_t *view, index_t line)
+{
+    if (view->NumOfLines == 0 || model->NumOfLines == 0)
+        return;
+
+    if (line >= model->NumOfLines)
+        line = model->NumOfLines - 1;
+    if (view->RowsMode == DEFAULT)
+        SetVScroll(hwnd, view, line);
+    else if (view->RowsMode == FILTER)
+        SetVScroll(hwnd, view, FindFilterRow(&view->Filter, line));
     else
-    {
-        ShowScrollBar(hwnd, SB_VERT, TRUE);
-        view->VScale = (double)MAX_SCROLL / (view->NumOfLines - view->LinesInWindow);
-        SetScrollRange(hwnd, SB_VERT, 0, MAX_SCROLL, FALSE);
-        SetVScroll(hwnd, view, view->VScrollPos);
-    }
+        SetVScroll(hwnd, view, GetLayoutRow(&view->Layout, line));
+}
 
-    return SUCCESS;
+/*  Scrolls the view to show the row of the model character in the upper row,
+    without layout the character out of the window is moved to its middle
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    const model_t *model - pointer on model structure
+    view_t *view - pointer on view structure
+    offset_t offset - offset of the character, the offsets after the loaded lines go to the last one
+*/
+void GoToViewOffset(HWND hwnd, const model_t *model, view_t *view, offset_t offset)
+{
+    offset_t end;
+    offset_t column;
+    index_t row;
+
+    if (view->NumOfLines == 0 || model->NumOfLines == 0)
+        return;
+
+    end = GetModelLineOffset(model, model->NumOfLines);
+    if (offset >= end)
+        offset = end - 1;
+
+    FindViewRow(model, view, offset, &row, &column);
+    SetVScroll(hwnd, view, row);
+    ShowViewColumn(hwnd, view, column);
 }
 
-/* Sets the vertical scroll caret by the specified position
+/*  Scrolls the view to show the line at the percentage of the loaded characters in the upper row
 INPUT:
     HWND hwnd - window handle for which the displaying will be performed
+    const model_t *model - pointer on model structure
     view_t *view - pointer on view structure
-    unsigned long pos - position of vertical scroll
+    double percent - the percentage from 0 to 100
 */
-void SetVScroll(HWND hwnd, view_t *view, unsigned long pos)
+void GoToViewPercent(HWND hwnd, const model_t *model, view_t *view, double percent)
 {
-    if (pos < 0)
+    offset_t end;
+    offset_t offset;
+
+    if (view->NumOfLines == 0 || model->NumOfLines == 0)
+        return;
+
+    end = GetModelLineOffset(model, model->NumOfLines);
+    offset = percent > 0 ? (offset_t)(end * (percent < 100 ? percent : 100) / 100) : 0;
+    GoToViewLine(hwnd, model, view, FindModelLine(model, offset < end ? offset : end - 1));
+}
+
+/*  Marks the model characters and scrolls the view to show the first one. The view
+    is not scrolled vertically if the row of the character is in the window, otherwise
+    the row becomes the upper one. Without layout the character out of the window
+    is moved to its middle
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    const model_t *model - pointer on model structure
+    view_t *view - pointer on view structure
+    offset_t offset - offset of the first character
+    offset_t length - the number of characters, zero removes the mark
+*/
+void ShowViewText(HWND hwnd, const model_t *model, view_t *view, offset_t offset, offset_t length)
+{
+    index_t row;
+    offset_t column;
+
+    view->MarkOffset = offset;
+    view->MarkLength = length;
+    InvalidateRect(hwnd, NULL, TRUE);
+    if (length == 0 || view->NumOfLines == 0 || model->NumOfLines == 0)
         return;
 
+    FindViewRow(model, view, offset, &row, &column);
+    if (row < view->VScrollPos || row >= view->VScrollPos + view->LinesInWindow)
+        SetVScroll(hwnd, view, row);
+    ShowViewColumn(hwnd, view, column);
+}
+
+/* Sets the vertical scroll caret by the specified position
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    view_t *view - pointer on view structure
+    index_t pos - position of vertical scroll
+*/
+void SetVScroll(HWND hwnd, view_t *view, index_t pos)
+{
     if(view->NumOfLines < view->LinesInWindow)
         return;
 
@@ -292,18 +590,18 @@ void SetVScroll(HWND hwnd, view_t *view, unsigned long pos)
         view->VScrollPos = view->NumOfLines - view->LinesInWindow;
 
     InvalidateRect(hwnd, NULL, TRUE);
-    SetScrollPos(hwnd, SB_VERT, view->VScrollPos * view->VScale, TRUE);
+    SetScrollPos(hwnd, SB_VERT, (int)(view->VScrollPos / view->VScrollStep), TRUE);
 }
 
 /* Sets the horizontal scroll caret by the specified position
 INPUT:
     HWND hwnd - window handle for which the displaying will be performed
     view_t *view - pointer on view structure
-    unsigned long pos - position of horizontal scroll
+    offset_t pos - position of horizontal scroll
 */
-void SetHScroll(HWND hwnd, view_t *view, unsigned long pos)
+void SetHScroll(HWND hwnd, view_t *view, offset_t pos)
 {
-    if (pos < 0 || view->Mode != DEFAULT)
+    if (view->Mode == LAYOUT)
         return;
 
     view->HScrollPos = pos;
@@ -311,7 +609,38 @@ void SetHScroll(HWND hwnd, view_t *view, unsigned long pos)
         view->HScrollPos = view->MaxLineLenght - view->SymbolsInWindowLine;
 
     InvalidateRect(hwnd, NULL, TRUE);
-    SetScrollPos(hwnd, SB_HORZ, view->HScrollPos * view->HScale, TRUE);
+    SetScrollPos(hwnd, SB_HORZ, (int)(view->HScrollPos / view->HScrollStep), TRUE);
+}
+
+/*  Sets the vertical scroll caret by the dragged thumb. Its 32-bit track position
+    is read, the 16 bits of the scroll message would lose the rows of a long view
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    view_t *view - pointer on view structure
+*/
+void SetVScrollThumb(HWND hwnd, view_t *view)
+{
+    SCROLLINFO info;
+
+    info.cbSize = sizeof(info);
+    info.fMask = SIF_TRACKPOS;
+    if (GetScrollInfo(hwnd, SB_VERT, &info))
+        SetVScroll(hwnd, view, (index_t)info.nTrackPos * view->VScrollStep);
+}
+
+/*  Sets the horizontal scroll caret by the dragged thumb in the same way
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    view_t *view - pointer on view structure
+*/
+void SetHScrollThumb(HWND hwnd, view_t *view)
+{
+    SCROLLINFO info;
+
+    info.cbSize = sizeof(info);
+    info.fMask = SIF_TRACKPOS;
+    if (GetScrollInfo(hwnd, SB_HORZ, &info))
+        SetHScroll(hwnd, view, (offset_t)info.nTrackPos * view->HScrollStep);
 }
 
 /* Shifts the vertical scroll caret by the specified amount
@@ -340,62 +669,430 @@ void SetWithDeltaHScroll(HWND hwnd, view_t *view, long delta)
     SetHScroll(hwnd, view, view->HScrollPos + delta);
 }
 
+/* Buffers of the drawn row */
+typedef struct
+{
+    char *Text;         /* Characters of the file read by blocks */
+    wchar_t *Chars;     /* UTF-16 characters of the UTF-8 row */
+    INT *Advances;      /* Widths of these characters in pixels */
+    int *Widths;        /* Widths of these characters in columns */
+} row_buffers_t;
+
+/*  Allocates the buffers for the rows of the columns, the UTF-8 rows take up
+    to four characters and two UTF-16 characters per column
+INPUT:
+    row_buffers_t *buffers - pointer on row buffers structure
+    unsigned long columns - the number of columns in a row
+    int isUtf8 - nonzero if some rows are drawn as UTF-8 or have tabs
+RETURN:
+    error_t - error code
+*/
+static error_t AllocRowBuffers(row_buffers_t *buffers, unsigned long columns, int isUtf8)
+{
+    buffers->Text = malloc(isUtf8 ? 4 * (size_t)columns : columns);
+    buffers->Chars = isUtf8 ? malloc(2 * (size_t)columns * sizeof(wchar_t)) : NULL;
+    buffers->Advances = isUtf8 ? malloc(2 * (size_t)columns * sizeof(INT)) : NULL;
+    buffers->Widths = isUtf8 ? malloc(2 * (size_t)columns * sizeof(int)) : NULL;
+
+    if (buffers->Text == NULL ||
+        (isUtf8 && (buffers->Chars == NULL || buffers->Advances == NULL || buffers->Widths == NULL)))
+        return MEMORY_SHORTAGE;
+    return SUCCESS;
+}
+
+/*  Frees the row buffers
+INPUT:
+    row_buffers_t *buffers - pointer on row buffers structure
+*/
+static void FreeRowBuffers(row_buffers_t *buffers)
+{
+    free(buffers->Text);
+    free(buffers->Chars);
+    free(buffers->Advances);
+    free(buffers->Widths);
+}
+
+/*  Draws the characters of the model line starting in the columns of the row.
+    The characters of the ASCII line without tabs are drawn as they are, the
+    others are converted and every character is placed in its columns, so
+    a tab is drawn as a space up to the next tab stop
+INPUT:
+    HDC hdc - device context of the window
+    const model_t *model - pointer on model structure
+    const view_t *view - pointer on view structure
+    row_buffers_t *buffers - pointer on row buffers structure
+    index_t line - index of the model line
+    offset_t column - the first column of the row
+    unsigned long columns - the number of columns in the row
+    int x - the left side of the row in the window
+    int y - the top of the row in the window
+    offset_t *from - offset in the line of a character starting not after the column,
+                     receives the one of the first character after the row
+    offset_t *fromColumn - the column this character starts at
+*/
+static void DrawRow(HDC hdc, const model_t *model, const view_t *view, row_buffers_t *buffers, index_t line,
+                    offset_t column, unsigned long columns, int x, int y, offset_t *from, offset_t *fromColumn)
+{
+    offset_t lineLen = GetModelLineLength(model, line);
+    offset_t start;
+    offset_t skip;
+    offset_t len;
+    const char *text;
+    size_t count;
+    size_t used;
+    size_t i;
+
+    if (!model->IsUtf8 && !IsModelTabLine(model, line))
+    {
+        if (lineLen <= column)
+            return;
+
+        /* Only the visible part is passed, the length of TextOut is an int */
+        len = lineLen - column;
+        if (len > columns)
+            len = columns;
+        text = GetModelText(model, GetModelLineOffset(model, line) + column, buffers->Text, &len);
+        TextOut(hdc, x, y, text, (int)len);
+        return;
+    }
+
+    /* The wide character or the tab crossing the left border is skipped, the row starts after it */
+    skip = FindModelColumn(model, line, *from, *fromColumn, column, &start);
+    if (skip >= lineLen || start >= column + columns)
+    {
+        *from = skip;
+        *fromColumn = start;
+        return;
+    }
+
+    len = lineLen - skip;
+    if (len > 4 * (offset_t)columns)
+        len = 4 * (offset_t)columns;
+    text = GetModelText(model, GetModelLineOffset(model, line) + skip, buffers->Text, &len);
+    count = ConvertColumns(text, (size_t)len, start, column + columns - start, model->TabSize, buffers->Chars,
+                           buffers->Widths, &used);
+
+    *from = skip + used;
+    *fromColumn = start;
+    for (i = 0; i < count; i++)
+    {
+        buffers->Advances[i] = buffers->Widths[i] * view->Font.SymbolWidth;
+        *fromColumn += buffers->Widths[i];
+    }
+    ExtTextOutW(hdc, x + (int)((start - column) * view->Font.SymbolWidth), y, 0, NULL, buffers->Chars, (UINT)count,
+                buffers->Advances);
+}
+
+/*  Fills the background of the keywords of the row. The first span reaching the row
+    is found by the binary search and the columns are counted from the row start
+INPUT:
+    HDC hdc - device context of the window
+    const model_t *model - pointer on model structure
+    view_t *view - pointer on view structure
+    HBRUSH brush - brush of the background
+    index_t line - index of the model line
+    offset_t column - the first column of the row
+    unsigned long columns - the number of columns in the row
+    int x - left border of the row
+    int y - top border of the row
+    offset_t from - offset in the line of a character starting not after the column
+    offset_t fromColumn - the column this character starts at
+*/
+static void DrawHighlights(HDC hdc, const model_t *model, view_t *view, HBRUSH brush, index_t line, offset_t column,
+                           unsigned long columns, int x, int y, offset_t from, offset_t fromColumn)
+{
+    const keyword_span_t *spans;
+    offset_t rowFrom;
+    offset_t rowTo;
+    offset_t pos;
+    offset_t posColumn;
+    offset_t start;
+    size_t count;
+    size_t low = 0;
+    size_t high;
+    RECT rect;
+
+    rowFrom = FindModelColumn(model, line, from, fromColumn, column, &posColumn);
+    rowTo = FindModelColumn(model, line, rowFrom, posColumn, column + columns, &start);
+    if (rowFrom >= rowTo)
+        return;
+
+    count = FindLineHighlights(&view->Highlighter, model, line, rowFrom, rowTo, &spans);
+    high = count;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+
+        if (spans[middle].Start + spans[middle].Length <= rowFrom)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    /* The span crossing a border of the row is cut at it */
+    rect.top = y;
+    rect.bottom = y + view->Font.LineHeight;
+    pos = rowFrom;
+    for (; low < count && spans[low].Start < rowTo; low++)
+    {
+        offset_t spanEnd = spans[low].Start + spans[low].Length;
+        offset_t first = column;
+        offset_t last = column + columns;
+
+        if (spans[low].Start > rowFrom)
+        {
+            first = GetModelColumnFrom(model, line, pos, posColumn, spans[low].Start);
+            pos = spans[low].Start;
+            posColumn = first;
+        }
+        if (spanEnd < rowTo)
+        {
+            last = GetModelColumnFrom(model, line, pos, posColumn, spanEnd);
+            pos = spanEnd;
+            posColumn = last;
+        }
+        if (last > column + columns)
+            last = column + columns;
+        if (first >= last)
+            continue;
+
+        rect.left = x + (int)((first - column) * view->Font.SymbolWidth);
+        rect.right = x + (int)((last - column) * view->Font.SymbolWidth);
+        FillRect(hdc, &rect, brush);
+    }
+}
+
+/*  Inverts the marked characters of the row
+INPUT:
+    HDC hdc - device context of the window
+    const model_t *model - pointer on model structure
+    const view_t *view - pointer on view structure
+    index_t line - index of the model line
+    offset_t column - the first column of the row
+    unsigned long columns - the number of columns in the row
+    int x - left border of the row
+    int y - top border of the row
+*/
+static void DrawMark(HDC hdc, const model_t *model, const view_t *view, index_t line, offset_t column,
+                     unsigned long columns, int x, int y)
+{
+    offset_t lineStart = GetModelLineOffset(model, line);
+    offset_t lineEnd;
+    offset_t markEnd = view->MarkOffset + view->MarkLength;
+    offset_t first;
+    offset_t last;
+    RECT rect;
+
+    if (view->MarkLength == 0 || markEnd <= lineStart)
+        return;
+
+    lineEnd = lineStart + GetModelLineLength(model, line);
+    if (view->MarkOffset >= lineEnd)
+        return;
+
+    /* The mark may begin on the previous lines and end on the next ones */
+    first = view->MarkOffset > lineStart ? GetModelColumn(model, line, view->MarkOffset - lineStart) : 0;
+    last = GetModelColumn(model, line, (markEnd < lineEnd ? markEnd : lineEnd) - lineStart);
+    if (first < column)
+        first = column;
+    if (last > column + columns)
+        last = column + columns;
+    if (first >= last)
+        return;
+
+    rect.left = x + (int)((first - column) * view->Font.SymbolWidth);
+    rect.right = x + (int)((last - column) * view->Font.SymbolWidth);
+    rect.top = y;
+    rect.bottom = y + view->Font.LineHeight;
+    InvertRect(hdc, &rect);
+}
+
 /*  Displays the view
 INPUT:
     HWND hwnd - window handle for which the displaying will be performed
+    const model_t *model - pointer on model structure
     view_t *view - pointer on view structure
 */
-void DisplayView(HWND hwnd, view_t *view)
+void DisplayView(HWND hwnd, const model_t *model, view_t *view)
 {
     HDC hdc;
     PAINTSTRUCT ps;
     unsigned long counter = 0;
-
-    if (view->Data == NULL)
-        return;
-
-    hdc = BeginPaint(hwnd, &ps);
     RECT windowRect;
+    row_buffers_t buffers;
+    HBRUSH brush = NULL;
 
+    hdc = BeginPaint(hwnd, &ps);
     GetClientRect(hwnd, &windowRect);
 
-    /* Display a part of the file according to the shifts and sizes of the window */
-    for (; counter < view->NumOfLines && counter < view->LinesInWindow; counter++)
+    /* The characters of the file read by blocks are copied row by row */
+    if (AllocRowBuffers(&buffers, view->SymbolsInWindowLine > view->Layout.Width ?
+                        view->SymbolsInWindowLine : view->Layout.Width,
+                        model->IsUtf8 || model->NumOfTabLines > 0) != SUCCESS)
     {
-        unsigned long index = counter + view->VScrollPos;
-        unsigned long len;
+        FreeRowBuffers(&buffers);
+        EndPaint(hwnd, &ps);
+        return;
+    }
+
+    /* The keywords are filled behind the transparent text */
+    if (HasHighlighterKeywords(&view->Highlighter))
+        brush = CreateSolidBrush(HIGHLIGHT_COLOR);
 
-        if(index != view->NumOfLines - 1)
+    /* Display a part of the file according to the shifts and sizes of the window */
+    if (view->Mode != LAYOUT)
+    {
+        for (; counter + view->VScrollPos < view->NumOfLines && counter < view->LinesInWindow; counter++)
         {
-            len = view->Data[index + 1] - view->Data[index];
-            if(view->Data[index][len - 1] == 0)
-                len -= 1;
+            index_t line = counter + view->VScrollPos;
+            offset_t from = 0;
+            offset_t fromColumn = 0;
+
+            /* The filtered rows are the kept lines */
+            if (view->Mode == FILTER)
+                line = view->Filter.Lines[line];
+
+            if (brush != NULL)
+                DrawHighlights(hdc, model, view, brush, line, view->HScrollPos, view->SymbolsInWindowLine,
+                               windowRect.left, windowRect.top + counter * view->Font.LineHeight, from, fromColumn);
+            DrawRow(hdc, model, view, &buffers, line, view->HScrollPos, view->SymbolsInWindowLine, windowRect.left,
+                    windowRect.top + counter * view->Font.LineHeight, &from, &fromColumn);
+            DrawMark(hdc, model, view, line, view->HScrollPos, view->SymbolsInWindowLine, windowRect.left,
+                     windowRect.top + counter * view->Font.LineHeight);
         }
-        else
-            len = strlen(view->Data[index]);
+    }
+    else if (view->Mode == LAYOUT && view->NumOfLines > 0)
+    {
+        unsigned long lineLen = view->Layout.Width;
+        index_t line;
+        index_t part;
+        index_t numOfParts;
+        offset_t from = 0;
+        offset_t fromColumn = 0;
+
+        /* Only the first row is searched, the next ones follow the lines */
+        FindLayoutLine(&view->Layout, view->VScrollPos, &line, &part);
+        numOfParts = GetLayoutRow(&view->Layout, line + 1) - GetLayoutRow(&view->Layout, line);
+
+        for (; counter + view->VScrollPos < view->NumOfLines && counter < view->LinesInWindow; counter++)
+        {
+            if (brush != NULL)
+                DrawHighlights(hdc, model, view, brush, line, part * lineLen, lineLen, windowRect.left,
+                               windowRect.top + counter * view->Font.LineHeight, from, fromColumn);
+            DrawRow(hdc, model, view, &buffers, line, part * lineLen, lineLen, windowRect.left,
+                    windowRect.top + counter * view->Font.LineHeight, &from, &fromColumn);
+            DrawMark(hdc, model, view, line, part * lineLen, lineLen, windowRect.left,
+                     windowRect.top + counter * view->Font.LineHeight);
+
+            if (part + 1 < numOfParts)
+                part++;
+            else if (++line < model->NumOfLines)
+            {
+                part = 0;
+                from = 0;
+                fromColumn = 0;
+                numOfParts = GetLayoutRow(&view->Layout, line + 1) - GetLayoutRow(&view->Layout, line);
+            }
+        }
+    }
 
-        TextOut(hdc, windowRect.left, windowRect.top + counter * view->Font.LineHeight,
-            &view->Data[index][view->HScrollPos], len - view->HScrollPos);
+    if (brush != NULL)
+        DeleteObject(brush);
+    FreeRowBuffers(&buffers);
+    EndPaint(hwnd, &ps);
+}
+
+/*  Displays the rows of the merged files, every row starts with the tag of its
+    file on the background of the file
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    merged_log_t *merge - pointer on locked merged log structure
+    view_t *view - pointer on view structure built by MergedViewRectResize
+*/
+void DisplayMergedView(HWND hwnd, merged_log_t *merge, view_t *view)
+{
+    static const COLORREF tagColors[] =
+    {
+        RGB(200, 220, 255), RGB(210, 240, 200), RGB(255, 215, 200), RGB(235, 210, 245),
+        RGB(255, 240, 190), RGB(200, 240, 240), RGB(240, 220, 210), RGB(225, 225, 225)
+    };
+    HDC hdc;
+    PAINTSTRUCT ps;
+    RECT windowRect;
+    row_buffers_t buffers;
+    merged_row_t *rows;
+    index_t numOfRows = 0;
+    index_t counter;
+    int tagWidth = MERGE_TAG_LENGTH * view->Font.SymbolWidth;
+    int isUtf8 = 0;
+    int i;
+
+    hdc = BeginPaint(hwnd, &ps);
+    GetClientRect(hwnd, &windowRect);
+
+    for (i = 0; i < merge->NumOfSources; i++)
+        if (merge->Sources[i].Model.IsUtf8 || merge->Sources[i].Model.NumOfTabLines > 0)
+            isUtf8 = 1;
+
+    /* The rows of the window are merged at once from the nearest checkpoint */
+    rows = malloc(view->LinesInWindow * sizeof(merged_row_t));
+    if (rows == NULL || AllocRowBuffers(&buffers, view->SymbolsInWindowLine, isUtf8) != SUCCESS)
+    {
+        if (rows != NULL)
+            FreeRowBuffers(&buffers);
+        free(rows);
+        EndPaint(hwnd, &ps);
+        return;
+    }
+    if (view->VScrollPos < view->NumOfLines)
+        numOfRows = GetMergedRows(merge, view->VScrollPos, rows, view->LinesInWindow);
+
+    for (counter = 0; counter < numOfRows; counter++)
+    {
+        const merge_source_t *source = &merge->Sources[rows[counter].Source];
+        int y = windowRect.top + (int)counter * view->Font.LineHeight;
+        offset_t from = 0;
+        offset_t fromColumn = 0;
+        size_t color = (size_t)rows[counter].Source % (sizeof(tagColors) / sizeof(tagColors[0]));
+        HBRUSH brush = CreateSolidBrush(tagColors[color]);
+        RECT tagRect;
+
+        /* The tag leaves a column before the text */
+        tagRect.left = windowRect.left;
+        tagRect.top = y;
+        tagRect.right = windowRect.left + tagWidth - view->Font.SymbolWidth;
+        tagRect.bottom = y + view->Font.LineHeight;
+        FillRect(hdc, &tagRect, brush);
+        DeleteObject(brush);
+        TextOut(hdc, windowRect.left, y, source->Tag, (int)strlen(source->Tag));
+
+        DrawRow(hdc, &source->Model, view, &buffers, rows[counter].Line, view->HScrollPos, view->SymbolsInWindowLine,
+                windowRect.left + tagWidth, y, &from, &fromColumn);
     }
 
+    FreeRowBuffers(&buffers);
+    free(rows);
     EndPaint(hwnd, &ps);
 }
 
-/* Clears the data field of the view
+/* Clears the rows of the view
 INPUT:
     view_t *view - pointer on view structure
 OUTPUT:
-    view_t *view - pointer on view structure with zero values in data field and NumOfLines
+    view_t *view - pointer on view structure with empty layout and zero NumOfLines
 */
 void ClearViewData(view_t *view)
 {
     if (view == NULL)
         return;
 
-    free(view->Data);
-    view->Data = NULL;
+    ClearLayout(&view->Layout);
 
     view->NumOfLines = 0;
+    view->MarkOffset = 0;
+    view->MarkLength = 0;
+    ClearHighlighter(&view->Highlighter);
+    ClearLineFilter(&view->Filter);
 }
 
 /*  Clears the view
@@ -409,10 +1106,10 @@ void ClearView(view_t *view)
     if (view == NULL)
         return;
 
-    free(view->Data);
-    view->Data = NULL;
+    ClearLayout(&view->Layout);
 
     view->NumOfLines = 0;
+    view->EstimatedNumOfLines = 0;
     view->VScrollPos = 0;
     view->Mode = DEFAULT;
     view->HScrollPos = 0;
@@ -425,4 +1122,8 @@ void ClearView(view_t *view)
 
     view->WindowWidth = 0;
     view->WindowHeight = 0;
+    view->MarkOffset = 0;
+    view->MarkLength = 0;
+    ClearHighlighter(&view->Highlighter);
+    ClearLineFilter(&view->Filter);
 }
@@ -3,8 +3,13 @@
 
 #include <windows.h>
 #include "../model/fileModel.h"
+#include "viewLayout.h"
+#include "keywordHighlight.h"
+#include "../model/lineFilter.h"
+#include "../model/mergedLog.h"
 
-#define MAX_SCROLL 65530
+#define MAX_SCROLL 0x7FFFFFFF     /* The largest scrollbar position, the dragged thumb is read by 32 bits */
+#define HIGHLIGHT_COLOR RGB(255, 230, 120)  /* Background of the highlighted keywords */
 
 /* Font parameters */
 typedef struct
@@ -18,25 +23,32 @@ typedef struct
 typedef enum
 {
     DEFAULT,    /* Switches the display to the non-layout mode */
-    LAYOUT      /* Switches the display to the layout mode */
+    LAYOUT,     /* Switches the display to the layout mode */
+    FILTER      /* Switches the display to the lines kept by the filter without layout */
 } mode_t;
 
 /*  The structure that implements the view */
 typedef struct
 {
-    const char **Data;                  /* Lines */
-    unsigned long NumOfLines;           /* Number of lines */
-    unsigned long VScrollPos;           /* Vertical scroll caret position */
+    layout_t Layout;                    /* Wrapped rows (LAYOUT mode) */
+    index_t NumOfLines;                 /* Number of lines */
+    index_t EstimatedNumOfLines;        /* Expected number of lines when the file is loaded */
+    index_t VScrollPos;                 /* Vertical scroll caret position */
     mode_t Mode;                        /* Display mode */
-    unsigned long HScrollPos;           /* Horizontal scroll caret position */
-    double HScale;                      /* Horizontal scrollbar scale */
-    double VScale;                      /* Vertical scrollbar scale */
+    mode_t RowsMode;                    /* Display mode the current rows are built for */
+    offset_t HScrollPos;                /* Horizontal scroll caret position */
+    offset_t HScrollStep;               /* The number of columns of one horizontal scrollbar position */
+    index_t VScrollStep;                /* The number of rows of one vertical scrollbar position */
     unsigned long LinesInWindow;        /* The number of lines that fit in the window */
     unsigned long SymbolsInWindowLine;  /* The number of characters that fit in a line in the window */
-    unsigned long MaxLineLenght;        /* Maximum lenght of line in view */
+    offset_t MaxLineLenght;             /* Maximum lenght of line in view */
     font_params_t Font;                 /* Font for displaying text */
     unsigned long WindowWidth;          /* The width of the window */
     unsigned long WindowHeight;         /* The height of the window */
+    offset_t MarkOffset;                /* Offset of the first marked model character */
+    offset_t MarkLength;                /* The number of marked characters, zero if nothing is marked */
+    highlighter_t Highlighter;          /* Highlighting of the keywords in the painted rows */
+    line_filter_t Filter;               /* Lines shown in the FILTER mode */
 } view_t;
 
 /* Initializes the view
@@ -57,34 +69,155 @@ INPUT:
 */
 void SetViewFont(HWND hwnd, view_t *view, TCHAR *fontname, unsigned long height);
 
+/*  Returns the number of characters fitting in a row of the workspace
+INPUT:
+    const view_t *view - pointer on view structure
+    long windowWidth - the width of the workspace
+RETURN:
+    unsigned long - the number of characters, at least one
+*/
+unsigned long GetViewColumns(const view_t *view, long windowWidth);
+
 /*  Rebuilds the view according to the new window sizes and performs
     the necessary changes in the display of scrollbars
 INPUT:
     HWND hwnd - window handle for which the displaying will be performed
-    view_t *view - pointer on view structure
     model_t *model - pointer on model structure
-    long windowWidth - the width of the workspace or a negative number to use the past value
-    long windowHeight - the height of the workspace or a negative number to use the past value
+    view_t *view - pointer on view structure
+    long windowWidth - the width of the workspace
+    long windowHeight - the height of the workspace
 RETURN:
     error_t - error code
 */
 error_t ViewRectResize(HWND hwnd, model_t *model, view_t *view, long windowWidth, long windowHeight);
 
+/*  Rebuilds the view of the merged files according to the new window sizes. The
+    rows are the merged lines without layout, the tag of the file takes the
+    first MERGE_TAG_LENGTH columns of the window
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    merged_log_t *merge - pointer on locked merged log structure
+    view_t *view - pointer on view structure in the DEFAULT mode
+    long windowWidth - the width of the workspace
+    long windowHeight - the height of the workspace
+RETURN:
+    error_t - error code
+*/
+error_t MergedViewRectResize(HWND hwnd, merged_log_t *merge, view_t *view, long windowWidth, long windowHeight);
+
+/*  Replaces the layout of the view with the one built in the background and
+    rebuilds the view for the window sizes the layout was built for
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    model_t *model - pointer on model structure
+    view_t *view - pointer on view structure
+    layout_t *layout - the new layout, it receives the old one of the view
+    long windowWidth - the width of the workspace
+    long windowHeight - the height of the workspace
+RETURN:
+    error_t - error code
+*/
+error_t ReplaceViewLayout(HWND hwnd, model_t *model, view_t *view, layout_t *layout,
+                          long windowWidth, long windowHeight);
+
+/*  Checks whether the last row of the view is shown
+INPUT:
+    const view_t *view - pointer on view structure
+RETURN:
+    int - nonzero if the view is scrolled to the bottom
+*/
+int IsViewAtBottom(const view_t *view);
+
+/*  Finds the model character shown in the upper left corner of the window
+INPUT:
+    const model_t *model - pointer on model structure
+    const view_t *view - pointer on view structure
+RETURN:
+    offset_t - offset of the character, zero for the empty view
+*/
+offset_t GetViewOffset(const model_t *model, const view_t *view);
+
+/*  Finds the model line shown in the upper row of the window
+INPUT:
+    const model_t *model - pointer on model structure
+    const view_t *view - pointer on view structure
+RETURN:
+    index_t - index of the line, zero for the empty view
+*/
+index_t GetViewLine(const model_t *model, const view_t *view);
+
+/*  Scrolls the view to show the model line in the upper row. The filtered view
+    shows the first kept line not before it
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    const model_t *model - pointer on model structure
+    view_t *view - pointer on view structure
+    index_t line - index of the line, the lines after the last one go to the last one
+*/
+void GoToViewLine(HWND hwnd, const model_t *model, view_t *view, index_t line);
+
+/*  Scrolls the view to show the row of the model character in the upper row,
+    without layout the character out of the window is moved to its middle
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    const model_t *model - pointer on model structure
+    view_t *view - pointer on view structure
+    offset_t offset - offset of the character, the offsets after the loaded lines go to the last one
+*/
+void GoToViewOffset(HWND hwnd, const model_t *model, view_t *view, offset_t offset);
+
+/*  Scrolls the view to show the line at the percentage of the loaded characters in the upper row
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    const model_t *model - pointer on model structure
+    view_t *view - pointer on view structure
+    double percent - the percentage from 0 to 100
+*/
+void GoToViewPercent(HWND hwnd, const model_t *model, view_t *view, double percent);
+
+/*  Marks the model characters and scrolls the view to show the first one. The view
+    is not scrolled vertically if the row of the character is in the window, otherwise
+    the row becomes the upper one. Without layout the character out of the window
+    is moved to its middle
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    const model_t *model - pointer on model structure
+    view_t *view - pointer on view structure
+    offset_t offset - offset of the first character
+    offset_t length - the number of characters, zero removes the mark
+*/
+void ShowViewText(HWND hwnd, const model_t *model, view_t *view, offset_t offset, offset_t length);
+
 /* Sets the vertical scroll caret by the specified position
 INPUT:
     HWND hwnd - window handle for which the displaying will be performed
     view_t *view - pointer on view structure
-    unsigned long pos - position of vertical scroll
+    index_t pos - position of vertical scroll
 */
-void SetVScroll(HWND hwnd, view_t *view, unsigned long pos);
+void SetVScroll(HWND hwnd, view_t *view, index_t pos);
 
 /* Sets the horizontal scroll caret by the specified position
 INPUT:
     HWND hwnd - window handle for which the displaying will be performed
     view_t *view - pointer on view structure
-    unsigned long pos - position of horizontal scroll
+    offset_t pos - position of horizontal scroll
+*/
+void SetHScroll(HWND hwnd, view_t *view, offset_t pos);
+
+/*  Sets the vertical scroll caret by the dragged thumb. Its 32-bit track position
+    is read, the 16 bits of the scroll message would lose the rows of a long view
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    view_t *view - pointer on view structure
+*/
+void SetVScrollThumb(HWND hwnd, view_t *view);
+
+/*  Sets the horizontal scroll caret by the dragged thumb in the same way
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    view_t *view - pointer on view structure
 */
-void SetHScroll(HWND hwnd, view_t *view, unsigned long pos);
+void SetHScrollThumb(HWND hwnd, view_t *view);
 
 /* Shifts the vertical scroll caret by the specified amount
 INPUT:
@@ -105,15 +238,25 @@ void SetWithDeltaHScroll(HWND hwnd, view_t *view, long delta);
 /*  Displays the view
 INPUT:
     HWND hwnd - window handle for which the displaying will be performed
+    const model_t *model - pointer on model structure
     view_t *view - pointer on view structure
 */
-void DisplayView(HWND hwnd, view_t *view);
+void DisplayView(HWND hwnd, const model_t *model, view_t *view);
+
+/*  Displays the rows of the merged files, every row starts with the tag of its
+    file on the background of the file
+INPUT:
+    HWND hwnd - window handle for which the displaying will be performed
+    merged_log_t *merge - pointer on locked merged log structure
+    view_t *view - pointer on view structure built by MergedViewRectResize
+*/
+void DisplayMergedView(HWND hwnd, merged_log_t *merge, view_t *view);
 
-/* Clears the data field of the view
+/* Clears the rows of the view
 INPUT:
     view_t *view - pointer on view structure
 OUTPUT:
-    view_t *view - pointer on view structure with zero values in data field and NumOfLines
+    view_t *view - pointer on view structure with empty layout and zero NumOfLines
 */
 void ClearViewData(view_t *view);
 
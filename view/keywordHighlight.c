@@ -0,0 +1,209 @@
+#include "keywordHighlight.h"
+#include <string.h>
+
+/*  Initializes the highlighter
+INPUT:
+    highlighter_t *highlighter - pointer on highlighter structure
+OUTPUT:
+    highlighter_t *highlighter - pointer on highlighter structure without keywords
+*/
+void InitHighlighter(highlighter_t *highlighter)
+{
+    InitKeywordSet(&highlighter->Keywords);
+    highlighter->Lines = NULL;
+    highlighter->Text = NULL;
+    highlighter->TextSize = 0;
+    highlighter->Spans = NULL;
+    highlighter->SpansSize = 0;
+}
+
+/*  Compiles the keywords separated by spaces, tabs or line breaks and drops the
+    cached spans. The previous keywords stay if the new ones cannot be compiled
+INPUT:
+    highlighter_t *highlighter - pointer on highlighter structure
+    const char *text - the keywords in UTF-8, the empty text removes the highlighting
+    size_t length - the number of characters of the text
+    int ignoreCase - nonzero if the case of the ASCII letters is ignored
+RETURN:
+    error_t - error code, BAD_PATTERN if there are too many keywords or a keyword is too long
+*/
+error_t SetHighlighterKeywords(highlighter_t *highlighter, const char *text, size_t length, int ignoreCase)
+{
+    keyword_set_t keywords;
+    error_t err;
+
+    InitKeywordSet(&keywords);
+    err = CompileKeywordSet(&keywords, text, length, ignoreCase);
+    if (err != SUCCESS)
+        return err;
+
+    ClearKeywordSet(&highlighter->Keywords);
+    highlighter->Keywords = keywords;
+    ResetHighlighter(highlighter);
+
+    return SUCCESS;
+}
+
+/*  Checks whether there are keywords to highlight
+INPUT:
+    const highlighter_t *highlighter - pointer on highlighter structure
+RETURN:
+    int - nonzero if there are keywords
+*/
+int HasHighlighterKeywords(const highlighter_t *highlighter)
+{
+    return highlighter->Keywords.NumOfStates > 0;
+}
+
+/*  Finds the keyword spans of the characters of the model, the spans are left in
+    the Spans buffer of the highlighter
+INPUT:
+    highlighter_t *highlighter - pointer on highlighter structure
+    const model_t *model - pointer on model structure
+    offset_t offset - offset of the first character
+    size_t size - the number of characters
+    size_t *numOfSpans - the number of found spans
+RETURN:
+    error_t - error code
+*/
+static error_t ScanText(highlighter_t *highlighter, const model_t *model, offset_t offset, size_t size,
+                        size_t *numOfSpans)
+{
+    size_t spansSize = size / 2 + 1;
+    offset_t length = size;
+    const char *text;
+
+    /* The buffers only grow, the next rows usually fit in them */
+    if (model->Data == NULL && highlighter->TextSize < size)
+    {
+        char *tmp = realloc(highlighter->Text, size);
+
+        if (tmp == NULL)
+            return MEMORY_SHORTAGE;
+        highlighter->Text = tmp;
+        highlighter->TextSize = size;
+    }
+    if (highlighter->SpansSize < spansSize)
+    {
+        keyword_span_t *tmp = realloc(highlighter->Spans, spansSize * sizeof(keyword_span_t));
+
+        if (tmp == NULL)
+            return MEMORY_SHORTAGE;
+        highlighter->Spans = tmp;
+        highlighter->SpansSize = spansSize;
+    }
+
+    text = GetModelText(model, offset, highlighter->Text, &length);
+    *numOfSpans = FindKeywords(&highlighter->Keywords, text, (size_t)length, highlighter->Spans, spansSize);
+    return SUCCESS;
+}
+
+/*  Finds the keyword spans of the model line covering the characters. The spans of
+    the short line are cached for the whole line, the long line is scanned around
+    the characters only
+INPUT:
+    highlighter_t *highlighter - pointer on highlighter structure
+    const model_t *model - pointer on model structure
+    index_t line - index of the model line
+    offset_t from - offset in the line of the first character
+    offset_t to - offset in the line after the last character
+    const keyword_span_t **spans - the spans relative to the line start, valid until the next call
+RETURN:
+    size_t - the number of spans, 0 if there is not enough memory
+*/
+size_t FindLineHighlights(highlighter_t *highlighter, const model_t *model, index_t line, offset_t from,
+                          offset_t to, const keyword_span_t **spans)
+{
+    offset_t lineStart = GetModelLineOffset(model, line);
+    offset_t lineLen = GetModelLineLength(model, line);
+    highlight_line_t *entry;
+    size_t count;
+    size_t i;
+
+    *spans = NULL;
+    if (!HasHighlighterKeywords(highlighter) || lineLen == 0)
+        return 0;
+
+    /* The keyword crossing the characters lies within its length around them */
+    if (lineLen > HIGHLIGHT_LINE_LIMIT)
+    {
+        offset_t first = from > MAX_KEYWORD_LENGTH ? from - MAX_KEYWORD_LENGTH : 0;
+        offset_t last = to + MAX_KEYWORD_LENGTH < lineLen ? to + MAX_KEYWORD_LENGTH : lineLen;
+
+        if (first >= last || ScanText(highlighter, model, lineStart + first, (size_t)(last - first), &count) != SUCCESS)
+            return 0;
+        for (i = 0; i < count; i++)
+            highlighter->Spans[i].Start += (size_t)first;
+        *spans = highlighter->Spans;
+        return count;
+    }
+
+    if (highlighter->Lines == NULL)
+    {
+        highlighter->Lines = calloc(HIGHLIGHT_CACHE_LINES, sizeof(highlight_line_t));
+        if (highlighter->Lines == NULL)
+            return 0;
+    }
+
+    entry = &highlighter->Lines[line & (HIGHLIGHT_CACHE_LINES - 1)];
+    if (!entry->IsUsed || entry->Line != line || entry->Offset != lineStart || entry->Length != lineLen)
+    {
+        keyword_span_t *lineSpans = NULL;
+
+        if (ScanText(highlighter, model, lineStart, (size_t)lineLen, &count) != SUCCESS)
+            return 0;
+        if (count > 0)
+        {
+            lineSpans = malloc(count * sizeof(keyword_span_t));
+            if (lineSpans == NULL)
+                return 0;
+            memcpy(lineSpans, highlighter->Spans, count * sizeof(keyword_span_t));
+        }
+
+        free(entry->Spans);
+        entry->Line = line;
+        entry->Offset = lineStart;
+        entry->Length = lineLen;
+        entry->Spans = lineSpans;
+        entry->NumOfSpans = count;
+        entry->IsUsed = 1;
+    }
+
+    *spans = entry->Spans;
+    return entry->NumOfSpans;
+}
+
+/*  Drops the cached spans, the keywords stay
+INPUT:
+    highlighter_t *highlighter - pointer on highlighter structure
+*/
+void ResetHighlighter(highlighter_t *highlighter)
+{
+    size_t i;
+
+    if (highlighter->Lines == NULL)
+        return;
+
+    for (i = 0; i < HIGHLIGHT_CACHE_LINES; i++)
+        free(highlighter->Lines[i].Spans);
+    free(highlighter->Lines);
+    highlighter->Lines = NULL;
+}
+
+/*  Releases the highlighter
+INPUT:
+    highlighter_t *highlighter - pointer on highlighter structure
+OUTPUT:
+    highlighter_t *highlighter - pointer on highlighter structure without keywords
+*/
+void ClearHighlighter(highlighter_t *highlighter)
+{
+    if (highlighter == NULL)
+        return;
+
+    ResetHighlighter(highlighter);
+    ClearKeywordSet(&highlighter->Keywords);
+    free(highlighter->Text);
+    free(highlighter->Spans);
+    InitHighlighter(highlighter);
+}
@@ -0,0 +1,92 @@
+#ifndef __KEYWORD_HIGHLIGHT_H_INCLUDED
+#define __KEYWORD_HIGHLIGHT_H_INCLUDED
+
+#include "../model/fileModel.h"
+#include "../model/keywordSet.h"
+
+#define HIGHLIGHT_CACHE_LINES 4096          /* The number of cached lines, a power of two */
+#define HIGHLIGHT_LINE_LIMIT (64ul << 10)   /* Longer lines are scanned row by row and not cached */
+
+/* Keyword spans of one model line */
+typedef struct
+{
+    index_t Line;               /* Index of the model line */
+    offset_t Offset;            /* Offset of the line when it was scanned */
+    offset_t Length;            /* Length of the line when it was scanned, the growing last line is scanned again */
+    keyword_span_t *Spans;      /* Spans relative to the line start, NULL if there are none */
+    size_t NumOfSpans;          /* The number of spans */
+    int IsUsed;                 /* Nonzero if the entry holds a line */
+} highlight_line_t;
+
+/*  Highlighting of the keywords in the painted rows. The spans of the lines are
+    cached by the line index, the window shows consecutive lines, so they never
+    evict each other and scrolling back and forth does not scan them again */
+typedef struct
+{
+    keyword_set_t Keywords;     /* The highlighted keywords */
+    highlight_line_t *Lines;    /* HIGHLIGHT_CACHE_LINES entries or NULL before the first scan */
+    char *Text;                 /* Characters of the scanned part of the file read by blocks */
+    size_t TextSize;            /* Size of Text */
+    keyword_span_t *Spans;      /* Spans of the scanned part before they are cached */
+    size_t SpansSize;           /* The number of elements of Spans */
+} highlighter_t;
+
+/*  Initializes the highlighter
+INPUT:
+    highlighter_t *highlighter - pointer on highlighter structure
+OUTPUT:
+    highlighter_t *highlighter - pointer on highlighter structure without keywords
+*/
+void InitHighlighter(highlighter_t *highlighter);
+
+/*  Compiles the keywords separated by spaces, tabs or line breaks and drops the
+    cached spans. The previous keywords stay if the new ones cannot be compiled
+INPUT:
+    highlighter_t *highlighter - pointer on highlighter structure
+    const char *text - the keywords in UTF-8, the empty text removes the highlighting
+    size_t length - the number of characters of the text
+    int ignoreCase - nonzero if the case of the ASCII letters is ignored
+RETURN:
+    error_t - error code, BAD_PATTERN if there are too many keywords or a keyword is too long
+*/
+error_t SetHighlighterKeywords(highlighter_t *highlighter, const char *text, size_t length, int ignoreCase);
+
+/*  Checks whether there are keywords to highlight
+INPUT:
+    const highlighter_t *highlighter - pointer on highlighter structure
+RETURN:
+    int - nonzero if there are keywords
+*/
+int HasHighlighterKeywords(const highlighter_t *highlighter);
+
+/*  Finds the keyword spans of the model line covering the characters. The spans of
+    the short line are cached for the whole line, the long line is scanned around
+    the characters only
+INPUT:
+    highlighter_t *highlighter - pointer on highlighter structure
+    const model_t *model - pointer on model structure
+    index_t line - index of the model line
+    offset_t from - offset in the line of the first character
+    offset_t to - offset in the line after the last character
+    const keyword_span_t **spans - the spans relative to the line start, valid until the next call
+RETURN:
+    size_t - the number of spans, 0 if there is not enough memory
+*/
+size_t FindLineHighlights(highlighter_t *highlighter, const model_t *model, index_t line, offset_t from,
+                          offset_t to, const keyword_span_t **spans);
+
+/*  Drops the cached spans, the keywords stay
+INPUT:
+    highlighter_t *highlighter - pointer on highlighter structure
+*/
+void ResetHighlighter(highlighter_t *highlighter);
+
+/*  Releases the highlighter
+INPUT:
+    highlighter_t *highlighter - pointer on highlighter structure
+OUTPUT:
+    highlighter_t *highlighter - pointer on highlighter structure without keywords
+*/
+void ClearHighlighter(highlighter_t *highlighter);
+
+#endif // __KEYWORD_HIGHLIGHT_H_INCLUDED
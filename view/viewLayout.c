@@ -0,0 +1,885 @@
+#include "viewLayout.h"
+#include "../thread/threadPool.h"
+#include <string.h>
+
+#define MIN_CAPACITY 1024               /* Initial number of entries in the lists of long lines */
+#define MIN_TASK_LINES (256ul << 10)    /* Minimum number of model lines examined by one parallel task */
+#define MIN_TASK_BLOCKS 4096            /* Minimum number of tree blocks summed by one parallel task */
+#define TASKS_PER_THREAD 4              /* Tasks per pool thread to even out the load */
+#define CANCEL_PERIOD (64ul << 10)      /* The number of lines examined between the cancellation checks */
+
+/* Long lines found by one task of the parallel search */
+typedef struct
+{
+    index_t *Lines;             /* Indexes of the long lines */
+    offset_t *Lengths;          /* Widths of the long lines in columns */
+    index_t Count;              /* The number of long lines found */
+    index_t Capacity;           /* The number of entries allocated in the lists */
+    index_t Position;           /* Position of the first long line in the lists of the layout */
+    int IsShort;                /* Nonzero if the lists could not grow, the search of the task stopped */
+} found_lines_t;
+
+/* Shared state of the parallel search of the long lines */
+typedef struct
+{
+    layout_t *Layout;           /* Pointer on the layout */
+    const model_t *Model;       /* Pointer on the model */
+    index_t First;              /* The first model line examined */
+    index_t Last;               /* The line after the last one examined */
+    index_t TaskLines;          /* The number of lines examined by one task */
+    found_lines_t *Found;       /* The long lines found by every task */
+} parallel_scan_t;
+
+/* Shared state of the parallel summation of the tree blocks */
+typedef struct
+{
+    layout_t *Layout;           /* Pointer on the layout */
+    index_t TaskBlocks;         /* The number of blocks summed by one task */
+    index_t *ExtraRows;         /* Extra rows of the lines summed by every task */
+} parallel_sum_t;
+
+static unsigned long CacheBudget = LAYOUT_CACHE_BUDGET; /* Bytes the cached trees may take */
+
+/*  Sets the memory budget of the cached trees, the layouts of all the views share it
+INPUT:
+    unsigned long bytes - the number of bytes
+*/
+void SetLayoutCacheBudget(unsigned long bytes)
+{
+    CacheBudget = bytes;
+}
+
+/*  Initializes the layout
+INPUT:
+    layout_t *layout - pointer on layout structure
+OUTPUT:
+    layout_t *layout - pointer on empty layout structure
+*/
+void InitLayout(layout_t *layout)
+{
+    int i;
+
+    layout->LongLines = NULL;
+    layout->Lengths = NULL;
+    layout->NumOfLong = 0;
+    layout->Capacity = 0;
+    layout->Threshold = 0;
+    layout->NumOfLines = 0;
+
+    layout->Width = 0;
+    layout->Tree = NULL;
+    layout->TreeCapacity = 0;
+    layout->ExtraRows = 0;
+    layout->TreeOfLong = 0;
+
+    for (i = 0; i < LAYOUT_CACHE_SIZE; i++)
+    {
+        layout->Cache[i].Width = 0;
+        layout->Cache[i].Tree = NULL;
+        layout->Cache[i].TreeCapacity = 0;
+        layout->Cache[i].ExtraRows = 0;
+        layout->Cache[i].TreeOfLong = 0;
+        layout->Cache[i].LastUse = 0;
+    }
+    layout->Clock = 0;
+    layout->Cancel = NULL;
+}
+
+/*  Returns the number of rows besides the first one taken by the line
+INPUT:
+    offset_t len - length of the line
+    unsigned long width - the number of characters in a row
+RETURN:
+    index_t - the number of extra rows
+*/
+static index_t GetExtraRows(offset_t len, unsigned long width)
+{
+    return len <= width ? 0 : (len - 1) / width;
+}
+
+/*  Returns the number of tasks splitting the work between the pool threads
+INPUT:
+    index_t amount - the amount of work
+    index_t minAmount - the minimum amount of work done by one task
+RETURN:
+    unsigned long - the number of tasks
+*/
+static unsigned long GetNumOfTasks(index_t amount, index_t minAmount)
+{
+    index_t numOfTasks = amount / minAmount;
+    unsigned long maxTasks = GetThreadPoolLimit() * TASKS_PER_THREAD;
+
+    if (numOfTasks > maxTasks)
+        numOfTasks = maxTasks;
+    return numOfTasks == 0 ? 1 : (unsigned long)numOfTasks;
+}
+
+/*  Returns the number of blocks of the long lines, it is the number of tree nodes
+INPUT:
+    const layout_t *layout - pointer on layout structure
+RETURN:
+    index_t - the number of blocks
+*/
+static index_t GetNumOfBlocks(const layout_t *layout)
+{
+    return (layout->NumOfLong + LAYOUT_BLOCK - 1) / LAYOUT_BLOCK;
+}
+
+/*  Returns the weight of the long line: the distance from the previous long line
+    plus its extra rows. The sum of the weights up to the line is its last row
+INPUT:
+    const layout_t *layout - pointer on layout structure
+    index_t index - index of the long line
+RETURN:
+    index_t - the weight
+*/
+static index_t GetLongLineWeight(const layout_t *layout, index_t index)
+{
+    index_t previous = index == 0 ? 0 : layout->LongLines[index - 1];
+
+    return layout->LongLines[index] - previous + GetExtraRows(layout->Lengths[index], layout->Width);
+}
+
+/*  Returns the sum of the weights of the first blocks
+INPUT:
+    const layout_t *layout - pointer on layout structure
+    index_t count - the number of blocks
+RETURN:
+    index_t - the sum of the weights
+*/
+static index_t GetTreePrefix(const layout_t *layout, index_t count)
+{
+    index_t sum = 0;
+
+    for (; count > 0; count &= count - 1)
+        sum += layout->Tree[count];
+
+    return sum;
+}
+
+/*  Makes room for the tree nodes of all the blocks
+INPUT:
+    layout_t *layout - pointer on layout structure
+RETURN:
+    error_t - error code
+*/
+static error_t ReserveTree(layout_t *layout)
+{
+    index_t needed = GetNumOfBlocks(layout) + 1;
+    index_t capacity = layout->TreeCapacity * 2;
+    index_t *tree;
+
+    if (needed <= layout->TreeCapacity)
+        return SUCCESS;
+
+    if (capacity < needed)
+        capacity = needed;
+    if (!FITS_IN_MEMORY(capacity, sizeof(index_t)))
+        return MEMORY_SHORTAGE;
+    tree = realloc(layout->Tree, (size_t)capacity * sizeof(index_t));
+    if (tree == NULL)
+        return MEMORY_SHORTAGE;
+
+    layout->Tree = tree;
+    layout->TreeCapacity = capacity;
+    return SUCCESS;
+}
+
+/*  Sums the weights of the blocks of one task into their tree nodes
+INPUT:
+    void *arg - pointer on parallel summation structure
+    unsigned long index - index of the task
+*/
+static void SumBlocks(void *arg, unsigned long index)
+{
+    parallel_sum_t *sum = arg;
+    layout_t *layout = sum->Layout;
+    index_t block = index * sum->TaskBlocks;
+    index_t first = block * LAYOUT_BLOCK;
+    index_t last = first + sum->TaskBlocks * LAYOUT_BLOCK;
+    index_t extraRows = 0;
+    index_t i;
+
+    if (last > layout->NumOfLong)
+        last = layout->NumOfLong;
+
+    for (i = first; i < last; i++)
+    {
+        if (i % LAYOUT_BLOCK == 0)
+            layout->Tree[i / LAYOUT_BLOCK + 1] = 0;
+        layout->Tree[i / LAYOUT_BLOCK + 1] += GetLongLineWeight(layout, i);
+        extraRows += GetExtraRows(layout->Lengths[i], layout->Width);
+    }
+
+    sum->ExtraRows[index] = extraRows;
+}
+
+/*  Rebuilds the tree for the current width in linear time, many blocks are
+    summed on the thread pool
+INPUT:
+    layout_t *layout - pointer on layout structure
+RETURN:
+    error_t - error code
+*/
+static error_t RebuildTree(layout_t *layout)
+{
+    index_t numOfBlocks = GetNumOfBlocks(layout);
+    unsigned long numOfTasks = GetNumOfTasks(numOfBlocks, MIN_TASK_BLOCKS);
+    index_t extraRows = 0;
+    index_t node;
+    parallel_sum_t sum;
+    unsigned long i;
+
+    if (ReserveTree(layout) != SUCCESS)
+        return MEMORY_SHORTAGE;
+
+    sum.Layout = layout;
+    sum.TaskBlocks = (numOfBlocks + numOfTasks - 1) / numOfTasks;
+    sum.ExtraRows = &extraRows;
+    if (numOfTasks > 1)
+    {
+        sum.ExtraRows = calloc(numOfTasks, sizeof(index_t));
+        if (sum.ExtraRows == NULL)
+            return MEMORY_SHORTAGE;
+        RunParallel(SumBlocks, &sum, numOfTasks);
+    }
+    else
+        SumBlocks(&sum, 0);
+
+    layout->ExtraRows = 0;
+    layout->TreeOfLong = layout->NumOfLong;
+    for (i = 0; i < numOfTasks; i++)
+        layout->ExtraRows += sum.ExtraRows[i];
+    if (numOfTasks > 1)
+        free(sum.ExtraRows);
+
+    /* Every node passes its sum to the parent */
+    for (node = 1; node <= numOfBlocks; node++)
+    {
+        index_t parent = node + (node & (~node + 1));
+
+        if (parent <= numOfBlocks)
+            layout->Tree[parent] += layout->Tree[node];
+    }
+
+    return SUCCESS;
+}
+
+/*  Adds the listed long lines which are not summed yet to the tree
+INPUT:
+    layout_t *layout - pointer on layout structure
+RETURN:
+    error_t - error code
+*/
+static error_t ExtendTree(layout_t *layout)
+{
+    if (ReserveTree(layout) != SUCCESS)
+        return MEMORY_SHORTAGE;
+
+    for (; layout->TreeOfLong < layout->NumOfLong; layout->TreeOfLong++)
+    {
+        index_t index = layout->TreeOfLong;
+        index_t weight = GetLongLineWeight(layout, index);
+
+        layout->ExtraRows += GetExtraRows(layout->Lengths[index], layout->Width);
+
+        if (index % LAYOUT_BLOCK == 0)
+        {
+            /* The new node covers the blocks which are not covered by the previous nodes */
+            index_t node = index / LAYOUT_BLOCK + 1;
+
+            layout->Tree[node] = weight + GetTreePrefix(layout, node - 1) -
+                                 GetTreePrefix(layout, node - (node & (~node + 1)));
+        }
+        else
+        {
+            /* The block is the last one, so its node has no parents yet */
+            layout->Tree[index / LAYOUT_BLOCK + 1] += weight;
+        }
+    }
+
+    return SUCCESS;
+}
+
+/*  Makes room in the lists of long lines
+INPUT:
+    layout_t *layout - pointer on layout structure
+    index_t needed - the number of long lines
+RETURN:
+    error_t - error code
+*/
+static error_t ReserveLongLines(layout_t *layout, index_t needed)
+{
+    if (needed > layout->Capacity)
+    {
+        index_t capacity = layout->Capacity < MIN_CAPACITY ? MIN_CAPACITY : layout->Capacity * 2;
+        index_t *lines;
+        offset_t *lengths;
+
+        if (capacity < needed)
+            capacity = needed;
+
+        if (!FITS_IN_MEMORY(capacity, sizeof(offset_t)))
+            return MEMORY_SHORTAGE;
+
+        lines = realloc(layout->LongLines, (size_t)capacity * sizeof(index_t));
+        if (lines == NULL)
+            return MEMORY_SHORTAGE;
+        layout->LongLines = lines;
+
+        lengths = realloc(layout->Lengths, (size_t)capacity * sizeof(offset_t));
+        if (lengths == NULL)
+            return MEMORY_SHORTAGE;
+        layout->Lengths = lengths;
+
+        layout->Capacity = capacity;
+    }
+
+    return SUCCESS;
+}
+
+/*  Adds the line to the list of long lines and to the tree
+INPUT:
+    layout_t *layout - pointer on layout structure
+    index_t line - index of the model line
+    offset_t len - length of the model line
+RETURN:
+    error_t - error code
+*/
+static error_t AppendLongLine(layout_t *layout, index_t line, offset_t len)
+{
+    if (ReserveLongLines(layout, layout->NumOfLong + 1) != SUCCESS)
+        return MEMORY_SHORTAGE;
+
+    layout->LongLines[layout->NumOfLong] = line;
+    layout->Lengths[layout->NumOfLong] = len;
+    layout->NumOfLong++;
+    if (ExtendTree(layout) != SUCCESS)
+    {
+        layout->NumOfLong--;
+        return MEMORY_SHORTAGE;
+    }
+
+    return SUCCESS;
+}
+
+/*  Checks whether the model line may take more than one row
+INPUT:
+    const layout_t *layout - pointer on layout structure
+    const model_t *model - pointer on model structure
+    index_t line - index of the model line
+    offset_t *len - width of the long line in columns
+RETURN:
+    int - nonzero if the line is wider than the threshold
+*/
+static int IsLongLine(const layout_t *layout, const model_t *model, index_t line, offset_t *len)
+{
+    offset_t distance = GetModelLineOffset(model, line + 1) - GetModelLineOffset(model, line);
+
+    /* The distance between the line starts is enough to reject short lines, a line
+       is never wider than its length, or than its length times the tab size if it has tabs */
+    if (distance <= layout->Threshold &&
+        (!IsModelTabLine(model, line) || distance * model->TabSize <= layout->Threshold))
+        return 0;
+
+    *len = GetModelLineColumns(model, line);
+    return *len > layout->Threshold;
+}
+
+/*  Checks whether the update of the layout is cancelled
+INPUT:
+    const layout_t *layout - pointer on layout structure
+RETURN:
+    int - nonzero if the update must stop
+*/
+static int IsLayoutCancelled(const layout_t *layout)
+{
+    return layout->Cancel != NULL && *layout->Cancel != 0;
+}
+
+/*  Adds the long line to the lists of the task
+INPUT:
+    found_lines_t *found - pointer on the long lines of the task
+    index_t line - index of the model line
+    offset_t len - width of the model line in columns
+RETURN:
+    error_t - error code
+*/
+static error_t AppendFoundLine(found_lines_t *found, index_t line, offset_t len)
+{
+    if (found->Count == found->Capacity)
+    {
+        index_t capacity = found->Capacity < MIN_CAPACITY ? MIN_CAPACITY : found->Capacity * 2;
+        index_t *lines;
+        offset_t *lengths;
+
+        if (!FITS_IN_MEMORY(capacity, sizeof(offset_t)))
+            return MEMORY_SHORTAGE;
+
+        lines = realloc(found->Lines, (size_t)capacity * sizeof(index_t));
+        if (lines == NULL)
+            return MEMORY_SHORTAGE;
+        found->Lines = lines;
+
+        lengths = realloc(found->Lengths, (size_t)capacity * sizeof(offset_t));
+        if (lengths == NULL)
+            return MEMORY_SHORTAGE;
+        found->Lengths = lengths;
+
+        found->Capacity = capacity;
+    }
+
+    found->Lines[found->Count] = line;
+    found->Lengths[found->Count] = len;
+    found->Count++;
+    return SUCCESS;
+}
+
+/*  Finds the long lines in the lines of one task and keeps them with their widths
+INPUT:
+    void *arg - pointer on parallel search structure
+    unsigned long index - index of the task
+*/
+static void FindLongLines(void *arg, unsigned long index)
+{
+    parallel_scan_t *scan = arg;
+    found_lines_t *found = &scan->Found[index];
+    index_t line = scan->First + index * scan->TaskLines;
+    index_t last = line + scan->TaskLines;
+    offset_t len;
+
+    if (last > scan->Last)
+        last = scan->Last;
+
+    for (; line < last; line++)
+    {
+        if (line % CANCEL_PERIOD == 0 && IsLayoutCancelled(scan->Layout))
+            break;
+        if (IsLongLine(scan->Layout, scan->Model, line, &len) && AppendFoundLine(found, line, len) != SUCCESS)
+        {
+            found->IsShort = 1;
+            break;
+        }
+    }
+}
+
+/*  Copies the long lines of one task to the lists of the layout at its position
+INPUT:
+    void *arg - pointer on parallel search structure
+    unsigned long index - index of the task
+*/
+static void CopyLongLines(void *arg, unsigned long index)
+{
+    parallel_scan_t *scan = arg;
+    found_lines_t *found = &scan->Found[index];
+
+    memcpy(scan->Layout->LongLines + found->Position, found->Lines, (size_t)found->Count * sizeof(index_t));
+    memcpy(scan->Layout->Lengths + found->Position, found->Lengths, (size_t)found->Count * sizeof(offset_t));
+}
+
+/*  Frees the long lines found by the tasks
+INPUT:
+    parallel_scan_t *scan - pointer on parallel search structure
+    unsigned long numOfTasks - the number of tasks
+*/
+static void FreeFoundLines(parallel_scan_t *scan, unsigned long numOfTasks)
+{
+    unsigned long i;
+
+    for (i = 0; i < numOfTasks; i++)
+    {
+        free(scan->Found[i].Lines);
+        free(scan->Found[i].Lengths);
+    }
+    free(scan->Found);
+}
+
+/*  Lists the long lines among the new model lines. Many lines are split into
+    ranges examined on the thread pool: every range keeps its long lines with
+    their widths, a prefix sum of their numbers gives the positions and the
+    ranges copy their lines to the lists, so every line is examined once and
+    the lists are the same as the ones of the sequential search. A cancelled
+    search leaves the layout consistent, only some of the model lines remain
+    unexamined
+INPUT:
+    layout_t *layout - pointer on layout structure
+    const model_t *model - pointer on model structure
+    index_t end - the lines before this one are examined
+RETURN:
+    error_t - error code
+*/
+static error_t ScanLongLines(layout_t *layout, const model_t *model, index_t end)
+{
+    parallel_scan_t scan;
+    unsigned long numOfTasks = GetNumOfTasks(end - layout->NumOfLines, MIN_TASK_LINES);
+    index_t total = layout->NumOfLong;
+    unsigned long i;
+
+    if (numOfTasks <= 1)
+    {
+        index_t line;
+        offset_t len;
+
+        for (line = layout->NumOfLines; line < end; line++)
+        {
+            if (line % CANCEL_PERIOD == 0 && IsLayoutCancelled(layout))
+                break;
+            if (IsLongLine(layout, model, line, &len) && AppendLongLine(layout, line, len) != SUCCESS)
+                return MEMORY_SHORTAGE;
+            layout->NumOfLines = line + 1;
+        }
+        return SUCCESS;
+    }
+
+    scan.Layout = layout;
+    scan.Model = model;
+    scan.First = layout->NumOfLines;
+    scan.Last = end;
+    scan.TaskLines = (scan.Last - scan.First + numOfTasks - 1) / numOfTasks;
+    scan.Found = calloc(numOfTasks, sizeof(found_lines_t));
+    if (scan.Found == NULL)
+        return MEMORY_SHORTAGE;
+
+    RunParallel(FindLongLines, &scan, numOfTasks);
+
+    /* The lines found by a cancelled search are incomplete, the examined lines stay the same */
+    if (IsLayoutCancelled(layout))
+    {
+        FreeFoundLines(&scan, numOfTasks);
+        return SUCCESS;
+    }
+
+    /* The numbers of the found lines give the positions of the first long lines of the tasks */
+    for (i = 0; i < numOfTasks; i++)
+    {
+        if (scan.Found[i].IsShort)
+        {
+            FreeFoundLines(&scan, numOfTasks);
+            return MEMORY_SHORTAGE;
+        }
+        scan.Found[i].Position = total;
+        total += scan.Found[i].Count;
+    }
+
+    if (ReserveLongLines(layout, total) != SUCCESS)
+    {
+        FreeFoundLines(&scan, numOfTasks);
+        return MEMORY_SHORTAGE;
+    }
+
+    RunParallel(CopyLongLines, &scan, numOfTasks);
+    FreeFoundLines(&scan, numOfTasks);
+
+    layout->NumOfLong = total;
+    layout->NumOfLines = end;
+    return ExtendTree(layout);
+}
+
+/*  Drops all the cached trees
+INPUT:
+    layout_t *layout - pointer on layout structure
+*/
+static void DropCachedTrees(layout_t *layout)
+{
+    int i;
+
+    for (i = 0; i < LAYOUT_CACHE_SIZE; i++)
+    {
+        free(layout->Cache[i].Tree);
+        layout->Cache[i].Tree = NULL;
+        layout->Cache[i].TreeCapacity = 0;
+        layout->Cache[i].Width = 0;
+    }
+}
+
+/*  Puts the current tree into the cache. The least recently used trees are
+    dropped while the cache does not fit in the budget
+INPUT:
+    layout_t *layout - pointer on layout structure with nonzero width
+*/
+static void CacheTree(layout_t *layout)
+{
+    size_t size = (size_t)layout->TreeCapacity * sizeof(index_t);
+    int slot = 0;
+    int i;
+
+    for (i = 0; i < LAYOUT_CACHE_SIZE; i++)
+        if (layout->Cache[i].Width != 0)
+            size += (size_t)layout->Cache[i].TreeCapacity * sizeof(index_t);
+
+    for (;;)
+    {
+        int oldest = -1;
+
+        for (i = 0; i < LAYOUT_CACHE_SIZE; i++)
+        {
+            if (layout->Cache[i].Width == 0)
+                slot = i;
+            else if (oldest < 0 || layout->Cache[i].LastUse < layout->Cache[oldest].LastUse)
+                oldest = i;
+        }
+
+        /* Stop when the tree fits and there is a free slot */
+        if (size <= CacheBudget && layout->Cache[slot].Width == 0)
+            break;
+        if (oldest < 0)
+        {
+            /* The tree alone exceeds the budget */
+            free(layout->Tree);
+            return;
+        }
+
+        size -= (size_t)layout->Cache[oldest].TreeCapacity * sizeof(index_t);
+        free(layout->Cache[oldest].Tree);
+        layout->Cache[oldest].Tree = NULL;
+        layout->Cache[oldest].TreeCapacity = 0;
+        layout->Cache[oldest].Width = 0;
+    }
+
+    layout->Cache[slot].Width = layout->Width;
+    layout->Cache[slot].Tree = layout->Tree;
+    layout->Cache[slot].TreeCapacity = layout->TreeCapacity;
+    layout->Cache[slot].ExtraRows = layout->ExtraRows;
+    layout->Cache[slot].TreeOfLong = layout->TreeOfLong;
+    layout->Cache[slot].LastUse = ++layout->Clock;
+}
+
+/*  Makes the tree of the width current. A cached tree is only extended with
+    the long lines listed after it was cached, otherwise the tree is rebuilt
+INPUT:
+    layout_t *layout - pointer on layout structure
+    unsigned long width - the number of characters in a row
+RETURN:
+    error_t - error code
+*/
+static error_t SwitchTree(layout_t *layout, unsigned long width)
+{
+    int i;
+
+    if (layout->Width != 0)
+        CacheTree(layout);
+
+    layout->Width = width;
+    layout->Tree = NULL;
+    layout->TreeCapacity = 0;
+
+    for (i = 0; i < LAYOUT_CACHE_SIZE; i++)
+        if (layout->Cache[i].Width == width)
+        {
+            layout->Tree = layout->Cache[i].Tree;
+            layout->TreeCapacity = layout->Cache[i].TreeCapacity;
+            layout->ExtraRows = layout->Cache[i].ExtraRows;
+            layout->TreeOfLong = layout->Cache[i].TreeOfLong;
+            layout->Cache[i].Width = 0;
+            layout->Cache[i].Tree = NULL;
+            layout->Cache[i].TreeCapacity = 0;
+            return ExtendTree(layout);
+        }
+
+    return RebuildTree(layout);
+}
+
+/*  Brings the layout in line with the row width and examines at most the given
+    number of the new model lines, so a long update can release the model between
+    the parts. The layout is consistent after every part
+INPUT:
+    layout_t *layout - pointer on layout structure
+    const model_t *model - pointer on model structure
+    unsigned long width - the number of characters in a row
+    index_t maxLines - the maximum number of examined lines
+RETURN:
+    error_t - error code
+*/
+error_t UpdateLayoutPart(layout_t *layout, const model_t *model, unsigned long width, index_t maxLines)
+{
+    /* Shorter lines may be wrapped now, so all of them are examined again */
+    if (layout->NumOfLines == 0 || width < layout->Threshold || model->NumOfLines < layout->NumOfLines)
+    {
+        DropCachedTrees(layout);
+        layout->NumOfLong = 0;
+        layout->NumOfLines = 0;
+        layout->Threshold = width / 2;
+        layout->Width = width;
+        if (RebuildTree(layout) != SUCCESS)
+            return MEMORY_SHORTAGE;
+    }
+
+    if (width != layout->Width && SwitchTree(layout, width) != SUCCESS)
+        return MEMORY_SHORTAGE;
+
+    if (model->NumOfLines - layout->NumOfLines > maxLines)
+        return ScanLongLines(layout, model, layout->NumOfLines + maxLines);
+    return ScanLongLines(layout, model, model->NumOfLines);
+}
+
+/*  Brings the layout in line with the model lines and the row width. The new lines
+    of the model are added incrementally, a width change only recomputes the sums
+    unless the width becomes less than the threshold of the long lines. The sums for
+    the recently used widths are cached, so returning to such width is a lookup.
+    The update stops early when the value pointed by Cancel becomes nonzero
+INPUT:
+    layout_t *layout - pointer on layout structure
+    const model_t *model - pointer on model structure
+    unsigned long width - the number of characters in a row
+RETURN:
+    error_t - error code
+*/
+error_t UpdateLayout(layout_t *layout, const model_t *model, unsigned long width)
+{
+    return UpdateLayoutPart(layout, model, width, model->NumOfLines);
+}
+
+/*  Forgets the model lines starting from the line, the next update examines them again.
+    It is used when the last line of the model grows
+INPUT:
+    layout_t *layout - pointer on layout structure
+    index_t numOfLines - the number of model lines kept
+*/
+void TrimLayout(layout_t *layout, index_t numOfLines)
+{
+    if (numOfLines >= layout->NumOfLines)
+        return;
+
+    /* The cached trees would have to be trimmed too */
+    DropCachedTrees(layout);
+
+    while (layout->NumOfLong > 0 && layout->LongLines[layout->NumOfLong - 1] >= numOfLines)
+    {
+        index_t index = layout->NumOfLong - 1;
+
+        /* The node of the last block has no parents, so only it holds the weight */
+        if (index < layout->TreeOfLong)
+        {
+            layout->Tree[index / LAYOUT_BLOCK + 1] -= GetLongLineWeight(layout, index);
+            layout->ExtraRows -= GetExtraRows(layout->Lengths[index], layout->Width);
+            layout->TreeOfLong = index;
+        }
+        layout->NumOfLong = index;
+    }
+
+    layout->NumOfLines = numOfLines;
+}
+
+/*  Returns the number of rows in the layout
+INPUT:
+    const layout_t *layout - pointer on layout structure
+RETURN:
+    index_t - the number of rows
+*/
+index_t GetLayoutRows(const layout_t *layout)
+{
+    return layout->NumOfLines + layout->ExtraRows;
+}
+
+/*  Finds the model line shown in the row
+INPUT:
+    const layout_t *layout - pointer on layout structure
+    index_t row - index of the row, less than the number of rows
+    index_t *line - index of the model line
+    index_t *part - index of the row among the rows of the line
+*/
+void FindLayoutLine(const layout_t *layout, index_t row, index_t *line, index_t *part)
+{
+    index_t numOfBlocks = GetNumOfBlocks(layout);
+    index_t node = 0;
+    index_t rest = row;
+    index_t step = 1;
+    index_t index;
+
+    /* Descending the tree to the first block whose last row is not less than the row */
+    while (step * 2 <= numOfBlocks)
+        step *= 2;
+    for (; step > 0; step /= 2)
+        if (node + step <= numOfBlocks && layout->Tree[node + step] < rest)
+        {
+            node += step;
+            rest -= layout->Tree[node];
+        }
+
+    *part = 0;
+    if (node == numOfBlocks)
+    {
+        /* The row is below all the long lines */
+        *line = row - layout->ExtraRows;
+        return;
+    }
+
+    /* Walking through the block, lastRow is the last row of the current long line */
+    {
+        index_t lastRow = row - rest;
+
+        for (index = node * LAYOUT_BLOCK; ; index++)
+        {
+            index_t extra = GetExtraRows(layout->Lengths[index], layout->Width);
+            index_t firstRow;
+
+            lastRow += GetLongLineWeight(layout, index);
+            if (lastRow < row)
+                continue;
+
+            firstRow = lastRow - extra;
+            if (row >= firstRow)
+            {
+                *line = layout->LongLines[index];
+                *part = row - firstRow;
+            }
+            else
+                *line = layout->LongLines[index] - (firstRow - row);
+            return;
+        }
+    }
+}
+
+/*  Returns the first row of the model line
+INPUT:
+    const layout_t *layout - pointer on layout structure
+    index_t line - index of the model line
+RETURN:
+    index_t - index of the row
+*/
+index_t GetLayoutRow(const layout_t *layout, index_t line)
+{
+    index_t l = 0;
+    index_t r = layout->NumOfLong;
+    index_t lastRow;
+    index_t index;
+
+    /* Counting the long lines before the line */
+    while (l < r)
+    {
+        index_t midle = (r - l) / 2 + l;
+
+        if (layout->LongLines[midle] < line)
+            l = midle + 1;
+        else
+            r = midle;
+    }
+    if (l == 0)
+        return line;
+
+    /* The last row of the previous long line */
+    index = (l - 1) / LAYOUT_BLOCK * LAYOUT_BLOCK;
+    lastRow = GetTreePrefix(layout, index / LAYOUT_BLOCK);
+    for (; index < l; index++)
+        lastRow += GetLongLineWeight(layout, index);
+
+    return lastRow + (line - layout->LongLines[l - 1]);
+}
+
+/*  Clears the layout
+INPUT:
+    layout_t *layout - pointer on layout structure
+OUTPUT:
+    layout_t *layout - pointer on layout structure filled with zero values
+*/
+void ClearLayout(layout_t *layout)
+{
+    if (layout == NULL)
+        return;
+
+    free(layout->LongLines);
+    free(layout->Lengths);
+    free(layout->Tree);
+    DropCachedTrees(layout);
+    InitLayout(layout);
+}
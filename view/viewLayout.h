@@ -0,0 +1,131 @@
+#ifndef __VIEW_LAYOUT_H_INCLUDED
+#define __VIEW_LAYOUT_H_INCLUDED
+
+#include "../model/fileModel.h"
+
+#define LAYOUT_BLOCK 64                         /* The number of long lines summed in one node of the tree */
+#define LAYOUT_CACHE_SIZE 8                     /* The number of cached trees of other widths */
+#define LAYOUT_CACHE_BUDGET (16 * 1024 * 1024)  /* Default memory budget of the cached trees in bytes */
+
+/*  Sums of the long lines for one width */
+typedef struct
+{
+    unsigned long Width;            /* The number of characters in a row or 0 for a free entry */
+    index_t *Tree;                  /* Fenwick tree over the block weights */
+    index_t TreeCapacity;           /* The number of nodes fitting in the tree */
+    index_t ExtraRows;              /* The number of rows besides the first ones of the lines */
+    index_t TreeOfLong;             /* The number of long lines summed in the tree */
+    unsigned long LastUse;          /* Time of the last use for the LRU eviction */
+} layout_tree_t;
+
+/*  Wrapped layout of the model lines without a pointer per row. Only the lines
+    longer than Threshold can take more than one row, they are listed with their
+    widths in display columns, so the UTF-8 lines are counted once per threshold.
+    A Fenwick tree over blocks of the listed lines stores the number of
+    rows up to the end of every block, so rows and lines are mapped in O(log n)
+    and a width change recomputes the list sums without touching the file */
+typedef struct
+{
+    index_t *LongLines;             /* Indices of the lines longer than Threshold, increasing */
+    offset_t *Lengths;              /* Widths of these lines in columns */
+    index_t NumOfLong;              /* The number of listed lines */
+    index_t Capacity;               /* The number of lines fitting in the lists */
+    offset_t Threshold;             /* Lines not longer than it always take one row */
+    index_t NumOfLines;             /* The number of model lines examined */
+
+    unsigned long Width;            /* The number of columns in a row */
+    index_t *Tree;                  /* Fenwick tree over the block weights, 1-based */
+    index_t TreeCapacity;           /* The number of nodes fitting in the tree */
+    index_t ExtraRows;              /* The number of rows besides the first ones of the lines */
+    index_t TreeOfLong;             /* The number of long lines summed in the tree */
+
+    layout_tree_t Cache[LAYOUT_CACHE_SIZE]; /* Trees of the recently used widths */
+    unsigned long Clock;            /* Counter of the tree switches */
+
+    const volatile long *Cancel;    /* Nonzero value stops the search of the long lines or NULL */
+} layout_t;
+
+/*  Sets the memory budget of the cached trees, the layouts of all the views share it
+INPUT:
+    unsigned long bytes - the number of bytes
+*/
+void SetLayoutCacheBudget(unsigned long bytes);
+
+/*  Initializes the layout
+INPUT:
+    layout_t *layout - pointer on layout structure
+OUTPUT:
+    layout_t *layout - pointer on empty layout structure
+*/
+void InitLayout(layout_t *layout);
+
+/*  Brings the layout in line with the model lines and the row width. The new lines
+    of the model are added incrementally, a width change only recomputes the sums
+    unless the width becomes less than the threshold of the long lines. The sums for
+    the recently used widths are cached, so returning to such width is a lookup.
+    The update stops early when the value pointed by Cancel becomes nonzero
+INPUT:
+    layout_t *layout - pointer on layout structure
+    const model_t *model - pointer on model structure
+    unsigned long width - the number of characters in a row
+RETURN:
+    error_t - error code
+*/
+error_t UpdateLayout(layout_t *layout, const model_t *model, unsigned long width);
+
+/*  Brings the layout in line with the row width and examines at most the given
+    number of the new model lines, so a long update can release the model between
+    the parts. The layout is consistent after every part
+INPUT:
+    layout_t *layout - pointer on layout structure
+    const model_t *model - pointer on model structure
+    unsigned long width - the number of characters in a row
+    index_t maxLines - the maximum number of examined lines
+RETURN:
+    error_t - error code
+*/
+error_t UpdateLayoutPart(layout_t *layout, const model_t *model, unsigned long width, index_t maxLines);
+
+/*  Forgets the model lines starting from the line, the next update examines them again.
+    It is used when the last line of the model grows
+INPUT:
+    layout_t *layout - pointer on layout structure
+    index_t numOfLines - the number of model lines kept
+*/
+void TrimLayout(layout_t *layout, index_t numOfLines);
+
+/*  Returns the number of rows in the layout
+INPUT:
+    const layout_t *layout - pointer on layout structure
+RETURN:
+    index_t - the number of rows
+*/
+index_t GetLayoutRows(const layout_t *layout);
+
+/*  Finds the model line shown in the row
+INPUT:
+    const layout_t *layout - pointer on layout structure
+    index_t row - index of the row, less than the number of rows
+    index_t *line - index of the model line
+    index_t *part - index of the row among the rows of the line
+*/
+void FindLayoutLine(const layout_t *layout, index_t row, index_t *line, index_t *part);
+
+/*  Returns the first row of the model line
+INPUT:
+    const layout_t *layout - pointer on layout structure
+    index_t line - index of the model line
+RETURN:
+    index_t - index of the row
+*/
+index_t GetLayoutRow(const layout_t *layout, index_t line);
+
+/*  Clears the layout
+INPUT:
+    layout_t *layout - pointer on layout structure
+OUTPUT:
+    layout_t *layout - pointer on layout structure filled with zero values
+*/
+void ClearLayout(layout_t *layout);
+
+#endif // __VIEW_LAYOUT_H_INCLUDED